@@ -1,6 +1,7 @@
 #include "GLTFAnimation.hpp"
 
 #include <algorithm>
+#include <cmath>
 
 using namespace nlohmann;
 
@@ -149,6 +150,124 @@ Animation ImportAnimation(
 	return animation;
 }
 
+static float TransformError(const glm::vec3& a, const glm::vec3& b)
+{
+	return glm::length(a - b);
+}
+
+// Angle of the rotation between a and b. Computed from the distance between the quaternions rather than from their
+//  dot product, which is too imprecise near 1 to measure small errors.
+static float TransformError(const glm::quat& a, const glm::quat& b)
+{
+	const glm::vec4 va(a.x, a.y, a.z, a.w);
+	const glm::vec4 vb(b.x, b.y, b.z, b.w);
+	const float distance = std::min(glm::length(va - vb), glm::length(va + vb));
+	return 4 * std::asin(std::min(distance / 2, 1.0f));
+}
+
+template <typename KeyFrameTp>
+static CompressedKeyFrameList<KeyFrameTp> CompressKeyFrames(
+	const KeyFrameList<KeyFrameTp>& keyFrameList, float tolerance, float sampleRate, float& maxError)
+{
+	std::span<const KeyFrameTp> keyFrames = keyFrameList.KeyFrames();
+	if (keyFrames.empty())
+		return {};
+
+	// Cubic splines are resampled to linear key frames, which are then reduced like any other linear track
+	std::vector<KeyFrameTp> samples;
+	if (keyFrameList.Interpolation() == KeyFrameInterpolation::CubicSpline)
+	{
+		const float startTime = keyFrames.front().time;
+		const float duration = keyFrames.back().time - startTime;
+		const size_t numSamples = static_cast<size_t>(std::ceil(duration * sampleRate));
+		for (size_t i = 0; i <= numSamples; i++)
+		{
+			KeyFrameTp& sample = samples.emplace_back();
+			sample.time = i == numSamples ? keyFrames.back().time
+			                              : startTime + static_cast<float>(i) / sampleRate;
+			sample.transform = keyFrameList.GetTransform(sample.time);
+		}
+	}
+	else
+	{
+		samples.assign(keyFrames.begin(), keyFrames.end());
+	}
+
+	const KeyFrameInterpolation interpolation = keyFrameList.Interpolation() == KeyFrameInterpolation::Step
+	                                                ? KeyFrameInterpolation::Step
+	                                                : KeyFrameInterpolation::Linear;
+
+	// Greedily extends each segment for as long as the samples it skips can be interpolated within the tolerance.
+	//  The first and last key frames are always kept so that the length of the animation does not change.
+	std::vector<KeyFrameTp> reduced = { samples.front() };
+	size_t segmentStart = 0;
+	for (size_t i = 1; i + 1 < samples.size(); i++)
+	{
+		const KeyFrameTp& segmentEnd = samples[i + 1];
+		bool canSkip = true;
+		for (size_t j = segmentStart + 1; j <= i && canSkip; j++)
+		{
+			typename KeyFrameTp::TransformTp interpolated;
+			if (interpolation == KeyFrameInterpolation::Step)
+				interpolated = samples[segmentStart].transform;
+			else
+				interpolated = KeyFrameTp::LinearInterpolate(samples[segmentStart], segmentEnd, samples[j].time);
+			canSkip = TransformError(interpolated, samples[j].transform) <= tolerance;
+		}
+
+		if (!canSkip)
+		{
+			reduced.push_back(samples[i]);
+			segmentStart = i;
+		}
+	}
+	if (samples.size() > 1)
+		reduced.push_back(samples.back());
+
+	CompressedKeyFrameList<KeyFrameTp> compressed =
+		CompressedKeyFrameList<KeyFrameTp>::Encode(interpolation, reduced);
+
+	// Measures the error at every source key frame and halfway between them
+	for (size_t i = 0; i < samples.size(); i++)
+	{
+		float t = samples[i].time;
+		maxError = std::max(maxError, TransformError(compressed.GetTransform(t), keyFrameList.GetTransform(t)));
+		if (i + 1 < samples.size())
+		{
+			t = (samples[i].time + samples[i + 1].time) / 2;
+			maxError = std::max(maxError, TransformError(compressed.GetTransform(t), keyFrameList.GetTransform(t)));
+		}
+	}
+
+	return compressed;
+}
+
+Animation CompressAnimation(const Animation& animation, const AnimationCompressionSettings& settings)
+{
+	EG_ASSERT(!animation.IsCompressed());
+
+	Animation result(animation.NumTargets());
+	result.name = animation.name;
+	result.compressionInfo.uncompressedBytes = animation.DataBytes();
+
+	AnimationCompressionInfo& info = result.compressionInfo;
+	for (int target = 0; target < ToInt(animation.NumTargets()); target++)
+	{
+		result.SetCompressedKeyFrames(
+			target,
+			CompressKeyFrames(
+				animation.ScaleKeyFrames(target), settings.scaleTolerance, settings.sampleRate, info.maxScaleError),
+			CompressKeyFrames(
+				animation.RotationKeyFrames(target), settings.rotationTolerance, settings.sampleRate,
+				info.maxRotationError),
+			CompressKeyFrames(
+				animation.TranslationKeyFrames(target), settings.translationTolerance, settings.sampleRate,
+				info.maxTranslationError));
+	}
+
+	return result;
+}
+
 ImportedSkeleton ImportSkeleton(const GLTFData& gltfData, const json& nodesArray, const json& skinEl)
 {
 	ImportedSkeleton result;
@@ -203,6 +322,7 @@ ImportedSkeleton ImportSkeleton(const GLTFData& gltfData, const json& nodesArray
 		result.skeleton.SetBoneParent(i, boneParentIds[i]);
 	}
 
+	result.skeleton.UpdateParentFirstOrder();
 	result.skeleton.InitDualBones();
 
 	// TODO: Set result.skeleton.rootTransform to the skeleton node's transform
@@ -12,6 +12,18 @@ Animation ImportAnimation(
 	const GLTFData& data, const nlohmann::json& animationEl, size_t numTargets,
 	const std::function<std::vector<int>(int)>& getTargetIndicesFromNodeIndex);
 
+struct AnimationCompressionSettings
+{
+	float rotationTolerance = 0.001f; // In radians
+	float translationTolerance = 0.001f;
+	float scaleTolerance = 0.001f;
+	float sampleRate = 60; // Cubic spline tracks are resampled to linear key frames at this rate
+};
+
+// Removes key frames that can be interpolated from their neighbours within the tolerances, then quantizes the
+//  remaining key frames. The maximum error, which includes quantization error, is stored in compressionInfo.
+Animation CompressAnimation(const Animation& animation, const AnimationCompressionSettings& settings);
+
 struct ImportedSkeleton
 {
 	Skeleton skeleton;
@@ -804,6 +804,28 @@ public:
 			}
 
 			std::sort(animations.begin(), animations.end(), AnimationNameCompare());
+
+			// Either a boolean or a map of compression settings, the rotation tolerance is given in degrees
+			const YAML::Node compressionNode = generateContext.YAMLNode()["compressAnimations"];
+			if (compressionNode.IsMap() || compressionNode.as<bool>(false))
+			{
+				AnimationCompressionSettings compressionSettings;
+				if (compressionNode.IsMap())
+				{
+					const float defaultRotationTolerance = glm::degrees(compressionSettings.rotationTolerance);
+					compressionSettings.rotationTolerance =
+						glm::radians(compressionNode["rotationTolerance"].as<float>(defaultRotationTolerance));
+					compressionSettings.translationTolerance =
+						compressionNode["translationTolerance"].as<float>(compressionSettings.translationTolerance);
+					compressionSettings.scaleTolerance =
+						compressionNode["scaleTolerance"].as<float>(compressionSettings.scaleTolerance);
+					compressionSettings.sampleRate =
+						std::max(compressionNode["sampleRate"].as<float>(compressionSettings.sampleRate), 1.0f);
+				}
+
+				for (Animation& animation : animations)
+					animation = CompressAnimation(animation, compressionSettings);
+			}
 		}
 
 		// Applies winding
@@ -10,6 +10,7 @@
 
 #include <algorithm>
 #include <fstream>
+#include <mutex>
 #include <span>
 
 #include <glslang_c_interface.h>
@@ -80,7 +81,8 @@ static std::optional<glslang_stage_t> DeduceShaderStage(std::string_view sourceP
 
 namespace glslang
 {
-bool hasTriedToLoadGlslang = false;
+// Shaders may be generated from several threads at once, so the library is loaded through a once flag
+std::once_flag loadGlslangOnceFlag;
 bool successfullyLoadedGlslang = false;
 eg::DynamicLibrary glslangLibrary;
 eg::DynamicLibrary spirvLibrary;
@@ -110,8 +112,6 @@ decltype(&::glslang_program_SPIRV_get_messages) program_SPIRV_get_messages;
 
 void LoadGlslangLibrary()
 {
-	hasTriedToLoadGlslang = true;
-
 	std::string glslangLibraryName = eg::DynamicLibrary::PlatformFormat("glslang");
 	if (!glslangLibrary.Open(glslangLibraryName.c_str()))
 	{
@@ -242,8 +242,7 @@ public:
 
 	bool Generate(AssetGenerateContext& generateContext) override
 	{
-		if (!glslang::hasTriedToLoadGlslang)
-			glslang::LoadGlslangLibrary();
+		std::call_once(glslang::loadGlslangOnceFlag, &glslang::LoadGlslangLibrary);
 		if (!glslang::successfullyLoadedGlslang)
 			return false;
 
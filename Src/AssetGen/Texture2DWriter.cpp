@@ -4,11 +4,16 @@
 #include "../EGame/Graphics/ImageLoader.hpp"
 #include "../EGame/IOUtils.hpp"
 #include "../EGame/Log.hpp"
+#include "../EGame/SIMD.hpp"
 #include "../EGame/String.hpp"
+#include "../EGame/ThreadPool.hpp"
 
 #include <stb_dxt.h>
 #include <stb_image_resize2.h>
 
+#include <algorithm>
+#include <vector>
+
 namespace eg::asset_gen
 {
 static const std::pair<std::string_view, Format> formatNames[] = {
@@ -60,143 +65,127 @@ void Texture2DWriter::ParseYAMLSettings(const YAML::Node& node)
 	m_useGlobalDownscale = node["useGlobalDownscale"].as<bool>(false);
 }
 
-void Texture2DWriter::ProcessMipLevel(const uint8_t* imageData, int width, int height, int mode)
+static int BytesPerBlock(Format format)
 {
-	const int alpha = m_format == eg::Format::BC3_UNorm;
-
-	int bytesPerBlock;
-	switch (m_format)
-	{
-	case eg::Format::BC1_RGBA_UNorm:
-	case eg::Format::BC4_UNorm:
-		bytesPerBlock = 8;
-		break;
-	case eg::Format::BC3_UNorm:
-	case eg::Format::BC5_UNorm:
-		bytesPerBlock = 16;
-		break;
-	case eg::Format::R8G8B8A8_UNorm:
+	switch (format)
 	{
-		m_data.emplace_back(imageData, width * height * 4);
-		return;
-	}
-	case eg::Format::R8_UNorm:
-	{
-		m_data.emplace_back(imageData, width * height);
-		return;
-	}
+	case Format::BC1_RGBA_UNorm:
+	case Format::BC4_UNorm:
+		return 8;
+	case Format::BC3_UNorm:
+	case Format::BC5_UNorm:
+		return 16;
 	default:
 		EG_PANIC("Unexpected format")
 	}
+}
 
-	int numBlocks = ((width + 3) / 4) * ((height + 3) / 4);
-
-	const size_t outputBytes = numBlocks * bytesPerBlock;
-	std::unique_ptr<uint8_t, FreeDel> outputDataUP(static_cast<uint8_t*>(std::malloc(outputBytes)));
-	uint8_t* outputBuffer = outputDataUP.get();
-
-	switch (m_format)
-	{
-	case eg::Format::BC1_RGBA_UNorm:
-	case eg::Format::BC3_UNorm:
+// Copies the 4x4 block at (x, y) to block, keeping the first blockChannels channels of each pixel.
+//  Pixels outside the image are set to zero.
+static void GatherBlock(
+	const uint8_t* image, int width, int height, int numChannels, int x, int y, uint8_t* block, int blockChannels)
+{
+	for (int by = 0; by < 4; by++)
 	{
-		uint8_t inputBuffer[4][4][4];
-		for (int y = 0; y < height; y += 4)
+		const int ty = y + by;
+		for (int bx = 0; bx < 4; bx++)
 		{
-			for (int x = 0; x < width; x += 4)
-			{
-				// Copies block pixels to the input buffer
-				for (int by = 0; by < 4; by++)
-				{
-					int ty = y + by;
-					for (int bx = 0; bx < 4; bx++)
-					{
-						int tx = x + bx;
-						if (tx >= width || ty >= height)
-						{
-							std::memset(inputBuffer[by][bx], 0, 4);
-						}
-						else
-						{
-							std::copy_n(imageData + (ty * width + tx) * 4, 4, inputBuffer[by][bx]);
-						}
-					}
-				}
-
-				stb_compress_dxt_block(outputBuffer, inputBuffer[0][0], alpha, mode);
-				outputBuffer += bytesPerBlock;
-			}
+			const int tx = x + bx;
+			uint8_t* blockPixel = block + (by * 4 + bx) * blockChannels;
+			if (tx >= width || ty >= height)
+				std::memset(blockPixel, 0, ToUnsigned(blockChannels));
+			else
+				std::copy_n(image + (ty * width + tx) * numChannels, blockChannels, blockPixel);
 		}
-
-		break;
 	}
-	case eg::Format::BC4_UNorm:
-	{
-		uint8_t inputBuffer[4][4];
+}
 
-		for (int y = 0; y < height; y += 4)
-		{
-			for (int x = 0; x < width; x += 4)
-			{
-				// Copies block pixels to the input buffer
-				for (int by = 0; by < 4; by++)
-				{
-					int ty = y + by;
-					for (int bx = 0; bx < 4; bx++)
-					{
-						int tx = x + bx;
-						if (tx >= width || ty >= height)
-							inputBuffer[by][bx] = 0;
-						else
-							inputBuffer[by][bx] = imageData[ty * width + tx];
-					}
-				}
+// Compresses the row of blocks starting at pixel row y
+static void CompressBlockRow(
+	Format format, const uint8_t* image, int width, int height, int y, uint8_t* output, int mode)
+{
+	const int bytesPerBlock = BytesPerBlock(format);
 
-				stb_compress_bc4_block(outputBuffer, inputBuffer[0]);
-				outputBuffer += bytesPerBlock;
-			}
+	uint8_t block[4 * 4 * 4];
+	for (int x = 0; x < width; x += 4)
+	{
+		switch (format)
+		{
+		case Format::BC1_RGBA_UNorm:
+		case Format::BC3_UNorm:
+			GatherBlock(image, width, height, 4, x, y, block, 4);
+			stb_compress_dxt_block(output, block, format == Format::BC3_UNorm, mode);
+			break;
+		case Format::BC4_UNorm:
+			GatherBlock(image, width, height, 1, x, y, block, 1);
+			stb_compress_bc4_block(output, block);
+			break;
+		case Format::BC5_UNorm:
+			GatherBlock(image, width, height, 4, x, y, block, 2);
+			stb_compress_bc5_block(output, block);
+			break;
+		default:
+			EG_PANIC("Unexpected format")
 		}
+		output += bytesPerBlock;
+	}
+}
 
+void Texture2DWriter::AddMipLevels(std::span<const MipLevel> mipLevels, int mode)
+{
+	switch (m_format)
+	{
+	case Format::R8G8B8A8_UNorm:
+	case Format::R8_UNorm:
+	{
+		const int bytesPerPixel = m_format == Format::R8_UNorm ? 1 : 4;
+		for (const MipLevel& mip : mipLevels)
+			m_data.emplace_back(mip.data, ToUnsigned(mip.width * mip.height * bytesPerPixel));
+		return;
+	}
+	case Format::BC1_RGBA_UNorm:
+	case Format::BC3_UNorm:
+	case Format::BC4_UNorm:
+	case Format::BC5_UNorm:
 		break;
+	default:
+		EG_PANIC("Unexpected format")
 	}
-	case eg::Format::BC5_UNorm:
+
+	const size_t bytesPerBlock = ToUnsigned(BytesPerBlock(m_format));
+
+	// Every block row of every mip level is compressed independently, into one buffer for the whole layer
+	std::vector<size_t> firstBlockRow(mipLevels.size() + 1, 0);
+	std::vector<size_t> outputOffsets(mipLevels.size());
+	size_t outputBytes = 0;
+	for (size_t i = 0; i < mipLevels.size(); i++)
 	{
-		uint8_t inputBuffer[4][4][2];
+		const size_t numBlockRows = ToUnsigned((mipLevels[i].height + 3) / 4);
+		outputOffsets[i] = outputBytes;
+		outputBytes += ToUnsigned((mipLevels[i].width + 3) / 4) * numBlockRows * bytesPerBlock;
+		firstBlockRow[i + 1] = firstBlockRow[i] + numBlockRows;
+	}
+
+	std::unique_ptr<uint8_t, FreeDel> outputDataUP(static_cast<uint8_t*>(std::malloc(outputBytes)));
+	uint8_t* output = outputDataUP.get();
 
-		for (int y = 0; y < height; y += 4)
+	SharedThreadPool().ParallelFor(
+		firstBlockRow.back(), 4,
+		[&](size_t begin, size_t end)
 		{
-			for (int x = 0; x < width; x += 4)
+			for (size_t row = begin; row < end; row++)
 			{
-				// Copies block pixels to the input buffer
-				for (int by = 0; by < 4; by++)
-				{
-					int ty = y + by;
-					for (int bx = 0; bx < 4; bx++)
-					{
-						int tx = x + bx;
-						if (tx >= width || ty >= height)
-						{
-							std::memset(inputBuffer[by][bx], 0, 2);
-						}
-						else
-						{
-							std::copy_n(imageData + (ty * width + tx) * 4, 2, inputBuffer[by][bx]);
-						}
-					}
-				}
-
-				stb_compress_bc5_block(outputBuffer, inputBuffer[0][0]);
-				outputBuffer += bytesPerBlock;
+				const size_t mip = ToUnsigned(
+					std::upper_bound(firstBlockRow.begin(), firstBlockRow.end(), row) - firstBlockRow.begin() - 1);
+				const size_t blockY = row - firstBlockRow[mip];
+				const size_t rowBytes = ToUnsigned((mipLevels[mip].width + 3) / 4) * bytesPerBlock;
+				CompressBlockRow(
+					m_format, mipLevels[mip].data, mipLevels[mip].width, mipLevels[mip].height,
+					static_cast<int>(blockY * 4), output + outputOffsets[mip] + blockY * rowBytes, mode);
 			}
-		}
+		});
 
-		break;
-	}
-	default:
-		EG_PANIC("Unexpected format")
-	}
-
-	m_data.emplace_back(outputDataUP.get(), outputBytes);
+	m_data.emplace_back(output, outputBytes);
 	m_freeDelUP.push_back(std::move(outputDataUP));
 }
 
@@ -205,24 +194,93 @@ int NextMipSize(int prevSize)
 	return std::max(prevSize / 2, 1);
 }
 
-template <bool Linear>
-void GenerateNextMip(const uint8_t* src, uint8_t* dest, int width, int height, int numChannels)
+// Lookup tables for sRGB mip generation, giving the same results as converting each value through float
+struct SRGBTables
+{
+	uint8_t toLinear[256];
+	uint8_t toSRGB[256];
+
+	SRGBTables()
+	{
+		for (uint32_t i = 0; i < 256; i++)
+		{
+			toLinear[i] = static_cast<uint8_t>(eg::SRGBToLinear(static_cast<float>(i) / 255.0f) * 255.0f);
+			toSRGB[i] = static_cast<uint8_t>(eg::LinearToSRGB(static_cast<float>(i) / 255.0f) * 255.0f);
+		}
+	}
+};
+
+#ifdef EG_HAS_SIMD
+// Averages 2x2 blocks of a linear image with SSE2, returns the number of destination pixels written
+static int GenerateNextMipRowSSE(
+	const uint8_t* srcRow0, const uint8_t* srcRow1, uint8_t* dest, int nextWidth, int numChannels)
 {
-	int nextWidth = NextMipSize(width);
-	int nextHeight = NextMipSize(height);
+	int x = 0;
+	if (numChannels == 4)
+	{
+		// Two destination pixels from four source pixels in each row
+		const __m128i zero = _mm_setzero_si128();
+		for (; x + 2 <= nextWidth; x += 2)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow0 + x * 8));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow1 + x * 8));
+			const __m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+			const __m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+			const __m128i sum = _mm_add_epi16(_mm_unpacklo_epi64(lo, hi), _mm_unpackhi_epi64(lo, hi));
+			const __m128i avg = _mm_srli_epi16(sum, 2);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dest + x * 4), _mm_packus_epi16(avg, avg));
+		}
+	}
+	else if (numChannels == 1)
+	{
+		// Eight destination pixels from sixteen source pixels in each row, adjacent pixels are split into the low and
+		//  high bytes of 16-bit lanes
+		const __m128i lowMask = _mm_set1_epi16(0xFF);
+		for (; x + 8 <= nextWidth; x += 8)
+		{
+			const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow0 + x * 2));
+			const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(srcRow1 + x * 2));
+			const __m128i sumA = _mm_add_epi16(_mm_and_si128(a, lowMask), _mm_srli_epi16(a, 8));
+			const __m128i sumB = _mm_add_epi16(_mm_and_si128(b, lowMask), _mm_srli_epi16(b, 8));
+			const __m128i avg = _mm_srli_epi16(_mm_add_epi16(sumA, sumB), 2);
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(dest + x), _mm_packus_epi16(avg, avg));
+		}
+	}
+	return x;
+}
+#endif
+
+// Generates the next mip level with a 2x2 box filter, averaging in linear space if srgbTables is set.
+//  Rows of the destination are distributed over the shared thread pool.
+static void GenerateNextMip(
+	const uint8_t* src, uint8_t* dest, int width, int height, int numChannels, const SRGBTables* srgbTables)
+{
+	const int nextWidth = NextMipSize(width);
+	const int nextHeight = NextMipSize(height);
 
 	auto GetSrcPixel = [&](int x, int y, int c)
 	{
 		uint32_t v = src[((y * width) + x) * numChannels + c];
-		if (!Linear && c < 3)
-			v = static_cast<uint32_t>(eg::SRGBToLinear(static_cast<float>(v) / 255.0f) * 255.0f);
+		if (srgbTables != nullptr && c < 3)
+			v = srgbTables->toLinear[v];
 		return v;
 	};
 
-	// For each pixel in the next image, averages the pixels from the previous 2x2 block
-	for (int y = 0; y < nextHeight; y++)
+	auto GenerateRow = [&](int y)
 	{
-		for (int x = 0; x < nextWidth; x++)
+		uint8_t* destRow = dest + y * nextWidth * numChannels;
+
+		int x = 0;
+#ifdef EG_HAS_SIMD
+		// The vector path reads whole 2x2 blocks, which 1 pixel wide or high levels do not have
+		if (srgbTables == nullptr && width >= 2 && height >= 2)
+		{
+			const uint8_t* srcRow0 = src + y * 2 * width * numChannels;
+			x = GenerateNextMipRowSSE(srcRow0, srcRow0 + width * numChannels, destRow, nextWidth, numChannels);
+		}
+#endif
+
+		for (; x < nextWidth; x++)
 		{
 			for (int c = 0; c < numChannels; c++)
 			{
@@ -235,27 +293,51 @@ void GenerateNextMip(const uint8_t* src, uint8_t* dest, int width, int height, i
 					}
 				}
 
-				*dest = static_cast<uint8_t>(sumIntensity / 4);
-				if (!Linear && c < 3)
-					*dest = static_cast<uint8_t>(eg::LinearToSRGB(static_cast<float>(*dest) / 255.0f) * 255.0f);
-				dest++;
+				uint8_t value = static_cast<uint8_t>(sumIntensity / 4);
+				if (srgbTables != nullptr && c < 3)
+					value = srgbTables->toSRGB[value];
+				destRow[x * numChannels + c] = value;
 			}
 		}
-	}
+	};
+
+	const size_t rowsPerTask = ToUnsigned(std::max(16384 / nextWidth, 1));
+	SharedThreadPool().ParallelFor(
+		ToUnsigned(nextHeight), rowsPerTask,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t y = begin; y < end; y++)
+				GenerateRow(static_cast<int>(y));
+		});
+}
+
+int Texture2DWriter::NumInputChannels() const
+{
+	return (m_format == Format::BC4_UNorm || m_format == Format::R8_UNorm) ? 1 : 4;
 }
 
 bool Texture2DWriter::AddLayer(std::istream& imageStream, std::string_view fileName)
+{
+	ImageLoader loader(imageStream);
+
+	std::unique_ptr<uint8_t, FreeDel> data = loader.Load(NumInputChannels());
+	if (!data)
+		return false;
+
+	return AddLayer(std::move(data), loader.Width(), loader.Height(), fileName);
+}
+
+bool Texture2DWriter::AddLayer(
+	std::unique_ptr<uint8_t, FreeDel> pixels, int width, int height, std::string_view fileName)
 {
 	std::string messagePrefix;
 	if (!fileName.empty())
 		messagePrefix = Concat({ "Texture '", fileName, "': " });
 
-	ImageLoader loader(imageStream);
-
 	if (m_width == -1)
-		m_width = loader.Width();
+		m_width = width;
 	if (m_height == -1)
-		m_height = loader.Height();
+		m_height = height;
 
 	if (IsCompressedFormat(m_format) && (m_width % 4 != 0 || m_height % 4 != 0))
 	{
@@ -273,14 +355,9 @@ bool Texture2DWriter::AddLayer(std::istream& imageStream, std::string_view fileN
 			m_numMipLevels = std::max(m_numMipLevels - 2, 1);
 	}
 
-	int loadChannels = 4;
-	if (m_format == Format::BC4_UNorm || m_format == Format::R8_UNorm)
-		loadChannels = 1;
+	const int loadChannels = NumInputChannels();
 
-	// Loads the image
-	std::unique_ptr<uint8_t, FreeDel> firstLayerDataUP = loader.Load(loadChannels);
-	if (!firstLayerDataUP)
-		return false;
+	std::unique_ptr<uint8_t, FreeDel> firstLayerDataUP = std::move(pixels);
 	uint8_t* firstLayerData = firstLayerDataUP.get();
 
 	bool isCompressed = m_format != Format::R8_UNorm && m_format != Format::R8G8B8A8_UNorm;
@@ -290,7 +367,7 @@ bool Texture2DWriter::AddLayer(std::istream& imageStream, std::string_view fileN
 	}
 
 	// Resizes the image if the size doesn't match
-	if (m_width != loader.Width() || m_height != loader.Height())
+	if (m_width != width || m_height != height)
 	{
 		Log(LogLevel::Warning, "as",
 		    "{0}Inconsistent texture array resolution, layer '{1}' will be resized to {2}x{3}.", messagePrefix,
@@ -302,13 +379,13 @@ bool Texture2DWriter::AddLayer(std::istream& imageStream, std::string_view fileN
 		if (m_isSRGB)
 		{
 			stbir_resize_uint8_srgb(
-				firstLayerData, loader.Width(), loader.Height(), 0, newData, m_width, m_height, 0,
+				firstLayerData, width, height, 0, newData, m_width, m_height, 0,
 				static_cast<stbir_pixel_layout>(loadChannels));
 		}
 		else
 		{
 			stbir_resize_uint8_linear(
-				firstLayerData, loader.Width(), loader.Height(), 0, newData, m_width, m_height, 0,
+				firstLayerData, width, height, 0, newData, m_width, m_height, 0,
 				static_cast<stbir_pixel_layout>(loadChannels));
 		}
 
@@ -333,28 +410,27 @@ bool Texture2DWriter::AddLayer(std::istream& imageStream, std::string_view fileN
 	if (m_dxtDither)
 		dxtMode |= STB_DXT_DITHER;
 
-	ProcessMipLevel(firstLayerData, m_width, m_height, dxtMode);
+	static const SRGBTables srgbTables;
+
+	std::vector<MipLevel> mipLevels;
+	mipLevels.reserve(ToUnsigned(m_numMipLevels));
+	mipLevels.push_back({ firstLayerData, m_width, m_height });
 
-	int mipWidth = m_width;
-	int mipHeight = m_height;
-	uint8_t* srcData = firstLayerData;
 	for (int i = 1; i < m_numMipLevels; i++)
 	{
 		// Generates the next mip level
-		if (m_isSRGB)
-			GenerateNextMip<false>(srcData, nextMipData, mipWidth, mipHeight, loadChannels);
-		else
-			GenerateNextMip<true>(srcData, nextMipData, mipWidth, mipHeight, loadChannels);
+		const MipLevel& prevLevel = mipLevels.back();
+		GenerateNextMip(
+			prevLevel.data, nextMipData, prevLevel.width, prevLevel.height, loadChannels,
+			m_isSRGB ? &srgbTables : nullptr);
 
-		mipWidth = NextMipSize(mipWidth);
-		mipHeight = NextMipSize(mipHeight);
-
-		ProcessMipLevel(nextMipData, mipWidth, mipHeight, dxtMode);
-
-		srcData = nextMipData;
-		nextMipData += mipWidth * mipHeight * loadChannels;
+		mipLevels.push_back({ nextMipData, NextMipSize(prevLevel.width), NextMipSize(prevLevel.height) });
+		nextMipData += mipLevels.back().width * mipLevels.back().height * loadChannels;
 	}
 
+	// Compression is done once all levels exist so that small levels can be compressed in parallel with large ones
+	AddMipLevels(mipLevels, dxtMode);
+
 	m_numLayers++;
 
 	return true;
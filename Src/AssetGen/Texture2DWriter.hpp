@@ -5,6 +5,7 @@
 #include "../EGame/Utils.hpp"
 
 #include <cstdint>
+#include <memory>
 #include <span>
 #include <string_view>
 #include <yaml-cpp/yaml.h>
@@ -20,6 +21,12 @@ public:
 
 	bool AddLayer(std::istream& imageStream, std::string_view fileName = {});
 
+	// Adds a layer from decoded pixels, which must have NumInputChannels() channels.
+	bool AddLayer(std::unique_ptr<uint8_t, FreeDel> pixels, int width, int height, std::string_view fileName = {});
+
+	// Number of channels that layer pixels are expected to have for the current format.
+	int NumInputChannels() const;
+
 	[[nodiscard]] bool Write(std::ostream& stream) const;
 
 	void SetIsArrayTexture(bool isArrayTexture) { m_isArrayTexture = isArrayTexture; }
@@ -29,7 +36,15 @@ public:
 	void SetIs3D(bool is3D) { m_is3D = is3D; }
 
 private:
-	void ProcessMipLevel(const uint8_t* imageData, int width, int height, int mode);
+	struct MipLevel
+	{
+		const uint8_t* data;
+		int width;
+		int height;
+	};
+
+	// Adds the mip levels of a layer to the output, compressing them if the format is compressed.
+	void AddMipLevels(std::span<const MipLevel> mipLevels, int mode);
 
 	Format m_format = Format::R8G8B8A8_UNorm;
 	bool m_isSRGB = false;
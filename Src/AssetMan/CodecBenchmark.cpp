@@ -0,0 +1,79 @@
+#include "CodecBenchmark.hpp"
+#include "ANSIColors.hpp"
+
+#include "../EGame/Compression.hpp"
+#include "../EGame/Utils.hpp"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+// Decompression is repeated until at least this much time has passed to get stable timings
+static constexpr int64_t MIN_DECODE_TIME = 200000000;
+
+void WriteCodecBenchmark(std::span<const eg::EAPAsset> assets)
+{
+	uint64_t totalBytes = 0;
+	for (const eg::EAPAsset& asset : assets)
+		totalBytes += asset.generatedAssetData.size();
+
+	std::cout << "codec benchmark over " << assets.size() << " assets (" << eg::ReadableBytesSize(totalBytes)
+			  << "):" << std::endl;
+
+	std::vector<char> outputBuffer;
+	for (uint32_t c = 1; c <= static_cast<uint32_t>(eg::MAX_COMPRESSION_CODEC); c++)
+	{
+		const eg::CompressionCodec codec = static_cast<eg::CompressionCodec>(c);
+		if (!eg::IsCompressionCodecSupported(codec))
+		{
+			std::cout << ANSI_COLOR_YELLOW << eg::CompressionCodecName(codec) << ANSI_COLOR_RESET
+					  << " not supported by this build" << std::endl;
+			continue;
+		}
+
+		std::vector<std::vector<char>> compressed(assets.size());
+		uint64_t compressedBytes = 0;
+		const int64_t encodeBegin = eg::NanoTime();
+		for (size_t i = 0; i < assets.size(); i++)
+		{
+			compressed[i] =
+				eg::Compress(codec, assets[i].generatedAssetData.data(), assets[i].generatedAssetData.size());
+			compressedBytes += compressed[i].size();
+		}
+		const int64_t encodeTime = eg::NanoTime() - encodeBegin;
+
+		bool ok = true;
+		uint32_t decodeIterations = 0;
+		const int64_t decodeBegin = eg::NanoTime();
+		int64_t decodeTime = 0;
+		while (ok && decodeTime < MIN_DECODE_TIME)
+		{
+			for (size_t i = 0; i < assets.size() && ok; i++)
+			{
+				outputBuffer.resize(assets[i].generatedAssetData.size());
+				ok = eg::Decompress(
+					codec, compressed[i].data(), compressed[i].size(), outputBuffer.data(), outputBuffer.size());
+			}
+			decodeIterations++;
+			decodeTime = eg::NanoTime() - decodeBegin;
+		}
+
+		if (!ok)
+		{
+			std::cout << ANSI_COLOR_RED << eg::CompressionCodecName(codec) << ANSI_COLOR_RESET
+					  << " failed to decompress its own output" << std::endl;
+			continue;
+		}
+
+		const double ratio = static_cast<double>(totalBytes) / static_cast<double>(std::max<uint64_t>(compressedBytes, 1));
+		const double encodeMBs = static_cast<double>(totalBytes) / std::max(static_cast<double>(encodeTime), 1.0) * 1E3;
+		const double decodeGBs =
+			static_cast<double>(totalBytes) * decodeIterations / std::max(static_cast<double>(decodeTime), 1.0);
+
+		std::cout << ANSI_COLOR_GREEN << std::left << std::setw(5) << eg::CompressionCodecName(codec)
+				  << ANSI_COLOR_RESET << std::right << std::fixed << std::setprecision(2) << " ratio: " << ratio
+				  << " size: " << eg::ReadableBytesSize(compressedBytes) << " encode: " << encodeMBs << "MB/s"
+				  << " decode: " << decodeGBs << "GB/s" << std::endl;
+	}
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <span>
+
+#include "../EGame/Assets/EAPFile.hpp"
+
+// Recompresses all assets with every supported codec and prints ratio, encode and decode throughput.
+void WriteCodecBenchmark(std::span<const eg::EAPAsset> assets);
@@ -2,6 +2,7 @@
 #include "ANSIColors.hpp"
 
 #include "../EGame/Assets/AssetLoad.hpp"
+#include "../EGame/Assets/ModelAsset.hpp"
 #include "../EGame/Assets/Texture2DLoader.hpp"
 #include "../EGame/Utils.hpp"
 
@@ -19,12 +20,13 @@ void WriteListOutput(std::span<const eg::EAPAsset> assets)
 		std::cout << " " << asset.loaderName << " " << asset.format.version << ":" << std::hex << asset.format.nameHash
 				  << std::dec << " " << eg::ReadableBytesSize(asset.generatedAssetData.size());
 
-		if (asset.compress)
+		if (asset.codec != eg::CompressionCodec::None)
 		{
 			int compressionRatio = std::round(
 				100 *
 				(1 - static_cast<double>(asset.compressedSize) / static_cast<double>(asset.generatedAssetData.size())));
-			std::cout << " (comp: " << eg::ReadableBytesSize(asset.compressedSize) << " " << compressionRatio << "%)";
+			std::cout << " (" << eg::CompressionCodecName(asset.codec) << ": "
+					  << eg::ReadableBytesSize(asset.compressedSize) << " " << compressionRatio << "%)";
 		}
 		std::cout << std::endl;
 
@@ -32,3 +34,20 @@ void WriteListOutput(std::span<const eg::EAPAsset> assets)
 			eg::Texture2DLoaderPrintInfo(asset.generatedAssetData, std::cout);
 	}
 }
+
+void WriteAnimationInfoOutput(std::span<const eg::EAPAsset> assets)
+{
+	std::cout << "animation info:" << std::endl;
+
+	for (const eg::EAPAsset& asset : assets)
+	{
+		if (asset.loaderName != "Model")
+			continue;
+
+		std::cout << ANSI_COLOR_GREEN << asset.assetName << ANSI_COLOR_RESET << std::endl;
+		if (asset.format == eg::ModelAssetFormat)
+			eg::ModelAssetPrintAnimationInfo(asset.generatedAssetData, std::cout);
+		else
+			std::cout << " unsupported format version " << asset.format.version << std::endl;
+	}
+}
@@ -6,3 +6,6 @@
 
 void WriteListOutput(std::span<const eg::EAPAsset> assets);
 void WriteInfoOutput(std::span<const eg::EAPAsset> assets);
+
+// Lists the animations in model assets with their memory usage, and the savings and error of compressed animations.
+void WriteAnimationInfoOutput(std::span<const eg::EAPAsset> assets);
@@ -3,6 +3,7 @@
 
 #include "../EGame/Alloc/LinearAllocator.hpp"
 #include "../EGame/Assets/EAPFile.hpp"
+#include "CodecBenchmark.hpp"
 #include "InfoOutput.hpp"
 #include "ParseArguments.hpp"
 
@@ -48,6 +49,18 @@ int main(int argc, char** argv)
 		operationPerformed = true;
 	}
 
+	if (parsedArguments.benchmarkCodecs)
+	{
+		WriteCodecBenchmark(*readResult);
+		operationPerformed = true;
+	}
+
+	if (parsedArguments.writeAnimationInfo)
+	{
+		WriteAnimationInfoOutput(*readResult);
+		operationPerformed = true;
+	}
+
 	if (parsedArguments.removeByName.empty())
 	{
 		if (!operationPerformed)
@@ -20,6 +20,8 @@ ParsedArguments ParseArguments(int argc, char** argv)
 	argumentHandlers["i"] = [&]() { parsed.writeInfo = true; };
 	argumentHandlers["l"] = [&]() { parsed.writeList = true; };
 	argumentHandlers["d"] = [&]() { parsed.dryRun = true; };
+	argumentHandlers["b"] = [&]() { parsed.benchmarkCodecs = true; };
+	argumentHandlers["a"] = [&]() { parsed.writeAnimationInfo = true; };
 
 	for (int i = 1; i < argc; i++)
 	{
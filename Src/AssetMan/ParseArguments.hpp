@@ -11,6 +11,8 @@ struct ParsedArguments
 	bool writeInfo = false;
 	bool writeList = false;
 	bool dryRun = false;
+	bool benchmarkCodecs = false;
+	bool writeAnimationInfo = false;
 
 	std::vector<std::string_view> removeByName;
 };
@@ -0,0 +1,7 @@
+#pragma once
+
+// Generates mip chains and compresses a procedural texture in every supported format, prints MPixels/s per format.
+void RunTextureBenchmark();
+
+// Adds 100k instances to MeshBatch in every mode and prints the time spent per add.
+void RunMeshBatchBenchmark();
@@ -0,0 +1,43 @@
+#include "Benchmarks.hpp"
+
+#include <iostream>
+#include <string_view>
+
+struct Benchmark
+{
+	std::string_view name;
+	void (*run)();
+};
+
+static const Benchmark benchmarks[] = {
+	{ "texture", &RunTextureBenchmark },
+	{ "meshbatch", &RunMeshBatchBenchmark },
+};
+
+// Runs the benchmarks named on the command line, or all of them if none are given
+int main(int argc, char** argv)
+{
+	bool anyRun = false;
+	for (const Benchmark& benchmark : benchmarks)
+	{
+		bool selected = argc <= 1;
+		for (int i = 1; i < argc; i++)
+			selected |= benchmark.name == argv[i];
+		if (!selected)
+			continue;
+
+		std::cout << "== " << benchmark.name << " ==" << std::endl;
+		benchmark.run();
+		anyRun = true;
+	}
+
+	if (!anyRun)
+	{
+		std::cout << "unknown benchmark, available:";
+		for (const Benchmark& benchmark : benchmarks)
+			std::cout << " " << benchmark.name;
+		std::cout << std::endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,138 @@
+#include "../EGame/Graphics/AbstractionHL.hpp"
+#include "../EGame/Graphics/MeshBatch.hpp"
+#include "../EGame/ThreadPool.hpp"
+#include "../EGame/Utils.hpp"
+#include "Benchmarks.hpp"
+
+#include <glm/glm.hpp>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+static constexpr uint32_t NUM_ADDS = 100000;
+static constexpr uint32_t NUM_PIPELINES = 16;
+static constexpr uint32_t NUM_MATERIALS = 400;
+static constexpr uint32_t NUM_MODELS = 64;
+static constexpr uint32_t MESHES_PER_MODEL = 8;
+static constexpr int NUM_ITERATIONS = 20;
+static constexpr uint32_t ADDS_PER_CONTEXT = 4096;
+
+static void PrintResult(const char* label, int64_t time)
+{
+	std::cout << std::left << std::setw(18) << label << std::right << std::fixed << std::setprecision(2) << " "
+			  << (static_cast<double>(time) * 1E-6) << "ms (" << (static_cast<double>(time) / NUM_ADDS)
+			  << "ns per add, including End)" << std::endl;
+}
+
+// Material that is only added, never bound
+class BenchmarkMaterial : public eg::IMaterial
+{
+public:
+	explicit BenchmarkMaterial(size_t pipelineHash) : m_pipelineHash(pipelineHash) {}
+
+	size_t PipelineHash() const override { return m_pipelineHash; }
+	bool BindPipeline(eg::CommandContext& cmdCtx, void* drawArgs) const override { return true; }
+	bool BindMaterial(eg::CommandContext& cmdCtx, void* drawArgs) const override { return true; }
+
+private:
+	size_t m_pipelineHash;
+};
+
+void RunMeshBatchBenchmark()
+{
+	std::vector<std::unique_ptr<BenchmarkMaterial>> materials;
+	for (uint32_t i = 0; i < NUM_MATERIALS; i++)
+		materials.push_back(std::make_unique<BenchmarkMaterial>(i % NUM_PIPELINES));
+
+	// End uploads the instance data, which runs on the null backend so that its time is included. This matters since
+	//  sort key batches do their sorting in End while bucket batches do that work in Add.
+	if (!eg::InitializeGraphicsAPI(eg::GraphicsAPI::Null, eg::GraphicsAPIInitArguments{}))
+	{
+		std::cout << "failed to initialize the null graphics backend" << std::endl;
+		return;
+	}
+
+	// The buffer handles are never dereferenced since the batches are ended but not drawn
+	std::vector<eg::MeshBatch::Mesh> meshes;
+	for (uintptr_t model = 1; model <= NUM_MODELS; model++)
+	{
+		for (uint32_t mesh = 0; mesh < MESHES_PER_MODEL; mesh++)
+		{
+			eg::MeshBatch::Mesh& batchMesh = meshes.emplace_back();
+			batchMesh.vertexBuffer = eg::BufferRef(reinterpret_cast<eg::BufferHandle>(model * 16));
+			batchMesh.indexBuffer = eg::BufferRef(reinterpret_cast<eg::BufferHandle>(model * 16 + 8));
+			batchMesh.firstIndex = mesh * 300;
+			batchMesh.firstVertex = mesh * 100;
+			batchMesh.numElements = 300;
+			batchMesh.indexType = eg::IndexType::UInt16;
+		}
+	}
+
+	// Pseudo random instances, where runs of a few instances share material and mesh as when adding models
+	struct Add
+	{
+		uint32_t material;
+		uint32_t mesh;
+	};
+	std::vector<Add> adds(NUM_ADDS);
+	uint32_t randomState = 1;
+	for (uint32_t i = 0; i < NUM_ADDS; i++)
+	{
+		randomState = randomState * 1664525U + 1013904223U;
+		if (i % 4 == 0)
+			adds[i] = { (randomState >> 8) % NUM_MATERIALS, (randomState >> 16) % (NUM_MODELS * MESHES_PER_MODEL) };
+		else
+			adds[i] = adds[i - 1];
+	}
+
+	std::cout << NUM_ADDS << " adds, " << NUM_MATERIALS << " materials, " << meshes.size() << " meshes:" << std::endl;
+
+	for (eg::MeshBatchMode mode : { eg::MeshBatchMode::Buckets, eg::MeshBatchMode::SortKeys })
+	{
+		eg::MeshBatch meshBatch(mode);
+
+		int64_t bestTime = INT64_MAX;
+		for (int iteration = 0; iteration < NUM_ITERATIONS; iteration++)
+		{
+			const int64_t beginTime = eg::NanoTime();
+			meshBatch.Begin();
+			for (const Add& add : adds)
+			{
+				meshBatch.Add(meshes[add.mesh], *materials[add.material], glm::mat4(1.0f));
+			}
+			meshBatch.End(eg::DC);
+			bestTime = std::min(bestTime, eg::NanoTime() - beginTime);
+			eg::MarkUploadBuffersAvailable();
+		}
+
+		PrintResult(mode == eg::MeshBatchMode::Buckets ? "buckets" : "sortkeys", bestTime);
+
+		// Adds through recording contexts on the shared pool, End includes merging the contexts
+		const uint32_t numContexts = (NUM_ADDS + ADDS_PER_CONTEXT - 1) / ADDS_PER_CONTEXT;
+		bestTime = INT64_MAX;
+		for (int iteration = 0; iteration < NUM_ITERATIONS; iteration++)
+		{
+			const int64_t beginTime = eg::NanoTime();
+			meshBatch.Begin(numContexts);
+			eg::SharedThreadPool().ParallelFor(
+				NUM_ADDS, ADDS_PER_CONTEXT,
+				[&](size_t begin, size_t end)
+				{
+					eg::MeshBatch::RecordingContext& context =
+						meshBatch.GetRecordingContext(static_cast<uint32_t>(begin / ADDS_PER_CONTEXT));
+					for (size_t i = begin; i < end; i++)
+					{
+						context.Add(meshes[adds[i].mesh], *materials[adds[i].material], glm::mat4(1.0f));
+					}
+				});
+			meshBatch.End(eg::DC);
+			bestTime = std::min(bestTime, eg::NanoTime() - beginTime);
+			eg::MarkUploadBuffersAvailable();
+		}
+		PrintResult(mode == eg::MeshBatchMode::Buckets ? "buckets, threaded" : "sortkeys, threaded", bestTime);
+	}
+
+	eg::DestroyUploadBuffers();
+	eg::DestroyGraphicsAPI();
+}
@@ -0,0 +1,102 @@
+#include "../AssetGen/Texture2DWriter.hpp"
+#include "../EGame/ThreadPool.hpp"
+#include "../EGame/Utils.hpp"
+#include "Benchmarks.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+static constexpr int TEXTURE_SIZE = 2048;
+
+// Each format is encoded repeatedly until at least this much time has passed
+static constexpr int64_t MIN_ENCODE_TIME = 500000000;
+
+// Smooth gradients with some noise, so that block compression has to do realistic work
+static std::vector<uint8_t> GenerateImage(int size)
+{
+	std::vector<uint8_t> pixels(static_cast<size_t>(size) * static_cast<size_t>(size) * 4);
+	uint32_t noiseState = 1;
+	for (int y = 0; y < size; y++)
+	{
+		for (int x = 0; x < size; x++)
+		{
+			noiseState = noiseState * 1664525U + 1013904223U;
+			const float noise = static_cast<float>(noiseState >> 24) / 255.0f;
+			const float fx = static_cast<float>(x) / static_cast<float>(size);
+			const float fy = static_cast<float>(y) / static_cast<float>(size);
+
+			const float values[4] = { 0.5f + 0.4f * std::sin(fx * 20.0f) + 0.1f * noise,
+				                      0.5f + 0.4f * std::cos(fy * 13.0f) + 0.1f * noise, fx * fy,
+				                      0.75f + 0.25f * std::sin((fx + fy) * 7.0f) };
+
+			uint8_t* pixel = &pixels[(static_cast<size_t>(y) * static_cast<size_t>(size) + static_cast<size_t>(x)) * 4];
+			for (int c = 0; c < 4; c++)
+				pixel[c] = static_cast<uint8_t>(std::clamp(values[c], 0.0f, 1.0f) * 255.0f);
+		}
+	}
+	return pixels;
+}
+
+void RunTextureBenchmark()
+{
+	const std::vector<uint8_t> image = GenerateImage(TEXTURE_SIZE);
+
+	std::cout << TEXTURE_SIZE << "x" << TEXTURE_SIZE << " texture with full mip chain, "
+			  << eg::SharedThreadPool().NumWorkers() << " workers:" << std::endl;
+
+	for (std::string_view format : { "r8", "rgba8", "bc1", "bc3", "bc4", "bc5" })
+	{
+		for (bool srgb : { false, true })
+		{
+			if (srgb && (format == "r8" || format == "bc4" || format == "bc5"))
+				continue;
+
+			std::ostringstream settingsStream;
+			settingsStream << "format: " << format << "\nsrgb: " << (srgb ? "true" : "false");
+			const YAML::Node settings = YAML::Load(settingsStream.str());
+
+			uint32_t iterations = 0;
+			size_t outputBytes = 0;
+			const int64_t beginTime = eg::NanoTime();
+			int64_t elapsed = 0;
+			while (elapsed < MIN_ENCODE_TIME)
+			{
+				eg::asset_gen::Texture2DWriter writer;
+				writer.ParseYAMLSettings(settings);
+
+				// The writer takes ownership of the pixels, so the source channels are copied into a new allocation
+				const size_t numChannels = static_cast<size_t>(writer.NumInputChannels());
+				const size_t numPixels = static_cast<size_t>(TEXTURE_SIZE) * static_cast<size_t>(TEXTURE_SIZE);
+				std::unique_ptr<uint8_t, eg::FreeDel> pixels(
+					static_cast<uint8_t*>(std::malloc(numPixels * numChannels)));
+				for (size_t i = 0; i < numPixels; i++)
+					std::memcpy(pixels.get() + i * numChannels, &image[i * 4], numChannels);
+
+				std::ostringstream outputStream;
+				if (!writer.AddLayer(std::move(pixels), TEXTURE_SIZE, TEXTURE_SIZE) || !writer.Write(outputStream))
+				{
+					std::cout << format << " failed to encode" << std::endl;
+					return;
+				}
+
+				outputBytes = outputStream.view().size();
+				iterations++;
+				elapsed = eg::NanoTime() - beginTime;
+			}
+
+			const double megaPixels = static_cast<double>(TEXTURE_SIZE) * TEXTURE_SIZE * iterations * 1E-6;
+			const double seconds = static_cast<double>(elapsed) * 1E-9;
+
+			std::cout << std::left << std::setw(11) << (std::string(format) + (srgb ? " (srgb)" : "")) << std::right
+					  << std::fixed << std::setprecision(2) << " " << std::setw(8) << (megaPixels / seconds)
+					  << " MPixels/s, " << (seconds * 1E3 / iterations) << "ms per texture, output "
+					  << eg::ReadableBytesSize(outputBytes) << std::endl;
+		}
+	}
+}
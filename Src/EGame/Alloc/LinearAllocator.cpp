@@ -54,6 +54,14 @@ void LinearAllocator::Reset()
 		pool->pos = 0;
 }
 
+size_t LinearAllocator::BytesReserved() const
+{
+	size_t bytes = 0;
+	for (Pool* pool = m_firstPool; pool != nullptr; pool = pool->next)
+		bytes += pool->size;
+	return bytes;
+}
+
 LinearAllocator::Pool* LinearAllocator::AllocatePool(size_t size)
 {
 	size_t dataBeginOffset = RoundToNextMultiple(sizeof(Pool), alignof(std::max_align_t));
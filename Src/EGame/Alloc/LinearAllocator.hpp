@@ -53,6 +53,9 @@ public:
 
 	void Reset();
 
+	// Returns the total size of all pools owned by the allocator
+	size_t BytesReserved() const;
+
 	static constexpr size_t STD_POOL_SIZE = 16 * 1024 * 1024; // 16 MiB
 
 	bool disableMultiPoolWarning = false;
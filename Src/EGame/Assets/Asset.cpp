@@ -1,20 +1,26 @@
 #include "Asset.hpp"
+#include "../Alloc/ObjectPool.hpp"
 #include "../Compression.hpp"
 #include "../Console.hpp"
 #include "../IOUtils.hpp"
 #include "../Platform/DynamicLibrary.hpp"
 #include "../Platform/FileSystem.hpp"
+#include "../Platform/MemoryMappedFile.hpp"
+#include "../ThreadPool.hpp"
+#include "AssetCache.hpp"
 #include "AssetGenerator.hpp"
 #include "AssetLoad.hpp"
+#include "AssetLoadAsync.hpp"
 #include "EAPFile.hpp"
 #include "WebAssetDownload.hpp"
-#include "YAMLUtils.hpp"
 
 #include <algorithm>
-#include <ctime>
+#include <atomic>
+#include <condition_variable>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
+#include <mutex>
 #include <queue>
 #include <regex>
 #include <span>
@@ -24,13 +30,16 @@
 namespace eg
 {
 LinearAllocator detail::assetAllocator;
+LinearAllocator* detail::currentAssetAllocator = &detail::assetAllocator;
 
 bool detail::createAssetPackage;
 bool detail::disableAssetPackageCompression;
+std::atomic<uint64_t> detail::assetsUnloadCounter;
 
 struct AssetDirectory
 {
-	std::string_view name;
+	std::string name;
+	std::string fullPath;
 	Asset* firstAsset = nullptr;
 	AssetDirectory* firstChildDir = nullptr;
 	AssetDirectory* nextSiblingDir = nullptr;
@@ -38,6 +47,53 @@ struct AssetDirectory
 
 static AssetDirectory assetRootDir;
 
+// Directories may be shared between mounts, so they are freed by UnloadAssets once they no longer contain anything
+static ObjectPool<AssetDirectory> assetDirectoryPool;
+
+// Assets loaded at the same mount path share an allocator, so that they can be freed together by UnloadAssets
+struct AssetMount
+{
+	std::string path;
+	AssetDirectory* directory = nullptr;
+	LinearAllocator allocator{ 1024 * 1024 };
+
+	// In load order, so that assets can be destroyed before the assets they depend on
+	std::vector<Asset*> assets;
+};
+
+static std::vector<std::unique_ptr<AssetMount>> assetMounts;
+
+// Every loaded asset in load order, across all mounts
+static std::vector<Asset*> assetLoadOrder;
+
+// Allows looking up paths in assetsByPath by string_view without allocating
+struct AssetPathHash
+{
+	using is_transparent = void;
+	size_t operator()(std::string_view path) const { return std::hash<std::string_view>()(path); }
+};
+
+// Index of all loaded assets by canonical path, and by the 32-bit FNV-1a hash of the canonical path (as computed by
+//  CTStringHash). Hashes shared by several assets map to nullptr so that hash lookups never return the wrong asset.
+// Each path maps to every loaded asset with that path in load order. The last one is the one that is found by lookups,
+//  the others are shadowed and become visible again if the mount that shadows them is unloaded.
+static std::unordered_map<std::string, std::vector<Asset*>, AssetPathHash, std::equal_to<>> assetsByPath;
+static std::unordered_map<uint32_t, Asset*> assetsByPathHash;
+
+static void AddAssetPathHash(uint32_t pathHash, Asset* asset, std::string_view canonicalPath, bool logCollision)
+{
+	auto [hashIt, hashInserted] = assetsByPathHash.emplace(pathHash, asset);
+	if (!hashInserted && hashIt->second != nullptr)
+	{
+		if (logCollision)
+		{
+			Log(LogLevel::Warning, "as", "Asset path hash collision involving '{0}', it must be looked up by string",
+			    canonicalPath);
+		}
+		hashIt->second = nullptr;
+	}
+}
+
 static AssetDirectory* FindDirectory(AssetDirectory* current, std::string_view path, bool create)
 {
 	if (path.empty())
@@ -68,12 +124,12 @@ static AssetDirectory* FindDirectory(AssetDirectory* current, std::string_view p
 	if (!create)
 		return nullptr;
 
-	AssetDirectory* newDir = detail::assetAllocator.New<AssetDirectory>();
-
-	// Initializes the name of the new directory
-	char* nameBuffer = reinterpret_cast<char*>(detail::assetAllocator.Allocate(entryName.size()));
-	std::memcpy(nameBuffer, entryName.data(), entryName.size());
-	newDir->name = std::string_view(nameBuffer, entryName.size());
+	AssetDirectory* newDir = assetDirectoryPool.New();
+	newDir->name = entryName;
+	if (current->fullPath.empty())
+		newDir->fullPath = newDir->name;
+	else
+		newDir->fullPath = Concat({ current->fullPath, "/", newDir->name });
 
 	// Adds the new directory to the linked list
 	newDir->nextSiblingDir = current->firstChildDir;
@@ -82,6 +138,64 @@ static AssetDirectory* FindDirectory(AssetDirectory* current, std::string_view p
 	return FindDirectory(newDir, remPath, create);
 }
 
+static AssetMount& GetAssetMount(std::string_view mountPath)
+{
+	std::string path = CanonicalPath(mountPath);
+	for (const std::unique_ptr<AssetMount>& mount : assetMounts)
+	{
+		if (mount->path == path)
+			return *mount;
+	}
+
+	AssetMount& mount = *assetMounts.emplace_back(std::make_unique<AssetMount>());
+	mount.directory = FindDirectory(&assetRootDir, path, true);
+	mount.path = std::move(path);
+	mount.allocator.disableMultiPoolWarning = true;
+	return mount;
+}
+
+// Adds an asset to the directory tree and the lookup index, name is relative to the mount directory.
+static void AddAsset(Asset* asset, AssetMount& mount, std::string_view name)
+{
+	asset->fullName = mount.allocator.MakeStringCopy(name);
+	asset->name = BaseName(asset->fullName);
+
+	AssetDirectory* directory = FindDirectory(mount.directory, ParentPath(name), true);
+	asset->next = directory->firstAsset;
+	directory->firstAsset = asset;
+	mount.assets.push_back(asset);
+	assetLoadOrder.push_back(asset);
+
+	const std::string canonicalPath = CanonicalPath(Concat({ directory->fullPath, "/", asset->name }));
+	const uint32_t pathHash = CTStringHash(canonicalPath).hash;
+	std::vector<Asset*>& pathAssets = assetsByPath[canonicalPath];
+	pathAssets.push_back(asset);
+	if (pathAssets.size() > 1)
+	{
+		// The same path was loaded again, the new asset shadows the old one until the new one is unloaded
+		Log(LogLevel::Warning, "as", "Asset '{0}' was loaded more than once", canonicalPath);
+		if (Asset*& hashEntry = assetsByPathHash[pathHash]; hashEntry != nullptr)
+			hashEntry = asset;
+		return;
+	}
+
+	AddAssetPathHash(pathHash, asset, canonicalPath, true);
+}
+
+// Loads an asset with the mount's allocator and adds it to the mount, returns nullptr if loading failed
+static Asset* LoadAssetIntoMount(
+	AssetMount& mount, const AssetLoader& loader, std::string_view name, std::span<const char> data,
+	std::shared_ptr<void> preparedData)
+{
+	detail::currentAssetAllocator = &mount.allocator;
+	Asset* asset = LoadAsset(loader, name, data, nullptr, std::move(preparedData));
+	detail::currentAssetAllocator = &detail::assetAllocator;
+
+	if (asset != nullptr)
+		AddAsset(asset, mount, name);
+	return asset;
+}
+
 struct BoundAssetExtension
 {
 	std::string_view extension;
@@ -109,85 +223,6 @@ void BindAssetExtension(std::string_view extension, std::string_view loader, std
 	it->generator = detail::assetAllocator.MakeStringCopy(generator);
 }
 
-static const char cachedAssetMagic[] = { -1, 'E', 'A', 'C' };
-
-static void SaveAssetToCache(const GeneratedAsset& asset, uint64_t yamlParamsHash, const std::string& cachePath)
-{
-	eg::CreateDirectories(ParentPath(cachePath, false));
-
-	std::ofstream stream(cachePath, std::ios::binary);
-
-	stream.write(cachedAssetMagic, sizeof(cachedAssetMagic));
-	BinWrite(stream, yamlParamsHash);
-	BinWrite(stream, asset.format.nameHash);
-	BinWrite(stream, asset.format.version);
-	BinWrite(stream, static_cast<uint32_t>(asset.flags));
-	BinWrite(stream, static_cast<uint64_t>(time(nullptr)));
-
-	BinWrite(stream, UnsignedNarrow<uint32_t>(asset.fileDependencies.size()));
-	for (const std::string& dep : asset.fileDependencies)
-		BinWriteString(stream, dep);
-
-	BinWrite(stream, UnsignedNarrow<uint32_t>(asset.loadDependencies.size()));
-	for (const std::string& dep : asset.loadDependencies)
-		BinWriteString(stream, dep);
-
-	BinWrite(stream, UnsignedNarrow<uint32_t>(asset.data.size()));
-	stream.write(asset.data.data(), asset.data.size());
-}
-
-static std::optional<GeneratedAsset> TryReadAssetFromCache(
-	const std::string& currentDirPath, const AssetFormat& expectedFormat, uint64_t expectedYamlHash,
-	const std::string& cachePath)
-{
-	std::ifstream stream(cachePath, std::ios::binary);
-	if (!stream)
-		return {};
-
-	char magic[sizeof(cachedAssetMagic)];
-	stream.read(magic, sizeof(magic));
-	if (std::memcmp(cachedAssetMagic, magic, sizeof(magic)) != 0)
-		return {};
-
-	uint64_t yamlHash = BinRead<uint64_t>(stream);
-	if (yamlHash != expectedYamlHash && yamlHash != 0)
-		return {};
-
-	GeneratedAsset asset;
-
-	asset.format.nameHash = BinRead<uint32_t>(stream);
-	asset.format.version = BinRead<uint32_t>(stream);
-	if (asset.format.nameHash != expectedFormat.nameHash || asset.format.version != expectedFormat.version)
-		return {};
-
-	asset.flags = static_cast<AssetFlags>(BinRead<uint32_t>(stream));
-	const auto generateTime = std::chrono::system_clock::from_time_t(BinRead<uint64_t>(stream));
-
-	const uint32_t numFileDependencies = BinRead<uint32_t>(stream);
-	asset.fileDependencies.reserve(numFileDependencies);
-	for (uint32_t i = 0; i < numFileDependencies; i++)
-	{
-		std::string dependency = BinReadString(stream);
-		std::string dependencyFullPath = currentDirPath + dependency;
-		if (LastWriteTime(dependencyFullPath.c_str()) > generateTime)
-			return {};
-		asset.fileDependencies.push_back(std::move(dependency));
-	}
-
-	const uint32_t numLoadDependencies = BinRead<uint32_t>(stream);
-	asset.loadDependencies.reserve(numLoadDependencies);
-	for (uint32_t i = 0; i < numLoadDependencies; i++)
-	{
-		asset.loadDependencies.push_back(BinReadString(stream));
-	}
-
-	const uint32_t dataSize = BinRead<uint32_t>(stream);
-	asset.data.resize(dataSize);
-	stream.read(asset.data.data(), dataSize);
-
-	return asset;
-}
-
 struct AssetToLoad
 {
 	enum State
@@ -202,13 +237,39 @@ struct AssetToLoad
 	std::string name;
 	GeneratedAsset generatedAsset;
 	const AssetLoader* loader = nullptr;
+	CompressionCodec eapCodec = CompressionCodec::Zlib;
+
+	// Inputs for the generation task
+	std::string generatorName;
+	YAML::Node yamlNode;
+
+	// Written by the generation task, guarded by AssetGenerationQueue::mutex
+	bool generated = false;
+	bool generateOk = false;
+};
+
+// Tracks asset generation tasks running on the shared thread pool
+struct AssetGenerationQueue
+{
+	std::mutex mutex;
+	std::condition_variable assetGeneratedSignal;
+	size_t numGenerated = 0;
+
+	// Blocks until the asset has been generated (or read from the cache), returns whether that succeeded
+	bool WaitGenerated(const AssetToLoad& assetToLoad)
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		assetGeneratedSignal.wait(lock, [&] { return assetToLoad.generated; });
+		return assetToLoad.generateOk;
+	}
 };
 
 // Generates and loads an asset recursively so that all it's load-time dependencies are satisfied.
+//  Generation happens on the thread pool, this only waits for the asset and its dependencies to be generated.
 static bool ProcessAsset(
-	AssetToLoad& assetToLoad, AssetDirectory& destinationDir,
+	AssetToLoad& assetToLoad, AssetMount& mount,
 	const std::unordered_map<std::string_view, AssetToLoad*>& assetsToLoadByName,
-	std::vector<AssetToLoad*>* assetsToposortOut)
+	AssetGenerationQueue& generationQueue, std::vector<AssetToLoad*>* assetsToposortOut)
 {
 	switch (assetToLoad.state)
 	{
@@ -241,7 +302,7 @@ static bool ProcessAsset(
 		std::string fullDepPathCanonical = CanonicalPath(fullDepPathView);
 		auto it = assetsToLoadByName.find(fullDepPathCanonical);
 
-		if (it == assetsToLoadByName.end())
+		if (it == assetsToLoadByName.end() || !generationQueue.WaitGenerated(*it->second))
 		{
 			eg::Log(
 				LogLevel::Warning, "as",
@@ -251,7 +312,7 @@ static bool ProcessAsset(
 			continue;
 		}
 
-		if (!ProcessAsset(*it->second, destinationDir, assetsToLoadByName, assetsToposortOut))
+		if (!ProcessAsset(*it->second, mount, assetsToLoadByName, generationQueue, assetsToposortOut))
 		{
 			eg::Log(
 				LogLevel::Warning, "as",
@@ -264,7 +325,8 @@ static bool ProcessAsset(
 	}
 
 	// Loads the asset
-	Asset* asset = LoadAsset(*assetToLoad.loader, assetToLoad.name, assetToLoad.generatedAsset.data, nullptr);
+	Asset* asset =
+		LoadAssetIntoMount(mount, *assetToLoad.loader, assetToLoad.name, assetToLoad.generatedAsset.data, nullptr);
 	if (asset == nullptr)
 	{
 		// The asset failed to load
@@ -277,13 +339,6 @@ static bool ProcessAsset(
 		assetsToposortOut->push_back(&assetToLoad);
 	}
 
-	asset->fullName = detail::assetAllocator.MakeStringCopy(assetToLoad.name);
-	asset->name = BaseName(asset->fullName);
-
-	AssetDirectory* directory = FindDirectory(&destinationDir, ParentPath(assetToLoad.name), true);
-	asset->next = directory->firstAsset;
-	directory->firstAsset = asset;
-
 	assetToLoad.state = AssetToLoad::STATE_LOADED;
 	return true;
 }
@@ -307,6 +362,42 @@ static void FindAllFilesInDirectory(
 	}
 }
 
+// Called from the thread pool, so this must only read the shared YAML root node.
+static std::optional<GeneratedAsset> GenerateOrReadCachedAsset(
+	const AssetToLoad& assetToLoad, const std::string& dirPath, const std::string& cachePath,
+	const YAML::Node& rootNode)
+{
+	const AssetFormat& format = *assetToLoad.loader->format;
+	const uint64_t cacheKey =
+		detail::AssetCacheKey(dirPath, assetToLoad.name, assetToLoad.generatorName, assetToLoad.yamlNode, format);
+
+	// Tries to load the asset from the cache
+	std::optional<GeneratedAsset> generated = detail::AssetCacheRead(cachePath, cacheKey, dirPath, format);
+	if (generated.has_value())
+		return generated;
+
+	// Generates the asset since loading from the cache failed
+	int64_t timeBegin = NanoTime();
+	generated =
+		GenerateAsset(dirPath, assetToLoad.generatorName, assetToLoad.name, assetToLoad.yamlNode, rootNode);
+	int64_t genDuration = NanoTime() - timeBegin;
+
+	if (!generated.has_value())
+		return {};
+
+	std::ostringstream msg;
+	msg << "Generated asset '" << assetToLoad.name << "' in " << std::setprecision(2) << std::fixed
+		<< (static_cast<double>(genDuration) * 1E-6) << "ms";
+	eg::Log(LogLevel::Info, "as", "{0}", msg.str());
+
+	if (!HasFlag(generated->flags, AssetFlags::NeverCache))
+	{
+		detail::AssetCacheWrite(cachePath, cacheKey, dirPath, *generated);
+	}
+
+	return generated;
+}
+
 static bool LoadAssetsYAML(const std::string& path, std::string_view mountPath)
 {
 #if defined(__EMSCRIPTEN__)
@@ -317,15 +408,15 @@ static bool LoadAssetsYAML(const std::string& path, std::string_view mountPath)
 	if (!yamlStream)
 		return false;
 
-	std::string cachePath = path + "/.AssetCache/";
 	std::string dirPath = yamlPath.substr(0, path.size() + 1);
+	std::string cachePath = detail::AssetCacheDirectory(dirPath);
 
 	YAML::Node node = YAML::Load(yamlStream);
 
 	std::vector<AssetToLoad> assetsToLoad;
 	std::unordered_map<std::string_view, AssetToLoad*> assetsToLoadByName;
 	std::unordered_set<std::string> assetsAlreadyAdded;
-	auto LoadAsset = [&](std::string name, const YAML::Node& assetNode)
+	auto AddAssetToLoad = [&](std::string name, const YAML::Node& assetNode)
 	{
 		if (assetsAlreadyAdded.count(name))
 			return;
@@ -365,38 +456,27 @@ static bool LoadAssetsYAML(const std::string& path, std::string_view mountPath)
 			return;
 		}
 
-		const uint64_t yamlHash = HashYAMLNode(assetNode);
-
-		// Tries to load the asset from the cache
-		std::string assetCachePath = Concat({ cachePath, assetToLoad.name, ".eab" });
-		std::optional<GeneratedAsset> generated =
-			TryReadAssetFromCache(dirPath, *assetToLoad.loader->format, yamlHash, assetCachePath);
-
-		// Generates the asset if loading from the cache failed
-		if (!generated.has_value())
+		if (const YAML::Node& compressionNode = assetNode["compression"])
 		{
-			int64_t timeBegin = NanoTime();
-			generated = GenerateAsset(dirPath, generatorName, assetToLoad.name, assetNode, node);
-			int64_t genDuration = NanoTime() - timeBegin;
-
-			if (!generated.has_value())
-				return;
-
-			std::ostringstream msg;
-			msg << "Generated asset '" << assetToLoad.name << "' in " << std::setprecision(2) << std::fixed
-				<< (static_cast<double>(genDuration) * 1E-6) << "ms";
-			eg::Log(LogLevel::Info, "as", "{0}", msg.str());
-
-			// Don't cache if the resource generated in less than 0.5ms
-			constexpr int64_t CACHE_TIME_THRESHOLD = 500000;
-			if (genDuration > CACHE_TIME_THRESHOLD && !HasFlag(generated->flags, AssetFlags::NeverCache))
+			const std::string codecName = compressionNode.as<std::string>();
+			std::optional<CompressionCodec> codec = ParseCompressionCodec(codecName);
+			if (!codec.has_value() || !IsCompressionCodecSupported(*codec))
 			{
-				SaveAssetToCache(*generated, yamlHash, assetCachePath);
+				Log(LogLevel::Warning, "as", "Unsupported compression '{0}' for '{1}', using zlib.", codecName,
+				    assetToLoad.name);
+			}
+			else
+			{
+				assetToLoad.eapCodec = *codec;
 			}
 		}
 
+		assetToLoad.generatorName = std::move(generatorName);
+
+		// Nodes may be shared between several assets (through regex), so each generation task gets its own copy
+		assetToLoad.yamlNode = YAML::Clone(assetNode);
+
 		assetsAlreadyAdded.insert(assetToLoad.name);
-		assetToLoad.generatedAsset = std::move(*generated);
 		assetsToLoad.push_back(std::move(assetToLoad));
 	};
 
@@ -418,13 +498,13 @@ static bool LoadAssetsYAML(const std::string& path, std::string_view mountPath)
 			{
 				if (std::regex_match(file, regex))
 				{
-					LoadAsset(file, assetNode);
+					AddAssetToLoad(file, assetNode);
 				}
 			}
 		}
 		if (const YAML::Node& nameNode = assetNode["name"])
 		{
-			LoadAsset(nameNode.as<std::string>(), assetNode);
+			AddAssetToLoad(nameNode.as<std::string>(), assetNode);
 		}
 	}
 
@@ -433,13 +513,67 @@ static bool LoadAssetsYAML(const std::string& path, std::string_view mountPath)
 		assetsToLoadByName.emplace(asset.name, &asset);
 	}
 
-	AssetDirectory& mountDir = *FindDirectory(&assetRootDir, mountPath, true);
+	const int64_t generateBeginTime = NanoTime();
+	const AssetCacheStats cacheStatsBefore = GetAssetCacheStats();
+
+	// Reads assets from the cache or generates them on the thread pool. Generators and the cache do not depend on
+	//  other assets, so every asset can be generated independently and only loading has to respect dependencies.
+	AssetGenerationQueue generationQueue;
+	ThreadPool& threadPool = SharedThreadPool();
+	for (AssetToLoad& asset : assetsToLoad)
+	{
+		threadPool.Add(
+			[&generationQueue, &asset, &dirPath, &cachePath, &node]
+			{
+				std::optional<GeneratedAsset> generated =
+					GenerateOrReadCachedAsset(asset, dirPath, cachePath, node);
+				if (generated.has_value())
+					asset.generatedAsset = std::move(*generated);
+
+				{
+					std::lock_guard<std::mutex> lock(generationQueue.mutex);
+					asset.generated = true;
+					asset.generateOk = generated.has_value();
+					generationQueue.numGenerated++;
+				}
+				generationQueue.assetGeneratedSignal.notify_all();
+			});
+	}
+
+	AssetMount& mount = GetAssetMount(mountPath);
 
 	std::vector<AssetToLoad*> assetsToposorted;
 
+	// Loads assets on this thread in the order they were listed, as soon as they have been generated
 	for (AssetToLoad& asset : assetsToLoad)
 	{
-		ProcessAsset(asset, mountDir, assetsToLoadByName, detail::createAssetPackage ? &assetsToposorted : nullptr);
+		if (!generationQueue.WaitGenerated(asset))
+			continue;
+		ProcessAsset(
+			asset, mount, assetsToLoadByName, generationQueue,
+			detail::createAssetPackage ? &assetsToposorted : nullptr);
+	}
+
+	// Tasks reference assetsToLoad, so all of them must finish before returning
+	{
+		std::unique_lock<std::mutex> lock(generationQueue.mutex);
+		generationQueue.assetGeneratedSignal.wait(
+			lock, [&] { return generationQueue.numGenerated == assetsToLoad.size(); });
+	}
+
+	if (!assetsToLoad.empty())
+	{
+		detail::AssetCacheTrim(cachePath);
+
+		const AssetCacheStats cacheStats = GetAssetCacheStats();
+		std::ostringstream msg;
+		msg << "Generated " << assetsToLoad.size() << " assets with " << threadPool.NumWorkers() << " workers in "
+			<< std::setprecision(2) << std::fixed
+			<< (static_cast<double>(NanoTime() - generateBeginTime) * 1E-6) << "ms (cache hits: "
+			<< (cacheStats.hits - cacheStatsBefore.hits)
+			<< ", misses: " << (cacheStats.misses - cacheStatsBefore.misses)
+			<< ", evictions: " << (cacheStats.evictions - cacheStatsBefore.evictions) << ")";
+		eg::Log(LogLevel::Info, "as", "{0}", msg.str());
 	}
 
 	if (detail::createAssetPackage)
@@ -454,8 +588,12 @@ static bool LoadAssetsYAML(const std::string& path, std::string_view mountPath)
 				eapAsset.loaderName = asset->loader->name;
 				eapAsset.format = *asset->loader->format;
 				eapAsset.generatedAssetData = { asset->generatedAsset.data.data(), asset->generatedAsset.data.size() };
-				eapAsset.compress = !HasFlag(asset->generatedAsset.flags, AssetFlags::DisableEAPCompression) &&
-			                        !detail::disableAssetPackageCompression;
+				eapAsset.codec = asset->eapCodec;
+				if (HasFlag(asset->generatedAsset.flags, AssetFlags::DisableEAPCompression) ||
+			        detail::disableAssetPackageCompression)
+				{
+					eapAsset.codec = CompressionCodec::None;
+				}
 				return eapAsset;
 			});
 
@@ -467,54 +605,214 @@ static bool LoadAssetsYAML(const std::string& path, std::string_view mountPath)
 #endif
 }
 
-bool LoadAssetsFromEAPStream(std::istream& stream, std::string_view mountPath)
+bool detail::CheckEAPAssetLoader(const EAPAsset& eapAsset)
 {
-	AssetDirectory& mountDir = *FindDirectory(&assetRootDir, mountPath, true);
+	if (eapAsset.loader == nullptr)
+	{
+		eg::Log(
+			LogLevel::Error, "as", "EAP file references unknown loader '{0}' (by the asset '{1}')", eapAsset.loaderName,
+			eapAsset.assetName);
+		return false;
+	}
 
-	LinearAllocator allocator;
-	auto eapReadResult = ReadEAPFile(stream, allocator);
-	if (!eapReadResult)
+	// Checks that the format version is supported by the loader
+	if (*eapAsset.loader->format != eapAsset.format)
 	{
-		eg::Log(LogLevel::Error, "as", "Invalid EAP file");
+		eg::Log(
+			LogLevel::Error, "as", "EAP asset '{0}' uses a format not supported by it's loader ({1})",
+			eapAsset.assetName, eapAsset.loaderName);
 		return false;
 	}
 
-	for (const EAPAsset& eapAsset : *eapReadResult)
+	return true;
+}
+
+static bool LoadEAPAsset(const EAPAsset& eapAsset, AssetMount& mount, std::shared_ptr<void> preparedData)
+{
+	Asset* asset = LoadAssetIntoMount(
+		mount, *eapAsset.loader, eapAsset.assetName, eapAsset.generatedAssetData, std::move(preparedData));
+	if (asset == nullptr)
+	{
+		eg::Log(
+			LogLevel::Error, "as", "EAP asset '{0}' failed to load (with loader '{1}').", eapAsset.assetName,
+			eapAsset.loaderName);
+		return false;
+	}
+
+	return true;
+}
+
+bool detail::LoadEAPAsset(const EAPAsset& eapAsset, std::string_view mountPath, std::shared_ptr<void> preparedData)
+{
+	return eg::LoadEAPAsset(eapAsset, GetAssetMount(mountPath), std::move(preparedData));
+}
+
+static bool LoadEAPAssets(std::span<const EAPAsset> eapAssets, std::string_view mountPath)
+{
+	AssetMount& mount = GetAssetMount(mountPath);
+
+	for (const EAPAsset& eapAsset : eapAssets)
 	{
-		if (eapAsset.loader == nullptr)
+		if (!detail::CheckEAPAssetLoader(eapAsset) || !LoadEAPAsset(eapAsset, mount, nullptr))
+			return false;
+	}
+
+	return true;
+}
+
+struct EAPPipelineAsset
+{
+	bool done = false;
+	bool ok = false;
+	std::shared_ptr<void> preparedData;
+};
+
+struct EAPPipeline
+{
+	std::mutex mutex;
+	std::condition_variable assetDoneSignal;
+	std::vector<EAPPipelineAsset> assets;
+	size_t numDone = 0;
+
+	std::atomic_bool cancel{ false };
+	std::atomic<int64_t> decompressTime{ 0 };
+	std::atomic<int64_t> prepareTime{ 0 };
+};
+
+// Decompresses and prepares assets on the shared thread pool while this thread runs the final loader callbacks.
+//  Those still run in package order, which WriteEAPFile guarantees is a topological order of load dependencies.
+static bool LoadEAPAssetsPipelined(std::span<const EAPAsset> eapAssets, std::string_view mountPath, int64_t indexTime)
+{
+	const int64_t beginTime = NanoTime();
+
+	for (const EAPAsset& eapAsset : eapAssets)
+	{
+		if (!detail::CheckEAPAssetLoader(eapAsset))
+			return false;
+	}
+
+	EAPPipeline pipeline;
+	pipeline.assets.resize(eapAssets.size());
+
+	ThreadPool& threadPool = SharedThreadPool();
+	for (size_t i = 0; i < eapAssets.size(); i++)
+	{
+		threadPool.Add(
+			[&pipeline, &eapAsset = eapAssets[i], i]
+			{
+				bool ok = false;
+				std::shared_ptr<void> preparedData;
+				if (!pipeline.cancel.load(std::memory_order_relaxed))
+				{
+					const int64_t decompressBegin = NanoTime();
+					ok = eapAsset.codec == CompressionCodec::None || DecompressEAPAsset(eapAsset);
+					const int64_t prepareBegin = NanoTime();
+					pipeline.decompressTime += prepareBegin - decompressBegin;
+
+					if (!ok)
+					{
+						eg::Log(LogLevel::Error, "as", "EAP asset '{0}' failed to decompress.", eapAsset.assetName);
+					}
+					else if (eapAsset.loader->prepare)
+					{
+						preparedData = eapAsset.loader->prepare(eapAsset.assetName, eapAsset.generatedAssetData);
+						ok = preparedData != nullptr;
+						pipeline.prepareTime += NanoTime() - prepareBegin;
+					}
+				}
+
+				{
+					std::lock_guard<std::mutex> lock(pipeline.mutex);
+					pipeline.assets[i].done = true;
+					pipeline.assets[i].ok = ok;
+					pipeline.assets[i].preparedData = std::move(preparedData);
+					pipeline.numDone++;
+				}
+				pipeline.assetDoneSignal.notify_all();
+			});
+	}
+
+	AssetMount& mount = GetAssetMount(mountPath);
+
+	bool ok = true;
+	int64_t waitTime = 0;
+	int64_t loadTime = 0;
+	for (size_t i = 0; i < eapAssets.size() && ok; i++)
+	{
+		const int64_t waitBegin = NanoTime();
+		std::shared_ptr<void> preparedData;
 		{
-			eg::Log(
-				LogLevel::Error, "as", "EAP file references unknown loader '{0}' (by the asset '{1}')",
-				eapAsset.loaderName, eapAsset.assetName);
+			std::unique_lock<std::mutex> lock(pipeline.mutex);
+			pipeline.assetDoneSignal.wait(lock, [&] { return pipeline.assets[i].done; });
+			ok = pipeline.assets[i].ok;
+			preparedData = std::move(pipeline.assets[i].preparedData);
 		}
+		const int64_t loadBegin = NanoTime();
+		waitTime += loadBegin - waitBegin;
 
-		// Checks that the format version is supported by the loader
-		if (*eapAsset.loader->format != eapAsset.format)
+		if (!ok)
 		{
 			eg::Log(
-				LogLevel::Error, "as", "EAP asset '{0}' uses a format not supported by it's loader ({1})",
-				eapAsset.assetName, eapAsset.loaderName);
+				LogLevel::Error, "as", "EAP asset '{0}' failed to load (with loader '{1}').", eapAssets[i].assetName,
+				eapAssets[i].loaderName);
 		}
-
-		// Loads the asset
-		Asset* asset = LoadAsset(*eapAsset.loader, eapAsset.assetName, eapAsset.generatedAssetData, nullptr);
-		if (asset == nullptr)
+		else
 		{
-			eg::Log(
-				LogLevel::Error, "as", "EAP asset '{0}' failed to load (with loader '{1}').", eapAsset.assetName,
-				eapAsset.loaderName);
-			return false;
+			ok = LoadEAPAsset(eapAssets[i], mount, std::move(preparedData));
 		}
+		loadTime += NanoTime() - loadBegin;
+	}
 
-		asset->fullName = detail::assetAllocator.MakeStringCopy(eapAsset.assetName);
-		asset->name = BaseName(asset->fullName);
+	// Tasks reference the pipeline and asset data, so all of them must finish before returning
+	pipeline.cancel = true;
+	{
+		std::unique_lock<std::mutex> lock(pipeline.mutex);
+		pipeline.assetDoneSignal.wait(lock, [&] { return pipeline.numDone == eapAssets.size(); });
+	}
 
-		AssetDirectory* directory = FindDirectory(&mountDir, ParentPath(eapAsset.assetName), true);
-		asset->next = directory->firstAsset;
-		directory->firstAsset = asset;
+	if (ok)
+	{
+		auto ToMS = [](int64_t nanoseconds) { return static_cast<double>(nanoseconds) * 1E-6; };
+		std::ostringstream msg;
+		msg << std::setprecision(2) << std::fixed << "Loaded " << eapAssets.size() << " assets with "
+			<< threadPool.NumWorkers() << " workers in " << ToMS(NanoTime() - beginTime + indexTime)
+			<< "ms (index: " << ToMS(indexTime) << "ms, decompress: " << ToMS(pipeline.decompressTime)
+			<< "ms, prepare: " << ToMS(pipeline.prepareTime) << "ms, main thread load: " << ToMS(loadTime)
+			<< "ms, main thread wait: " << ToMS(waitTime) << "ms)";
+		eg::Log(LogLevel::Info, "as", "{0}", msg.str());
 	}
 
-	return true;
+	return ok;
+}
+
+bool LoadAssetsFromEAPStream(std::istream& stream, std::string_view mountPath)
+{
+	LinearAllocator allocator;
+	auto eapReadResult = ReadEAPFile(stream, allocator);
+	if (!eapReadResult)
+	{
+		eg::Log(LogLevel::Error, "as", "Invalid EAP file");
+		return false;
+	}
+
+	return LoadEAPAssets(*eapReadResult, mountPath);
+}
+
+bool LoadAssetsFromEAPMemory(std::span<const char> data, std::string_view mountPath)
+{
+	const int64_t indexBeginTime = NanoTime();
+
+	LinearAllocator allocator;
+	std::optional<std::vector<EAPAsset>> eapIndex = ReadEAPFileIndex(data, allocator);
+	if (!eapIndex)
+	{
+		// Legacy packages have no table of contents, so these are loaded serially through a stream
+		MemoryStreambuf streambuf(data);
+		std::istream stream(&streambuf);
+		return LoadAssetsFromEAPStream(stream, mountPath);
+	}
+
+	return LoadEAPAssetsPipelined(*eapIndex, mountPath, NanoTime() - indexBeginTime);
 }
 
 bool LoadAssets(const std::string& path, std::string_view mountPath)
@@ -532,6 +830,13 @@ bool LoadAssets(const std::string& path, std::string_view mountPath)
 	{
 		okEap = LoadAssetsFromEAPStream(*downloadedStream, mountPath);
 	}
+#ifndef __EMSCRIPTEN__
+	else if (MemoryMappedFile eapFile; eapFile.Open(eapPath.c_str()))
+	{
+		// Uncompressed assets are loaded straight from the mapping, which is unmapped once loading is done
+		okEap = LoadAssetsFromEAPMemory(eapFile.Data(), mountPath);
+	}
+#endif
 	else
 	{
 		std::ifstream stream(eapPath, std::ios::binary);
@@ -578,40 +883,157 @@ void detail::LoadAssetGenLibrary()
 }
 #endif
 
+// Checks whether a path is already in the form produced by CanonicalPath
+static bool IsCanonicalPath(std::string_view path)
+{
+	if (path.empty() || path.front() == '/' || path.back() == '/')
+		return false;
+	bool canonical = true;
+	IterateStringParts(path, '/', [&](std::string_view part) { canonical &= part != "." && part != ".."; });
+	return canonical && path.find("//") == std::string_view::npos;
+}
+
 const Asset* detail::FindAsset(std::string_view name)
 {
-	std::string cPath = CanonicalPath(name);
-	AssetDirectory* dir = FindDirectory(&assetRootDir, ParentPath(cPath), false);
-	if (dir == nullptr)
-		return nullptr;
+	// Most lookups use canonical paths already, these can be looked up without allocating
+	auto it = IsCanonicalPath(name) ? assetsByPath.find(name) : assetsByPath.find(CanonicalPath(name));
+	return it != assetsByPath.end() ? it->second.back() : nullptr;
+}
+
+const Asset* detail::FindAsset(CTStringHash canonicalPathHash)
+{
+	auto it = assetsByPathHash.find(canonicalPathHash.hash);
+	return it != assetsByPathHash.end() ? it->second : nullptr;
+}
+
+// Removes unloaded assets from the asset lists of dir and its subdirectories
+static void UnlinkAssetsR(AssetDirectory* dir, const std::unordered_set<const Asset*>& unloadedAssets)
+{
+	Asset** link = &dir->firstAsset;
+	while (*link != nullptr)
+	{
+		if (unloadedAssets.count(*link))
+			*link = (*link)->next;
+		else
+			link = &(*link)->next;
+	}
 
-	std::string_view baseName = BaseName(name);
-	for (Asset* asset = dir->firstAsset; asset != nullptr; asset = asset->next)
+	for (AssetDirectory* subDir = dir->firstChildDir; subDir != nullptr; subDir = subDir->nextSiblingDir)
 	{
-		if (asset->name == baseName)
-			return asset;
+		UnlinkAssetsR(subDir, unloadedAssets);
 	}
+}
 
-	return nullptr;
+// Frees the subdirectories of dir that contain no assets and are not the directory of a remaining mount
+static void FreeEmptyDirectoriesR(
+	AssetDirectory* dir, const std::unordered_set<const AssetDirectory*>& mountDirectories)
+{
+	AssetDirectory** link = &dir->firstChildDir;
+	while (*link != nullptr)
+	{
+		AssetDirectory* subDir = *link;
+		FreeEmptyDirectoriesR(subDir, mountDirectories);
+		if (subDir->firstAsset == nullptr && subDir->firstChildDir == nullptr && !mountDirectories.count(subDir))
+		{
+			*link = subDir->nextSiblingDir;
+			assetDirectoryPool.Delete(subDir);
+		}
+		else
+		{
+			link = &subDir->nextSiblingDir;
+		}
+	}
 }
 
-static void UnloadAssetsR(AssetDirectory* dir)
+void UnloadAssets(std::string_view mountPath)
 {
-	for (Asset* asset = dir->firstAsset; asset != nullptr; asset = asset->next)
+	const std::string path = CanonicalPath(mountPath);
+	auto IsInSubtree = [&](const std::unique_ptr<AssetMount>& mount)
 	{
-		asset->DestroyInstance();
+		return path.empty() || mount->path == path ||
+		       (mount->path.starts_with(path) && mount->path[path.size()] == '/');
+	};
+
+	std::unordered_set<const Asset*> unloadedAssets;
+	for (const std::unique_ptr<AssetMount>& mount : assetMounts)
+	{
+		if (IsInSubtree(mount))
+			unloadedAssets.insert(mount->assets.begin(), mount->assets.end());
 	}
 
-	for (AssetDirectory* subDir = dir->firstChildDir; subDir != nullptr; subDir = subDir->nextSiblingDir)
+	if (!unloadedAssets.empty())
 	{
-		UnloadAssetsR(subDir);
+		// Destroys assets in reverse load order across all mounts, since later assets may depend on earlier ones
+		for (auto assetIt = assetLoadOrder.rbegin(); assetIt != assetLoadOrder.rend(); ++assetIt)
+		{
+			if (unloadedAssets.count(*assetIt))
+				(*assetIt)->DestroyInstance();
+		}
+		std::erase_if(assetLoadOrder, [&](const Asset* asset) { return unloadedAssets.count(asset) != 0; });
+
+		UnlinkAssetsR(&assetRootDir, unloadedAssets);
+
+		for (auto it = assetsByPath.begin(); it != assetsByPath.end();)
+		{
+			// Shadowed assets become visible again if the assets shadowing them are unloaded
+			std::erase_if(it->second, [&](const Asset* asset) { return unloadedAssets.count(asset) != 0; });
+			if (it->second.empty())
+				it = assetsByPath.erase(it);
+			else
+				++it;
+		}
+
+		// The hash index is rebuilt since unloading may both restore shadowed assets and resolve hash collisions
+		assetsByPathHash.clear();
+		for (const auto& [assetPath, pathAssets] : assetsByPath)
+			AddAssetPathHash(CTStringHash(assetPath).hash, pathAssets.back(), assetPath, false);
 	}
+
+	// Frees the asset objects and names of the mounts
+	std::erase_if(assetMounts, IsInSubtree);
+
+	std::unordered_set<const AssetDirectory*> mountDirectories;
+	for (const std::unique_ptr<AssetMount>& mount : assetMounts)
+		mountDirectories.insert(mount->directory);
+	FreeEmptyDirectoriesR(&assetRootDir, mountDirectories);
+
+	detail::assetsUnloadCounter++;
 }
 
 void UnloadAssets()
 {
-	UnloadAssetsR(&assetRootDir);
-	detail::assetAllocator.Reset();
+	UnloadAssets("");
+}
+
+std::vector<AssetMountMemoryUsage> GetAssetMemoryUsage()
+{
+	std::vector<AssetMountMemoryUsage> result;
+	result.reserve(assetMounts.size());
+
+	for (const std::unique_ptr<AssetMount>& mount : assetMounts)
+	{
+		AssetMountMemoryUsage& mountUsage = result.emplace_back();
+		mountUsage.mountPath = mount->path;
+		mountUsage.allocatorBytes = mount->allocator.BytesReserved();
+
+		for (const Asset* asset : mount->assets)
+		{
+			auto typeIt = std::find_if(
+				mountUsage.byType.begin(), mountUsage.byType.end(),
+				[&](const auto& typeUsage) { return typeUsage.first == asset->assetType; });
+			if (typeIt == mountUsage.byType.end())
+				typeIt = mountUsage.byType.emplace(mountUsage.byType.end(), asset->assetType, AssetMemoryUsage());
+
+			for (AssetMemoryUsage* usage : { &mountUsage.total, &typeIt->second })
+			{
+				usage->numAssets++;
+				usage->cpuBytes += asset->cpuBytes;
+				usage->gpuBytes += asset->gpuBytes;
+			}
+		}
+	}
+
+	return result;
 }
 
 static void IterateAssetsR(const AssetDirectory& dir, const std::function<void(const Asset&)>& callback)
@@ -2,25 +2,40 @@
 
 #include <atomic>
 #include <functional>
+#include <memory>
 #include <istream>
 #include <optional>
+#include <span>
+#include <string>
 #include <thread>
 #include <typeindex>
+#include <vector>
 
 #include "../API.hpp"
 #include "../Alloc/LinearAllocator.hpp"
 #include "../Assert.hpp"
+#include "../Hash.hpp"
 
 namespace eg
 {
+struct EAPAsset;
+
 namespace detail
 {
 extern EG_API LinearAllocator assetAllocator;
 
+// Allocator that Asset::Create uses, points to the allocator of the mount that is currently being loaded into
+extern EG_API LinearAllocator* currentAssetAllocator;
+
 extern bool createAssetPackage;
 extern bool disableAssetPackageCompression;
 
 void LoadAssetGenLibrary();
+
+bool CheckEAPAssetLoader(const EAPAsset& eapAsset);
+
+// Loads an asset from a package into mountPath, must be called on the main thread
+bool LoadEAPAsset(const EAPAsset& eapAsset, std::string_view mountPath, std::shared_ptr<void> preparedData);
 } // namespace detail
 
 struct Asset
@@ -32,6 +47,10 @@ struct Asset
 	void (*instanceDtor)(void*);
 	Asset* next;
 
+	// Memory used by the asset, as reported by its loader through AssetLoadContext::AddMemoryUsage
+	uint64_t cpuBytes = 0;
+	uint64_t gpuBytes = 0;
+
 	explicit Asset(std::type_index _assetType) : assetType(_assetType), next(nullptr) {}
 
 	void DestroyInstance()
@@ -46,9 +65,9 @@ struct Asset
 	template <typename T>
 	static Asset* Create()
 	{
-		Asset* asset = detail::assetAllocator.New<Asset>(std::type_index(typeid(T)));
+		Asset* asset = detail::currentAssetAllocator->New<Asset>(std::type_index(typeid(T)));
 		asset->instanceDtor = [](void* instance) { reinterpret_cast<T*>(instance)->~T(); };
-		asset->instance = detail::assetAllocator.Allocate(sizeof(T), alignof(T));
+		asset->instance = detail::currentAssetAllocator->Allocate(sizeof(T), alignof(T));
 		return asset;
 	}
 };
@@ -67,8 +86,39 @@ inline void BindAssetExtension(std::string_view extension, std::string_view load
 // Similar to LoadAssets, but loads from an EAP stream
 [[nodiscard]] EG_API bool LoadAssetsFromEAPStream(std::istream& stream, std::string_view mountPath);
 
+// Similar to LoadAssets, but loads from an EAP file that is already in memory.
+//  Uncompressed assets are passed to loaders without being copied, data only needs to stay valid during the call.
+[[nodiscard]] EG_API bool LoadAssetsFromEAPMemory(std::span<const char> data, std::string_view mountPath);
+
 EG_API void UnloadAssets();
 
+// Unloads the assets that were mounted at mountPath or at a path inside it, other assets stay valid.
+//  Assets are destroyed in the reverse of the order they were loaded in, across all of the unloaded mounts. Assets
+//  that stay loaded must not depend on unloaded ones, so mounts that depend on each other should be unloaded together
+//  or in the reverse of the order they were loaded in.
+EG_API void UnloadAssets(std::string_view mountPath);
+
+struct AssetMemoryUsage
+{
+	uint32_t numAssets = 0;
+	uint64_t cpuBytes = 0;
+	uint64_t gpuBytes = 0;
+};
+
+struct AssetMountMemoryUsage
+{
+	std::string mountPath;
+
+	// Memory reserved by the mount's allocator, which holds asset objects and names
+	uint64_t allocatorBytes = 0;
+
+	AssetMemoryUsage total;
+	std::vector<std::pair<std::type_index, AssetMemoryUsage>> byType;
+};
+
+// Returns the memory used by loaded assets, per mount and per asset type within each mount.
+EG_API std::vector<AssetMountMemoryUsage> GetAssetMemoryUsage();
+
 namespace console
 {
 struct CompletionsList;
@@ -77,7 +127,18 @@ struct CompletionsList;
 namespace detail
 {
 EG_API const Asset* FindAsset(std::string_view name);
+
+// Looks up an asset by the hash of its canonical path (the full path without a leading slash).
+EG_API const Asset* FindAsset(CTStringHash canonicalPathHash);
+
+template <typename T>
+T* CastAsset(const Asset* asset)
+{
+	if (asset == nullptr || asset->assetType != std::type_index(typeid(T)))
+		return nullptr;
+	return reinterpret_cast<T*>(asset->instance);
 }
+} // namespace detail
 
 inline std::optional<std::type_index> GetAssetType(std::string_view name)
 {
@@ -89,10 +150,25 @@ inline std::optional<std::type_index> GetAssetType(std::string_view name)
 template <typename T>
 T* FindAsset(std::string_view name)
 {
-	const Asset* asset = detail::FindAsset(name);
-	if (asset == nullptr || asset->assetType != std::type_index(typeid(T)))
-		return nullptr;
-	return reinterpret_cast<T*>(asset->instance);
+	return detail::CastAsset<T>(detail::FindAsset(name));
+}
+
+// Avoids ambiguity between the string_view and CTStringHash overloads for string literals
+template <typename T>
+T* FindAsset(const char* name)
+{
+	return FindAsset<T>(std::string_view(name));
+}
+
+/**
+ * Finds an asset without doing any string processing, for hot paths with literal names:
+ *  FindAsset<Texture>(CTStringHash("Textures/Wall.png"))
+ * The name must be the canonical path of the asset, the full path without a leading slash, "." or "..".
+ */
+template <typename T>
+T* FindAsset(CTStringHash canonicalPathHash)
+{
+	return detail::CastAsset<T>(detail::FindAsset(canonicalPathHash));
 }
 
 template <typename T>
@@ -103,6 +179,20 @@ T& GetAsset(std::string_view name)
 	EG_PANIC("Asset not found '" << name << "'");
 }
 
+template <typename T>
+T& GetAsset(const char* name)
+{
+	return GetAsset<T>(std::string_view(name));
+}
+
+template <typename T>
+T& GetAsset(CTStringHash canonicalPathHash)
+{
+	if (T* asset = FindAsset<T>(canonicalPathHash))
+		return *asset;
+	EG_PANIC("Asset not found (hash " << canonicalPathHash.hash << ")");
+}
+
 EG_API void IterateAssets(const std::function<void(const Asset&)>& callback);
 
 EG_API void AssetCommandCompletionProvider(console::CompletionsList& list, const std::type_index* assetType = nullptr);
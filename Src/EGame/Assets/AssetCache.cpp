@@ -0,0 +1,322 @@
+#include "AssetCache.hpp"
+#include "../Hash.hpp"
+#include "../IOUtils.hpp"
+#include "../Log.hpp"
+#include "../Platform/FileSystem.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace eg
+{
+static const char cachedAssetMagic[] = { -1, 'E', 'A', 'C' };
+static constexpr uint32_t CACHED_ASSET_VERSION = 2;
+
+static constexpr uint64_t DEFAULT_CACHE_MAX_BYTES = 4ULL * 1024 * 1024 * 1024;
+
+static std::optional<std::string> cacheDirectory;
+static std::optional<uint64_t> cacheMaxBytes;
+
+static struct
+{
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> writes;
+	std::atomic<uint64_t> evictions;
+	std::atomic<uint64_t> bytesRead;
+	std::atomic<uint64_t> bytesWritten;
+} cacheStats;
+
+void SetAssetCacheDirectory(std::string path)
+{
+	cacheDirectory = std::move(path);
+}
+
+void SetAssetCacheMaxBytes(uint64_t maxBytes)
+{
+	cacheMaxBytes = maxBytes;
+}
+
+AssetCacheStats GetAssetCacheStats()
+{
+	AssetCacheStats stats;
+	stats.hits = cacheStats.hits;
+	stats.misses = cacheStats.misses;
+	stats.writes = cacheStats.writes;
+	stats.evictions = cacheStats.evictions;
+	stats.bytesRead = cacheStats.bytesRead;
+	stats.bytesWritten = cacheStats.bytesWritten;
+	return stats;
+}
+
+void ResetAssetCacheStats()
+{
+	cacheStats.hits = 0;
+	cacheStats.misses = 0;
+	cacheStats.writes = 0;
+	cacheStats.evictions = 0;
+	cacheStats.bytesRead = 0;
+	cacheStats.bytesWritten = 0;
+}
+
+std::string detail::AssetCacheDirectory(std::string_view assetDirPath)
+{
+	if (!cacheDirectory.has_value())
+	{
+		const char* env = std::getenv("EG_ASSET_CACHE_DIR");
+		cacheDirectory = env != nullptr ? env : "";
+	}
+
+	if (cacheDirectory->empty())
+		return Concat({ assetDirPath, ".AssetCache/" });
+	if (cacheDirectory->back() == '/' || cacheDirectory->back() == '\\')
+		return *cacheDirectory;
+	return *cacheDirectory + "/";
+}
+
+static uint64_t CacheMaxBytes()
+{
+	if (!cacheMaxBytes.has_value())
+	{
+		cacheMaxBytes = DEFAULT_CACHE_MAX_BYTES;
+		if (const char* env = std::getenv("EG_ASSET_CACHE_MAX_MB"))
+		{
+			char* end;
+			const unsigned long long maxMB = std::strtoull(env, &end, 10);
+			if (end == env || *end != '\0')
+				Log(LogLevel::Warning, "as", "Could not parse EG_ASSET_CACHE_MAX_MB, should be an integer.");
+			else
+				cacheMaxBytes = static_cast<uint64_t>(maxMB) * 1024 * 1024;
+		}
+	}
+	return *cacheMaxBytes;
+}
+
+static std::optional<uint64_t> HashFileContents(const std::string& path)
+{
+	std::ifstream stream(path, std::ios::binary);
+	if (!stream)
+		return {};
+	std::vector<char> contents = ReadStreamContents(stream);
+	return HashFNV1a64(std::string_view(contents.data(), contents.size()));
+}
+
+static std::string CacheEntryPath(std::string_view cacheDir, uint64_t key)
+{
+	std::ostringstream nameStream;
+	nameStream << std::hex << std::setw(16) << std::setfill('0') << key;
+	return Concat({ cacheDir, nameStream.str(), ".eab" });
+}
+
+uint64_t detail::AssetCacheKey(
+	std::string_view assetDirPath, std::string_view assetName, std::string_view generatorName,
+	const YAML::Node& yamlNode, const AssetFormat& format)
+{
+	// Mirrors AssetGenerateContext::RelSourcePath, which generators use to find their main source file
+	std::string relSourcePath(assetName);
+	if (const YAML::Node& sourceNode = yamlNode["source"])
+		relSourcePath = sourceNode.as<std::string>();
+	const uint64_t sourceHash = HashFileContents(Concat({ assetDirPath, relSourcePath })).value_or(0);
+
+	// The emitted YAML is hashed with FNV-1a rather than std::hash, which may differ between platforms
+	std::ostringstream keyStream;
+	keyStream << generatorName << '\0' << assetName << '\0' << YAML::Dump(yamlNode) << '\0' << format.nameHash << ':'
+			  << format.version << ':' << sourceHash;
+	return HashFNV1a64(keyStream.str());
+}
+
+std::optional<GeneratedAsset> detail::AssetCacheRead(
+	std::string_view cacheDir, uint64_t key, std::string_view assetDirPath, const AssetFormat& expectedFormat)
+{
+	const std::string entryPath = CacheEntryPath(cacheDir, key);
+
+	auto Miss = []() -> std::optional<GeneratedAsset>
+	{
+		cacheStats.misses++;
+		return {};
+	};
+
+	std::ifstream stream(entryPath, std::ios::binary);
+	if (!stream)
+		return Miss();
+
+	char magic[sizeof(cachedAssetMagic)];
+	stream.read(magic, sizeof(magic));
+	if (!stream || std::memcmp(cachedAssetMagic, magic, sizeof(magic)) != 0 ||
+	    BinRead<uint32_t>(stream) != CACHED_ASSET_VERSION)
+	{
+		return Miss();
+	}
+
+	GeneratedAsset asset;
+
+	asset.format.nameHash = BinRead<uint32_t>(stream);
+	asset.format.version = BinRead<uint32_t>(stream);
+	if (asset.format.nameHash != expectedFormat.nameHash || asset.format.version != expectedFormat.version)
+		return Miss();
+
+	asset.flags = static_cast<AssetFlags>(BinRead<uint32_t>(stream));
+
+	// The entry is only valid if every file the generator read still has the same contents
+	const uint32_t numFileDependencies = BinRead<uint32_t>(stream);
+	asset.fileDependencies.reserve(numFileDependencies);
+	for (uint32_t i = 0; i < numFileDependencies && stream; i++)
+	{
+		std::string dependency = BinReadString(stream);
+		const uint64_t expectedHash = BinRead<uint64_t>(stream);
+		if (HashFileContents(Concat({ assetDirPath, dependency })) != expectedHash)
+			return Miss();
+		asset.fileDependencies.push_back(std::move(dependency));
+	}
+
+	const uint32_t numLoadDependencies = BinRead<uint32_t>(stream);
+	asset.loadDependencies.reserve(numLoadDependencies);
+	for (uint32_t i = 0; i < numLoadDependencies && stream; i++)
+	{
+		asset.loadDependencies.push_back(BinReadString(stream));
+	}
+
+	const uint64_t dataSize = BinRead<uint64_t>(stream);
+	if (!stream)
+		return Miss();
+	asset.data.resize(dataSize);
+	stream.read(asset.data.data(), static_cast<std::streamsize>(dataSize));
+	if (!stream)
+		return Miss();
+	stream.close();
+
+	// The modification time of entries is used as the last access time for eviction
+	std::error_code ec;
+	std::filesystem::last_write_time(entryPath, std::filesystem::file_time_type::clock::now(), ec);
+
+	cacheStats.hits++;
+	cacheStats.bytesRead += dataSize;
+	return asset;
+}
+
+static uint64_t CurrentProcessID()
+{
+#if defined(_WIN32)
+	return static_cast<uint64_t>(_getpid());
+#else
+	return static_cast<uint64_t>(getpid());
+#endif
+}
+
+void detail::AssetCacheWrite(
+	std::string_view cacheDir, uint64_t key, std::string_view assetDirPath, const GeneratedAsset& asset)
+{
+	CreateDirectories(cacheDir);
+
+	const std::string entryPath = CacheEntryPath(cacheDir, key);
+
+	// Writes to a temporary file first so that other processes sharing the cache never see partial entries.
+	//  The temporary name includes the process id and a random suffix so that concurrent writers never share a file,
+	//  thread ids alone can repeat across processes.
+	std::ostringstream tempPathStream;
+	tempPathStream << entryPath << ".tmp" << std::hex << CurrentProcessID() << "-";
+	tempPathStream << std::hash<std::thread::id>()(std::this_thread::get_id()) << "-" << std::random_device()();
+	const std::string tempPath = tempPathStream.str();
+
+	{
+		std::ofstream stream(tempPath, std::ios::binary);
+		if (!stream)
+		{
+			Log(LogLevel::Warning, "as", "Failed to open asset cache file for writing: '{0}'", tempPath);
+			return;
+		}
+
+		stream.write(cachedAssetMagic, sizeof(cachedAssetMagic));
+		BinWrite(stream, CACHED_ASSET_VERSION);
+		BinWrite(stream, asset.format.nameHash);
+		BinWrite(stream, asset.format.version);
+		BinWrite(stream, static_cast<uint32_t>(asset.flags));
+
+		BinWrite(stream, UnsignedNarrow<uint32_t>(asset.fileDependencies.size()));
+		for (const std::string& dep : asset.fileDependencies)
+		{
+			BinWriteString(stream, dep);
+			BinWrite(stream, HashFileContents(Concat({ assetDirPath, dep })).value_or(0));
+		}
+
+		BinWrite(stream, UnsignedNarrow<uint32_t>(asset.loadDependencies.size()));
+		for (const std::string& dep : asset.loadDependencies)
+			BinWriteString(stream, dep);
+
+		BinWrite(stream, static_cast<uint64_t>(asset.data.size()));
+		stream.write(asset.data.data(), static_cast<std::streamsize>(asset.data.size()));
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, entryPath, ec);
+	if (ec)
+	{
+		std::filesystem::remove(tempPath, ec);
+		return;
+	}
+
+	cacheStats.writes++;
+	cacheStats.bytesWritten += asset.data.size();
+}
+
+void detail::AssetCacheTrim(std::string_view cacheDir)
+{
+	const uint64_t maxBytes = CacheMaxBytes();
+	if (maxBytes == 0)
+		return;
+
+	struct Entry
+	{
+		std::filesystem::file_time_type lastAccess;
+		uint64_t size;
+		std::filesystem::path path;
+	};
+
+	std::vector<Entry> entries;
+	uint64_t totalBytes = 0;
+
+	std::error_code ec;
+	for (const auto& directoryEntry : std::filesystem::directory_iterator(std::filesystem::path(cacheDir), ec))
+	{
+		if (!directoryEntry.is_regular_file(ec) || directoryEntry.path().extension() != ".eab")
+			continue;
+		Entry& entry = entries.emplace_back();
+		entry.lastAccess = directoryEntry.last_write_time(ec);
+		entry.size = directoryEntry.file_size(ec);
+		entry.path = directoryEntry.path();
+		totalBytes += entry.size;
+	}
+
+	if (totalBytes <= maxBytes)
+		return;
+
+	std::sort(
+		entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.lastAccess < b.lastAccess; });
+
+	for (const Entry& entry : entries)
+	{
+		if (totalBytes <= maxBytes)
+			break;
+		if (std::filesystem::remove(entry.path, ec))
+		{
+			totalBytes -= entry.size;
+			cacheStats.evictions++;
+		}
+	}
+}
+} // namespace eg
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../API.hpp"
+#include "AssetGenerator.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace eg
+{
+struct AssetCacheStats
+{
+	uint64_t hits = 0;
+	uint64_t misses = 0;
+	uint64_t writes = 0;
+	uint64_t evictions = 0;
+	uint64_t bytesRead = 0;
+	uint64_t bytesWritten = 0;
+};
+
+/**
+ * Sets the directory that generated assets are cached in. The cache is content addressed, so the same directory can
+ * be shared by several asset directories, checkouts and machines (for example through a network mount).
+ * An empty path (the default) caches in .AssetCache/ inside each asset directory. The EG_ASSET_CACHE_DIR environment
+ * variable is used if this has not been called. Must not be called while assets are loading.
+ */
+EG_API void SetAssetCacheDirectory(std::string path);
+
+/**
+ * Sets the size the cache directory is trimmed to after assets have been generated, least recently used entries are
+ * evicted first. Zero disables eviction. Defaults to 4GiB, or EG_ASSET_CACHE_MAX_MB if set.
+ */
+EG_API void SetAssetCacheMaxBytes(uint64_t maxBytes);
+
+EG_API AssetCacheStats GetAssetCacheStats();
+EG_API void ResetAssetCacheStats();
+
+namespace detail
+{
+// Resolves the cache directory to use for assets in assetDirPath (which ends with a slash).
+std::string AssetCacheDirectory(std::string_view assetDirPath);
+
+/**
+ * Computes the key of an asset in the cache from its generator, YAML node, format and the bytes of its source file.
+ * Files the generator reads in addition to the source are only known after generation, these are stored with
+ * their content hashes in the cache entry and validated by AssetCacheRead.
+ */
+uint64_t AssetCacheKey(
+	std::string_view assetDirPath, std::string_view assetName, std::string_view generatorName,
+	const YAML::Node& yamlNode, const AssetFormat& format);
+
+std::optional<GeneratedAsset> AssetCacheRead(
+	std::string_view cacheDir, uint64_t key, std::string_view assetDirPath, const AssetFormat& expectedFormat);
+
+void AssetCacheWrite(
+	std::string_view cacheDir, uint64_t key, std::string_view assetDirPath, const GeneratedAsset& asset);
+
+// Evicts least recently used entries until the cache directory is within its size limit.
+void AssetCacheTrim(std::string_view cacheDir);
+} // namespace detail
+} // namespace eg
@@ -4,7 +4,6 @@
 #include "../String.hpp"
 #include "../Utils.hpp"
 #include "AssetFormat.hpp"
-#include "YAMLUtils.hpp"
 
 #include <memory>
 #include <optional>
@@ -12,6 +11,7 @@
 #include <string>
 #include <string_view>
 #include <vector>
+#include <yaml-cpp/yaml.h>
 
 namespace eg
 {
@@ -85,6 +85,7 @@ class EG_API AssetGenerator
 public:
 	virtual ~AssetGenerator() = default;
 
+	// May be called concurrently from several threads for different assets.
 	virtual bool Generate(AssetGenerateContext& generateContext) = 0;
 };
 
@@ -20,7 +20,8 @@ static bool AssetLoaderLess(const AssetLoader& a, std::string_view b)
 	return a.name < b;
 }
 
-void RegisterAssetLoader(std::string name, AssetLoaderCallback loader, const AssetFormat& format)
+void RegisterAssetLoader(
+	std::string name, AssetLoaderCallback loader, const AssetFormat& format, AssetPrepareCallback prepare)
 {
 	auto it = std::lower_bound(assetLoaders.begin(), assetLoaders.end(), name, &AssetLoaderLess);
 	if (it != assetLoaders.end() && it->name == name)
@@ -28,10 +29,11 @@ void RegisterAssetLoader(std::string name, AssetLoaderCallback loader, const Ass
 		Log(LogLevel::Warning, "as", "Re-registering asset loader '{0}'.", name);
 		it->format = &format;
 		it->callback = std::move(loader);
+		it->prepare = std::move(prepare);
 	}
 	else
 	{
-		assetLoaders.insert(it, AssetLoader{ std::move(name), &format, std::move(loader) });
+		assetLoaders.insert(it, AssetLoader{ std::move(name), &format, std::move(loader), std::move(prepare) });
 	}
 }
 
@@ -43,30 +45,47 @@ const AssetLoader* FindAssetLoader(std::string_view loader)
 	return &*it;
 }
 
-Asset* LoadAsset(const AssetLoader& loader, std::string_view assetPath, std::span<const char> data, Asset* asset)
+Asset* LoadAsset(
+	const AssetLoader& loader, std::string_view assetPath, std::span<const char> data, Asset* asset,
+	std::shared_ptr<void> preparedData)
 {
-	AssetLoadContext context(asset, assetPath, data);
+	if (loader.prepare && preparedData == nullptr)
+	{
+		preparedData = loader.prepare(assetPath, data);
+		if (preparedData == nullptr)
+			return nullptr;
+	}
+
+	AssetLoadContext context(asset, assetPath, data, std::move(preparedData));
 	if (!loader.callback(context))
 		return nullptr;
 
-	if (context.GetAsset() == nullptr)
+	Asset* result = context.GetAsset();
+	if (result == nullptr)
 	{
 		Log(LogLevel::Error, "as", "Asset loader '{0}' returned true but did not call CreateResult.", loader.name);
+		return nullptr;
 	}
 
-	return context.GetAsset();
+	// CreateResult has set cpuBytes to the size of the asset object
+	result->cpuBytes += context.CPUMemoryUsage();
+	result->gpuBytes = context.GPUMemoryUsage();
+
+	return result;
 }
 
-AssetLoadContext::AssetLoadContext(Asset* asset, std::string_view assetPath, std::span<const char> data)
-	: m_asset(asset), m_assetPath(assetPath), m_dirPath(ParentPath(assetPath, true)), m_data(data)
+AssetLoadContext::AssetLoadContext(
+	Asset* asset, std::string_view assetPath, std::span<const char> data, std::shared_ptr<void> preparedData)
+	: m_asset(asset), m_assetPath(assetPath), m_dirPath(ParentPath(assetPath, true)), m_data(data),
+	  m_preparedData(std::move(preparedData))
 {
 }
 
 void detail::RegisterAssetLoaders()
 {
 	RegisterAssetLoader("Shader", &ShaderModuleAsset::AssetLoader, ShaderModuleAsset::AssetFormat);
-	RegisterAssetLoader("Texture2D", &Texture2DLoader, Texture2DAssetFormat);
-	RegisterAssetLoader("Model", &ModelAssetLoader, ModelAssetFormat);
+	RegisterAssetLoader("Texture2D", &Texture2DLoader, Texture2DAssetFormat, &Texture2DPrepare);
+	RegisterAssetLoader("Model", &ModelAssetLoader, ModelAssetFormat, &ModelAssetPrepare);
 	RegisterAssetLoader("ParticleEmitter", &ParticleEmitterType::AssetLoader, ParticleEmitterType::AssetFormat);
 	RegisterAssetLoader("SpriteFont", &SpriteFontLoader, SpriteFontAssetFormat);
 	RegisterAssetLoader("AudioClip", &AudioClipAssetLoader, AudioClipAssetFormat);
@@ -76,6 +95,7 @@ void detail::RegisterAssetLoaders()
 		[](const AssetLoadContext& loadContext)
 		{
 			loadContext.CreateResult<std::string>(loadContext.Data().data(), loadContext.Data().size());
+			loadContext.AddMemoryUsage(loadContext.Data().size(), 0);
 			return true;
 		});
 
@@ -7,6 +7,7 @@
 #include "AssetGenerator.hpp"
 #include "DefaultAssetGenerator.hpp"
 
+#include <memory>
 #include <span>
 
 namespace eg
@@ -14,7 +15,9 @@ namespace eg
 class EG_API AssetLoadContext
 {
 public:
-	AssetLoadContext(Asset* asset, std::string_view assetPath, std::span<const char> data);
+	AssetLoadContext(
+		Asset* asset, std::string_view assetPath, std::span<const char> data,
+		std::shared_ptr<void> preparedData = nullptr);
 
 	/**
 	 * Creates the result asset. The loader must always call this function with the same type T.
@@ -34,6 +37,7 @@ public:
 		{
 			EG_PANIC("eg::AssetLoader::CreateResult called with different asset type upon reload.")
 		}
+		m_asset->cpuBytes = sizeof(T);
 
 		return *(new (m_asset->instance) T(std::forward<A>(args)...));
 	}
@@ -50,6 +54,29 @@ public:
 
 	std::span<const char> Data() const { return m_data; }
 
+	/**
+	 * Gets the state produced by the loader's prepare callback, or nullptr if the loader has none.
+	 * @tparam T The type of the object that the prepare callback created.
+	 */
+	template <typename T>
+	T* PreparedData() const
+	{
+		return static_cast<T*>(m_preparedData.get());
+	}
+
+	/**
+	 * Reports memory owned by the asset in addition to the asset object itself, such as heap allocations (cpu) and
+	 * textures or buffers (gpu). Used by GetAssetMemoryUsage, may be called several times.
+	 */
+	void AddMemoryUsage(uint64_t cpuBytes, uint64_t gpuBytes) const
+	{
+		m_cpuBytes += cpuBytes;
+		m_gpuBytes += gpuBytes;
+	}
+
+	uint64_t CPUMemoryUsage() const { return m_cpuBytes; }
+	uint64_t GPUMemoryUsage() const { return m_gpuBytes; }
+
 	std::string_view AssetPath() const { return m_assetPath; }
 
 	std::string_view DirPath() const { return m_dirPath; }
@@ -59,24 +86,39 @@ private:
 	std::string_view m_assetPath;
 	std::string_view m_dirPath;
 	std::span<const char> m_data;
+	std::shared_ptr<void> m_preparedData;
+	mutable uint64_t m_cpuBytes = 0;
+	mutable uint64_t m_gpuBytes = 0;
 };
 
 using AssetLoaderCallback = std::function<bool(const AssetLoadContext&)>;
 
+/**
+ * Optional first loading stage that may run on a worker thread, concurrently with other assets. It must only do
+ * CPU-side work (no graphics calls or global state) and returns state that is passed on to the loader callback
+ * through AssetLoadContext::PreparedData, or nullptr if preparation failed.
+ */
+using AssetPrepareCallback =
+	std::function<std::shared_ptr<void>(std::string_view assetPath, std::span<const char> data)>;
+
 struct AssetLoader
 {
 	std::string name;
 	const AssetFormat* format;
 	AssetLoaderCallback callback;
+	AssetPrepareCallback prepare;
 };
 
 EG_API const AssetLoader* FindAssetLoader(std::string_view loader);
 
+// Loads an asset, running the loader's prepare callback first unless preparedData is given.
 EG_API Asset* LoadAsset(
-	const AssetLoader& loader, std::string_view assetPath, std::span<const char> data, Asset* asset);
+	const AssetLoader& loader, std::string_view assetPath, std::span<const char> data, Asset* asset,
+	std::shared_ptr<void> preparedData = nullptr);
 
 EG_API void RegisterAssetLoader(
-	std::string name, AssetLoaderCallback loader, const AssetFormat& format = DefaultGeneratorFormat);
+	std::string name, AssetLoaderCallback loader, const AssetFormat& format = DefaultGeneratorFormat,
+	AssetPrepareCallback prepare = nullptr);
 
 namespace detail
 {
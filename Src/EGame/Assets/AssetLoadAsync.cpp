@@ -0,0 +1,319 @@
+#include "AssetLoadAsync.hpp"
+#include "../Log.hpp"
+#include "../MainThreadInvoke.hpp"
+#include "../Platform/FileSystem.hpp"
+#include "../Platform/MemoryMappedFile.hpp"
+#include "../ThreadPool.hpp"
+#include "AssetLoad.hpp"
+#include "EAPFile.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eg
+{
+struct detail::AsyncAssetLoad
+{
+	std::string path;
+	std::string mountPath;
+	int priority = 0;
+	uint64_t sequence = 0;
+
+	// Only accessed by the I/O thread until all assets have been handed to the main thread
+	LinearAllocator allocator;
+#ifndef __EMSCRIPTEN__
+	MemoryMappedFile file;
+#endif
+	std::vector<EAPAsset> assets;
+	bool indexRead = false;
+	size_t nextAssetToPrepare = 0;
+
+	std::atomic<uint32_t> numLoaded{ 0 };
+	std::atomic<uint32_t> numTotal{ 0 };
+	std::atomic_bool failed{ false };
+	std::atomic_bool done{ false };
+
+	void Fail()
+	{
+		failed = true;
+		done = true;
+	}
+};
+
+bool AssetLoadHandle::Done() const
+{
+	return m_load == nullptr || m_load->done.load();
+}
+
+bool AssetLoadHandle::Failed() const
+{
+	return m_load != nullptr && m_load->failed.load();
+}
+
+uint32_t AssetLoadHandle::NumLoaded() const
+{
+	return m_load == nullptr ? 0 : m_load->numLoaded.load();
+}
+
+uint32_t AssetLoadHandle::NumTotal() const
+{
+	return m_load == nullptr ? 0 : m_load->numTotal.load();
+}
+
+float AssetLoadHandle::Progress() const
+{
+	if (Done())
+		return 1.0f;
+	const uint32_t numTotal = NumTotal();
+	return numTotal == 0 ? 0.0f : static_cast<float>(NumLoaded()) / static_cast<float>(numTotal);
+}
+
+// Loads the whole asset directory on the main thread, used for asset lists that must be generated
+static void LoadAssetsOnMainThread(std::shared_ptr<detail::AsyncAssetLoad> load)
+{
+	MainThreadInvoke(
+		[load]
+		{
+			if (LoadAssets(load->path, load->mountPath))
+			{
+				load->numTotal = 1;
+				load->numLoaded = 1;
+				load->done = true;
+			}
+			else
+			{
+				load->Fail();
+			}
+		});
+}
+
+#ifndef __EMSCRIPTEN__
+// Reads the package index, returns false if the load has been handed off or has failed
+static bool ReadAsyncLoadIndex(const std::shared_ptr<detail::AsyncAssetLoad>& load)
+{
+	load->indexRead = true;
+
+	if (FileExists((load->path + "/Assets.yaml").c_str()))
+	{
+		LoadAssetsOnMainThread(load);
+		return false;
+	}
+
+	// Indexed packages are decompressed batch by batch later, other packages are decompressed while reading
+	const std::string eapPath = load->path + ".eap";
+	std::optional<std::vector<EAPAsset>> assets;
+	bool alreadyDecompressed = false;
+	if (load->file.Open(eapPath.c_str()))
+	{
+		assets = ReadEAPFileIndex(load->file.Data(), load->allocator);
+		if (!assets.has_value())
+		{
+			assets = ReadEAPFile(load->file.Data(), load->allocator);
+			alreadyDecompressed = true;
+		}
+	}
+	else if (std::ifstream stream(eapPath, std::ios::binary); stream)
+	{
+		assets = ReadEAPFile(stream, load->allocator);
+		alreadyDecompressed = true;
+	}
+
+	if (!assets.has_value())
+	{
+		Log(LogLevel::Error, "as", "Failed to load assets from '{0}' asynchronously.", load->path);
+		load->Fail();
+		return false;
+	}
+
+	for (EAPAsset& eapAsset : *assets)
+	{
+		if (!detail::CheckEAPAssetLoader(eapAsset))
+		{
+			load->Fail();
+			return false;
+		}
+		if (alreadyDecompressed)
+			eapAsset.codec = CompressionCodec::None;
+	}
+
+	load->assets = std::move(*assets);
+	load->numTotal = UnsignedNarrow<uint32_t>(load->assets.size());
+	if (load->assets.empty())
+	{
+		load->done = true;
+		return false;
+	}
+	return true;
+}
+
+// Decompresses and prepares the next batch of assets on the shared pool, then hands them to the main thread in
+//  package order. Returns false once all assets have been handed off.
+static bool PrepareAsyncLoadBatch(const std::shared_ptr<detail::AsyncAssetLoad>& load)
+{
+	ThreadPool& threadPool = SharedThreadPool();
+
+	const size_t batchBegin = load->nextAssetToPrepare;
+	const size_t batchSize = std::min<size_t>(load->assets.size() - batchBegin, threadPool.NumWorkers() + 1);
+	load->nextAssetToPrepare += batchSize;
+
+	struct PreparedAsset
+	{
+		bool ok = false;
+		std::shared_ptr<void> preparedData;
+	};
+	std::vector<PreparedAsset> prepared(batchSize);
+
+	// The main thread releases the package once the last asset has loaded, so this must be decided up front
+	const bool morePending = load->nextAssetToPrepare < load->assets.size();
+
+	threadPool.ParallelFor(
+		batchSize, 1,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const EAPAsset& eapAsset = load->assets[batchBegin + i];
+				if (eapAsset.codec != CompressionCodec::None && !DecompressEAPAsset(eapAsset))
+				{
+					Log(LogLevel::Error, "as", "EAP asset '{0}' failed to decompress.", eapAsset.assetName);
+					continue;
+				}
+				if (eapAsset.loader->prepare)
+				{
+					std::shared_ptr<void> preparedData =
+						eapAsset.loader->prepare(eapAsset.assetName, eapAsset.generatedAssetData);
+					if (preparedData == nullptr)
+						continue;
+					prepared[i].preparedData = std::move(preparedData);
+				}
+				prepared[i].ok = true;
+			}
+		});
+
+	for (size_t i = 0; i < batchSize; i++)
+	{
+		MainThreadInvoke(
+			[load, index = batchBegin + i, ok = prepared[i].ok, preparedData = std::move(prepared[i].preparedData)]
+			{
+				if (load->failed)
+					return;
+
+				if (!ok || !detail::LoadEAPAsset(load->assets[index], load->mountPath, preparedData))
+				{
+					load->Fail();
+					return;
+				}
+
+				// Package memory is no longer needed once the last asset has loaded
+				if (load->numLoaded + 1 == load->numTotal)
+				{
+					load->assets.clear();
+					load->file.Close();
+					load->allocator.Reset();
+				}
+				if (++load->numLoaded == load->numTotal)
+					load->done = true;
+			});
+	}
+
+	return morePending;
+}
+
+// Background thread that processes pending loads by priority, one batch of assets at a time
+class AsyncAssetLoadThread
+{
+public:
+	AsyncAssetLoadThread()
+	{
+		// Creates the shared pool first so that it is destroyed after this thread has been joined
+		SharedThreadPool();
+		m_thread = std::thread(&AsyncAssetLoadThread::ThreadTarget, this);
+	}
+
+	~AsyncAssetLoadThread()
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stop = true;
+		}
+		m_loadAddedSignal.notify_one();
+		m_thread.join();
+	}
+
+	void Add(std::shared_ptr<detail::AsyncAssetLoad> load)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			load->sequence = m_nextSequence++;
+			m_pendingLoads.push_back(std::move(load));
+		}
+		m_loadAddedSignal.notify_one();
+	}
+
+private:
+	void ThreadTarget()
+	{
+		while (true)
+		{
+			std::shared_ptr<detail::AsyncAssetLoad> load;
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_loadAddedSignal.wait(lock, [&] { return m_stop || !m_pendingLoads.empty(); });
+				if (m_stop)
+					return;
+
+				// Higher priority first, then in the order loads were started
+				load = *std::min_element(
+					m_pendingLoads.begin(), m_pendingLoads.end(),
+					[](const auto& a, const auto& b)
+					{ return a->priority != b->priority ? a->priority > b->priority : a->sequence < b->sequence; });
+			}
+
+			bool morePending;
+			if (load->failed)
+				morePending = false;
+			else if (!load->indexRead)
+				morePending = ReadAsyncLoadIndex(load);
+			else
+				morePending = PrepareAsyncLoadBatch(load);
+
+			if (!morePending)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_pendingLoads.erase(std::find(m_pendingLoads.begin(), m_pendingLoads.end(), load));
+			}
+		}
+	}
+
+	std::mutex m_mutex;
+	std::condition_variable m_loadAddedSignal;
+	std::vector<std::shared_ptr<detail::AsyncAssetLoad>> m_pendingLoads;
+	uint64_t m_nextSequence = 0;
+	bool m_stop = false;
+
+	std::thread m_thread;
+};
+#endif
+
+AssetLoadHandle LoadAssetsAsync(std::string path, std::string mountPath, int priority)
+{
+	auto load = std::make_shared<detail::AsyncAssetLoad>();
+	load->path = std::move(path);
+	load->mountPath = std::move(mountPath);
+	load->priority = priority;
+
+#ifdef __EMSCRIPTEN__
+	// There is no I/O thread without thread support, so the assets are loaded at the end of the frame instead
+	LoadAssetsOnMainThread(load);
+#else
+	static AsyncAssetLoadThread loadThread;
+	loadThread.Add(load);
+#endif
+
+	return AssetLoadHandle(std::move(load));
+}
+} // namespace eg
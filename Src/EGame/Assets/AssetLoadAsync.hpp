@@ -0,0 +1,99 @@
+#pragma once
+
+#include "../API.hpp"
+#include "Asset.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace eg
+{
+namespace detail
+{
+struct AsyncAssetLoad;
+} // namespace detail
+
+// Tracks an asynchronous load started by LoadAssetsAsync. Copies refer to the same load.
+class EG_API AssetLoadHandle
+{
+public:
+	AssetLoadHandle() = default;
+
+	explicit AssetLoadHandle(std::shared_ptr<detail::AsyncAssetLoad> load) : m_load(std::move(load)) {}
+
+	// True once every asset has been loaded, or the load has failed
+	bool Done() const;
+
+	bool Failed() const;
+
+	// Number of assets that have been loaded so far, and the total (zero until the package index has been read)
+	uint32_t NumLoaded() const;
+	uint32_t NumTotal() const;
+
+	// Fraction of assets loaded, in [0, 1]
+	float Progress() const;
+
+	bool IsValid() const { return m_load != nullptr; }
+
+private:
+	std::shared_ptr<detail::AsyncAssetLoad> m_load;
+};
+
+/**
+ * Starts loading assets from path (like LoadAssets) without blocking. The package is read, decompressed and
+ * prepared on a background I/O thread, and each asset is then finished on the main thread through
+ * MainThreadInvoke, so assets become available one by one over the following frames.
+ * Loads with higher priority are processed first. When only an Assets.yaml list exists, the assets are generated
+ * and loaded in one go on the main thread, as that is a development only path.
+ */
+EG_API AssetLoadHandle LoadAssetsAsync(std::string path, std::string mountPath, int priority = 0);
+
+namespace detail
+{
+// Incremented by UnloadAssets so that AssetHandle can tell when its cached pointer is stale
+extern EG_API std::atomic<uint64_t> assetsUnloadCounter;
+} // namespace detail
+
+// Refers to an asset by path, which may not have been loaded yet. The pointer is cached once the asset is found.
+template <typename T>
+class AssetHandle
+{
+public:
+	AssetHandle() = default;
+
+	explicit AssetHandle(std::string_view path) : m_path(path) {}
+
+	// Returns the asset, or nullptr if it has not been loaded (yet)
+	T* Get() const
+	{
+		const uint64_t unloadCounter = detail::assetsUnloadCounter.load(std::memory_order_relaxed);
+		if (m_asset == nullptr || m_unloadCounter != unloadCounter)
+		{
+			m_asset = FindAsset<T>(m_path);
+			m_unloadCounter = unloadCounter;
+		}
+		return m_asset;
+	}
+
+	bool Ready() const { return Get() != nullptr; }
+
+	const std::string& Path() const { return m_path; }
+
+	T* operator->() const
+	{
+		T* asset = Get();
+		EG_ASSERT(asset != nullptr);
+		return asset;
+	}
+
+	T& operator*() const { return *operator->(); }
+
+private:
+	std::string m_path;
+	mutable T* m_asset = nullptr;
+	mutable uint64_t m_unloadCounter = 0;
+};
+} // namespace eg
@@ -19,6 +19,7 @@ bool AudioClipAssetLoader(const AssetLoadContext& loadContext)
 		reinterpret_cast<const int16_t*>(loadContext.Data().data() + sizeof(uint32_t) + sizeof(uint64_t) * 2), samples);
 
 	loadContext.CreateResult<AudioClip>(sampleData, channelCount == 2, frequency);
+	loadContext.AddMemoryUsage(sampleData.size_bytes(), 0);
 	return true;
 }
 } // namespace eg
@@ -2,6 +2,7 @@
 #include "../Alloc/LinearAllocator.hpp"
 #include "../Compression.hpp"
 #include "../IOUtils.hpp"
+#include "../Log.hpp"
 #include "AssetLoad.hpp"
 
 #include <algorithm>
@@ -11,8 +12,28 @@
 
 namespace eg
 {
+// Magic for legacy packages where every asset is stored inline after its header
 static const char EAPMagic[] = { -1, 'E', 'A', 'P' };
 
+// Magic for indexed packages, followed by a version number and a table of contents
+static const char EAPIndexedMagic[] = { -1, 'E', 'A', 'X' };
+// Version 1 stored a compressed flag where version 2 stores a codec id, flag values 0 and 1 map to None and Zlib.
+static constexpr uint32_t EAP_INDEXED_VERSION = 2;
+static constexpr uint32_t EAP_MIN_INDEXED_VERSION = 1;
+
+// Asset data in indexed packages is aligned to this many bytes so that it can be used in place
+static constexpr uint64_t EAP_DATA_ALIGNMENT = 16;
+
+// Size of a table of contents entry, excluding the asset name
+static constexpr uint64_t EAP_TOC_ENTRY_BYTES = sizeof(uint16_t) + sizeof(uint32_t) * 4 + sizeof(uint64_t) * 3;
+
+struct EAPIndexEntry
+{
+	uint64_t offset;
+	uint64_t dataBytes;
+	uint64_t storedBytes;
+};
+
 void WriteEAPFile(std::span<const EAPAsset> assets, std::ostream& stream)
 {
 	if (assets.size() > UINT32_MAX)
@@ -20,9 +41,6 @@ void WriteEAPFile(std::span<const EAPAsset> assets, std::ostream& stream)
 		EG_PANIC("Too many assets for WriteEAPFile")
 	}
 
-	stream.write(EAPMagic, sizeof(EAPMagic));
-	BinWrite(stream, UnsignedNarrow<uint32_t>(assets.size()));
-
 	// Extracts loader names and deduplicates them
 	std::vector<std::string_view> loaderNames;
 	for (const EAPAsset& asset : assets)
@@ -30,80 +48,133 @@ void WriteEAPFile(std::span<const EAPAsset> assets, std::ostream& stream)
 	std::sort(loaderNames.begin(), loaderNames.end());
 	loaderNames.erase(std::unique(loaderNames.begin(), loaderNames.end()), loaderNames.end());
 
+	// Compresses assets up front so that the table of contents can store final offsets and sizes
+	std::vector<std::vector<char>> compressedData(assets.size());
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (assets[i].codec != CompressionCodec::None)
+		{
+			compressedData[i] =
+				Compress(assets[i].codec, assets[i].generatedAssetData.data(), assets[i].generatedAssetData.size());
+		}
+	}
+
+	uint64_t headerBytes = sizeof(EAPIndexedMagic) + sizeof(uint32_t) * 3;
+	for (std::string_view loader : loaderNames)
+		headerBytes += sizeof(uint16_t) + loader.size();
+	for (const EAPAsset& asset : assets)
+		headerBytes += EAP_TOC_ENTRY_BYTES + asset.assetName.size();
+
+	stream.write(EAPIndexedMagic, sizeof(EAPIndexedMagic));
+	BinWrite(stream, EAP_INDEXED_VERSION);
+	BinWrite(stream, UnsignedNarrow<uint32_t>(assets.size()));
+
 	// Writes loader names
 	BinWrite(stream, UnsignedNarrow<uint32_t>(loaderNames.size()));
 	for (std::string_view loader : loaderNames)
 		BinWriteString(stream, loader);
 
-	for (const EAPAsset& asset : assets)
+	// Writes the table of contents
+	uint64_t dataOffset = RoundToNextMultiple(headerBytes, EAP_DATA_ALIGNMENT);
+	for (size_t i = 0; i < assets.size(); i++)
 	{
+		const EAPAsset& asset = assets[i];
+
 		int64_t loaderIndex =
 			std::lower_bound(loaderNames.begin(), loaderNames.end(), asset.loaderName) - loaderNames.begin();
 		EG_ASSERT(loaderIndex >= 0 && loaderIndex < ToInt64(loaderNames.size()));
 
+		const bool compressed = asset.codec != CompressionCodec::None;
+		const uint64_t storedBytes = compressed ? compressedData[i].size() : asset.generatedAssetData.size();
+
 		BinWriteString(stream, asset.assetName);
 		BinWrite(stream, UnsignedNarrow<uint32_t>(ToUnsigned(loaderIndex)));
 		BinWrite(stream, asset.format.nameHash);
 		BinWrite(stream, asset.format.version);
+		BinWrite(stream, static_cast<uint32_t>(asset.codec));
+		BinWrite(stream, dataOffset);
+		BinWrite(stream, static_cast<uint64_t>(asset.generatedAssetData.size()));
+		BinWrite(stream, storedBytes);
 
-		uint64_t dataBytes = asset.generatedAssetData.size();
-		EG_ASSERT(dataBytes < 0x8000000000000000ULL);
-		if (asset.compress)
-			dataBytes |= 0x8000000000000000ULL;
+		dataOffset = RoundToNextMultiple(dataOffset + storedBytes, EAP_DATA_ALIGNMENT);
+	}
 
-		BinWrite(stream, dataBytes);
+	// Writes asset data
+	static const char padding[EAP_DATA_ALIGNMENT] = {};
+	uint64_t streamPos = headerBytes;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		const uint64_t alignedPos = RoundToNextMultiple(streamPos, EAP_DATA_ALIGNMENT);
+		stream.write(padding, static_cast<std::streamsize>(alignedPos - streamPos));
 
-		if (asset.compress)
-		{
-			WriteCompressedSection(stream, asset.generatedAssetData.data(), dataBytes);
-		}
-		else
-		{
-			stream.write(asset.generatedAssetData.data(), dataBytes);
-		}
+		std::span<const char> data = assets[i].generatedAssetData;
+		if (assets[i].codec != CompressionCodec::None)
+			data = compressedData[i];
+
+		stream.write(data.data(), static_cast<std::streamsize>(data.size()));
+		streamPos = alignedPos + data.size();
 	}
 }
 
-std::optional<std::vector<EAPAsset>> ReadEAPFile(std::istream& stream, LinearAllocator& allocator)
+static bool ReadLoaderNames(
+	std::istream& stream, std::vector<std::string>& loaderNames, std::vector<const AssetLoader*>& loaders)
 {
-	char magic[sizeof(EAPMagic)];
-	stream.read(magic, sizeof(magic));
-	if (std::memcmp(magic, EAPMagic, sizeof(magic)) != 0)
-		return {};
-
-	const uint32_t numAssets = BinRead<uint32_t>(stream);
 	const uint32_t numLoaderNames = BinRead<uint32_t>(stream);
-	std::vector<std::string> loaderNames(numLoaderNames);
-	std::vector<const AssetLoader*> loaders(numLoaderNames);
+	if (!stream)
+		return false;
+
+	loaderNames.resize(numLoaderNames);
+	loaders.resize(numLoaderNames);
 	for (uint32_t i = 0; i < numLoaderNames; i++)
 	{
 		loaderNames[i] = BinReadString(stream);
 		loaders[i] = FindAssetLoader(loaderNames[i]);
 	}
+	return static_cast<bool>(stream);
+}
+
+static bool ReadAssetHeader(
+	std::istream& stream, EAPAsset& asset, std::span<const std::string> loaderNames,
+	std::span<const AssetLoader* const> loaders)
+{
+	asset.assetName = BinReadString(stream);
+
+	uint32_t loaderIndex = BinRead<uint32_t>(stream);
+	if (!stream || loaderIndex >= loaderNames.size())
+		return false;
+	asset.loaderName = loaderNames[loaderIndex];
+	asset.loader = loaders[loaderIndex];
+
+	asset.format.nameHash = BinRead<uint32_t>(stream);
+	asset.format.version = BinRead<uint32_t>(stream);
+	return true;
+}
+
+static std::optional<std::vector<EAPAsset>> ReadLegacyEAPFile(std::istream& stream, LinearAllocator& allocator)
+{
+	const uint32_t numAssets = BinRead<uint32_t>(stream);
+
+	std::vector<std::string> loaderNames;
+	std::vector<const AssetLoader*> loaders;
+	if (!ReadLoaderNames(stream, loaderNames, loaders))
+		return {};
 
 	std::vector<EAPAsset> assets(numAssets);
 
 	for (uint32_t i = 0; i < numAssets; i++)
 	{
-		assets[i].assetName = BinReadString(stream);
-
-		uint32_t loaderIndex = BinRead<uint32_t>(stream);
-		if (loaderIndex >= numLoaderNames)
+		if (!ReadAssetHeader(stream, assets[i], loaderNames, loaders))
 			return {};
-		assets[i].loaderName = loaderNames[loaderIndex];
-		assets[i].loader = loaders[loaderIndex];
-
-		assets[i].format.nameHash = BinRead<uint32_t>(stream);
-		assets[i].format.version = BinRead<uint32_t>(stream);
 
 		uint64_t dataBytes = BinRead<uint64_t>(stream);
-		assets[i].compress = (dataBytes & 0x8000000000000000ULL) != 0;
+		const bool compressed = (dataBytes & 0x8000000000000000ULL) != 0;
+		assets[i].codec = compressed ? CompressionCodec::Zlib : CompressionCodec::None;
 		dataBytes &= ~0x8000000000000000ULL;
 
 		char* generatedAssetData = static_cast<char*>(allocator.Allocate(dataBytes));
 		assets[i].generatedAssetData = std::span<const char>(generatedAssetData, dataBytes);
 
-		if (assets[i].compress)
+		if (compressed)
 		{
 			ReadCompressedSection(stream, generatedAssetData, dataBytes, &assets[i].compressedSize);
 		}
@@ -115,4 +186,173 @@ std::optional<std::vector<EAPAsset>> ReadEAPFile(std::istream& stream, LinearAll
 
 	return assets;
 }
+
+// Reads the version, loader names and table of contents of an indexed package.
+//  The stream must be positioned directly after the magic.
+static bool ReadEAPIndex(std::istream& stream, std::vector<EAPAsset>& assets, std::vector<EAPIndexEntry>& entries)
+{
+	const uint32_t version = BinRead<uint32_t>(stream);
+	if (!stream || version < EAP_MIN_INDEXED_VERSION || version > EAP_INDEXED_VERSION)
+		return false;
+
+	const uint32_t numAssets = BinRead<uint32_t>(stream);
+
+	std::vector<std::string> loaderNames;
+	std::vector<const AssetLoader*> loaders;
+	if (!ReadLoaderNames(stream, loaderNames, loaders))
+		return false;
+
+	assets.resize(numAssets);
+	entries.resize(numAssets);
+	for (uint32_t i = 0; i < numAssets; i++)
+	{
+		if (!ReadAssetHeader(stream, assets[i], loaderNames, loaders))
+			return false;
+
+		const uint32_t codec = BinRead<uint32_t>(stream);
+		entries[i].offset = BinRead<uint64_t>(stream);
+		entries[i].dataBytes = BinRead<uint64_t>(stream);
+		entries[i].storedBytes = BinRead<uint64_t>(stream);
+
+		if (codec > static_cast<uint32_t>(MAX_COMPRESSION_CODEC))
+			return false;
+		assets[i].codec = static_cast<CompressionCodec>(codec);
+		if (!IsCompressionCodecSupported(assets[i].codec))
+		{
+			Log(LogLevel::Error, "as", "Asset {0} uses unsupported compression codec {1}", assets[i].assetName,
+			    CompressionCodecName(assets[i].codec));
+			return false;
+		}
+
+		const bool compressed = assets[i].codec != CompressionCodec::None;
+		assets[i].compressedSize = compressed ? entries[i].storedBytes : 0;
+
+		if (!compressed && entries[i].storedBytes != entries[i].dataBytes)
+			return false;
+		if (i != 0 && entries[i].offset < entries[i - 1].offset + entries[i - 1].storedBytes)
+			return false;
+	}
+
+	return static_cast<bool>(stream);
+}
+
+bool DecompressEAPAsset(const EAPAsset& asset)
+{
+	if (asset.generatedAssetData.empty())
+		return true;
+
+	// The output memory was allocated by the reader, so it is not actually const
+	char* output = const_cast<char*>(asset.generatedAssetData.data());
+	return Decompress(
+		asset.codec, asset.compressedData.data(), asset.compressedData.size(), output, asset.generatedAssetData.size());
+}
+
+std::optional<std::vector<EAPAsset>> ReadEAPFile(std::istream& stream, LinearAllocator& allocator)
+{
+	char magic[sizeof(EAPMagic)];
+	stream.read(magic, sizeof(magic));
+	if (std::memcmp(magic, EAPMagic, sizeof(magic)) == 0)
+		return ReadLegacyEAPFile(stream, allocator);
+	if (std::memcmp(magic, EAPIndexedMagic, sizeof(magic)) != 0)
+		return {};
+
+	std::vector<EAPAsset> assets;
+	std::vector<EAPIndexEntry> entries;
+	if (!ReadEAPIndex(stream, assets, entries))
+		return {};
+
+	const std::streamoff headerEnd = stream.tellg();
+	if (headerEnd < 0)
+		return {};
+
+	// Asset data is stored in table of contents order, so it can be read without seeking backwards
+	uint64_t streamPos = static_cast<uint64_t>(headerEnd);
+	std::vector<char> compressedData;
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (entries[i].offset < streamPos)
+			return {};
+		stream.ignore(static_cast<std::streamsize>(entries[i].offset - streamPos));
+
+		char* generatedAssetData = static_cast<char*>(allocator.Allocate(entries[i].dataBytes));
+		assets[i].generatedAssetData = std::span<const char>(generatedAssetData, entries[i].dataBytes);
+
+		if (assets[i].codec != CompressionCodec::None)
+		{
+			compressedData.resize(entries[i].storedBytes);
+			stream.read(compressedData.data(), static_cast<std::streamsize>(compressedData.size()));
+			assets[i].compressedData = compressedData;
+			if (!stream || !DecompressEAPAsset(assets[i]))
+				return {};
+			assets[i].compressedData = {};
+		}
+		else
+		{
+			stream.read(generatedAssetData, static_cast<std::streamsize>(entries[i].dataBytes));
+			if (!stream)
+				return {};
+		}
+
+		streamPos = entries[i].offset + entries[i].storedBytes;
+	}
+
+	return assets;
+}
+
+std::optional<std::vector<EAPAsset>> ReadEAPFileIndex(std::span<const char> fileData, LinearAllocator& allocator)
+{
+	MemoryStreambuf streambuf(fileData);
+	std::istream stream(&streambuf);
+
+	char magic[sizeof(EAPIndexedMagic)];
+	stream.read(magic, sizeof(magic));
+	if (!stream || std::memcmp(magic, EAPIndexedMagic, sizeof(magic)) != 0)
+		return {};
+
+	std::vector<EAPAsset> assets;
+	std::vector<EAPIndexEntry> entries;
+	if (!ReadEAPIndex(stream, assets, entries))
+		return {};
+
+	for (size_t i = 0; i < assets.size(); i++)
+	{
+		if (entries[i].offset > fileData.size() || entries[i].storedBytes > fileData.size() - entries[i].offset)
+			return {};
+
+		std::span<const char> storedData = fileData.subspan(entries[i].offset, entries[i].storedBytes);
+		if (assets[i].codec != CompressionCodec::None)
+		{
+			char* generatedAssetData = static_cast<char*>(allocator.Allocate(entries[i].dataBytes));
+			assets[i].generatedAssetData = std::span<const char>(generatedAssetData, entries[i].dataBytes);
+			assets[i].compressedData = storedData;
+		}
+		else
+		{
+			assets[i].generatedAssetData = storedData;
+		}
+	}
+
+	return assets;
+}
+
+std::optional<std::vector<EAPAsset>> ReadEAPFile(std::span<const char> fileData, LinearAllocator& allocator)
+{
+	std::optional<std::vector<EAPAsset>> assets = ReadEAPFileIndex(fileData, allocator);
+	if (!assets.has_value())
+	{
+		// Not an indexed package, falls back to reading through a stream
+		MemoryStreambuf streambuf(fileData);
+		std::istream stream(&streambuf);
+		return ReadEAPFile(stream, allocator);
+	}
+
+	for (EAPAsset& asset : *assets)
+	{
+		if (asset.codec != CompressionCodec::None && !DecompressEAPAsset(asset))
+			return {};
+		asset.compressedData = {};
+	}
+
+	return assets;
+}
 } // namespace eg
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../API.hpp"
+#include "../Compression.hpp"
 #include "AssetFormat.hpp"
 
 #include <cstdint>
@@ -19,15 +20,36 @@ struct EAPAsset
 	std::string loaderName;
 	AssetFormat format;
 	std::span<const char> generatedAssetData;
-	bool compress = true;
+	CompressionCodec codec = CompressionCodec::Zlib;
 
 	// Not needed for WriteEAPFile, may be nullptr if no loader was found
 	const class AssetLoader* loader = nullptr;
 
 	// Not needed for WriteEAPFile, will be zero if the asset was not compressed
 	uint64_t compressedSize = 0;
+
+	// Only set by ReadEAPFileIndex for compressed assets. Until DecompressEAPAsset has been called,
+	//  generatedAssetData refers to uninitialized memory of the right size.
+	std::span<const char> compressedData;
 };
 
+// Writes an indexed EAP file, where a table of contents with offsets and sizes precedes the asset data.
 EG_API void WriteEAPFile(std::span<const EAPAsset> assets, std::ostream& stream);
+
+// Reads an EAP file (indexed or legacy) from a stream, copying all asset data into allocator.
 EG_API std::optional<std::vector<EAPAsset>> ReadEAPFile(std::istream& stream, class LinearAllocator& allocator);
+
+// Reads an EAP file that is already in memory (for example a memory mapped file).
+//  For indexed files, uncompressed assets reference fileData directly without copying, so fileData
+//  must outlive the returned assets. Compressed assets are decompressed into allocator.
+EG_API std::optional<std::vector<EAPAsset>> ReadEAPFile(
+	std::span<const char> fileData, class LinearAllocator& allocator);
+
+// Reads only the table of contents of an indexed EAP file in memory, without decompressing anything.
+//  Compressed assets get output memory from allocator and must be decompressed with DecompressEAPAsset,
+//  which may be done concurrently for different assets. Returns nullopt for legacy files.
+EG_API std::optional<std::vector<EAPAsset>> ReadEAPFileIndex(
+	std::span<const char> fileData, class LinearAllocator& allocator);
+
+EG_API bool DecompressEAPAsset(const EAPAsset& asset);
 } // namespace eg
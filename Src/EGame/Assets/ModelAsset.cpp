@@ -1,16 +1,30 @@
 #include "ModelAsset.hpp"
 #include "../Assert.hpp"
+#include "../Graphics/StdVertex.hpp"
 #include "AssetLoad.hpp"
 
+#include <iomanip>
+#include <ostream>
+
 namespace eg
 {
-const AssetFormat ModelAssetFormat{ "EG::Model", 4 };
+const AssetFormat ModelAssetFormat{ "EG::Model", 5 };
 
 std::vector<detail::ModelVertexType> detail::modelVertexTypes;
 
-bool ModelAssetLoader(const AssetLoadContext& loadContext)
+struct ModelAssetPrepared
+{
+	explicit ModelAssetPrepared(ModelBuilderUnformatted _modelBuilder) : modelBuilder(std::move(_modelBuilder)) {}
+
+	ModelBuilderUnformatted modelBuilder;
+	bool hasAnimationData = false;
+	Skeleton skeleton;
+	std::vector<Animation> animations;
+};
+
+std::shared_ptr<void> ModelAssetPrepare(std::string_view assetPath, std::span<const char> data)
 {
-	MemoryStreambuf streamBuf(loadContext.Data());
+	MemoryStreambuf streamBuf(data);
 	std::istream stream(&streamBuf);
 
 	const uint32_t nameHash = BinRead<uint32_t>(stream);
@@ -21,12 +35,15 @@ bool ModelAssetLoader(const AssetLoadContext& loadContext)
 	if (vertexTypeIt == detail::modelVertexTypes.end())
 	{
 		Log(LogLevel::Error, "as", "Unknown model vertex type with hash {0}.", nameHash);
-		return false;
+		return nullptr;
 	}
 
-	ModelBuilderUnformatted modelBuilder(
-		vertexTypeIt->type, vertexTypeIt->size, std::type_index(typeid(uint32_t)), sizeof(uint32_t), IndexType::UInt32);
+	auto prepared = std::make_shared<ModelAssetPrepared>(ModelBuilderUnformatted(
+		vertexTypeIt->type, vertexTypeIt->size, std::type_index(typeid(uint32_t)), sizeof(uint32_t),
+		IndexType::UInt32));
+	ModelBuilderUnformatted& modelBuilder = prepared->modelBuilder;
 
+	size_t numMeshes = 0;
 	while (true)
 	{
 		const uint32_t numVertices = BinRead<uint32_t>(stream);
@@ -60,30 +77,120 @@ bool ModelAssetLoader(const AssetLoadContext& loadContext)
 
 		stream.read(static_cast<char*>(vertices), numVertices * vertexTypeIt->size);
 		stream.read(static_cast<char*>(indices), numIndices * sizeof(uint32_t));
+		numMeshes++;
 	}
 
-	Model& model = loadContext.CreateResult<Model>();
-	model = modelBuilder.CreateAndReset();
-
 	if (uint32_t numAnimationsPlus1 = BinRead<uint32_t>(stream))
 	{
-		model.skeleton = Skeleton::Deserialize(stream);
+		prepared->hasAnimationData = true;
+		prepared->skeleton = Skeleton::Deserialize(stream);
 
-		const size_t numTargets = model.skeleton.NumBones() + model.NumMeshes();
+		const size_t numTargets = prepared->skeleton.NumBones() + numMeshes;
 
-		std::vector<Animation> animations;
-		animations.reserve(numAnimationsPlus1 - 1);
+		prepared->animations.reserve(numAnimationsPlus1 - 1);
 		for (uint32_t i = 1; i < numAnimationsPlus1; i++)
 		{
-			animations.emplace_back(numTargets).Deserialize(stream);
+			prepared->animations.emplace_back(numTargets).Deserialize(stream);
 		}
+	}
+
+	return prepared;
+}
+
+bool ModelAssetLoader(const AssetLoadContext& loadContext)
+{
+	ModelAssetPrepared* prepared = loadContext.PreparedData<ModelAssetPrepared>();
+	EG_ASSERT(prepared != nullptr);
+
+	// Only the buffer upload is left at this point, everything else was parsed by ModelAssetPrepare
+	Model& model = loadContext.CreateResult<Model>();
+	model = prepared->modelBuilder.CreateAndReset();
 
-		model.SetAnimations(std::move(animations));
+	if (prepared->hasAnimationData)
+	{
+		model.skeleton = std::move(prepared->skeleton);
+		model.SetAnimations(std::move(prepared->animations));
 	}
 
+	loadContext.AddMemoryUsage(model.CPUDataBytes(), model.GPUDataBytes());
+
 	return true;
 }
 
+// Finds the size of a vertex type, the standard types are also checked since asset tools don't register them
+static std::optional<size_t> FindModelVertexSize(uint32_t nameHash)
+{
+	for (const detail::ModelVertexType& type : detail::modelVertexTypes)
+	{
+		if (type.nameHash == nameHash)
+			return type.size;
+	}
+	if (nameHash == StdVertex::Name.hash)
+		return sizeof(StdVertex);
+	if (nameHash == StdVertexAnim8::Name.hash)
+		return sizeof(StdVertexAnim8);
+	if (nameHash == StdVertexAnim16::Name.hash)
+		return sizeof(StdVertexAnim16);
+	return std::nullopt;
+}
+
+void ModelAssetPrintAnimationInfo(std::span<const char> data, std::ostream& outStream)
+{
+	MemoryStreambuf streamBuf(data);
+	std::istream stream(&streamBuf);
+
+	const std::optional<size_t> vertexSize = FindModelVertexSize(BinRead<uint32_t>(stream));
+	if (!vertexSize.has_value())
+	{
+		outStream << " unknown vertex type" << std::endl;
+		return;
+	}
+
+	// Skips over the meshes, only their number is needed to deserialize animations
+	size_t numMeshes = 0;
+	while (const uint32_t numVertices = BinRead<uint32_t>(stream))
+	{
+		const uint32_t numIndices = BinRead<uint32_t>(stream);
+		BinRead<uint8_t>(stream);
+		BinReadString(stream);
+		BinReadString(stream);
+		stream.ignore(static_cast<std::streamsize>(
+			sizeof(float) * 10 + numVertices * *vertexSize + numIndices * sizeof(uint32_t)));
+		numMeshes++;
+	}
+
+	const uint32_t numAnimationsPlus1 = BinRead<uint32_t>(stream);
+	if (numAnimationsPlus1 <= 1)
+	{
+		outStream << " no animations" << std::endl;
+		return;
+	}
+
+	const Skeleton skeleton = Skeleton::Deserialize(stream);
+	for (uint32_t i = 1; i < numAnimationsPlus1; i++)
+	{
+		Animation animation(skeleton.NumBones() + numMeshes);
+		animation.Deserialize(stream);
+
+		outStream << " " << animation.name << ": " << ReadableBytesSize(animation.DataBytes());
+		if (animation.IsCompressed())
+		{
+			const AnimationCompressionInfo& info = animation.compressionInfo;
+			const uint64_t savedBytes =
+				info.uncompressedBytes - std::min<uint64_t>(info.uncompressedBytes, animation.DataBytes());
+			outStream << " (saved " << ReadableBytesSize(savedBytes) << " of "
+					  << ReadableBytesSize(info.uncompressedBytes) << ")" << std::setprecision(3)
+					  << " max error rotation: " << glm::degrees(info.maxRotationError) << "deg"
+					  << " translation: " << info.maxTranslationError << " scale: " << info.maxScaleError;
+		}
+		else
+		{
+			outStream << " (uncompressed)";
+		}
+		outStream << std::endl;
+	}
+}
+
 MeshAccess ParseMeshAccessMode(std::string_view accessModeString, MeshAccess def)
 {
 	if (accessModeString == "gpu")
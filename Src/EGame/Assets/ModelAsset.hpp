@@ -7,6 +7,7 @@
 #include "AssetFormat.hpp"
 
 #include <cstdint>
+#include <memory>
 #include <span>
 
 namespace eg
@@ -38,8 +39,12 @@ void DefineModelVertexType()
 	detail::modelVertexTypes.emplace_back(V::Name.hash, std::type_index(typeid(V)), sizeof(V));
 }
 
+EG_API std::shared_ptr<void> ModelAssetPrepare(std::string_view assetPath, std::span<const char> data);
 EG_API bool ModelAssetLoader(const class AssetLoadContext& loadContext);
 
+// Writes the key frame memory usage of each animation in a model asset, and the error of compressed animations
+EG_API void ModelAssetPrintAnimationInfo(std::span<const char> data, std::ostream& outStream);
+
 EG_API MeshAccess ParseMeshAccessMode(std::string_view accessModeString, MeshAccess def = MeshAccess::GPUOnly);
 
 template <typename V>
@@ -2,6 +2,8 @@
 #include "../Graphics/AbstractionHL.hpp"
 #include "AssetLoad.hpp"
 
+#include <numeric>
+
 namespace eg
 {
 const AssetFormat Texture2DAssetFormat{ "EG::Texture2D", 4 };
@@ -31,15 +33,20 @@ enum
 	TF_3D = 32
 };
 
-bool Texture2DLoader(const AssetLoadContext& loadContext)
+struct Texture2DPrepared
 {
-	EG_ASSERT(reinterpret_cast<uintptr_t>(loadContext.Data().data()) % alignof(Header) == 0);
-	const Header* header = reinterpret_cast<const Header*>(loadContext.Data().data());
+	const Header* header;
+	uint32_t mipShift;
 
-	SamplerDescription sampler;
-	sampler.maxAnistropy = (header->flags & TF_Anistropy) ? 16 : 0;
-	auto filter = (header->flags & TF_LinearFiltering) ? eg::TextureFilter::Linear : eg::TextureFilter::Nearest;
-	sampler.minFilter = sampler.magFilter = filter;
+	// Bytes of all mips of one layer in the asset data, and of the mips that are kept after applying mipShift
+	size_t bytesPerLayer;
+	size_t retainedBytesPerLayer;
+};
+
+std::shared_ptr<void> Texture2DPrepare(std::string_view assetPath, std::span<const char> data)
+{
+	EG_ASSERT(reinterpret_cast<uintptr_t>(data.data()) % alignof(Header) == 0);
+	const Header* header = reinterpret_cast<const Header*>(data.data());
 
 	uint32_t mipShift = std::min(header->mipShifts[static_cast<int>(TextureAssetQuality)], header->numMipLevels - 1);
 
@@ -56,10 +63,39 @@ bool Texture2DLoader(const AssetLoadContext& loadContext)
 				eg::LogLevel::Warning, "as",
 				"Mip shift {0} applied instead of the requested {1} because the"
 				" compressed texture '{2}' would otherwise have a resolution that is not a multiple of 4.",
-				mipShift, requestedMipShift, loadContext.AssetPath());
+				mipShift, requestedMipShift, assetPath);
 		}
 	}
 
+	size_t bytesPerLayer = 0;
+	size_t retainedBytesPerLayer = 0;
+	for (uint32_t i = 0; i < header->numMipLevels; i++)
+	{
+		const size_t mipBytes =
+			GetImageByteSize(std::max(header->width >> i, 1U), std::max(header->height >> i, 1U), header->format);
+		bytesPerLayer += mipBytes;
+		if (i >= mipShift)
+			retainedBytesPerLayer += mipBytes;
+	}
+
+	EG_ASSERT(bytesPerLayer * header->numLayers + sizeof(Header) <= data.size());
+
+	return std::make_shared<Texture2DPrepared>(
+		Texture2DPrepared{ header, mipShift, bytesPerLayer, retainedBytesPerLayer });
+}
+
+bool Texture2DLoader(const AssetLoadContext& loadContext)
+{
+	const Texture2DPrepared* prepared = loadContext.PreparedData<Texture2DPrepared>();
+	EG_ASSERT(prepared != nullptr);
+	const Header* header = prepared->header;
+	const uint32_t mipShift = prepared->mipShift;
+
+	SamplerDescription sampler;
+	sampler.maxAnistropy = (header->flags & TF_Anistropy) ? 16 : 0;
+	auto filter = (header->flags & TF_LinearFiltering) ? eg::TextureFilter::Linear : eg::TextureFilter::Nearest;
+	sampler.minFilter = sampler.magFilter = filter;
+
 	Texture* texture;
 
 	TextureCreateInfo createInfo;
@@ -92,49 +128,47 @@ bool Texture2DLoader(const AssetLoadContext& loadContext)
 		texture = &loadContext.CreateResult<Texture>(Texture::Create2D(createInfo));
 	}
 
-	size_t bytesPerLayer = 0;
-	for (uint32_t i = 0; i < header->numMipLevels; i++)
+	// Mips are stored largest first within each layer, so the retained mips of a layer are a contiguous range at the
+	//  end of it. Only those are staged, in the temporary upload buffers that all textures in a load batch share.
+	const size_t skippedBytesPerLayer = prepared->bytesPerLayer - prepared->retainedBytesPerLayer;
+	const uint64_t stagingBytes = prepared->retainedBytesPerLayer * header->numLayers;
+	const uint64_t stagingAlignment =
+		IsCompressedFormat(header->format) ? 16 : std::lcm<uint64_t>(4, ToUnsigned(GetFormatSize(header->format)));
+	UploadBuffer stagingBuffer = GetTemporaryUploadBuffer(stagingBytes, stagingAlignment);
+
+	char* stagingMemory = static_cast<char*>(stagingBuffer.Map());
+	const char* layerData = loadContext.Data().data() + sizeof(Header);
+	for (uint32_t i = 0; i < header->numLayers; i++)
 	{
-		bytesPerLayer +=
-			GetImageByteSize(std::max(header->width >> i, 1U), std::max(header->height >> i, 1U), createInfo.format);
+		std::memcpy(
+			stagingMemory + i * prepared->retainedBytesPerLayer, layerData + skippedBytesPerLayer,
+			prepared->retainedBytesPerLayer);
+		layerData += prepared->bytesPerLayer;
 	}
+	stagingBuffer.Flush();
 
-	const size_t uploadBufferSize = bytesPerLayer * header->numLayers;
-	EG_ASSERT(uploadBufferSize + sizeof(Header) <= loadContext.Data().size());
-
-	Buffer uploadBuffer(
-		BufferFlags::HostAllocate | BufferFlags::CopySrc | BufferFlags::MapWrite, uploadBufferSize, nullptr);
-
-	void* uploadBufferMemory = uploadBuffer.Map(0, uploadBufferSize);
-	std::memcpy(uploadBufferMemory, loadContext.Data().data() + sizeof(Header), uploadBufferSize);
-	uploadBuffer.Flush(0, uploadBufferSize);
-
-	uint64_t bufferOffset = 0;
+	uint64_t bufferOffset = stagingBuffer.offset;
 	for (uint32_t i = 0; i < header->numLayers; i++)
 	{
-		for (uint32_t mip = 0; mip < header->numMipLevels; mip++)
+		for (uint32_t mip = mipShift; mip < header->numMipLevels; mip++)
 		{
-			const uint32_t mipWidth = std::max(header->width >> mip, 1U);
-			const uint32_t mipHeight = std::max(header->height >> mip, 1U);
-
-			if (mip >= mipShift)
-			{
-				TextureRange range = {};
-				range.sizeX = mipWidth;
-				range.sizeY = mipHeight;
-				range.sizeZ = 1;
-				range.offsetZ = i;
-				range.mipLevel = mip - mipShift;
-
-				eg::DC.SetTextureData(*texture, range, uploadBuffer, bufferOffset);
-			}
-
-			bufferOffset += GetImageByteSize(mipWidth, mipHeight, createInfo.format);
+			TextureRange range = {};
+			range.sizeX = std::max(header->width >> mip, 1U);
+			range.sizeY = std::max(header->height >> mip, 1U);
+			range.sizeZ = 1;
+			range.offsetZ = i;
+			range.mipLevel = mip - mipShift;
+
+			eg::DC.SetTextureData(*texture, range, stagingBuffer.buffer, bufferOffset);
+
+			bufferOffset += GetImageByteSize(range.sizeX, range.sizeY, createInfo.format);
 		}
 	}
 
 	texture->UsageHint(TextureUsage::ShaderSample, ShaderAccessFlags::Vertex | ShaderAccessFlags::Fragment);
 
+	loadContext.AddMemoryUsage(0, stagingBytes);
+
 	return true;
 }
 
@@ -3,7 +3,9 @@
 #include "../API.hpp"
 #include "AssetFormat.hpp"
 
+#include <memory>
 #include <span>
+#include <string_view>
 
 namespace eg
 {
@@ -18,6 +20,7 @@ EG_API extern TextureQuality TextureAssetQuality;
 
 EG_API extern const AssetFormat Texture2DAssetFormat;
 
+EG_API std::shared_ptr<void> Texture2DPrepare(std::string_view assetPath, std::span<const char> data);
 EG_API bool Texture2DLoader(const class AssetLoadContext& loadContext);
 
 EG_API void Texture2DLoaderPrintInfo(std::span<const char> data, std::ostream& outStream);
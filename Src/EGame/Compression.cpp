@@ -1,179 +1,246 @@
 #include "Compression.hpp"
 #include "Assert.hpp"
 #include "IOUtils.hpp"
+#include "Log.hpp"
 #include "Utils.hpp"
 
 #include <algorithm>
+#include <cstring>
 #include <fstream>
-#include <list>
+#include <memory>
 
 #include <zlib.h>
 
+#ifndef EG_NO_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
+
+#ifndef EG_NO_ZSTD
+#include <zstd.h>
+#endif
+
 namespace eg
 {
-bool ReadCompressedSection(std::istream& input, void* output, size_t outputSize, uint64_t* compressedSizeOut)
-{
-	const uint64_t compressedSize = BinRead<uint64_t>(input);
-	if (compressedSizeOut)
-		*compressedSizeOut = compressedSize;
+static constexpr size_t ZLIB_READ_BUFFER_SIZE = 64 * 1024;
+static constexpr int ZSTD_PACKAGE_LEVEL = 19;
 
-	z_stream inflateStream = {};
-	if (inflateInit(&inflateStream) != Z_OK)
+static std::vector<char> ZlibCompress(const void* data, size_t dataSize, int level)
+{
+	z_stream deflateStream = {};
+	if (deflateInit(&deflateStream, level) != Z_OK)
 	{
 		EG_PANIC("Error initializing ZLIB");
 	}
 
-	int status;
-	std::array<char, 256> outBuffer;
-	std::array<char, 256> inBuffer;
-
-	int64_t charsLeft = compressedSize;
-	int64_t outputcharsLeft = outputSize;
-
-	char* outputPtr = reinterpret_cast<char*>(output);
-
-	// Inflates the data 256 chars at a time
-	do
-	{
-		int64_t charsToRead = std::min<int64_t>(inBuffer.size(), charsLeft);
-		input.read(inBuffer.data(), charsToRead);
+	// Deflates everything in one call into a buffer that is guaranteed to be large enough
+	std::vector<char> output(deflateBound(&deflateStream, UnsignedNarrow<uLong>(dataSize)));
 
-		EG_ASSERT(input.gcount() == charsToRead);
-
-		charsLeft -= charsToRead;
-
-		inflateStream.avail_in = static_cast<uInt>(charsToRead);
-		inflateStream.next_in = reinterpret_cast<Bytef*>(inBuffer.data());
-
-		if (inflateStream.avail_in == 0)
-			break;
+	deflateStream.avail_in = UnsignedNarrow<uInt>(dataSize);
+	deflateStream.next_in = reinterpret_cast<const Bytef*>(data);
+	deflateStream.avail_out = UnsignedNarrow<uInt>(output.size());
+	deflateStream.next_out = reinterpret_cast<Bytef*>(output.data());
 
-		do
-		{
-			inflateStream.avail_out = outBuffer.size();
-			inflateStream.next_out = reinterpret_cast<Bytef*>(outBuffer.data());
+	int status = deflate(&deflateStream, Z_FINISH);
+	EG_ASSERT(status == Z_STREAM_END);
 
-			status = inflate(&inflateStream, Z_NO_FLUSH);
-			EG_ASSERT(status != Z_STREAM_ERROR);
+	output.resize(deflateStream.total_out);
+	deflateEnd(&deflateStream);
 
-			if (status == Z_MEM_ERROR)
-				std::abort();
-			if (status == Z_DATA_ERROR || status == Z_NEED_DICT)
-				return false;
+	return output;
+}
 
-			int64_t charsDecompressed =
-				static_cast<int64_t>(outBuffer.size()) - static_cast<int64_t>(inflateStream.avail_out);
-			if (outputcharsLeft < charsDecompressed)
-				return false;
+static bool ZlibDecompress(const void* input, size_t inputSize, void* output, size_t outputSize)
+{
+	z_stream inflateStream = {};
+	if (inflateInit(&inflateStream) != Z_OK)
+	{
+		EG_PANIC("Error initializing ZLIB");
+	}
 
-			std::copy_n(outBuffer.begin(), charsDecompressed, outputPtr);
+	inflateStream.avail_in = UnsignedNarrow<uInt>(inputSize);
+	inflateStream.next_in = reinterpret_cast<const Bytef*>(input);
+	inflateStream.avail_out = UnsignedNarrow<uInt>(outputSize);
+	inflateStream.next_out = reinterpret_cast<Bytef*>(output);
 
-			outputPtr += charsDecompressed;
-			outputcharsLeft -= charsDecompressed;
-		} while (inflateStream.avail_out == 0);
-	} while (status != Z_STREAM_END && charsLeft > 0);
+	int status = inflate(&inflateStream, Z_FINISH);
 
 	inflateEnd(&inflateStream);
-	return true;
+
+	if (status == Z_MEM_ERROR || status == Z_STREAM_ERROR)
+		std::abort();
+	return status == Z_STREAM_END;
 }
 
-void WriteCompressedSection(std::ostream& output, const void* data, size_t dataSize)
+bool IsCompressionCodecSupported(CompressionCodec codec)
 {
-	z_stream deflateStream = {};
-
-	deflateStream.avail_in = static_cast<uInt>(dataSize);
-	deflateStream.next_in = reinterpret_cast<const Bytef*>(data);
-
-	if (deflateInit(&deflateStream, Z_DEFAULT_COMPRESSION) != Z_OK)
+	switch (codec)
 	{
-		EG_PANIC("Error initializing ZLIB");
+	case CompressionCodec::None:
+	case CompressionCodec::Zlib: return true;
+#ifndef EG_NO_LZ4
+	case CompressionCodec::LZ4: return true;
+#endif
+#ifndef EG_NO_ZSTD
+	case CompressionCodec::Zstd: return true;
+#endif
+	default: return false;
 	}
+}
 
-	std::list<std::array<char, 256>> compressedData;
-	uInt lastPageUnusedchars;
-
-	// Deflates and writes the data 256 chars at a time
-	while (true)
+std::string_view CompressionCodecName(CompressionCodec codec)
+{
+	switch (codec)
 	{
-		auto& outBuffer = compressedData.emplace_back();
-
-		deflateStream.avail_out = UnsignedNarrow<uInt>(outBuffer.size());
-		deflateStream.next_out = reinterpret_cast<Bytef*>(outBuffer.data());
-
-		int status = deflate(&deflateStream, Z_FINISH);
-		EG_ASSERT(status != Z_STREAM_ERROR);
-
-		if (deflateStream.avail_out != 0)
-		{
-			lastPageUnusedchars = deflateStream.avail_out;
-			break;
-		}
+	case CompressionCodec::None: return "none";
+	case CompressionCodec::Zlib: return "zlib";
+	case CompressionCodec::LZ4: return "lz4";
+	case CompressionCodec::Zstd: return "zstd";
 	}
+	return "unknown";
+}
 
-	deflateEnd(&deflateStream);
+std::optional<CompressionCodec> ParseCompressionCodec(std::string_view name)
+{
+	for (uint32_t i = 0; i <= static_cast<uint32_t>(MAX_COMPRESSION_CODEC); i++)
+	{
+		if (CompressionCodecName(static_cast<CompressionCodec>(i)) == name)
+			return static_cast<CompressionCodec>(i);
+	}
+	return {};
+}
 
-	BinWrite<uint64_t>(output, compressedData.size() * 256 - lastPageUnusedchars);
-	std::for_each(
-		compressedData.begin(), std::prev(compressedData.end()),
-		[&](const std::array<char, 256>& page) { output.write(page.data(), page.size()); });
-	output.write(compressedData.back().data(), 256 - lastPageUnusedchars);
+std::vector<char> Compress(CompressionCodec codec, const void* data, size_t dataSize)
+{
+	switch (codec)
+	{
+	case CompressionCodec::None:
+	{
+		const char* dataChars = static_cast<const char*>(data);
+		return std::vector<char>(dataChars, dataChars + dataSize);
+	}
+	case CompressionCodec::Zlib: return ZlibCompress(data, dataSize, Z_BEST_COMPRESSION);
+#ifndef EG_NO_LZ4
+	case CompressionCodec::LZ4:
+	{
+		const int inputSize = ToInt(dataSize);
+		std::vector<char> output(static_cast<size_t>(LZ4_compressBound(inputSize)));
+		const int outputSize = LZ4_compress_HC(
+			static_cast<const char*>(data), output.data(), inputSize, ToInt(output.size()), LZ4HC_CLEVEL_DEFAULT);
+		EG_ASSERT(outputSize > 0);
+		output.resize(static_cast<size_t>(outputSize));
+		return output;
+	}
+#endif
+#ifndef EG_NO_ZSTD
+	case CompressionCodec::Zstd:
+	{
+		std::vector<char> output(ZSTD_compressBound(dataSize));
+		const size_t outputSize = ZSTD_compress(output.data(), output.size(), data, dataSize, ZSTD_PACKAGE_LEVEL);
+		EG_ASSERT(!ZSTD_isError(outputSize));
+		output.resize(outputSize);
+		return output;
+	}
+#endif
+	default: EG_PANIC("Compression codec " << CompressionCodecName(codec) << " is not supported by this build");
+	}
 }
 
-std::vector<char> Compress(const void* data, size_t dataSize)
+bool Decompress(CompressionCodec codec, const void* input, size_t inputSize, void* output, size_t outputSize)
 {
-	z_stream deflateStream = {};
+	switch (codec)
+	{
+	case CompressionCodec::None:
+		if (inputSize != outputSize)
+			return false;
+		std::memcpy(output, input, outputSize);
+		return true;
+	case CompressionCodec::Zlib: return ZlibDecompress(input, inputSize, output, outputSize);
+#ifndef EG_NO_LZ4
+	case CompressionCodec::LZ4:
+		return LZ4_decompress_safe(
+				   static_cast<const char*>(input), static_cast<char*>(output), ToInt(inputSize), ToInt(outputSize)) ==
+		       ToInt(outputSize);
+#endif
+#ifndef EG_NO_ZSTD
+	case CompressionCodec::Zstd: return ZSTD_decompress(output, outputSize, input, inputSize) == outputSize;
+#endif
+	default:
+		Log(LogLevel::Error, "as", "Compression codec {0} is not supported by this build", CompressionCodecName(codec));
+		return false;
+	}
+}
 
-	deflateStream.avail_in = static_cast<uInt>(dataSize);
-	deflateStream.next_in = reinterpret_cast<const Bytef*>(data);
+bool ReadCompressedSection(std::istream& input, void* output, size_t outputSize, uint64_t* compressedSizeOut)
+{
+	const uint64_t compressedSize = BinRead<uint64_t>(input);
+	if (compressedSizeOut)
+		*compressedSizeOut = compressedSize;
 
-	if (deflateInit(&deflateStream, Z_BEST_COMPRESSION) != Z_OK)
+	z_stream inflateStream = {};
+	if (inflateInit(&inflateStream) != Z_OK)
 	{
 		EG_PANIC("Error initializing ZLIB");
 	}
 
-	std::vector<char> output;
-	char outBuffer[256];
+	// Inflates straight into the output, only the compressed input goes through an intermediate buffer
+	std::unique_ptr<char[]> inBuffer(new char[ZLIB_READ_BUFFER_SIZE]);
+	inflateStream.avail_out = UnsignedNarrow<uInt>(outputSize);
+	inflateStream.next_out = reinterpret_cast<Bytef*>(output);
 
-	// Deflates and writes the data 256 chars at a time
-	while (true)
+	uint64_t bytesLeft = compressedSize;
+	int status = Z_OK;
+	while (status != Z_STREAM_END)
 	{
-		deflateStream.avail_out = sizeof(outBuffer);
-		deflateStream.next_out = reinterpret_cast<Bytef*>(outBuffer);
+		if (inflateStream.avail_in == 0)
+		{
+			if (bytesLeft == 0)
+				break;
+
+			const size_t bytesToRead = std::min<uint64_t>(ZLIB_READ_BUFFER_SIZE, bytesLeft);
+			input.read(inBuffer.get(), static_cast<std::streamsize>(bytesToRead));
+			if (input.gcount() != static_cast<std::streamsize>(bytesToRead))
+				break;
+			bytesLeft -= bytesToRead;
 
-		int status = deflate(&deflateStream, Z_FINISH);
-		EG_ASSERT(status != Z_STREAM_ERROR);
+			inflateStream.avail_in = static_cast<uInt>(bytesToRead);
+			inflateStream.next_in = reinterpret_cast<const Bytef*>(inBuffer.get());
+		}
 
-		output.insert(output.end(), outBuffer, outBuffer + (sizeof(outBuffer) - deflateStream.avail_out));
+		status = inflate(&inflateStream, Z_NO_FLUSH);
+		if (status == Z_MEM_ERROR)
+			std::abort();
+		if (status == Z_STREAM_ERROR || status == Z_DATA_ERROR || status == Z_NEED_DICT)
+			break;
 
-		if (deflateStream.avail_out != 0)
+		// The output buffer is full but the stream has not ended
+		if (status == Z_BUF_ERROR && inflateStream.avail_out == 0)
 			break;
 	}
 
-	deflateEnd(&deflateStream);
+	// Skips any remaining bytes so that the stream is positioned after the section
+	if (bytesLeft != 0)
+		input.ignore(static_cast<std::streamsize>(bytesLeft));
 
-	return output;
+	inflateEnd(&inflateStream);
+	return status == Z_STREAM_END;
 }
 
-bool Decompress(const void* input, size_t inputSize, void* output, size_t outputSize)
+void WriteCompressedSection(std::ostream& output, const void* data, size_t dataSize)
 {
-	z_stream inflateStream = {};
-	if (inflateInit(&inflateStream) != Z_OK)
-	{
-		EG_PANIC("Error initializing ZLIB");
-	}
-
-	inflateStream.avail_in = UnsignedNarrow<uInt>(inputSize);
-	inflateStream.next_in = reinterpret_cast<const Bytef*>(input);
-	inflateStream.avail_out = UnsignedNarrow<uInt>(outputSize);
-	inflateStream.next_out = reinterpret_cast<Bytef*>(output);
-
-	int status = inflate(&inflateStream, Z_NO_FLUSH);
+	std::vector<char> compressedData = ZlibCompress(data, dataSize, Z_DEFAULT_COMPRESSION);
+	BinWrite<uint64_t>(output, compressedData.size());
+	output.write(compressedData.data(), static_cast<std::streamsize>(compressedData.size()));
+}
 
-	inflateEnd(&inflateStream);
+std::vector<char> Compress(const void* data, size_t dataSize)
+{
+	return ZlibCompress(data, dataSize, Z_BEST_COMPRESSION);
+}
 
-	if (status == Z_MEM_ERROR || status == Z_STREAM_ERROR)
-		std::abort();
-	return status == Z_STREAM_END;
+bool Decompress(const void* input, size_t inputSize, void* output, size_t outputSize)
+{
+	return ZlibDecompress(input, inputSize, output, outputSize);
 }
 
 static const char* Base64Chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
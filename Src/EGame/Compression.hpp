@@ -5,11 +5,36 @@
 #include <cstddef>
 #include <cstdint>
 #include <iosfwd>
+#include <optional>
 #include <string_view>
 #include <vector>
 
 namespace eg
 {
+// Algorithm used to compress a block of data. These values are stored in asset packages and must not change.
+enum class CompressionCodec : uint32_t
+{
+	None = 0,
+	Zlib = 1,
+	LZ4 = 2,
+	Zstd = 3,
+};
+
+constexpr CompressionCodec MAX_COMPRESSION_CODEC = CompressionCodec::Zstd;
+
+// zlib is always available, LZ4 and zstd depend on whether the libraries were found at build time.
+EG_API bool IsCompressionCodecSupported(CompressionCodec codec);
+
+EG_API std::string_view CompressionCodecName(CompressionCodec codec);
+
+EG_API std::optional<CompressionCodec> ParseCompressionCodec(std::string_view name);
+
+// Compresses data with settings that favor compression ratio (and decompression speed) over compression speed.
+EG_API std::vector<char> Compress(CompressionCodec codec, const void* data, size_t dataSize);
+
+// Decompresses input into output, outputSize must be the exact size of the uncompressed data.
+EG_API bool Decompress(CompressionCodec codec, const void* input, size_t inputSize, void* output, size_t outputSize);
+
 EG_API bool ReadCompressedSection(
 	std::istream& input, void* output, size_t outputSize, uint64_t* compressedSizeOut = nullptr);
 EG_API void WriteCompressedSection(std::ostream& output, const void* data, size_t dataSize);
@@ -1,4 +1,5 @@
 #include "ConsoleCommands.hpp"
+#include "Assets/Asset.hpp"
 #include "Console.hpp"
 #include "Core.hpp"
 #include "Graphics/Model.hpp"
@@ -175,6 +176,54 @@ void RegisterConsoleCommands()
 			}
 		});
 
+	console::AddCommand(
+		"pcache", 0,
+		[&](std::span<const std::string_view> args, console::Writer& writer)
+		{
+			if (gal::GetPipelineCacheStat == nullptr)
+			{
+				writer.WriteLine(console::WarnColor, "pcache is not supported by this graphics API");
+			}
+			else
+			{
+				PipelineCacheStat stat = gal::GetPipelineCacheStat();
+
+				std::ostringstream creationTimeStream;
+				creationTimeStream << std::setprecision(2) << std::fixed
+								   << (static_cast<double>(stat.creationTimeNs) * 1E-6);
+				std::string creationTimeString = creationTimeStream.str();
+
+				writer.Write(console::InfoColor, "Pipeline cache: ");
+				writer.Write(console::InfoColorSpecial, std::to_string(stat.loadedBytes / 1024));
+				writer.Write(console::InfoColor, " KiB loaded, ");
+				writer.Write(console::InfoColorSpecial, std::to_string(stat.hits));
+				writer.Write(console::InfoColor, " hits, ");
+				writer.Write(console::InfoColorSpecial, std::to_string(stat.misses));
+				writer.Write(console::InfoColor, " misses, ");
+				writer.Write(console::InfoColorSpecial, std::to_string(stat.unreported));
+				writer.Write(console::InfoColor, " unreported, ");
+				writer.Write(console::InfoColorSpecial, creationTimeString);
+				writer.Write(console::InfoColor, " ms spent creating pipelines");
+			}
+		});
+
+	console::AddCommand(
+		"assetmem", 0,
+		[&](std::span<const std::string_view> args, console::Writer& writer)
+		{
+			for (const AssetMountMemoryUsage& mountUsage : GetAssetMemoryUsage())
+			{
+				writer.Write(console::InfoColor, "/" + mountUsage.mountPath + ": ");
+				writer.Write(console::InfoColorSpecial, std::to_string(mountUsage.total.numAssets));
+				writer.Write(console::InfoColor, " assets, CPU: ");
+				writer.Write(console::InfoColorSpecial, ReadableBytesSize(mountUsage.total.cpuBytes));
+				writer.Write(console::InfoColor, ", GPU: ");
+				writer.Write(console::InfoColorSpecial, ReadableBytesSize(mountUsage.total.gpuBytes));
+				writer.Write(console::InfoColor, ", allocator: ");
+				writer.WriteLine(console::InfoColorSpecial, ReadableBytesSize(mountUsage.allocatorBytes));
+			}
+		});
+
 	console::AddCommand(
 		"gpuinfo", 0,
 		[&](std::span<const std::string_view> args, console::Writer& writer)
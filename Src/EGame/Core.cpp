@@ -35,6 +35,9 @@ detail::MTIBase* detail::firstMTI;
 detail::MTIBase* detail::lastMTI;
 std::thread::id detail::mainThreadId;
 
+// Holds the invokes that are being processed while new ones are added to allocMTI
+static LinearAllocator processingAllocMTI;
+
 bool detail::shouldClose;
 std::string detail::gameName;
 std::string_view detail::exeDirPath;
@@ -116,6 +119,8 @@ void detail::RunFrame(IGame& game)
 		gal::BeginFrame();
 	}
 
+	detail::UploadBuffersBeginFrame();
+
 	auto gpuTimer = StartGPUTimer("Frame");
 
 	while (!pendingProfilers.empty())
@@ -162,11 +167,22 @@ void detail::RunFrame(IGame& game)
 	console::Update(dt);
 	console::Draw(SpriteBatch::overlay, detail::resolutionX, detail::resolutionY);
 
-	// Processes main thread invokes
-	for (detail::MTIBase* mti = detail::firstMTI; mti != nullptr; mti = mti->next)
+	// Processes main thread invokes. The queue is detached first so that other threads can keep adding to it.
+	detail::MTIBase* firstMTI;
+	{
+		std::lock_guard<std::mutex> lock(detail::mutexMTI);
+		firstMTI = detail::firstMTI;
+		detail::firstMTI = detail::lastMTI = nullptr;
+		std::swap(detail::allocMTI, processingAllocMTI);
+	}
+	for (detail::MTIBase* mti = firstMTI; mti != nullptr;)
+	{
+		detail::MTIBase* next = mti->next;
 		mti->Invoke();
-	detail::firstMTI = detail::lastMTI = nullptr;
-	detail::allocMTI.Reset();
+		mti->~MTIBase();
+		mti = next;
+	}
+	processingAllocMTI.Reset();
 
 	eg::RenderPassBeginInfo rpBeginInfo;
 	rpBeginInfo.colorAttachments[0].loadOp = AttachmentLoadOp::Load;
@@ -43,7 +43,8 @@ int detail::PlatformInit(const RunConfig& runConfig)
 		SDL_SetHint("SDL_VIDEO_X11_NET_WM_BYPASS_COMPOSITOR", "0");
 	}
 
-	graphics_api::vk::EarlyInitializeMemoized();
+	if (runConfig.graphicsAPI != GraphicsAPI::Null)
+		graphics_api::vk::EarlyInitializeMemoized();
 
 	constexpr int DISPLAY_INDEX = 0;
 	SDL_DisplayMode currentDisplayMode;
@@ -115,6 +116,10 @@ int detail::PlatformInit(const RunConfig& runConfig)
 	{
 		windowFlags |= SDL_WINDOW_VULKAN;
 	}
+	else if (runConfig.graphicsAPI == GraphicsAPI::Null)
+	{
+		windowFlags = SDL_WINDOW_HIDDEN;
+	}
 
 	int windowW = std::max(currentDisplayMode.w * 3 / 5, ToInt(runConfig.minWindowW));
 	int windowH = std::max(windowW * 2 / 3, ToInt(runConfig.minWindowH));
@@ -8,6 +8,7 @@
 #include "Assets/Asset.hpp"
 #include "Assets/AssetGenerator.hpp"
 #include "Assets/AssetLoad.hpp"
+#include "Assets/AssetLoadAsync.hpp"
 #include "Assets/ModelAsset.hpp"
 #include "Assets/ShaderModule.hpp"
 #include "Assets/Texture2DLoader.hpp"
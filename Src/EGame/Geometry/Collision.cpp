@@ -35,133 +35,147 @@ static inline float MinQuadraticRoot(float a, float b, float c, float maxR)
 	return std::numeric_limits<float>::quiet_NaN();
 }
 
-void CheckEllipsoidMeshCollision(
-	CollisionInfo& info, const CollisionEllipsoid& ellipsoid, const glm::vec3& move, const CollisionMesh& mesh,
-	const glm::mat4& meshTransform)
+static void CheckEllipsoidTriangleCollision(
+	CollisionInfo& info, const glm::vec3 (&triVerticesES)[3], const glm::vec3& basePointES, const glm::vec3& moveES)
 {
-	const glm::vec3 oneOverRadii = 1.0f / ellipsoid.radii;
+	Plane plane(triVerticesES[0], triVerticesES[1], triVerticesES[2]);
+	plane.FlipNormal();
+
+	if (glm::dot(plane.GetNormal(), moveES) < 0.0f)
+		return;
+
+	const float distToPlane = plane.GetDistanceToPoint(basePointES);
+	const float NDotMove = glm::dot(plane.GetNormal(), moveES);
+
+	float t0, t1;
+	bool embeddedInPlane = false;
 
-	for (uint32_t i = 0; i < mesh.NumIndices(); i += 3)
+	if (std::abs(NDotMove) < 1E-6f)
 	{
-		glm::vec3 triVerticesES[3];
-		for (int j = 0; j < 3; j++)
+		// Sphere is moving parallel to the plane.
+		if (std::abs(distToPlane) >= 1.0f)
 		{
-			const glm::vec3 worldPos(meshTransform * glm::vec4(mesh.VertexByIndex(i + j), 1.0f));
-			triVerticesES[j] = worldPos * oneOverRadii;
+			// Sphere is above the plane, so no collision can occur.
+			return;
 		}
 
-		const glm::vec3 basePointES = ellipsoid.center * oneOverRadii;
-		const glm::vec3 moveES = move * oneOverRadii;
+		// Sphere is embedded in the plane.
+		embeddedInPlane = true;
+		t0 = 0.0f;
+		t1 = 1.0f;
+	}
+	else
+	{
+		// The sphere is not moving parallel to the plane.
 
-		Plane plane(triVerticesES[0], triVerticesES[1], triVerticesES[2]);
-		plane.FlipNormal();
+		t0 = (-1.0f - distToPlane) / NDotMove;
+		t1 = (1.0f - distToPlane) / NDotMove;
 
-		if (glm::dot(plane.GetNormal(), moveES) < 0.0f)
-			continue;
+		// Swaps the values so t1 > t0
+		if (t0 > t1)
+		{
+			std::swap(t0, t1);
+		}
 
-		const float distToPlane = plane.GetDistanceToPoint(basePointES);
-		const float NDotMove = glm::dot(plane.GetNormal(), moveES);
+		if (t0 > 1.0f || t1 < 0.0f)
+		{
+			// The whole intersection range is outside [0,1], no collision is possible.
+			return;
+		}
 
-		float t0, t1;
-		bool embeddedInPlane = false;
+		t0 = glm::clamp(t0, 0.0f, 1.0f);
+		t1 = glm::clamp(t1, 0.0f, 1.0f);
+	}
 
-		if (std::abs(NDotMove) < 1E-6f)
+	if (!embeddedInPlane && (!info.collisionFound || t0 < info.distance))
+	{
+		// Checks for intersections with the inside of the triangle.
+		const glm::vec3 planeIntersect = basePointES - plane.GetNormal() + t0 * moveES;
+		if (TriangleContainsPoint(triVerticesES[0], triVerticesES[1], triVerticesES[2], planeIntersect))
 		{
-			// Sphere is moving parallel to the plane.
-			if (std::abs(distToPlane) >= 1.0f)
-			{
-				// Sphere is above the plane, so no collision can occur.
-				continue;
-			}
-
-			// Sphere is embedded in the plane.
-			embeddedInPlane = true;
-			t0 = 0.0f;
-			t1 = 1.0f;
+			info.collisionFound = true;
+			info.distance = t0;
+			info.positionES = planeIntersect;
+			return;
 		}
-		else
-		{
-			// The sphere is not moving parallel to the plane.
+	}
 
-			t0 = (-1.0f - distToPlane) / NDotMove;
-			t1 = (1.0f - distToPlane) / NDotMove;
+	float t = 1.0f;
 
-			// Swaps the values so t1 > t0
-			if (t0 > t1)
-			{
-				std::swap(t0, t1);
-			}
+	const float squaredMoveDistES = glm::length2(moveES);
 
-			if (t0 > 1.0f || t1 < 0.0f)
-			{
-				// The whole intersection range is outside [0,1], no collision is possible.
-				continue;
-			}
+	// Checks for intersections with vertices.
+	for (const glm::vec3& vertex : triVerticesES)
+	{
+		const float a = squaredMoveDistES;
+		const float b = 2.0f * glm::dot(moveES, basePointES - vertex);
+		const float c = glm::distance2(vertex, basePointES) - 1.0f;
 
-			t0 = glm::clamp(t0, 0.0f, 1.0f);
-			t1 = glm::clamp(t1, 0.0f, 1.0f);
-		}
+		const float root = MinQuadraticRoot(a, b, c, t);
 
-		if (!embeddedInPlane && (!info.collisionFound || t0 < info.distance))
+		if (!std::isnan(root) && (!info.collisionFound || root < info.distance))
 		{
-			// Checks for intersections with the inside of the triangle.
-			const glm::vec3 planeIntersect = basePointES - plane.GetNormal() + t0 * moveES;
-			if (TriangleContainsPoint(triVerticesES[0], triVerticesES[1], triVerticesES[2], planeIntersect))
-			{
-				info.collisionFound = true;
-				info.distance = t0;
-				info.positionES = planeIntersect;
-				continue;
-			}
+			info.collisionFound = true;
+			info.distance = t = root;
+			info.positionES = vertex;
 		}
+	}
 
-		float t = 1.0f;
-
-		const float squaredMoveDistES = glm::length2(moveES);
+	// Checks for intersections with edges.
+	const glm::vec3 edgeDirections[] = { triVerticesES[1] - triVerticesES[0], triVerticesES[2] - triVerticesES[1],
+		                                 triVerticesES[0] - triVerticesES[2] };
+	for (int v = 0; v < 3; v++)
+	{
+		const glm::vec3 baseToVertex = triVerticesES[v] - basePointES;
+		const float edgeLenSq = glm::length2(edgeDirections[v]);
+		const float edgeDotMove = glm::dot(edgeDirections[v], moveES);
+		const float edgeDotBaseToVertex = glm::dot(edgeDirections[v], baseToVertex);
 
-		// Checks for intersections with vertices.
-		for (const glm::vec3& vertex : triVerticesES)
-		{
-			const float a = squaredMoveDistES;
-			const float b = 2.0f * glm::dot(moveES, basePointES - vertex);
-			const float c = glm::distance2(vertex, basePointES) - 1.0f;
+		const float a = -(edgeLenSq * squaredMoveDistES) + edgeDotMove * edgeDotMove;
+		const float b = 2.0f * (edgeLenSq * glm::dot(moveES, baseToVertex) - edgeDotMove * edgeDotBaseToVertex);
+		const float c = edgeLenSq * (1.0f - glm::length2(baseToVertex)) + edgeDotBaseToVertex * edgeDotBaseToVertex;
 
-			const float root = MinQuadraticRoot(a, b, c, t);
+		const float root = MinQuadraticRoot(a, b, c, 1.0f);
+		if (std::isnan(root) || (info.collisionFound && root > info.distance))
+			continue;
 
-			if (!std::isnan(root) && (!info.collisionFound || root < info.distance))
-			{
-				info.collisionFound = true;
-				info.distance = t = root;
-				info.positionES = vertex;
-			}
+		const float f0 = (edgeDotMove * root - edgeDotBaseToVertex) / edgeLenSq;
+		if (f0 >= 0.0f && f0 <= 1.0f)
+		{
+			info.collisionFound = true;
+			info.distance = t = root;
+			info.positionES = triVerticesES[v] + f0 * edgeDirections[v];
 		}
+	}
+}
 
-		// Checks for intersections with edges.
-		const glm::vec3 edgeDirections[] = { triVerticesES[1] - triVerticesES[0], triVerticesES[2] - triVerticesES[1],
-			                                 triVerticesES[0] - triVerticesES[2] };
-		for (int v = 0; v < 3; v++)
+void CheckEllipsoidMeshCollision(
+	CollisionInfo& info, const CollisionEllipsoid& ellipsoid, const glm::vec3& move, const CollisionMesh& mesh,
+	const glm::mat4& meshTransform)
+{
+	const glm::vec3 oneOverRadii = 1.0f / ellipsoid.radii;
+	const glm::vec3 basePointES = ellipsoid.center * oneOverRadii;
+	const glm::vec3 moveES = move * oneOverRadii;
+
+	// Only triangles overlapping the box swept by the ellipsoid can collide with it. The box is slightly inflated to
+	//  account for precision lost when moving it into mesh space.
+	const glm::vec3 sweepMargin = ellipsoid.radii * 1.01f + 1E-4f;
+	const AABB sweptBox(
+		glm::min(ellipsoid.center, ellipsoid.center + move) - sweepMargin,
+		glm::max(ellipsoid.center, ellipsoid.center + move) + sweepMargin);
+	const AABB sweptBoxMS = sweptBox.TransformedBoundingBox(glm::inverse(meshTransform));
+
+	mesh.ForEachTriangleInBox(
+		sweptBoxMS,
+		[&](uint32_t firstIndex)
 		{
-			const glm::vec3 baseToVertex = triVerticesES[v] - basePointES;
-			const float edgeLenSq = glm::length2(edgeDirections[v]);
-			const float edgeDotMove = glm::dot(edgeDirections[v], moveES);
-			const float edgeDotBaseToVertex = glm::dot(edgeDirections[v], baseToVertex);
-
-			const float a = -(edgeLenSq * squaredMoveDistES) + edgeDotMove * edgeDotMove;
-			const float b = 2.0f * (edgeLenSq * glm::dot(moveES, baseToVertex) - edgeDotMove * edgeDotBaseToVertex);
-			const float c = edgeLenSq * (1.0f - glm::length2(baseToVertex)) + edgeDotBaseToVertex * edgeDotBaseToVertex;
-
-			const float root = MinQuadraticRoot(a, b, c, 1.0f);
-			if (std::isnan(root) || (info.collisionFound && root > info.distance))
-				continue;
-
-			const float f0 = (edgeDotMove * root - edgeDotBaseToVertex) / edgeLenSq;
-			if (f0 >= 0.0f && f0 <= 1.0f)
+			glm::vec3 triVerticesES[3];
+			for (uint32_t j = 0; j < 3; j++)
 			{
-				info.collisionFound = true;
-				info.distance = t = root;
-				info.positionES = triVerticesES[v] + f0 * edgeDirections[v];
+				const glm::vec3 worldPos(meshTransform * glm::vec4(mesh.VertexByIndex(firstIndex + j), 1.0f));
+				triVerticesES[j] = worldPos * oneOverRadii;
 			}
-		}
-	}
+			CheckEllipsoidTriangleCollision(info, triVerticesES, basePointES, moveES);
+		});
 }
 } // namespace eg
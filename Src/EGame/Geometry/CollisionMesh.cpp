@@ -1,73 +1,123 @@
 #include "CollisionMesh.hpp"
 #include "../Assert.hpp"
+#include "../IOUtils.hpp"
 #include "../Utils.hpp"
 #include "Ray.hpp"
 
 #include <bit>
+#include <istream>
+#include <ostream>
 
 namespace eg
 {
+// Returns the distance along the ray to the triangle, or a negative value if the ray misses it
+static float IntersectTriangle(const Ray& ray, const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2)
+{
+	glm::vec3 d1 = v1 - v0;
+	glm::vec3 d2 = v2 - v0;
+	glm::vec3 pn = glm::normalize(glm::cross(d1, d2));
+	float pd = glm::dot(pn, v0);
+	float dv = glm::dot(pn, ray.GetDirection());
+	float ps = glm::dot(ray.GetStart(), pn);
+
+	if (std::abs(dv) < 1E-6f)
+		return -1;
+
+	float pdist = (pd - ps) / dv;
+	if (!(pdist > 0))
+		return -1;
+
+	glm::vec3 pos = ray.GetPoint(pdist);
+
+	float a = glm::dot(d1, d1);
+	float b = glm::dot(d1, d2);
+	float c = glm::dot(d2, d2);
+
+	glm::vec3 vp = pos - v0;
+
+	float d = glm::dot(vp, d1);
+	float e = glm::dot(vp, d2);
+
+	float ac_bb = (a * c) - (b * b);
+
+	float x = (d * c) - (e * b);
+	float y = (e * a) - (d * b);
+	float z = x + y - ac_bb;
+
+	if ((std::bit_cast<uint32_t>(z) & ~(std::bit_cast<uint32_t>(x) | std::bit_cast<uint32_t>(y))) & 0x80000000)
+		return pdist;
+	return -1;
+}
+
+// Returns the distance along the ray where it enters the box, or infinity if it misses the box
+static float IntersectBox(
+	const glm::vec3& rayStart, const glm::vec3& oneOverDirection, const glm::vec3& boundsMin,
+	const glm::vec3& boundsMax)
+{
+	const glm::vec3 t1 = (boundsMin - rayStart) * oneOverDirection;
+	const glm::vec3 t2 = (boundsMax - rayStart) * oneOverDirection;
+	const glm::vec3 tMin = glm::min(t1, t2);
+	const glm::vec3 tMax = glm::max(t1, t2);
+	const float enter = std::max(std::max(tMin.x, tMin.y), std::max(tMin.z, 0.0f));
+	const float exit = std::min(std::min(tMax.x, tMax.y), tMax.z);
+	return enter <= exit ? enter : INFINITY;
+}
+
 int CollisionMesh::Intersect(const Ray& ray, float& distanceOut, const glm::mat4* transform) const
 {
 	int ans = -1;
 	distanceOut = INFINITY;
+	if (m_bvhNodes.empty())
+		return ans;
 
-	std::vector<glm::vec3> positionsCopy;
-	const glm::vec3* positions;
+	// Moves the ray into mesh space. The direction is not normalized, so distances along the ray are the same in
+	// both spaces.
+	Ray meshRay = ray;
 	if (transform != nullptr)
 	{
-		positionsCopy.resize(m_vertices.size());
-		for (uint32_t i = 0; i < m_vertices.size(); i++)
-		{
-			positionsCopy[i] = *transform * glm::vec4(m_vertices[i], 1.0f);
-		}
-		positions = positionsCopy.data();
-	}
-	else
-	{
-		positions = m_vertices.data();
+		const glm::mat4 inverseTransform = glm::inverse(*transform);
+		meshRay.SetStart(glm::vec3(inverseTransform * glm::vec4(ray.GetStart(), 1.0f)));
+		meshRay.SetDirection(glm::vec3(inverseTransform * glm::vec4(ray.GetDirection(), 0.0f)));
 	}
 
-	for (uint32_t i = 0; i < m_indices.size(); i += 3)
+	const glm::vec3 oneOverDirection = 1.0f / meshRay.GetDirection();
+
+	uint32_t stack[MAX_BVH_DEPTH + 1];
+	uint32_t stackSize = 0;
+	stack[stackSize++] = 0;
+	while (stackSize > 0)
 	{
-		glm::vec3 v0 = positions[m_indices[i + 0]];
-		glm::vec3 v1 = positions[m_indices[i + 1]];
-		glm::vec3 v2 = positions[m_indices[i + 2]];
-
-		glm::vec3 d1 = v1 - v0;
-		glm::vec3 d2 = v2 - v0;
-		glm::vec3 pn = glm::normalize(glm::cross(d1, d2));
-		float pd = glm::dot(pn, v0);
-		float dv = glm::dot(pn, ray.GetDirection());
-		float ps = glm::dot(ray.GetStart(), pn);
-
-		if (std::abs(dv) < 1E-6f)
+		const uint32_t nodeIndex = stack[--stackSize];
+		const BVHNode& node = m_bvhNodes[nodeIndex];
+		if (IntersectBox(meshRay.GetStart(), oneOverDirection, node.boundsMin, node.boundsMax) >= distanceOut)
 			continue;
 
-		float pdist = (pd - ps) / dv;
-		if (pdist > 0 && pdist < distanceOut)
+		if (node.numTriangles == 0)
 		{
-			glm::vec3 pos = ray.GetPoint(pdist);
-
-			float a = glm::dot(d1, d1);
-			float b = glm::dot(d1, d2);
-			float c = glm::dot(d2, d2);
-
-			glm::vec3 vp = pos - v0;
-
-			float d = glm::dot(vp, d1);
-			float e = glm::dot(vp, d2);
-
-			float ac_bb = (a * c) - (b * b);
-
-			float x = (d * c) - (e * b);
-			float y = (e * a) - (d * b);
-			float z = x + y - ac_bb;
+			// Visits the nearest child first so that the other one is more likely to be pruned
+			uint32_t nearChild = nodeIndex + 1;
+			uint32_t farChild = node.firstTriangleOrChild;
+			const BVHNode& near = m_bvhNodes[nearChild];
+			const BVHNode& far = m_bvhNodes[farChild];
+			if (IntersectBox(meshRay.GetStart(), oneOverDirection, near.boundsMin, near.boundsMax) >
+			    IntersectBox(meshRay.GetStart(), oneOverDirection, far.boundsMin, far.boundsMax))
+			{
+				std::swap(nearChild, farChild);
+			}
+			stack[stackSize++] = farChild;
+			stack[stackSize++] = nearChild;
+			continue;
+		}
 
-			if ((std::bit_cast<uint32_t>(z) & ~(std::bit_cast<uint32_t>(x) | std::bit_cast<uint32_t>(y))) & 0x80000000)
+		for (uint32_t i = 0; i < node.numTriangles; i++)
+		{
+			const uint32_t firstIndex = m_bvhTriangles[node.firstTriangleOrChild + i];
+			const float distance = IntersectTriangle(
+				meshRay, VertexByIndex(firstIndex), VertexByIndex(firstIndex + 1), VertexByIndex(firstIndex + 2));
+			if (distance > 0 && distance < distanceOut)
 			{
-				ans = i;
-				distanceOut = pdist;
+				ans = ToInt(firstIndex);
+				distanceOut = distance;
 			}
 		}
 	}
@@ -81,7 +131,7 @@ void CollisionMesh::Transform(const glm::mat4& transform)
 	{
 		v = glm::vec3(transform * glm::vec4(v, 1));
 	}
-	InitAABB();
+	InitBounds();
 }
 
 void CollisionMesh::FlipWinding()
@@ -92,8 +142,10 @@ void CollisionMesh::FlipWinding()
 	}
 }
 
-void CollisionMesh::InitAABB()
+void CollisionMesh::InitBounds()
 {
+	m_bvhNodes.clear();
+	m_bvhTriangles.clear();
 	if (m_vertices.empty())
 		return;
 
@@ -107,6 +159,178 @@ void CollisionMesh::InitAABB()
 
 	m_aabb.min = glm::vec3(min[0], min[1], min[2]);
 	m_aabb.max = glm::vec3(max[0], max[1], max[2]);
+
+	BuildBVH();
+}
+
+static constexpr uint32_t BVH_MAX_LEAF_TRIANGLES = 4;
+static constexpr uint32_t BVH_NUM_BINS = 16;
+
+namespace
+{
+struct BVHBuildTriangle
+{
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+	glm::vec3 centroid;
+	uint32_t firstIndex;
+};
+
+struct BVHBin
+{
+	glm::vec3 boundsMin{ INFINITY };
+	glm::vec3 boundsMax{ -INFINITY };
+	uint32_t numTriangles = 0;
+
+	void Add(const glm::vec3& otherMin, const glm::vec3& otherMax)
+	{
+		boundsMin = glm::min(boundsMin, otherMin);
+		boundsMax = glm::max(boundsMax, otherMax);
+	}
+
+	float HalfArea() const
+	{
+		if (numTriangles == 0)
+			return 0;
+		const glm::vec3 size = boundsMax - boundsMin;
+		return size.x * size.y + size.y * size.z + size.z * size.x;
+	}
+};
+} // namespace
+
+void CollisionMesh::BuildBVH()
+{
+	const uint32_t numTriangles = UnsignedNarrow<uint32_t>(m_indices.size() / 3);
+	if (numTriangles == 0)
+		return;
+
+	std::vector<BVHBuildTriangle> triangles(numTriangles);
+	for (uint32_t i = 0; i < numTriangles; i++)
+	{
+		const glm::vec3& v0 = VertexByIndex(i * 3);
+		const glm::vec3& v1 = VertexByIndex(i * 3 + 1);
+		const glm::vec3& v2 = VertexByIndex(i * 3 + 2);
+		triangles[i].boundsMin = glm::min(glm::min(v0, v1), v2);
+		triangles[i].boundsMax = glm::max(glm::max(v0, v1), v2);
+		triangles[i].centroid = (triangles[i].boundsMin + triangles[i].boundsMax) * 0.5f;
+		triangles[i].firstIndex = i * 3;
+	}
+
+	m_bvhNodes.reserve(numTriangles * 2 / BVH_MAX_LEAF_TRIANGLES + 1);
+
+	struct BuildItem
+	{
+		uint32_t begin;
+		uint32_t end;
+		uint32_t depth;
+		uint32_t parentIfSecondChild;
+	};
+	std::vector<BuildItem> buildStack;
+	buildStack.push_back({ 0, numTriangles, 0, UINT32_MAX });
+
+	// Nodes are allocated when popped from the stack. Since the first child is pushed last, it is allocated directly
+	//  after its parent, and the second child is allocated once the first child's subtree is complete.
+	while (!buildStack.empty())
+	{
+		const BuildItem item = buildStack.back();
+		buildStack.pop_back();
+
+		const uint32_t nodeIndex = UnsignedNarrow<uint32_t>(m_bvhNodes.size());
+		m_bvhNodes.emplace_back();
+		if (item.parentIfSecondChild != UINT32_MAX)
+			m_bvhNodes[item.parentIfSecondChild].firstTriangleOrChild = nodeIndex;
+
+		glm::vec3 boundsMin(INFINITY);
+		glm::vec3 boundsMax(-INFINITY);
+		glm::vec3 centroidMin(INFINITY);
+		glm::vec3 centroidMax(-INFINITY);
+		for (uint32_t i = item.begin; i < item.end; i++)
+		{
+			boundsMin = glm::min(boundsMin, triangles[i].boundsMin);
+			boundsMax = glm::max(boundsMax, triangles[i].boundsMax);
+			centroidMin = glm::min(centroidMin, triangles[i].centroid);
+			centroidMax = glm::max(centroidMax, triangles[i].centroid);
+		}
+		m_bvhNodes[nodeIndex].boundsMin = boundsMin;
+		m_bvhNodes[nodeIndex].boundsMax = boundsMax;
+
+		const uint32_t count = item.end - item.begin;
+		const glm::vec3 centroidExtent = centroidMax - centroidMin;
+		int axis = 0;
+		if (centroidExtent.y > centroidExtent[axis])
+			axis = 1;
+		if (centroidExtent.z > centroidExtent[axis])
+			axis = 2;
+
+		if (count <= BVH_MAX_LEAF_TRIANGLES || item.depth >= MAX_BVH_DEPTH || centroidExtent[axis] <= 0)
+		{
+			m_bvhNodes[nodeIndex].firstTriangleOrChild = item.begin;
+			m_bvhNodes[nodeIndex].numTriangles = count;
+			continue;
+		}
+
+		// Bins triangles by centroid along the longest axis and picks the split with the lowest surface area cost
+		BVHBin bins[BVH_NUM_BINS];
+		const float binScale = static_cast<float>(BVH_NUM_BINS) / centroidExtent[axis];
+		auto GetBin = [&](const BVHBuildTriangle& triangle)
+		{
+			const float bin = (triangle.centroid[axis] - centroidMin[axis]) * binScale;
+			return std::min(static_cast<uint32_t>(bin), BVH_NUM_BINS - 1);
+		};
+		for (uint32_t i = item.begin; i < item.end; i++)
+		{
+			BVHBin& bin = bins[GetBin(triangles[i])];
+			bin.Add(triangles[i].boundsMin, triangles[i].boundsMax);
+			bin.numTriangles++;
+		}
+
+		float rightCosts[BVH_NUM_BINS];
+		BVHBin accumulated;
+		for (uint32_t b = BVH_NUM_BINS - 1; b > 0; b--)
+		{
+			accumulated.Add(bins[b].boundsMin, bins[b].boundsMax);
+			accumulated.numTriangles += bins[b].numTriangles;
+			rightCosts[b] = accumulated.HalfArea() * static_cast<float>(accumulated.numTriangles);
+		}
+
+		float bestCost = INFINITY;
+		uint32_t bestSplit = 0;
+		accumulated = {};
+		for (uint32_t b = 1; b < BVH_NUM_BINS; b++)
+		{
+			accumulated.Add(bins[b - 1].boundsMin, bins[b - 1].boundsMax);
+			accumulated.numTriangles += bins[b - 1].numTriangles;
+			const float cost = accumulated.HalfArea() * static_cast<float>(accumulated.numTriangles) + rightCosts[b];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestSplit = b;
+			}
+		}
+
+		BVHBuildTriangle* mid = std::partition(
+			triangles.data() + item.begin, triangles.data() + item.end,
+			[&](const BVHBuildTriangle& triangle) { return GetBin(triangle) < bestSplit; });
+		uint32_t midIndex = static_cast<uint32_t>(mid - triangles.data());
+
+		// Falls back to a median split if all triangles ended up on one side
+		if (midIndex == item.begin || midIndex == item.end)
+		{
+			midIndex = item.begin + count / 2;
+			std::nth_element(
+				triangles.data() + item.begin, triangles.data() + midIndex, triangles.data() + item.end,
+				[&](const BVHBuildTriangle& a, const BVHBuildTriangle& b)
+				{ return a.centroid[axis] < b.centroid[axis]; });
+		}
+
+		m_bvhNodes[nodeIndex].numTriangles = 0;
+		buildStack.push_back({ midIndex, item.end, item.depth + 1, nodeIndex });
+		buildStack.push_back({ item.begin, midIndex, item.depth + 1, UINT32_MAX });
+	}
+
+	m_bvhTriangles.resize(numTriangles);
+	for (uint32_t i = 0; i < numTriangles; i++)
+		m_bvhTriangles[i] = triangles[i].firstIndex;
 }
 
 CollisionMesh CollisionMesh::Join(std::span<const CollisionMesh> meshes)
@@ -138,7 +362,36 @@ CollisionMesh CollisionMesh::Join(std::span<const CollisionMesh> meshes)
 		nextVertex += UnsignedNarrow<uint32_t>(mesh.m_vertices.size());
 	}
 
-	result.InitAABB();
+	result.InitBounds();
 	return result;
 }
+
+void CollisionMesh::Serialize(std::ostream& stream) const
+{
+	BinWrite(stream, UnsignedNarrow<uint32_t>(m_vertices.size()));
+	BinWrite(stream, UnsignedNarrow<uint32_t>(m_indices.size()));
+	BinWrite(stream, UnsignedNarrow<uint32_t>(m_bvhNodes.size()));
+	stream.write(reinterpret_cast<const char*>(m_vertices.data()), m_vertices.size() * sizeof(glm::vec3));
+	stream.write(reinterpret_cast<const char*>(m_indices.data()), m_indices.size() * sizeof(uint32_t));
+	stream.write(reinterpret_cast<const char*>(&m_aabb.min), sizeof(glm::vec3));
+	stream.write(reinterpret_cast<const char*>(&m_aabb.max), sizeof(glm::vec3));
+	stream.write(reinterpret_cast<const char*>(m_bvhNodes.data()), m_bvhNodes.size() * sizeof(BVHNode));
+	stream.write(reinterpret_cast<const char*>(m_bvhTriangles.data()), m_bvhTriangles.size() * sizeof(uint32_t));
+}
+
+CollisionMesh CollisionMesh::Deserialize(std::istream& stream)
+{
+	CollisionMesh mesh;
+	mesh.m_vertices.resize(BinRead<uint32_t>(stream));
+	mesh.m_indices.resize(BinRead<uint32_t>(stream));
+	mesh.m_bvhNodes.resize(BinRead<uint32_t>(stream));
+	mesh.m_bvhTriangles.resize(mesh.m_bvhNodes.empty() ? 0 : mesh.m_indices.size() / 3);
+	stream.read(reinterpret_cast<char*>(mesh.m_vertices.data()), mesh.m_vertices.size() * sizeof(glm::vec3));
+	stream.read(reinterpret_cast<char*>(mesh.m_indices.data()), mesh.m_indices.size() * sizeof(uint32_t));
+	stream.read(reinterpret_cast<char*>(&mesh.m_aabb.min), sizeof(glm::vec3));
+	stream.read(reinterpret_cast<char*>(&mesh.m_aabb.max), sizeof(glm::vec3));
+	stream.read(reinterpret_cast<char*>(mesh.m_bvhNodes.data()), mesh.m_bvhNodes.size() * sizeof(BVHNode));
+	stream.read(reinterpret_cast<char*>(mesh.m_bvhTriangles.data()), mesh.m_bvhTriangles.size() * sizeof(uint32_t));
+	return mesh;
+}
 } // namespace eg
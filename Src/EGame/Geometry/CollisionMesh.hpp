@@ -5,6 +5,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <iosfwd>
 #include <span>
 #include <vector>
 
@@ -30,7 +31,7 @@ public:
 			}
 		}
 
-		mesh.InitAABB();
+		mesh.InitBounds();
 		return mesh;
 	}
 
@@ -42,7 +43,7 @@ public:
 		mesh.m_indices.resize(indices.size());
 		std::copy(vertices.begin(), vertices.end(), mesh.m_vertices.begin());
 		std::copy(indices.begin(), indices.end(), mesh.m_indices.begin());
-		mesh.InitAABB();
+		mesh.InitBounds();
 		return mesh;
 	}
 
@@ -52,8 +53,53 @@ public:
 
 	void FlipWinding();
 
+	/**
+	 * Finds the closest triangle hit by a ray, and returns the index of its first vertex index (or -1 if no triangle is
+	 * hit). If transform is set, the ray is transformed into mesh space rather than transforming the mesh.
+	 */
 	int Intersect(const class Ray& ray, float& intersectPos, const glm::mat4* transform = nullptr) const;
 
+	// Calls callback with the index of the first vertex index of every triangle whose bounding box overlaps box
+	template <typename CallbackFn>
+	void ForEachTriangleInBox(const AABB& box, CallbackFn callback) const
+	{
+		if (m_bvhNodes.empty())
+			return;
+
+		uint32_t stack[MAX_BVH_DEPTH + 1];
+		uint32_t stackSize = 0;
+		stack[stackSize++] = 0;
+		while (stackSize > 0)
+		{
+			const BVHNode& node = m_bvhNodes[stack[--stackSize]];
+			if (glm::any(glm::greaterThan(node.boundsMin, box.max)) || glm::any(glm::lessThan(node.boundsMax, box.min)))
+				continue;
+
+			if (node.numTriangles == 0)
+			{
+				stack[stackSize++] = node.firstTriangleOrChild;
+				stack[stackSize++] = static_cast<uint32_t>(&node - m_bvhNodes.data()) + 1;
+				continue;
+			}
+
+			for (uint32_t i = 0; i < node.numTriangles; i++)
+			{
+				const uint32_t firstIndex = m_bvhTriangles[node.firstTriangleOrChild + i];
+				const glm::vec3& v0 = VertexByIndex(firstIndex);
+				const glm::vec3& v1 = VertexByIndex(firstIndex + 1);
+				const glm::vec3& v2 = VertexByIndex(firstIndex + 2);
+				const glm::vec3 triangleMin = glm::min(glm::min(v0, v1), v2);
+				const glm::vec3 triangleMax = glm::max(glm::max(v0, v1), v2);
+				if (!glm::any(glm::greaterThan(triangleMin, box.max)) && !glm::any(glm::lessThan(triangleMax, box.min)))
+					callback(firstIndex);
+			}
+		}
+	}
+
+	// Writes the mesh along with its bounding volume hierarchy, so that it does not have to be rebuilt when loaded
+	void Serialize(std::ostream& stream) const;
+	static CollisionMesh Deserialize(std::istream& stream);
+
 	size_t NumIndices() const { return m_indices.size(); }
 
 	size_t NumVertices() const { return m_vertices.size(); }
@@ -69,11 +115,27 @@ public:
 	const eg::AABB& BoundingBox() const { return m_aabb; }
 
 private:
-	void InitAABB();
+	// Computes the bounding box and builds the bounding volume hierarchy
+	void InitBounds();
+
+	void BuildBVH();
+
+	static constexpr uint32_t MAX_BVH_DEPTH = 48;
+
+	struct BVHNode
+	{
+		glm::vec3 boundsMin;
+		uint32_t firstTriangleOrChild; // Index into m_bvhTriangles for leaves, the second child for interior nodes
+		glm::vec3 boundsMax;
+		uint32_t numTriangles; // Zero for interior nodes, whose first child directly follows them
+	};
 
 	std::vector<uint32_t> m_indices;
 	std::vector<glm::vec3> m_vertices;
 
 	AABB m_aabb;
+
+	std::vector<BVHNode> m_bvhNodes;
+	std::vector<uint32_t> m_bvhTriangles; // First vertex index of each triangle, ordered by leaf
 };
 } // namespace eg
@@ -1,7 +1,16 @@
 #include "Frustum.hpp"
+#include "../Assert.hpp"
+#include "../SIMD.hpp"
 #include "AABB.hpp"
 #include "Sphere.hpp"
 
+#include <algorithm>
+#include <limits>
+
+#ifdef EG_HAS_SIMD
+#include <immintrin.h>
+#endif
+
 namespace eg
 {
 static Plane CreateFrustumPlane(
@@ -77,6 +86,297 @@ bool Frustum::Intersects(const AABB& aabb) const
 	return true;
 }
 
+// Frustum planes in structure of arrays layout for the batch tests. There are 8 entries so that cached plane indices
+//  can be masked instead of checked, entries of disabled planes never reject anything.
+struct BatchPlanes
+{
+	alignas(32) float nx[8];
+	alignas(32) float ny[8];
+	alignas(32) float nz[8];
+	alignas(32) float d[8];
+	uint32_t firstPlane;
+
+	BatchPlanes(const Plane* planes, bool enableZCheck) : firstPlane(enableZCheck ? 0 : 2)
+	{
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			const bool enabled = i >= firstPlane && i < 6;
+			nx[i] = enabled ? planes[i].GetNormal().x : 0.0f;
+			ny[i] = enabled ? planes[i].GetNormal().y : 0.0f;
+			nz[i] = enabled ? planes[i].GetNormal().z : 0.0f;
+			d[i] = enabled ? planes[i].GetDistance() : -std::numeric_limits<float>::infinity();
+		}
+	}
+
+	// Same tests as Intersects, written so that the SIMD kernels below give identical results
+	bool SphereRejected(uint32_t p, const SphereSoA& spheres, size_t i) const
+	{
+		const float dist = nx[p] * spheres.x[i] + ny[p] * spheres.y[i] + nz[p] * spheres.z[i] - d[p];
+		return dist < -spheres.radius[i];
+	}
+
+	// A box is outside a plane if its vertex furthest along the plane normal is
+	bool AABBRejected(uint32_t p, const AABBSoA& boxes, size_t i) const
+	{
+		const float x = nx[p] >= 0 ? boxes.maxX[i] : boxes.minX[i];
+		const float y = ny[p] >= 0 ? boxes.maxY[i] : boxes.minY[i];
+		const float z = nz[p] >= 0 ? boxes.maxZ[i] : boxes.minZ[i];
+		return nx[p] * x + ny[p] * y + nz[p] * z - d[p] <= 0;
+	}
+};
+
+template <typename RejectedFn>
+static bool IntersectsScalar(const BatchPlanes& planes, uint8_t* cachedPlane, RejectedFn rejected)
+{
+	if (cachedPlane != nullptr && rejected(*cachedPlane & 7U))
+		return false;
+	for (uint32_t p = planes.firstPlane; p < 6; p++)
+	{
+		if (rejected(p))
+		{
+			if (cachedPlane != nullptr)
+				*cachedPlane = static_cast<uint8_t>(p);
+			return false;
+		}
+	}
+	return true;
+}
+
+#ifdef EG_HAS_SIMD
+struct SphereGroupSSE
+{
+	__m128 x, y, z, negRadius;
+
+	EG_SIMD_TARGET("sse4.1")
+	SphereGroupSSE(const SphereSoA& spheres, size_t i)
+		: x(_mm_loadu_ps(spheres.x + i)), y(_mm_loadu_ps(spheres.y + i)), z(_mm_loadu_ps(spheres.z + i)),
+		  negRadius(_mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres.radius + i)))
+	{
+	}
+
+	EG_SIMD_TARGET("sse4.1") __m128 Rejected(__m128 nx, __m128 ny, __m128 nz, __m128 d) const
+	{
+		const __m128 dist =
+			_mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, x), _mm_mul_ps(ny, y)), _mm_mul_ps(nz, z)), d);
+		return _mm_cmplt_ps(dist, negRadius);
+	}
+};
+
+struct AABBGroupSSE
+{
+	__m128 minX, minY, minZ, maxX, maxY, maxZ;
+
+	EG_SIMD_TARGET("sse4.1")
+	AABBGroupSSE(const AABBSoA& boxes, size_t i)
+		: minX(_mm_loadu_ps(boxes.minX + i)), minY(_mm_loadu_ps(boxes.minY + i)), minZ(_mm_loadu_ps(boxes.minZ + i)),
+		  maxX(_mm_loadu_ps(boxes.maxX + i)), maxY(_mm_loadu_ps(boxes.maxY + i)), maxZ(_mm_loadu_ps(boxes.maxZ + i))
+	{
+	}
+
+	EG_SIMD_TARGET("sse4.1") __m128 Rejected(__m128 nx, __m128 ny, __m128 nz, __m128 d) const
+	{
+		const __m128 zero = _mm_setzero_ps();
+		const __m128 x = _mm_blendv_ps(minX, maxX, _mm_cmpge_ps(nx, zero));
+		const __m128 y = _mm_blendv_ps(minY, maxY, _mm_cmpge_ps(ny, zero));
+		const __m128 z = _mm_blendv_ps(minZ, maxZ, _mm_cmpge_ps(nz, zero));
+		const __m128 dist =
+			_mm_sub_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, x), _mm_mul_ps(ny, y)), _mm_mul_ps(nz, z)), d);
+		return _mm_cmple_ps(dist, zero);
+	}
+};
+
+struct SphereGroupAVX2
+{
+	__m256 x, y, z, negRadius;
+
+	EG_SIMD_TARGET("avx2")
+	SphereGroupAVX2(const SphereSoA& spheres, size_t i)
+		: x(_mm256_loadu_ps(spheres.x + i)), y(_mm256_loadu_ps(spheres.y + i)), z(_mm256_loadu_ps(spheres.z + i)),
+		  negRadius(_mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(spheres.radius + i)))
+	{
+	}
+
+	EG_SIMD_TARGET("avx2") __m256 Rejected(__m256 nx, __m256 ny, __m256 nz, __m256 d) const
+	{
+		const __m256 dist = _mm256_sub_ps(
+			_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, x), _mm256_mul_ps(ny, y)), _mm256_mul_ps(nz, z)), d);
+		return _mm256_cmp_ps(dist, negRadius, _CMP_LT_OQ);
+	}
+};
+
+struct AABBGroupAVX2
+{
+	__m256 minX, minY, minZ, maxX, maxY, maxZ;
+
+	EG_SIMD_TARGET("avx2")
+	AABBGroupAVX2(const AABBSoA& boxes, size_t i)
+		: minX(_mm256_loadu_ps(boxes.minX + i)), minY(_mm256_loadu_ps(boxes.minY + i)),
+		  minZ(_mm256_loadu_ps(boxes.minZ + i)), maxX(_mm256_loadu_ps(boxes.maxX + i)),
+		  maxY(_mm256_loadu_ps(boxes.maxY + i)), maxZ(_mm256_loadu_ps(boxes.maxZ + i))
+	{
+	}
+
+	EG_SIMD_TARGET("avx2") __m256 Rejected(__m256 nx, __m256 ny, __m256 nz, __m256 d) const
+	{
+		const __m256 zero = _mm256_setzero_ps();
+		const __m256 x = _mm256_blendv_ps(minX, maxX, _mm256_cmp_ps(nx, zero, _CMP_GE_OQ));
+		const __m256 y = _mm256_blendv_ps(minY, maxY, _mm256_cmp_ps(ny, zero, _CMP_GE_OQ));
+		const __m256 z = _mm256_blendv_ps(minZ, maxZ, _mm256_cmp_ps(nz, zero, _CMP_GE_OQ));
+		const __m256 dist = _mm256_sub_ps(
+			_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, x), _mm256_mul_ps(ny, y)), _mm256_mul_ps(nz, z)), d);
+		return _mm256_cmp_ps(dist, zero, _CMP_LE_OQ);
+	}
+};
+
+// Tests volumes 4 at a time, returns the number of volumes tested. Each lane tracks the plane that rejected it, which
+//  starts out as the cached plane.
+template <typename Group, typename SoA>
+EG_SIMD_TARGET("sse4.1")
+static size_t IntersectsBatchSSE(const BatchPlanes& planes, const SoA& volumes, uint64_t* visibleMask, uint8_t* cache)
+{
+	size_t i = 0;
+	for (; i + 4 <= volumes.count; i += 4)
+	{
+		const Group group(volumes, i);
+		__m128 rejected = _mm_setzero_ps();
+		__m128i rejectPlane = _mm_setzero_si128();
+
+		if (cache != nullptr)
+		{
+			const int c0 = cache[i] & 7, c1 = cache[i + 1] & 7, c2 = cache[i + 2] & 7, c3 = cache[i + 3] & 7;
+			rejectPlane = _mm_setr_epi32(c0, c1, c2, c3);
+			rejected = group.Rejected(
+				_mm_setr_ps(planes.nx[c0], planes.nx[c1], planes.nx[c2], planes.nx[c3]),
+				_mm_setr_ps(planes.ny[c0], planes.ny[c1], planes.ny[c2], planes.ny[c3]),
+				_mm_setr_ps(planes.nz[c0], planes.nz[c1], planes.nz[c2], planes.nz[c3]),
+				_mm_setr_ps(planes.d[c0], planes.d[c1], planes.d[c2], planes.d[c3]));
+		}
+
+		for (uint32_t p = planes.firstPlane; p < 6 && _mm_movemask_ps(rejected) != 0xF; p++)
+		{
+			const __m128 planeRejected = group.Rejected(
+				_mm_set1_ps(planes.nx[p]), _mm_set1_ps(planes.ny[p]), _mm_set1_ps(planes.nz[p]),
+				_mm_set1_ps(planes.d[p]));
+			const __m128 newlyRejected = _mm_andnot_ps(rejected, planeRejected);
+			rejectPlane =
+				_mm_blendv_epi8(rejectPlane, _mm_set1_epi32(static_cast<int>(p)), _mm_castps_si128(newlyRejected));
+			rejected = _mm_or_ps(rejected, planeRejected);
+		}
+
+		if (cache != nullptr)
+		{
+			alignas(16) int planeIndices[4];
+			_mm_store_si128(reinterpret_cast<__m128i*>(planeIndices), rejectPlane);
+			for (size_t j = 0; j < 4; j++)
+				cache[i + j] = static_cast<uint8_t>(planeIndices[j]);
+		}
+
+		const uint64_t visible = static_cast<uint64_t>(~_mm_movemask_ps(rejected) & 0xF);
+		visibleMask[i / 64] |= visible << (i % 64);
+	}
+	return i;
+}
+
+// Same as IntersectsBatchSSE, 8 volumes at a time
+template <typename Group, typename SoA>
+EG_SIMD_TARGET("avx2")
+static size_t IntersectsBatchAVX2(const BatchPlanes& planes, const SoA& volumes, uint64_t* visibleMask, uint8_t* cache)
+{
+	size_t i = 0;
+	for (; i + 8 <= volumes.count; i += 8)
+	{
+		const Group group(volumes, i);
+		__m256 rejected = _mm256_setzero_ps();
+		__m256i rejectPlane = _mm256_setzero_si256();
+
+		if (cache != nullptr)
+		{
+			rejectPlane = _mm256_and_si256(
+				_mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(cache + i))),
+				_mm256_set1_epi32(7));
+			rejected = group.Rejected(
+				_mm256_i32gather_ps(planes.nx, rejectPlane, 4), _mm256_i32gather_ps(planes.ny, rejectPlane, 4),
+				_mm256_i32gather_ps(planes.nz, rejectPlane, 4), _mm256_i32gather_ps(planes.d, rejectPlane, 4));
+		}
+
+		for (uint32_t p = planes.firstPlane; p < 6 && _mm256_movemask_ps(rejected) != 0xFF; p++)
+		{
+			const __m256 planeRejected = group.Rejected(
+				_mm256_set1_ps(planes.nx[p]), _mm256_set1_ps(planes.ny[p]), _mm256_set1_ps(planes.nz[p]),
+				_mm256_set1_ps(planes.d[p]));
+			const __m256 newlyRejected = _mm256_andnot_ps(rejected, planeRejected);
+			rejectPlane = _mm256_blendv_epi8(
+				rejectPlane, _mm256_set1_epi32(static_cast<int>(p)), _mm256_castps_si256(newlyRejected));
+			rejected = _mm256_or_ps(rejected, planeRejected);
+		}
+
+		if (cache != nullptr)
+		{
+			alignas(32) int planeIndices[8];
+			_mm256_store_si256(reinterpret_cast<__m256i*>(planeIndices), rejectPlane);
+			for (size_t j = 0; j < 8; j++)
+				cache[i + j] = static_cast<uint8_t>(planeIndices[j]);
+		}
+
+		const uint64_t visible = static_cast<uint64_t>(~_mm256_movemask_ps(rejected) & 0xFF);
+		visibleMask[i / 64] |= visible << (i % 64);
+	}
+	return i;
+}
+#endif
+
+static uint8_t* BeginBatch(size_t count, std::span<uint64_t> visibleMask, std::span<uint8_t> cachedPlanes)
+{
+	EG_ASSERT(visibleMask.size() * 64 >= count);
+	EG_ASSERT(cachedPlanes.empty() || cachedPlanes.size() >= count);
+	std::fill_n(visibleMask.begin(), (count + 63) / 64, 0);
+	return cachedPlanes.empty() ? nullptr : cachedPlanes.data();
+}
+
+void Frustum::IntersectsBatch(
+	const SphereSoA& spheres, std::span<uint64_t> visibleMask, std::span<uint8_t> cachedPlanes) const
+{
+	const BatchPlanes planes(m_planes, m_enableZCheck);
+	uint8_t* cache = BeginBatch(spheres.count, visibleMask, cachedPlanes);
+
+	size_t numTested = 0;
+#ifdef EG_HAS_SIMD
+	if (CPUSupportsAVX2())
+		numTested = IntersectsBatchAVX2<SphereGroupAVX2>(planes, spheres, visibleMask.data(), cache);
+	else if (CPUSupportsSSE41())
+		numTested = IntersectsBatchSSE<SphereGroupSSE>(planes, spheres, visibleMask.data(), cache);
+#endif
+
+	for (size_t i = numTested; i < spheres.count; i++)
+	{
+		const bool visible = IntersectsScalar(
+			planes, cache ? cache + i : nullptr, [&](uint32_t p) { return planes.SphereRejected(p, spheres, i); });
+		visibleMask[i / 64] |= static_cast<uint64_t>(visible) << (i % 64);
+	}
+}
+
+void Frustum::IntersectsBatch(
+	const AABBSoA& boxes, std::span<uint64_t> visibleMask, std::span<uint8_t> cachedPlanes) const
+{
+	const BatchPlanes planes(m_planes, m_enableZCheck);
+	uint8_t* cache = BeginBatch(boxes.count, visibleMask, cachedPlanes);
+
+	size_t numTested = 0;
+#ifdef EG_HAS_SIMD
+	if (CPUSupportsAVX2())
+		numTested = IntersectsBatchAVX2<AABBGroupAVX2>(planes, boxes, visibleMask.data(), cache);
+	else if (CPUSupportsSSE41())
+		numTested = IntersectsBatchSSE<AABBGroupSSE>(planes, boxes, visibleMask.data(), cache);
+#endif
+
+	for (size_t i = numTested; i < boxes.count; i++)
+	{
+		const bool visible = IntersectsScalar(
+			planes, cache ? cache + i : nullptr, [&](uint32_t p) { return planes.AABBRejected(p, boxes, i); });
+		visibleMask[i / 64] |= static_cast<uint64_t>(visible) << (i % 64);
+	}
+}
+
 bool Frustum::Contains(const Sphere& sphere) const
 {
 	for (int i = m_enableZCheck ? 0 : 2; i < 6; i++)
@@ -3,8 +3,33 @@
 #include "../API.hpp"
 #include "Plane.hpp"
 
+#include <cstdint>
+#include <span>
+
 namespace eg
 {
+// Spheres in structure of arrays layout, for testing many at once with Frustum::IntersectsBatch
+struct SphereSoA
+{
+	const float* x;
+	const float* y;
+	const float* z;
+	const float* radius;
+	size_t count;
+};
+
+// Axis aligned boxes in structure of arrays layout, for testing many at once with Frustum::IntersectsBatch
+struct AABBSoA
+{
+	const float* minX;
+	const float* minY;
+	const float* minZ;
+	const float* maxX;
+	const float* maxY;
+	const float* maxZ;
+	size_t count;
+};
+
 class EG_API Frustum
 {
 public:
@@ -15,6 +40,19 @@ public:
 
 	bool Intersects(const class AABB& aabb) const;
 
+	/**
+	 * Tests many volumes at once, with the same result as Intersects for each of them. Bit i % 64 of
+	 * visibleMask[i / 64] is set if volume i intersects the frustum, visibleMask must have room for count bits.
+	 *
+	 * cachedPlanes is optional. If given, it holds one plane index per volume (initialize to 0) which is tested
+	 * first, and is set to the plane that rejected the volume. Volumes that stay outside the frustum between calls
+	 * are then usually rejected by the first test.
+	 */
+	void IntersectsBatch(
+		const SphereSoA& spheres, std::span<uint64_t> visibleMask, std::span<uint8_t> cachedPlanes = {}) const;
+	void IntersectsBatch(
+		const AABBSoA& boxes, std::span<uint64_t> visibleMask, std::span<uint8_t> cachedPlanes = {}) const;
+
 	bool Contains(const class Sphere& sphere) const;
 	bool Contains(const glm::vec3& point) const;
 
@@ -2,6 +2,7 @@
 #include "../Assert.hpp"
 #include "../Hash.hpp"
 #include "../Log.hpp"
+#include "Null/NullGraphics.hpp"
 #include "OpenGL/OpenGL.hpp"
 #include "Vulkan/VulkanMain.hpp"
 
@@ -22,6 +23,7 @@ namespace eg
 namespace gal
 {
 GraphicsMemoryStat (*GetMemoryStat)();
+PipelineCacheStat (*GetPipelineCacheStat)();
 
 #define XM_ABSCALLBACK(name, ret, params) ret(*name) params;
 #include "AbstractionCallbacks.inl"
@@ -40,6 +42,7 @@ bool InitializeGraphicsAPI(GraphicsAPI api, const GraphicsAPIInitArguments& init
 #define XM_ABSCALLBACK(name, ret, params) gal::name = &graphics_api::gl::name;
 #include "AbstractionCallbacks.inl"
 #undef XM_ABSCALLBACK
+		gal::GetPipelineCacheStat = nullptr;
 		return eg::graphics_api::gl::Initialize(initArguments);
 
 #ifndef EG_NO_VULKAN
@@ -48,9 +51,18 @@ bool InitializeGraphicsAPI(GraphicsAPI api, const GraphicsAPIInitArguments& init
 #include "AbstractionCallbacks.inl"
 #undef XM_ABSCALLBACK
 		gal::GetMemoryStat = &eg::graphics_api::vk::GetMemoryStat;
+		gal::GetPipelineCacheStat = &eg::graphics_api::vk::GetPipelineCacheStat;
 		return eg::graphics_api::vk::Initialize(initArguments);
 #endif
 
+	case GraphicsAPI::Null:
+#define XM_ABSCALLBACK(name, ret, params) gal::name = &graphics_api::null::name;
+#include "AbstractionCallbacks.inl"
+#undef XM_ABSCALLBACK
+		gal::GetMemoryStat = &eg::graphics_api::null::GetMemoryStat;
+		gal::GetPipelineCacheStat = nullptr;
+		return eg::graphics_api::null::Initialize(initArguments);
+
 	default:
 		break;
 	}
@@ -65,6 +77,7 @@ void DestroyGraphicsAPI()
 #define XM_ABSCALLBACK(name, ret, params) gal::name = nullptr;
 #include "AbstractionCallbacks.inl"
 #undef XM_ABSCALLBACK
+	gal::GetPipelineCacheStat = nullptr;
 }
 
 template <>
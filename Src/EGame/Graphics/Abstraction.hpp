@@ -378,6 +378,11 @@ struct GraphicsPipelineCreateInfo
 	VertexBinding vertexBindings[MAX_VERTEX_BINDINGS];
 	VertexAttribute vertexAttributes[MAX_VERTEX_ATTRIBUTES];
 
+	// Framebuffer format variants declared with FramebufferFormatHint are compiled in the background. When the
+	//  pipeline is bound before the variant for the current framebuffer is ready, binding waits for it to compile
+	//  unless this is set, in which case draws are skipped until another pipeline is bound.
+	bool skipDrawsWhileCompiling = false;
+
 	const char* label = nullptr;
 };
 
@@ -724,9 +729,9 @@ inline GraphicsAPI CurrentGraphicsAPI()
 	return detail::graphicsAPI;
 }
 
-bool InitializeGraphicsAPI(GraphicsAPI api, const GraphicsAPIInitArguments& initArguments);
+EG_API bool InitializeGraphicsAPI(GraphicsAPI api, const GraphicsAPIInitArguments& initArguments);
 
-void DestroyGraphicsAPI();
+EG_API void DestroyGraphicsAPI();
 
 struct GraphicsMemoryStat
 {
@@ -736,6 +741,16 @@ struct GraphicsMemoryStat
 	uint32_t unusedRanges;
 };
 
+// Pipeline creations since the graphics API was initialized, for APIs that keep a pipeline cache
+struct PipelineCacheStat
+{
+	uint64_t loadedBytes; // Size of the cache data loaded from disk, 0 if there was no usable cache file
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t unreported; // Pipelines created while the driver does not report whether the cache was hit
+	int64_t creationTimeNs;
+};
+
 namespace gal
 {
 #define XM_ABSCALLBACK(name, ret, params) extern EG_API ret(*name) params;
@@ -743,5 +758,6 @@ namespace gal
 #undef XM_ABSCALLBACK
 
 extern EG_API GraphicsMemoryStat (*GetMemoryStat)();
+extern EG_API PipelineCacheStat (*GetPipelineCacheStat)();
 } // namespace gal
 } // namespace eg
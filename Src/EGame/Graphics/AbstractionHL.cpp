@@ -5,7 +5,10 @@
 #include "../IOUtils.hpp"
 #include "ImageLoader.hpp"
 
+#include <algorithm>
+#include <atomic>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 
 namespace eg
@@ -92,74 +95,191 @@ void TextureRef::UsageHint(TextureUsage usage, ShaderAccessFlags shaderAccessFla
 
 static constexpr uint64_t MIN_BUFFER_SIZE = 4 * 1024 * 1024; // 4MiB
 
-struct UploadBufferEntry
+// Number of frames that the ring size is based on, the ring only shrinks once all of these fit in half of it
+static constexpr uint32_t UPLOAD_HISTORY_FRAMES = 128;
+
+/**
+ * Upload memory comes from one mapped buffer split into a region per frame in flight. Allocations bump an atomic
+ * offset into the current frame's region, so they can be made from any thread. When the region is full, the rest of
+ * the frame allocates from overflow buffers and the ring is replaced by a larger one when the next frame begins.
+ * Frames that load a lot of assets would otherwise keep the ring large forever, so it is also replaced by a smaller
+ * one when usage over the last UPLOAD_HISTORY_FRAMES frames has dropped well below the region size.
+ * Buffers in use by frames that are still in flight are kept alive by the graphics backend.
+ */
+static struct
 {
-	uint64_t lastUsedFrame;
-	uint64_t size;
-	uint64_t offset;
 	Buffer buffer;
+	std::atomic<uint64_t> regionSize{ 0 }; // Published last when the ring is created
+	uint64_t regionBegin = 0;
+	std::atomic<uint64_t> regionOffset{ 0 };
+	uint32_t frameSlot = 0;
 
-	explicit UploadBufferEntry(uint64_t _size) : size(_size), offset(0)
-	{
-		BufferCreateInfo createInfo;
-		createInfo.flags = BufferFlags::MapWrite | BufferFlags::CopySrc | BufferFlags::HostAllocate;
-		createInfo.size = _size;
-		createInfo.label = "UploadBuffer";
-		buffer = Buffer(createInfo);
-	}
-};
+	std::mutex overflowMutex;
+	std::vector<Buffer> overflowBuffers[MAX_CONCURRENT_FRAMES];
+	uint64_t overflowBufferSize = 0;
+	uint64_t overflowOffset = 0;
+	uint64_t overflowBytes = 0;
 
-static std::vector<UploadBufferEntry> uploadBuffers;
+	uint64_t frameBytesHistory[UPLOAD_HISTORY_FRAMES] = {};
+	uint32_t historyIndex = 0;
+	uint32_t framesSinceResize = 0;
 
-UploadBuffer GetTemporaryUploadBuffer(uint64_t size, uint64_t alignment)
+	UploadBufferStats stats = {};
+} uploadRing;
+
+static Buffer CreateUploadBuffer(uint64_t size)
+{
+	BufferCreateInfo createInfo;
+	createInfo.flags = BufferFlags::MapWrite | BufferFlags::CopySrc | BufferFlags::HostAllocate;
+	createInfo.size = size;
+	createInfo.label = "UploadBuffer";
+	return Buffer(createInfo);
+}
+
+static void CreateUploadRing(uint64_t regionSize)
+{
+	uploadRing.buffer = CreateUploadBuffer(regionSize * MAX_CONCURRENT_FRAMES);
+	uploadRing.regionBegin = regionSize * uploadRing.frameSlot;
+	uploadRing.regionOffset = 0;
+	uploadRing.regionSize.store(regionSize, std::memory_order_release);
+	uploadRing.stats.regionBytes = regionSize;
+	uploadRing.framesSinceResize = 0;
+
+	Log(LogLevel::Info, "gfx", "Created upload ring buffer with {0} per frame.", ReadableBytesSize(regionSize));
+}
+
+static bool TryAllocateFromRing(uint64_t size, uint64_t alignment, UploadBuffer& allocation)
 {
-	UploadBufferEntry* selected = nullptr;
-	for (UploadBufferEntry& buffer : uploadBuffers)
+	const uint64_t regionSize = uploadRing.regionSize.load(std::memory_order_acquire);
+	if (regionSize == 0)
+		return false;
+
+	uint64_t offset = uploadRing.regionOffset.load(std::memory_order_relaxed);
+	while (true)
 	{
-		if (buffer.lastUsedFrame == UINT64_MAX || buffer.lastUsedFrame == FrameIdx() ||
-		    buffer.lastUsedFrame + MAX_CONCURRENT_FRAMES <= FrameIdx())
+		const uint64_t alignedOffset =
+			RoundToNextMultiple(uploadRing.regionBegin + offset, alignment) - uploadRing.regionBegin;
+		if (alignedOffset + size > regionSize)
+			return false;
+
+		if (uploadRing.regionOffset.compare_exchange_weak(offset, alignedOffset + size, std::memory_order_relaxed))
 		{
-			uint64_t newOffset = RoundToNextMultiple(buffer.offset, alignment) + size;
-			if (buffer.lastUsedFrame != FrameIdx() || newOffset <= buffer.size)
-			{
-				selected = &buffer;
-				break;
-			}
+			allocation.buffer = uploadRing.buffer;
+			allocation.offset = uploadRing.regionBegin + alignedOffset;
+			allocation.range = size;
+			return true;
 		}
 	}
+}
 
-	if (selected == nullptr)
-	{
-		uint64_t allocSize = std::max(RoundToNextMultiple<uint64_t>(size, 1024 * 1024), MIN_BUFFER_SIZE);
-		selected = &uploadBuffers.emplace_back(allocSize);
+UploadBuffer GetTemporaryUploadBuffer(uint64_t size, uint64_t alignment)
+{
+	UploadBuffer allocation;
+	if (TryAllocateFromRing(size, alignment, allocation))
+		return allocation;
 
-		Log(LogLevel::Info, "gfx", "Created upload buffer with size {0}.", ReadableBytesSize(allocSize));
-	}
-	else if (selected->lastUsedFrame != FrameIdx())
+	std::lock_guard<std::mutex> lock(uploadRing.overflowMutex);
+
+	// Retries since another thread may have created the ring while this one was waiting
+	if (uploadRing.buffer.handle == nullptr)
+		CreateUploadRing(std::max(RoundToNextMultiple<uint64_t>(size, 1024 * 1024), MIN_BUFFER_SIZE));
+	if (TryAllocateFromRing(size, alignment, allocation))
+		return allocation;
+
+	std::vector<Buffer>& overflowBuffers = uploadRing.overflowBuffers[uploadRing.frameSlot];
+	uint64_t offset = RoundToNextMultiple(uploadRing.overflowOffset, alignment);
+	if (overflowBuffers.empty() || offset + size > uploadRing.overflowBufferSize)
 	{
-		selected->offset = 0;
+		uploadRing.overflowBufferSize =
+			std::max(RoundToNextMultiple<uint64_t>(size, 1024 * 1024), uploadRing.regionSize.load());
+		overflowBuffers.push_back(CreateUploadBuffer(uploadRing.overflowBufferSize));
+		uploadRing.stats.overflowBuffers++;
+		offset = 0;
 	}
 
-	UploadBuffer ret;
-	ret.buffer = selected->buffer;
-	ret.offset = RoundToNextMultiple(selected->offset, alignment);
-	ret.range = size;
+	uploadRing.overflowOffset = offset + size;
+	uploadRing.overflowBytes += size;
 
-	selected->offset = ret.offset + size;
-	selected->lastUsedFrame = FrameIdx();
+	allocation.buffer = overflowBuffers.back();
+	allocation.offset = offset;
+	allocation.range = size;
+	return allocation;
+}
 
-	return ret;
+// Region size for frames using up to frameBytes, with some headroom so that small increases do not cause resizes
+static uint64_t UploadRegionSize(uint64_t frameBytes)
+{
+	return std::max(RoundToNextMultiple<uint64_t>(frameBytes + frameBytes / 4, 1024 * 1024), MIN_BUFFER_SIZE);
+}
+
+void detail::UploadBuffersBeginFrame()
+{
+	const uint64_t frameBytes = uploadRing.regionOffset.load() + uploadRing.overflowBytes;
+	uploadRing.stats.lastFrameBytes = frameBytes;
+	uploadRing.stats.peakFrameBytes = std::max(uploadRing.stats.peakFrameBytes, frameBytes);
+
+	uploadRing.frameBytesHistory[uploadRing.historyIndex] = frameBytes;
+	uploadRing.historyIndex = (uploadRing.historyIndex + 1) % UPLOAD_HISTORY_FRAMES;
+	uploadRing.framesSinceResize++;
+	const uint64_t recentPeakBytes =
+		*std::max_element(std::begin(uploadRing.frameBytesHistory), std::end(uploadRing.frameBytesHistory));
+
+	// The frame that last used this slot has completed, so its region and overflow buffers can be reused
+	uploadRing.frameSlot = CFrameIdx();
+	uploadRing.overflowBuffers[uploadRing.frameSlot].clear();
+	uploadRing.overflowOffset = 0;
+	uploadRing.overflowBytes = 0;
+
+	uint64_t newRegionSize = 0;
+	if (uploadRing.buffer.handle != nullptr)
+	{
+		if (frameBytes > uploadRing.regionSize)
+			newRegionSize = UploadRegionSize(frameBytes);
+		else if (uploadRing.framesSinceResize >= UPLOAD_HISTORY_FRAMES &&
+		         UploadRegionSize(recentPeakBytes) <= uploadRing.regionSize / 2)
+			newRegionSize = UploadRegionSize(recentPeakBytes);
+	}
+
+	if (newRegionSize != 0)
+	{
+		CreateUploadRing(newRegionSize);
+		uploadRing.stats.numResizes++;
+	}
+	else
+	{
+		uploadRing.regionBegin = uploadRing.regionSize * uploadRing.frameSlot;
+		uploadRing.regionOffset = 0;
+	}
 }
 
 void MarkUploadBuffersAvailable()
 {
-	for (UploadBufferEntry& buffer : uploadBuffers)
-		buffer.lastUsedFrame = UINT64_MAX;
+	for (std::vector<Buffer>& overflowBuffers : uploadRing.overflowBuffers)
+		overflowBuffers.clear();
+	uploadRing.overflowOffset = 0;
+	uploadRing.overflowBytes = 0;
+
+	uploadRing.frameSlot = CFrameIdx();
+	uploadRing.regionBegin = uploadRing.regionSize * uploadRing.frameSlot;
+	uploadRing.regionOffset = 0;
+
+	// Uploads made while loading are not representative of frames
+	uploadRing.stats.lastFrameBytes = 0;
+	uploadRing.stats.peakFrameBytes = 0;
+	std::fill(std::begin(uploadRing.frameBytesHistory), std::end(uploadRing.frameBytesHistory), 0);
+}
+
+UploadBufferStats GetUploadBufferStats()
+{
+	return uploadRing.stats;
 }
 
 void DestroyUploadBuffers()
 {
-	uploadBuffers.clear();
+	MarkUploadBuffersAvailable();
+	uploadRing.regionSize = 0;
+	uploadRing.regionBegin = 0;
+	uploadRing.buffer.Destroy();
 }
 
 void AssertFormatSupport(Format format, FormatCapabilities capabilities)
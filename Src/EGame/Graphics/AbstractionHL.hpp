@@ -151,6 +151,8 @@ struct UploadBuffer
 	void Flush() { buffer.Flush(offset, range); }
 };
 
+// Gets mapped memory for uploads that stays valid until the current frame has completed. Can be called from any
+//  thread, though with OpenGL an allocation that does not fit in the frame's region must be made on the main thread.
 EG_API UploadBuffer GetTemporaryUploadBuffer(uint64_t size, uint64_t alignment = 1);
 
 template <typename T>
@@ -165,6 +167,23 @@ UploadBuffer GetTemporaryUploadBufferWith(std::span<const T> data, uint64_t alig
 EG_API void MarkUploadBuffersAvailable();
 EG_API void DestroyUploadBuffers();
 
+struct UploadBufferStats
+{
+	uint64_t regionBytes; // Size of the ring buffer region that each frame allocates from
+	uint64_t lastFrameBytes;
+	uint64_t peakFrameBytes;  // Highest per-frame usage since loading finished
+	uint64_t overflowBuffers; // Buffers created because a frame did not fit in its region
+	uint32_t numResizes;
+};
+
+EG_API UploadBufferStats GetUploadBufferStats();
+
+namespace detail
+{
+// Starts allocating from the ring buffer region of the current frame, called after gal::BeginFrame
+EG_API void UploadBuffersBeginFrame();
+}
+
 class EG_API Buffer : public OwningRef<BufferRef>
 {
 public:
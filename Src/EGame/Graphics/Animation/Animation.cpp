@@ -11,8 +11,25 @@ namespace eg
 {
 void Animation::Serialize(std::ostream& stream) const
 {
-	BinWrite(stream, UnsignedNarrow<uint32_t>(m_targets.size()));
+	BinWrite(stream, UnsignedNarrow<uint32_t>(NumTargets()));
 	BinWriteString(stream, name);
+	BinWrite(stream, static_cast<uint8_t>(IsCompressed()));
+
+	if (IsCompressed())
+	{
+		BinWrite(stream, compressionInfo.uncompressedBytes);
+		BinWrite(stream, compressionInfo.maxRotationError);
+		BinWrite(stream, compressionInfo.maxTranslationError);
+		BinWrite(stream, compressionInfo.maxScaleError);
+
+		for (const CompressedTargetKeyFrames& targetKF : m_compressedTargets)
+		{
+			targetKF.scale.Write(stream);
+			targetKF.rotation.Write(stream);
+			targetKF.translation.Write(stream);
+		}
+		return;
+	}
 
 	for (const TargetKeyFrames& targetKF : m_targets)
 	{
@@ -25,21 +42,66 @@ void Animation::Serialize(std::ostream& stream) const
 void Animation::Deserialize(std::istream& stream)
 {
 	uint32_t numTargets = BinRead<uint32_t>(stream);
-	if (numTargets != m_targets.size())
+	if (numTargets != NumTargets())
 		EG_PANIC("Animation::Deserialize called with wrong number of targets");
 
 	name = BinReadString(stream);
 
-	for (TargetKeyFrames& targetKF : m_targets)
+	if (BinRead<uint8_t>(stream))
 	{
-		targetKF.scale.Read(stream);
-		targetKF.rotation.Read(stream);
-		targetKF.translation.Read(stream);
+		compressionInfo.uncompressedBytes = BinRead<uint64_t>(stream);
+		compressionInfo.maxRotationError = BinRead<float>(stream);
+		compressionInfo.maxTranslationError = BinRead<float>(stream);
+		compressionInfo.maxScaleError = BinRead<float>(stream);
+
+		m_compressedTargets.resize(numTargets);
+		m_targets = {};
+		for (CompressedTargetKeyFrames& targetKF : m_compressedTargets)
+		{
+			targetKF.scale.Read(stream);
+			targetKF.rotation.Read(stream);
+			targetKF.translation.Read(stream);
+		}
+	}
+	else
+	{
+		for (TargetKeyFrames& targetKF : m_targets)
+		{
+			targetKF.scale.Read(stream);
+			targetKF.rotation.Read(stream);
+			targetKF.translation.Read(stream);
+		}
 	}
 
 	UpdateLength();
 }
 
+void Animation::SetCompressedKeyFrames(
+	int target, CompressedKeyFrameList<SKeyFrame> scale, CompressedKeyFrameList<RKeyFrame> rotation,
+	CompressedKeyFrameList<TKeyFrame> translation)
+{
+	if (!IsCompressed())
+	{
+		m_compressedTargets.resize(m_targets.size());
+		m_targets = {};
+	}
+
+	m_compressedTargets[target].scale = std::move(scale);
+	m_compressedTargets[target].rotation = std::move(rotation);
+	m_compressedTargets[target].translation = std::move(translation);
+	UpdateLength();
+}
+
+size_t Animation::DataBytes() const
+{
+	size_t bytes = 0;
+	for (const TargetKeyFrames& targetKF : m_targets)
+		bytes += targetKF.scale.DataBytes() + targetKF.rotation.DataBytes() + targetKF.translation.DataBytes();
+	for (const CompressedTargetKeyFrames& targetKF : m_compressedTargets)
+		bytes += targetKF.scale.DataBytes() + targetKF.rotation.DataBytes() + targetKF.translation.DataBytes();
+	return bytes;
+}
+
 void Animation::UpdateLength()
 {
 	m_length = 0;
@@ -49,12 +111,40 @@ void Animation::UpdateLength()
 		m_length = std::max(m_length, targetKF.rotation.MaxT());
 		m_length = std::max(m_length, targetKF.translation.MaxT());
 	}
+	for (const CompressedTargetKeyFrames& targetKF : m_compressedTargets)
+	{
+		m_length = std::max(m_length, targetKF.scale.MaxT());
+		m_length = std::max(m_length, targetKF.rotation.MaxT());
+		m_length = std::max(m_length, targetKF.translation.MaxT());
+	}
 }
 
 void Animation::CalcTransform(TRSTransform& transformOut, int targetKF, float t) const
 {
+	if (IsCompressed())
+	{
+		transformOut.translation = m_compressedTargets[targetKF].translation.GetTransform(t);
+		transformOut.rotation = m_compressedTargets[targetKF].rotation.GetTransform(t);
+		transformOut.scale = m_compressedTargets[targetKF].scale.GetTransform(t);
+		return;
+	}
 	transformOut.translation = m_targets[targetKF].translation.GetTransform(t);
 	transformOut.rotation = m_targets[targetKF].rotation.GetTransform(t);
 	transformOut.scale = m_targets[targetKF].scale.GetTransform(t);
 }
+
+void Animation::CalcTransform(TRSTransform& transformOut, int targetKF, float t, TargetCursors& cursors) const
+{
+	if (IsCompressed())
+	{
+		const CompressedTargetKeyFrames& target = m_compressedTargets[targetKF];
+		transformOut.translation = target.translation.GetTransform(t, cursors.translation);
+		transformOut.rotation = target.rotation.GetTransform(t, cursors.rotation);
+		transformOut.scale = target.scale.GetTransform(t, cursors.scale);
+		return;
+	}
+	transformOut.translation = m_targets[targetKF].translation.GetTransform(t, cursors.translation);
+	transformOut.rotation = m_targets[targetKF].rotation.GetTransform(t, cursors.rotation);
+	transformOut.scale = m_targets[targetKF].scale.GetTransform(t, cursors.scale);
+}
 } // namespace eg
@@ -1,10 +1,20 @@
 #pragma once
 
+#include "CompressedKeyFrameList.hpp"
 #include "KeyFrame.hpp"
 #include "KeyFrameList.hpp"
 
 namespace eg
 {
+// Describes how a compressed animation differs from the animation it was generated from
+struct AnimationCompressionInfo
+{
+	uint64_t uncompressedBytes = 0;
+	float maxRotationError = 0; // In radians
+	float maxTranslationError = 0;
+	float maxScaleError = 0;
+};
+
 // Stores a list of key frames for a set of targets. Targets are indexed starting at 0. This class doesn't concern
 //  itself with what the targets are, but they are in practice either bones or whole meshes.
 class EG_API Animation
@@ -33,12 +43,46 @@ public:
 		UpdateLength();
 	}
 
+	/**
+	 * Replaces the key frames of a target with compressed key frames. The first call switches the whole animation to
+	 * compressed storage, so this must be called for every target that is animated.
+	 */
+	void SetCompressedKeyFrames(
+		int target, CompressedKeyFrameList<SKeyFrame> scale, CompressedKeyFrameList<RKeyFrame> rotation,
+		CompressedKeyFrameList<TKeyFrame> translation);
+
+	bool IsCompressed() const { return !m_compressedTargets.empty(); }
+
+	// Key frames of an uncompressed animation
+	const KeyFrameList<SKeyFrame>& ScaleKeyFrames(int target) const { return m_targets[target].scale; }
+	const KeyFrameList<RKeyFrame>& RotationKeyFrames(int target) const { return m_targets[target].rotation; }
+	const KeyFrameList<TKeyFrame>& TranslationKeyFrames(int target) const { return m_targets[target].translation; }
+
+	// Number of bytes used by key frame data
+	size_t DataBytes() const;
+
 	inline float Length() const { return m_length; }
 
 	void CalcTransform(struct TRSTransform& transformOut, int target, float t) const;
 
+	// Key frame search positions for the tracks of one target, see KeyFrameList::GetTransform
+	struct TargetCursors
+	{
+		uint32_t scale = 0;
+		uint32_t rotation = 0;
+		uint32_t translation = 0;
+	};
+
+	// Like CalcTransform(transformOut, target, t), but continues the key frame searches from cursors
+	void CalcTransform(struct TRSTransform& transformOut, int target, float t, TargetCursors& cursors) const;
+
+	size_t NumTargets() const { return IsCompressed() ? m_compressedTargets.size() : m_targets.size(); }
+
 	std::string name;
 
+	// Only set for compressed animations
+	AnimationCompressionInfo compressionInfo;
+
 private:
 	void UpdateLength();
 
@@ -52,7 +96,15 @@ private:
 		KeyFrameList<TKeyFrame> translation;
 	};
 
+	struct CompressedTargetKeyFrames
+	{
+		CompressedKeyFrameList<SKeyFrame> scale;
+		CompressedKeyFrameList<RKeyFrame> rotation;
+		CompressedKeyFrameList<TKeyFrame> translation;
+	};
+
 	std::vector<TargetKeyFrames> m_targets;
+	std::vector<CompressedTargetKeyFrames> m_compressedTargets;
 };
 
 struct AnimationNameCompare
@@ -167,7 +167,7 @@ void AnimationDriver::Update(float dt)
 	{
 		TRSTransform transform;
 
-		auto CalcTransform = [&](TRSTransform& transformOut, const ActiveAnimation& animation, float t)
+		auto CalcTransform = [&](TRSTransform& transformOut, ActiveAnimation& animation, float t)
 		{
 			// The index of the target to take this transform from. If mirroring is not enabled, this is the target
 			//  itself, but otherwise (only for bones) it is the bone on the other side of the mesh.
@@ -175,7 +175,9 @@ void AnimationDriver::Update(float dt)
 			if (animation.m_mirrorLR && i < m_numBoneMatrices)
 				srcTarget = m_model->skeleton.DualId(srcTarget);
 
-			animation.m_animation->CalcTransform(transformOut, srcTarget, t);
+			if (animation.m_cursors.size() <= srcTarget)
+				animation.m_cursors.resize(std::max<size_t>(numTargets, srcTarget + 1));
+			animation.m_animation->CalcTransform(transformOut, ToInt(srcTarget), t, animation.m_cursors[srcTarget]);
 
 			if (animation.m_mirrorLR)
 			{
@@ -186,9 +188,9 @@ void AnimationDriver::Update(float dt)
 			}
 		};
 
-		for (const auto& channelP : m_channels)
+		for (auto& channelP : m_channels)
 		{
-			const Channel& channel = channelP.second;
+			Channel& channel = channelP.second;
 
 			if (channel.m_previous.IsActive())
 			{
@@ -212,14 +214,12 @@ void AnimationDriver::Update(float dt)
 		m_targetMatrices[i] = transform.GetMatrix();
 	}
 
-	// Cascades bone parent transforms through the transform buffer
-	if (m_parentTransformApplied.size() < m_numBoneMatrices)
-		m_parentTransformApplied.resize(m_numBoneMatrices);
-	std::fill_n(m_parentTransformApplied.data(), m_numBoneMatrices, 0);
-	for (uint32_t i = 0; i < m_numBoneMatrices; i++)
+	// Cascades bone parent transforms through the transform buffer. Parents come first in this order, so their
+	//  transforms are already relative to the root bone when their children are reached.
+	for (uint32_t bone : m_model->skeleton.ParentFirstOrder())
 	{
-		if (!m_parentTransformApplied[i])
-			ApplyParentTransform(i);
+		if (std::optional<uint32_t> parentId = m_model->skeleton.ParentId(bone))
+			m_targetMatrices[bone] = m_targetMatrices[*parentId] * m_targetMatrices[bone];
 	}
 
 	// Applies the inverse bind matrix to each bone
@@ -229,6 +229,17 @@ void AnimationDriver::Update(float dt)
 	}
 }
 
+void AnimationDriver::UpdateMany(std::span<AnimationDriver* const> drivers, float dt, ThreadPool& threadPool)
+{
+	threadPool.ParallelFor(
+		drivers.size(), 4,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				drivers[i]->Update(dt);
+		});
+}
+
 void AnimationDriver::ActiveAnimation::Play(
 	const Animation& animation, bool looping, bool mirrorLR, std::function<void()> endCallback)
 {
@@ -238,6 +249,7 @@ void AnimationDriver::ActiveAnimation::Play(
 	m_mirrorLR = mirrorLR;
 	m_looping = looping;
 	m_endCallback = std::move(endCallback);
+	m_cursors.clear();
 }
 
 void AnimationDriver::ActiveAnimation::swap(ActiveAnimation& other)
@@ -247,6 +259,7 @@ void AnimationDriver::ActiveAnimation::swap(ActiveAnimation& other)
 	std::swap(m_looping, other.m_looping);
 	m_name.swap(other.m_name);
 	m_endCallback.swap(other.m_endCallback);
+	m_cursors.swap(other.m_cursors);
 }
 
 void AnimationDriver::UpdateAnimationPointer(ActiveAnimation& animation) const
@@ -257,6 +270,7 @@ void AnimationDriver::UpdateAnimationPointer(ActiveAnimation& animation) const
 		animation.m_animation = m_model->FindAnimation(animation.m_name);
 	else
 		animation.m_animation = nullptr;
+	animation.m_cursors.clear();
 }
 
 void AnimationDriver::ModelChanged()
@@ -268,21 +282,4 @@ void AnimationDriver::ModelChanged()
 		UpdateAnimationPointer(channel.second.m_next);
 	}
 }
-
-// DP function which turns bone transforms in m_boneMatrices
-//  from being relative to their parent to be relative to the root bone.
-void AnimationDriver::ApplyParentTransform(uint32_t index)
-{
-	if (std::optional<uint32_t> parentId = m_model->skeleton.ParentId(index))
-	{
-		if (!m_parentTransformApplied[*parentId])
-		{
-			ApplyParentTransform(*parentId);
-		}
-
-		m_targetMatrices[index] = m_targetMatrices[*parentId] * m_targetMatrices[index];
-	}
-
-	m_parentTransformApplied[index] = true;
-}
 } // namespace eg
@@ -5,6 +5,7 @@
 #include <memory>
 #include <vector>
 
+#include "../../ThreadPool.hpp"
 #include "../../Utils.hpp"
 #include "../Model.hpp"
 
@@ -34,6 +35,13 @@ public:
 
 	void Update(float dt);
 
+	/**
+	 * Updates many drivers in parallel, which gives the same result as calling Update on each of them. The drivers
+	 * must not be accessed from elsewhere until this returns.
+	 */
+	static void UpdateMany(
+		std::span<AnimationDriver* const> drivers, float dt, ThreadPool& threadPool = SharedThreadPool());
+
 	const Animation* CurrentAnimation(int channel) const
 	{
 		auto it = m_channels.find(channel);
@@ -89,6 +97,9 @@ private:
 		bool m_mirrorLR = false;
 		std::function<void()> m_endCallback;
 
+		// Key frame search positions for each target, kept between updates since time mostly moves forward
+		std::vector<Animation::TargetCursors> m_cursors;
+
 		bool IsActive() const { return m_animation != nullptr; }
 
 		void ModulateTime() { m_time = std::fmod(m_time, m_animation->Length()); }
@@ -116,9 +127,6 @@ private:
 
 	void ModelChanged();
 
-	std::vector<uint8_t> m_parentTransformApplied;
-	void ApplyParentTransform(uint32_t index);
-
 	std::map<int, Channel> m_channels;
 
 	bool m_targetMatricesAreIdentity = false;
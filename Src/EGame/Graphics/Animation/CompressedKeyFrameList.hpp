@@ -0,0 +1,229 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include "KeyFrame.hpp"
+#include "KeyFrameList.hpp"
+
+namespace eg
+{
+/**
+ * Key frame list stored with 16-bit times and 48-bit values. Rotations use smallest-three quaternion encoding,
+ * translations and scales are quantized to the range of values in the list. Only linear and step interpolation are
+ * supported, cubic spline tracks must be resampled before encoding.
+ */
+template <typename T>
+class CompressedKeyFrameList
+{
+public:
+	using TransformTp = typename T::TransformTp;
+
+	static constexpr bool IS_ROTATION = std::is_same_v<TransformTp, glm::quat>;
+
+	CompressedKeyFrameList() = default;
+
+	// Quantizes key frames, which must be sorted by time
+	static CompressedKeyFrameList Encode(KeyFrameInterpolation interpolation, std::span<const T> keyFrames)
+	{
+		EG_ASSERT(interpolation != KeyFrameInterpolation::CubicSpline);
+
+		CompressedKeyFrameList list;
+		list.m_interpolation = interpolation;
+		if (keyFrames.empty())
+			return list;
+
+		list.m_startTime = keyFrames.front().time;
+		list.m_timeStep = (keyFrames.back().time - keyFrames.front().time) / MAX_QUANTIZED;
+
+		if constexpr (!IS_ROTATION)
+		{
+			glm::vec3 rangeMax = keyFrames[0].transform;
+			list.m_rangeMin = keyFrames[0].transform;
+			for (const T& keyFrame : keyFrames)
+			{
+				list.m_rangeMin = glm::min(list.m_rangeMin, keyFrame.transform);
+				rangeMax = glm::max(rangeMax, keyFrame.transform);
+			}
+			list.m_rangeStep = (rangeMax - list.m_rangeMin) / MAX_QUANTIZED;
+		}
+
+		list.m_times.resize(keyFrames.size());
+		list.m_values.resize(keyFrames.size());
+		for (size_t i = 0; i < keyFrames.size(); i++)
+		{
+			if (list.m_timeStep != 0)
+				list.m_times[i] = Quantize((keyFrames[i].time - list.m_startTime) / list.m_timeStep);
+			list.m_values[i] = list.EncodeValue(keyFrames[i].transform);
+		}
+
+		return list;
+	}
+
+	TransformTp GetTransform(float t) const
+	{
+		uint32_t cursor = 0;
+		return GetTransform(t, cursor);
+	}
+
+	// See KeyFrameList::GetTransform
+	TransformTp GetTransform(float t, uint32_t& cursor) const
+	{
+		if (m_values.empty())
+			return T::DefaultTransform();
+
+		const size_t nIdx = detail::FindKeyFrame(m_times.size(), t, cursor, [&](size_t i) { return KeyTime(i); });
+
+		if (nIdx == 0)
+			return DecodeValue(0);
+		if (nIdx == m_values.size() || m_interpolation == KeyFrameInterpolation::Step)
+			return DecodeValue(nIdx - 1);
+
+		T a, b;
+		a.time = KeyTime(nIdx - 1);
+		a.transform = DecodeValue(nIdx - 1);
+		b.time = KeyTime(nIdx);
+		b.transform = DecodeValue(nIdx);
+		if (b.time <= a.time)
+			return b.transform;
+		return T::LinearInterpolate(a, b, t);
+	}
+
+	void Write(std::ostream& stream) const
+	{
+		BinWrite(stream, static_cast<uint8_t>(m_interpolation));
+		BinWrite(stream, UnsignedNarrow<uint32_t>(m_values.size()));
+		if (m_values.empty())
+			return;
+
+		BinWrite(stream, m_startTime);
+		BinWrite(stream, m_timeStep);
+		if constexpr (!IS_ROTATION)
+		{
+			stream.write(reinterpret_cast<const char*>(&m_rangeMin), sizeof(glm::vec3));
+			stream.write(reinterpret_cast<const char*>(&m_rangeStep), sizeof(glm::vec3));
+		}
+		stream.write(reinterpret_cast<const char*>(m_times.data()), m_times.size() * sizeof(uint16_t));
+		stream.write(reinterpret_cast<const char*>(m_values.data()), m_values.size() * sizeof(QuantizedValue));
+	}
+
+	void Read(std::istream& stream)
+	{
+		m_interpolation = static_cast<KeyFrameInterpolation>(BinRead<uint8_t>(stream));
+		const uint32_t count = BinRead<uint32_t>(stream);
+		m_times.resize(count);
+		m_values.resize(count);
+		if (count == 0)
+			return;
+
+		m_startTime = BinRead<float>(stream);
+		m_timeStep = BinRead<float>(stream);
+		if constexpr (!IS_ROTATION)
+		{
+			stream.read(reinterpret_cast<char*>(&m_rangeMin), sizeof(glm::vec3));
+			stream.read(reinterpret_cast<char*>(&m_rangeStep), sizeof(glm::vec3));
+		}
+		stream.read(reinterpret_cast<char*>(m_times.data()), count * sizeof(uint16_t));
+		stream.read(reinterpret_cast<char*>(m_values.data()), count * sizeof(QuantizedValue));
+	}
+
+	float MaxT() const { return m_times.empty() ? 0 : KeyTime(m_times.size() - 1); }
+
+	size_t NumKeyFrames() const { return m_values.size(); }
+
+	KeyFrameInterpolation Interpolation() const { return m_interpolation; }
+
+	// Number of bytes used by key frame times and values
+	size_t DataBytes() const { return m_times.size() * sizeof(uint16_t) + m_values.size() * sizeof(QuantizedValue); }
+
+private:
+	using QuantizedValue = std::array<uint16_t, 3>;
+
+	static constexpr float MAX_QUANTIZED = 65535.0f;
+
+	// Smallest-three components are in [-1/sqrt(2), 1/sqrt(2)] and use 15 bits each
+	static constexpr float MAX_QUANTIZED_QUAT = 32767.0f;
+	static constexpr float QUAT_COMPONENT_RANGE = 0.70710678f;
+
+	static uint16_t Quantize(float value)
+	{
+		return static_cast<uint16_t>(std::round(glm::clamp(value, 0.0f, MAX_QUANTIZED)));
+	}
+
+	float KeyTime(size_t index) const { return m_startTime + static_cast<float>(m_times[index]) * m_timeStep; }
+
+	QuantizedValue EncodeValue(const TransformTp& value) const
+	{
+		QuantizedValue result;
+		if constexpr (IS_ROTATION)
+		{
+			// Drops the largest component, which is recovered from the others since the quaternion has unit length.
+			//  Its sign is made positive by negating the quaternion, which represents the same rotation.
+			const glm::quat q = glm::normalize(value);
+			const float components[4] = { q.x, q.y, q.z, q.w };
+			uint16_t largest = 0;
+			for (uint16_t i = 1; i < 4; i++)
+			{
+				if (std::abs(components[i]) > std::abs(components[largest]))
+					largest = i;
+			}
+			const float sign = components[largest] < 0 ? -1.0f : 1.0f;
+
+			uint32_t outIndex = 0;
+			for (uint16_t i = 0; i < 4; i++)
+			{
+				if (i == largest)
+					continue;
+				const float normalized = (sign * components[i] / QUAT_COMPONENT_RANGE) * 0.5f + 0.5f;
+				result[outIndex++] = static_cast<uint16_t>(
+					std::round(glm::clamp(normalized, 0.0f, 1.0f) * MAX_QUANTIZED_QUAT));
+			}
+			result[0] |= static_cast<uint16_t>((largest & 1) << 15);
+			result[1] |= static_cast<uint16_t>((largest >> 1) << 15);
+		}
+		else
+		{
+			for (int i = 0; i < 3; i++)
+				result[i] = m_rangeStep[i] == 0 ? 0 : Quantize((value[i] - m_rangeMin[i]) / m_rangeStep[i]);
+		}
+		return result;
+	}
+
+	TransformTp DecodeValue(size_t index) const
+	{
+		const QuantizedValue& value = m_values[index];
+		if constexpr (IS_ROTATION)
+		{
+			const uint32_t largest = (value[0] >> 15) | ((value[1] >> 15) << 1);
+			float components[4];
+			float sumSquares = 0;
+			uint32_t inIndex = 0;
+			for (uint32_t i = 0; i < 4; i++)
+			{
+				if (i == largest)
+					continue;
+				const float normalized = static_cast<float>(value[inIndex++] & 0x7FFF) / MAX_QUANTIZED_QUAT;
+				components[i] = (normalized * 2 - 1) * QUAT_COMPONENT_RANGE;
+				sumSquares += components[i] * components[i];
+			}
+			components[largest] = std::sqrt(std::max(1 - sumSquares, 0.0f));
+			return glm::quat(components[3], components[0], components[1], components[2]);
+		}
+		else
+		{
+			return m_rangeMin + glm::vec3(value[0], value[1], value[2]) * m_rangeStep;
+		}
+	}
+
+	KeyFrameInterpolation m_interpolation = KeyFrameInterpolation::Linear;
+	float m_startTime = 0;
+	float m_timeStep = 0;
+	glm::vec3 m_rangeMin{ 0.0f };
+	glm::vec3 m_rangeStep{ 0.0f };
+	std::vector<uint16_t> m_times;
+	std::vector<QuantizedValue> m_values;
+};
+} // namespace eg
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <istream>
 #include <ostream>
+#include <span>
 #include <vector>
 
 #include "../../Assert.hpp"
@@ -25,6 +26,44 @@ enum class KeyFrameInterpolation
 	CubicSpline = 2
 };
 
+namespace detail
+{
+/**
+ * Finds the first key frame with a time not less than t, starting the search from cursor, which is then updated.
+ * Steps linearly from the cursor for a few key frames before falling back to a binary search, so that the search
+ * takes amortized constant time when t moves forward between calls. keyTime returns the time of a key frame index.
+ */
+template <typename KeyTimeFn>
+inline size_t FindKeyFrame(size_t numKeyFrames, float t, uint32_t& cursor, KeyTimeFn keyTime)
+{
+	// All key frames before the cursor have times less than t if it is still valid
+	size_t idx = cursor;
+	if (idx > numKeyFrames || (idx > 0 && keyTime(idx - 1) >= t))
+		idx = 0;
+
+	constexpr size_t MAX_LINEAR_STEPS = 4;
+	const size_t linearEnd = std::min(idx + MAX_LINEAR_STEPS, numKeyFrames);
+	while (idx < linearEnd && keyTime(idx) < t)
+		idx++;
+
+	if (idx == linearEnd)
+	{
+		size_t end = numKeyFrames;
+		while (idx < end)
+		{
+			const size_t mid = idx + (end - idx) / 2;
+			if (keyTime(mid) < t)
+				idx = mid + 1;
+			else
+				end = mid;
+		}
+	}
+
+	cursor = static_cast<uint32_t>(idx);
+	return idx;
+}
+} // namespace detail
+
 template <typename T>
 class KeyFrameList
 {
@@ -51,25 +90,22 @@ public:
 			return T::DefaultTransform();
 		auto it = std::lower_bound(
 			m_keyFrames.begin(), m_keyFrames.end(), t, [&](const T& a, float b) { return a.time < b; });
+		return Interpolate(static_cast<size_t>(it - m_keyFrames.begin()), t);
+	}
 
-		if (it == m_keyFrames.begin())
-			return it->transform;
-		if (it == m_keyFrames.end() || m_interpolation == KeyFrameInterpolation::Step)
-			return (it - 1)->transform;
-
-		size_t nIdx = it - m_keyFrames.begin();
-		size_t pIdx = nIdx - 1;
+	/**
+	 * Like GetTransform(t), but the search for the key frame starts from cursor, which is then updated. When t only
+	 * moves forward between calls (apart from looping back to the start), finding the key frame takes amortized
+	 * constant time. The cursor should start at 0.
+	 */
+	inline typename T::TransformTp GetTransform(float t, uint32_t& cursor) const
+	{
+		if (m_keyFrames.empty())
+			return T::DefaultTransform();
 
-		if (m_interpolation == KeyFrameInterpolation::Linear)
-		{
-			return T::LinearInterpolate(m_keyFrames[pIdx], m_keyFrames[nIdx], t);
-		}
-		if (m_interpolation == KeyFrameInterpolation::CubicSpline)
-		{
-			return T::CubicSplineInterpolate(
-				m_keyFrames[pIdx], m_keyFrames[nIdx], m_splineTangents[pIdx].out, m_splineTangents[nIdx].in, t);
-		}
-		return T::DefaultTransform();
+		const size_t idx =
+			detail::FindKeyFrame(m_keyFrames.size(), t, cursor, [&](size_t i) { return m_keyFrames[i].time; });
+		return Interpolate(idx, t);
 	}
 
 	inline void Write(std::ostream& stream) const
@@ -106,7 +142,39 @@ public:
 
 	inline float MaxT() const { return m_keyFrames.empty() ? 0 : m_keyFrames.back().time; }
 
+	KeyFrameInterpolation Interpolation() const { return m_interpolation; }
+
+	std::span<const T> KeyFrames() const { return m_keyFrames; }
+
+	// Number of bytes used by key frames and spline tangents
+	size_t DataBytes() const
+	{
+		return m_keyFrames.size() * sizeof(T) + m_splineTangents.size() * sizeof(SplineTangentsT);
+	}
+
 private:
+	// Interpolates between the key frames before and at nIdx, which is the first key frame not before t
+	inline typename T::TransformTp Interpolate(size_t nIdx, float t) const
+	{
+		if (nIdx == 0)
+			return m_keyFrames[0].transform;
+		if (nIdx == m_keyFrames.size() || m_interpolation == KeyFrameInterpolation::Step)
+			return m_keyFrames[nIdx - 1].transform;
+
+		size_t pIdx = nIdx - 1;
+
+		if (m_interpolation == KeyFrameInterpolation::Linear)
+		{
+			return T::LinearInterpolate(m_keyFrames[pIdx], m_keyFrames[nIdx], t);
+		}
+		if (m_interpolation == KeyFrameInterpolation::CubicSpline)
+		{
+			return T::CubicSplineInterpolate(
+				m_keyFrames[pIdx], m_keyFrames[nIdx], m_splineTangents[pIdx].out, m_splineTangents[nIdx].in, t);
+		}
+		return T::DefaultTransform();
+	}
+
 	KeyFrameInterpolation m_interpolation;
 	std::vector<T> m_keyFrames;
 	std::vector<SplineTangentsT> m_splineTangents;
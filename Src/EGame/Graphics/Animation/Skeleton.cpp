@@ -21,6 +21,8 @@ uint32_t Skeleton::AddBone(std::string name, const glm::mat4& inverseBindMatrix)
 	bone.parent = UINT32_MAX;
 	bone.inverseBindMatrix = inverseBindMatrix;
 
+	m_parentFirstOrderValid = false;
+
 	return UnsignedNarrow<uint32_t>(m_bones.size() - 1);
 }
 
@@ -96,6 +98,38 @@ void Skeleton::SetBoneParent(uint32_t boneId, std::optional<uint32_t> parentBone
 	{
 		m_bones[boneId].parent = UINT32_MAX;
 	}
+	m_parentFirstOrderValid = false;
+}
+
+std::span<const uint32_t> Skeleton::ParentFirstOrder() const
+{
+	if (!m_parentFirstOrderValid)
+		UpdateParentFirstOrder();
+	return m_parentFirstOrder;
+}
+
+void Skeleton::UpdateParentFirstOrder() const
+{
+	// Sorts bones by their depth in the hierarchy, which places every parent before its children
+	std::vector<uint32_t> depths(m_bones.size());
+	for (size_t i = 0; i < m_bones.size(); i++)
+	{
+		uint32_t depth = 0;
+		for (uint32_t parent = m_bones[i].parent; parent != UINT32_MAX && depth <= m_bones.size();
+		     parent = m_bones[parent].parent)
+		{
+			depth++;
+		}
+		depths[i] = depth;
+	}
+
+	m_parentFirstOrder.resize(m_bones.size());
+	for (size_t i = 0; i < m_bones.size(); i++)
+		m_parentFirstOrder[i] = UnsignedNarrow<uint32_t>(i);
+	std::stable_sort(
+		m_parentFirstOrder.begin(), m_parentFirstOrder.end(),
+		[&](uint32_t a, uint32_t b) { return depths[a] < depths[b]; });
+	m_parentFirstOrderValid = true;
 }
 
 std::optional<uint32_t> Skeleton::GetBoneIDByName(std::string_view name) const
@@ -163,6 +197,8 @@ Skeleton Skeleton::Deserialize(std::istream& stream)
 		skeleton.m_boneNamesSorted[i] = skeleton.m_bones[i].name;
 	}
 
+	skeleton.UpdateParentFirstOrder();
+
 	std::sort(skeleton.m_boneNamesSorted.begin(), skeleton.m_boneNamesSorted.end());
 	for (uint32_t i = 1; i < numBones; i++)
 	{
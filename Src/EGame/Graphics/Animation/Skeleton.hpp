@@ -4,6 +4,7 @@
 
 #include <glm/mat4x4.hpp>
 #include <optional>
+#include <span>
 #include <string>
 #include <string_view>
 #include <vector>
@@ -27,6 +28,9 @@ public:
 
 	uint32_t DualId(uint32_t boneId) const { return m_bones[boneId].dual; }
 
+	// Bone ids ordered so that every bone comes after its parent, computed on first use after the bones change
+	std::span<const uint32_t> ParentFirstOrder() const;
+
 	const glm::mat4& InverseBindMatrix(uint32_t boneId) const { return m_bones[boneId].inverseBindMatrix; }
 
 	void SetBoneParent(uint32_t boneId, std::optional<uint32_t> parentBoneId);
@@ -35,6 +39,10 @@ public:
 
 	void InitDualBones();
 
+	// Computes the order returned by ParentFirstOrder. Loaders call this once the hierarchy is complete, so that the
+	//  order is not computed lazily while the skeleton may be used from several threads.
+	void UpdateParentFirstOrder() const;
+
 	void Serialize(std::ostream& stream) const;
 	static Skeleton Deserialize(std::istream& stream);
 
@@ -50,7 +58,9 @@ private:
 	};
 
 	bool m_hasUniqueBoneNames = true;
+	mutable bool m_parentFirstOrderValid = true;
 	std::vector<Bone> m_bones;
+	mutable std::vector<uint32_t> m_parentFirstOrder;
 	std::vector<std::string> m_boneNamesSorted;
 };
 } // namespace eg
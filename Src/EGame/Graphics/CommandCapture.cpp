@@ -0,0 +1,1382 @@
+#include "CommandCapture.hpp"
+#include "../Assert.hpp"
+#include "../IOUtils.hpp"
+
+#include <cstring>
+#include <istream>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <variant>
+
+namespace eg
+{
+static const std::string_view capturedCommandNames[NUM_CAPTURED_COMMANDS] = {
+	"BufferBarrier",     "UpdateBuffer",     "FillBuffer",      "CopyBuffer",       "FlushBuffer",
+	"BindUniformBuffer", "BindStorageBuffer", "TextureBarrier", "SetTextureData",   "GetTextureData",
+	"CopyTextureData",   "GenerateMipmaps",  "BindTexture",     "BindStorageImage", "ClearColorTexture",
+	"ResolveTexture",    "BindDescriptorSet", "BindPipeline",   "PushConstants",    "DispatchCompute",
+	"SetViewport",       "SetScissor",       "SetStencilValue", "BeginRenderPass",  "EndRenderPass",
+	"BindIndexBuffer",   "BindVertexBuffer", "Draw",            "DrawIndexed",      "CopyQueryResults",
+	"WriteTimestamp",    "ResetQueries",     "BeginQuery",      "EndQuery",         "DebugLabelBegin",
+	"DebugLabelEnd",     "DebugLabelInsert",
+};
+
+std::string_view CapturedCommandName(CapturedCommand command)
+{
+	return capturedCommandNames[static_cast<size_t>(command)];
+}
+
+static constexpr size_t CLEAR_COLOR_BYTES = 16;
+
+static constexpr uint32_t CAPTURE_FILE_VERSION = 1;
+
+namespace
+{
+// Command arguments as stored in the stream, with handles replaced by indices into the capture's handle table
+
+struct BufferBarrierArgs
+{
+	eg::BufferBarrier barrier;
+	uint32_t buffer;
+};
+
+struct UpdateBufferArgs // Followed by size bytes of data
+{
+	uint64_t offset;
+	uint64_t size;
+	uint32_t buffer;
+};
+
+struct FillBufferArgs
+{
+	uint64_t offset;
+	uint64_t size;
+	uint32_t buffer;
+	uint32_t data;
+};
+
+struct CopyBufferArgs
+{
+	uint64_t srcOffset;
+	uint64_t dstOffset;
+	uint64_t size;
+	uint32_t src;
+	uint32_t dst;
+};
+
+struct FlushBufferArgs // Followed by range bytes of data
+{
+	uint64_t offset;
+	uint64_t range;
+	uint32_t buffer;
+};
+
+struct BindBufferArgs
+{
+	uint64_t offset;
+	uint64_t range;
+	uint32_t buffer;
+	uint32_t set;
+	uint32_t binding;
+};
+
+struct TextureBarrierArgs
+{
+	eg::TextureBarrier barrier;
+	uint32_t texture;
+};
+
+struct TextureDataArgs
+{
+	uint64_t offset;
+	TextureRange range;
+	uint32_t texture;
+	uint32_t buffer;
+};
+
+struct CopyTextureDataArgs
+{
+	TextureRange srcRange;
+	TextureOffset dstOffset;
+	uint32_t src;
+	uint32_t dst;
+};
+
+struct TextureArgs
+{
+	uint32_t texture;
+};
+
+struct BindTextureArgs
+{
+	uint32_t textureView;
+	uint32_t sampler;
+	uint32_t set;
+	uint32_t binding;
+};
+
+struct ClearColorTextureArgs
+{
+	char color[CLEAR_COLOR_BYTES];
+	uint32_t texture;
+	uint32_t mipLevel;
+};
+
+struct ResolveTextureArgs
+{
+	ResolveRegion region;
+	uint32_t src;
+	uint32_t dst;
+};
+
+struct BindDescriptorSetArgs
+{
+	uint32_t set;
+	uint32_t descriptorSet;
+};
+
+struct BindPipelineArgs
+{
+	uint32_t pipeline;
+};
+
+struct PushConstantsArgs // Followed by range bytes of data
+{
+	uint32_t offset;
+	uint32_t range;
+};
+
+struct DispatchComputeArgs
+{
+	uint32_t sizeX;
+	uint32_t sizeY;
+	uint32_t sizeZ;
+};
+
+struct ViewportArgs
+{
+	float x;
+	float y;
+	float w;
+	float h;
+};
+
+struct ScissorArgs
+{
+	int x;
+	int y;
+	int w;
+	int h;
+};
+
+struct StencilValueArgs
+{
+	StencilValue kind;
+	uint32_t value;
+};
+
+struct BeginRenderPassArgs
+{
+	RenderPassBeginInfo beginInfo; // The framebuffer handle is null in the stream, it is replaced on replay
+	uint32_t framebuffer;
+};
+
+struct BindIndexBufferArgs
+{
+	IndexType type;
+	uint32_t buffer;
+	uint32_t offset;
+};
+
+struct BindVertexBufferArgs
+{
+	uint32_t binding;
+	uint32_t buffer;
+	uint32_t offset;
+};
+
+struct DrawArgs
+{
+	uint32_t firstVertex;
+	uint32_t numVertices;
+	uint32_t firstInstance;
+	uint32_t numInstances;
+};
+
+struct DrawIndexedArgs
+{
+	uint32_t firstIndex;
+	uint32_t numIndices;
+	uint32_t firstVertex;
+	uint32_t firstInstance;
+	uint32_t numInstances;
+};
+
+struct CopyQueryResultsArgs
+{
+	uint64_t dstOffset;
+	uint32_t queryPool;
+	uint32_t firstQuery;
+	uint32_t numQueries;
+	uint32_t dstBuffer;
+};
+
+struct QueryArgs
+{
+	uint32_t queryPool;
+	uint32_t firstQuery;
+	uint32_t numQueries;
+};
+
+struct DebugLabelArgs // Followed by labelLength characters
+{
+	float color[4];
+	uint32_t labelLength;
+	bool hasColor;
+};
+
+struct NoArgs
+{
+};
+
+// Reads commands from a stream that may come from a file, so every read is bounds checked
+class CommandStreamReader
+{
+public:
+	explicit CommandStreamReader(std::span<const char> stream)
+		: m_pos(stream.data()), m_end(stream.data() + stream.size())
+	{
+	}
+
+	bool AtEnd() const { return m_pos == m_end; }
+
+	template <typename T>
+	T Read()
+	{
+		T value;
+		std::memcpy(&value, Skip(sizeof(T)), sizeof(T));
+		return value;
+	}
+
+	const char* Skip(uint64_t bytes)
+	{
+		if (bytes > static_cast<uint64_t>(m_end - m_pos))
+			EG_PANIC("Command capture stream is truncated")
+		const char* data = m_pos;
+		m_pos += bytes;
+		return data;
+	}
+
+private:
+	const char* m_pos;
+	const char* m_end;
+};
+} // namespace
+
+// Holds the original callbacks while a capture is recording, and the functions that replace them
+struct CommandRecorder
+{
+	static inline CommandCapture* active = nullptr;
+
+	struct Callbacks
+	{
+#define XM_ABSCALLBACK(name, ret, params) ret(*name) params;
+#include "AbstractionCallbacks.inl"
+#undef XM_ABSCALLBACK
+	};
+	static inline Callbacks original;
+
+	using HandleType = CommandCapture::HandleType;
+	using CapturedHandle = CommandCapture::CapturedHandle;
+
+	template <typename Args>
+	static void Record(
+		CapturedCommand command, const Args& args, const void* payload = nullptr, size_t payloadBytes = 0)
+	{
+		static_assert(std::is_trivially_copyable_v<Args>);
+		active->m_callCounts[static_cast<size_t>(command)]++;
+
+		std::vector<char>& stream = active->m_stream;
+		const size_t pos = stream.size();
+		stream.resize(pos + 1 + sizeof(Args) + payloadBytes);
+		stream[pos] = static_cast<char>(command);
+		std::memcpy(stream.data() + pos + 1, &args, sizeof(Args));
+		if (payloadBytes != 0)
+			std::memcpy(stream.data() + pos + 1 + sizeof(Args), payload, payloadBytes);
+	}
+
+	// Args are zeroed before they are filled in, since their padding bytes are copied into the stream as well
+	template <typename Args>
+	static void ZeroArgs(Args& args)
+	{
+		static_assert(std::is_trivially_copyable_v<Args>);
+		std::memset(static_cast<void*>(&args), 0, sizeof(Args));
+	}
+
+	static uint32_t Index(HandleType type, void* handle) { return active->HandleIndex(type, handle); }
+
+	static uint32_t BufferIndex(BufferHandle buffer, uint64_t end)
+	{
+		const uint32_t index = Index(HandleType::Buffer, buffer);
+		if (index != CommandCapture::NULL_HANDLE_INDEX)
+			active->m_handles[index].bufferSize = std::max(active->m_handles[index].bufferSize, end);
+		return index;
+	}
+
+	static uint32_t TextureIndex(TextureHandle texture, const TextureRange& range)
+	{
+		const uint32_t index = Index(HandleType::Texture, texture);
+		if (index != CommandCapture::NULL_HANDLE_INDEX)
+		{
+			CapturedHandle& handle = active->m_handles[index];
+			handle.textureWidth = std::max(handle.textureWidth, (range.offsetX + range.sizeX) << range.mipLevel);
+			handle.textureHeight = std::max(handle.textureHeight, (range.offsetY + range.sizeY) << range.mipLevel);
+			handle.textureLayers = std::max(handle.textureLayers, range.offsetZ + range.sizeZ);
+			handle.textureMipLevels = std::max(handle.textureMipLevels, range.mipLevel + 1);
+		}
+		return index;
+	}
+
+	static uint32_t QueryPoolIndex(QueryPoolHandle queryPool, QueryType type, uint32_t endQuery)
+	{
+		const uint32_t index = Index(HandleType::QueryPool, queryPool);
+		active->m_handles[index].queryType = type;
+		active->m_handles[index].queryCount = std::max(active->m_handles[index].queryCount, endQuery);
+		return index;
+	}
+
+	// Stand-in textures use a format with one byte per texel, so this is a lower bound of the bytes a range needs
+	static uint64_t RangeTexels(const TextureRange& range)
+	{
+		return static_cast<uint64_t>(range.sizeX) * range.sizeY * range.sizeZ;
+	}
+
+	static void BufferBarrier(CommandContextHandle ctx, BufferHandle handle, const eg::BufferBarrier& barrier)
+	{
+		BufferBarrierArgs args;
+		ZeroArgs(args);
+		args.barrier = barrier;
+		args.buffer = BufferIndex(handle, 0);
+		Record(CapturedCommand::BufferBarrier, args);
+		original.BufferBarrier(ctx, handle, barrier);
+	}
+
+	static void UpdateBuffer(
+		CommandContextHandle ctx, BufferHandle handle, uint64_t offset, uint64_t size, const void* data)
+	{
+		UpdateBufferArgs args;
+		ZeroArgs(args);
+		args.offset = offset;
+		args.size = size;
+		args.buffer = BufferIndex(handle, offset + size);
+		Record(CapturedCommand::UpdateBuffer, args, data, size);
+		original.UpdateBuffer(ctx, handle, offset, size, data);
+	}
+
+	static void FillBuffer(CommandContextHandle ctx, BufferHandle handle, uint64_t offset, uint64_t size, uint32_t data)
+	{
+		FillBufferArgs args;
+		ZeroArgs(args);
+		args.offset = offset;
+		args.size = size;
+		args.buffer = BufferIndex(handle, offset + size);
+		args.data = data;
+		Record(CapturedCommand::FillBuffer, args);
+		original.FillBuffer(ctx, handle, offset, size, data);
+	}
+
+	static void CopyBuffer(
+		CommandContextHandle ctx, BufferHandle src, BufferHandle dst, uint64_t srcOffset, uint64_t dstOffset,
+		uint64_t size)
+	{
+		CopyBufferArgs args;
+		ZeroArgs(args);
+		args.srcOffset = srcOffset;
+		args.dstOffset = dstOffset;
+		args.size = size;
+		args.src = BufferIndex(src, srcOffset + size);
+		args.dst = BufferIndex(dst, dstOffset + size);
+		Record(CapturedCommand::CopyBuffer, args);
+		original.CopyBuffer(ctx, src, dst, srcOffset, dstOffset, size);
+	}
+
+	// Flushes are where data written to mapped memory becomes visible, so that is when the data is captured
+	static void FlushBuffer(BufferHandle handle, uint64_t modOffset, uint64_t modRange)
+	{
+		const void* data = original.MapBuffer(handle, modOffset, modRange);
+		FlushBufferArgs args;
+		ZeroArgs(args);
+		args.offset = modOffset;
+		args.range = modRange;
+		args.buffer = BufferIndex(handle, modOffset + modRange);
+		Record(CapturedCommand::FlushBuffer, args, data, modRange);
+		original.FlushBuffer(handle, modOffset, modRange);
+	}
+
+	static void RecordBindBuffer(
+		CapturedCommand command, BufferHandle handle, uint32_t set, uint32_t binding, uint64_t offset, uint64_t range)
+	{
+		BindBufferArgs args;
+		ZeroArgs(args);
+		args.offset = offset;
+		args.range = range;
+		args.buffer = BufferIndex(handle, offset + range);
+		args.set = set;
+		args.binding = binding;
+		Record(command, args);
+	}
+
+	static void BindUniformBuffer(
+		CommandContextHandle ctx, BufferHandle handle, uint32_t set, uint32_t binding, uint64_t offset, uint64_t range)
+	{
+		RecordBindBuffer(CapturedCommand::BindUniformBuffer, handle, set, binding, offset, range);
+		original.BindUniformBuffer(ctx, handle, set, binding, offset, range);
+	}
+
+	static void BindStorageBuffer(
+		CommandContextHandle ctx, BufferHandle handle, uint32_t set, uint32_t binding, uint64_t offset, uint64_t range)
+	{
+		RecordBindBuffer(CapturedCommand::BindStorageBuffer, handle, set, binding, offset, range);
+		original.BindStorageBuffer(ctx, handle, set, binding, offset, range);
+	}
+
+	static void TextureBarrier(CommandContextHandle ctx, TextureHandle handle, const eg::TextureBarrier& barrier)
+	{
+		TextureBarrierArgs args;
+		ZeroArgs(args);
+		args.barrier = barrier;
+		args.texture = Index(HandleType::Texture, handle);
+		Record(CapturedCommand::TextureBarrier, args);
+		original.TextureBarrier(ctx, handle, barrier);
+	}
+
+	static void RecordTextureData(
+		CapturedCommand command, TextureHandle handle, const TextureRange& range, BufferHandle buffer, uint64_t offset)
+	{
+		TextureDataArgs args;
+		ZeroArgs(args);
+		args.offset = offset;
+		args.range = range;
+		args.texture = TextureIndex(handle, range);
+		args.buffer = BufferIndex(buffer, offset + RangeTexels(range));
+		Record(command, args);
+	}
+
+	static void SetTextureData(
+		CommandContextHandle ctx, TextureHandle handle, const TextureRange& range, BufferHandle buffer, uint64_t offset)
+	{
+		RecordTextureData(CapturedCommand::SetTextureData, handle, range, buffer, offset);
+		original.SetTextureData(ctx, handle, range, buffer, offset);
+	}
+
+	static void GetTextureData(
+		CommandContextHandle ctx, TextureHandle handle, const TextureRange& range, BufferHandle buffer, uint64_t offset)
+	{
+		RecordTextureData(CapturedCommand::GetTextureData, handle, range, buffer, offset);
+		original.GetTextureData(ctx, handle, range, buffer, offset);
+	}
+
+	static void CopyTextureData(
+		CommandContextHandle ctx, TextureHandle src, TextureHandle dst, const TextureRange& srcRange,
+		const TextureOffset& dstOffset)
+	{
+		const TextureRange dstRange = { dstOffset.offsetX, dstOffset.offsetY, dstOffset.offsetZ, srcRange.sizeX,
+			                            srcRange.sizeY,    srcRange.sizeZ,    dstOffset.mipLevel };
+		CopyTextureDataArgs args;
+		ZeroArgs(args);
+		args.srcRange = srcRange;
+		args.dstOffset = dstOffset;
+		args.src = TextureIndex(src, srcRange);
+		args.dst = TextureIndex(dst, dstRange);
+		Record(CapturedCommand::CopyTextureData, args);
+		original.CopyTextureData(ctx, src, dst, srcRange, dstOffset);
+	}
+
+	static void GenerateMipmaps(CommandContextHandle ctx, TextureHandle handle)
+	{
+		TextureArgs args;
+		ZeroArgs(args);
+		args.texture = Index(HandleType::Texture, handle);
+		Record(CapturedCommand::GenerateMipmaps, args);
+		original.GenerateMipmaps(ctx, handle);
+	}
+
+	static void BindTexture(
+		CommandContextHandle ctx, TextureViewHandle textureView, SamplerHandle sampler, uint32_t set, uint32_t binding)
+	{
+		BindTextureArgs args;
+		ZeroArgs(args);
+		args.textureView = Index(HandleType::TextureView, textureView);
+		args.sampler = Index(HandleType::Sampler, sampler);
+		args.set = set;
+		args.binding = binding;
+		Record(CapturedCommand::BindTexture, args);
+		original.BindTexture(ctx, textureView, sampler, set, binding);
+	}
+
+	static void BindStorageImage(CommandContextHandle ctx, TextureViewHandle texture, uint32_t set, uint32_t binding)
+	{
+		BindTextureArgs args;
+		ZeroArgs(args);
+		args.textureView = Index(HandleType::TextureView, texture);
+		args.sampler = CommandCapture::NULL_HANDLE_INDEX;
+		args.set = set;
+		args.binding = binding;
+		Record(CapturedCommand::BindStorageImage, args);
+		original.BindStorageImage(ctx, texture, set, binding);
+	}
+
+	static void ClearColorTexture(CommandContextHandle ctx, TextureHandle texture, uint32_t mipLevel, const void* color)
+	{
+		const TextureRange range = { 0, 0, 0, 1, 1, 1, mipLevel };
+		ClearColorTextureArgs args;
+		ZeroArgs(args);
+		std::memcpy(args.color, color, CLEAR_COLOR_BYTES);
+		args.texture = TextureIndex(texture, range);
+		args.mipLevel = mipLevel;
+		Record(CapturedCommand::ClearColorTexture, args);
+		original.ClearColorTexture(ctx, texture, mipLevel, color);
+	}
+
+	static void ResolveTexture(
+		CommandContextHandle ctx, TextureHandle src, TextureHandle dst, const ResolveRegion& region)
+	{
+		ResolveTextureArgs args;
+		ZeroArgs(args);
+		args.region = region;
+		args.src = Index(HandleType::Texture, src);
+		args.dst = Index(HandleType::Texture, dst);
+		Record(CapturedCommand::ResolveTexture, args);
+		original.ResolveTexture(ctx, src, dst, region);
+	}
+
+	static void BindDescriptorSet(CommandContextHandle ctx, uint32_t set, DescriptorSetHandle handle)
+	{
+		BindDescriptorSetArgs args;
+		ZeroArgs(args);
+		args.set = set;
+		args.descriptorSet = Index(HandleType::DescriptorSet, handle);
+		Record(CapturedCommand::BindDescriptorSet, args);
+		original.BindDescriptorSet(ctx, set, handle);
+	}
+
+	static void BindPipeline(CommandContextHandle ctx, PipelineHandle handle)
+	{
+		BindPipelineArgs args;
+		ZeroArgs(args);
+		args.pipeline = Index(HandleType::Pipeline, handle);
+		Record(CapturedCommand::BindPipeline, args);
+		original.BindPipeline(ctx, handle);
+	}
+
+	static void PushConstants(CommandContextHandle ctx, uint32_t offset, uint32_t range, const void* data)
+	{
+		PushConstantsArgs args;
+		ZeroArgs(args);
+		args.offset = offset;
+		args.range = range;
+		Record(CapturedCommand::PushConstants, args, data, range);
+		original.PushConstants(ctx, offset, range, data);
+	}
+
+	static void DispatchCompute(CommandContextHandle ctx, uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ)
+	{
+		DispatchComputeArgs args;
+		ZeroArgs(args);
+		args.sizeX = sizeX;
+		args.sizeY = sizeY;
+		args.sizeZ = sizeZ;
+		Record(CapturedCommand::DispatchCompute, args);
+		original.DispatchCompute(ctx, sizeX, sizeY, sizeZ);
+	}
+
+	static void SetViewport(CommandContextHandle ctx, float x, float y, float w, float h)
+	{
+		ViewportArgs args;
+		ZeroArgs(args);
+		args.x = x;
+		args.y = y;
+		args.w = w;
+		args.h = h;
+		Record(CapturedCommand::SetViewport, args);
+		original.SetViewport(ctx, x, y, w, h);
+	}
+
+	static void SetScissor(CommandContextHandle ctx, int x, int y, int w, int h)
+	{
+		ScissorArgs args;
+		ZeroArgs(args);
+		args.x = x;
+		args.y = y;
+		args.w = w;
+		args.h = h;
+		Record(CapturedCommand::SetScissor, args);
+		original.SetScissor(ctx, x, y, w, h);
+	}
+
+	static void SetStencilValue(CommandContextHandle ctx, StencilValue kind, uint32_t val)
+	{
+		StencilValueArgs args;
+		ZeroArgs(args);
+		args.kind = kind;
+		args.value = val;
+		Record(CapturedCommand::SetStencilValue, args);
+		original.SetStencilValue(ctx, kind, val);
+	}
+
+	static void BeginRenderPass(CommandContextHandle ctx, const RenderPassBeginInfo& beginInfo)
+	{
+		// The begin info is copied member by member, since copying the whole struct would also copy its padding.
+		//  The framebuffer pointer is left null, replay uses the framebuffer from the handle table instead.
+		BeginRenderPassArgs args;
+		ZeroArgs(args);
+		args.beginInfo.depthLoadOp = beginInfo.depthLoadOp;
+		args.beginInfo.stencilLoadOp = beginInfo.stencilLoadOp;
+		args.beginInfo.sampledDepthStencil = beginInfo.sampledDepthStencil;
+		args.beginInfo.depthClearValue = beginInfo.depthClearValue;
+		args.beginInfo.stencilClearValue = beginInfo.stencilClearValue;
+		for (uint32_t i = 0; i < MAX_COLOR_ATTACHMENTS; i++)
+		{
+			const RenderPassColorAttachment& attachment = beginInfo.colorAttachments[i];
+			RenderPassColorAttachment& argsAttachment = args.beginInfo.colorAttachments[i];
+			argsAttachment.loadOp = attachment.loadOp;
+			argsAttachment.finalUsage = attachment.finalUsage;
+			std::visit(
+				[&]<typename T>(const T& value) { argsAttachment.clearValue.template emplace<T>(value); },
+				attachment.clearValue);
+		}
+		args.framebuffer = Index(HandleType::Framebuffer, beginInfo.framebuffer);
+		Record(CapturedCommand::BeginRenderPass, args);
+		original.BeginRenderPass(ctx, beginInfo);
+	}
+
+	static void EndRenderPass(CommandContextHandle ctx)
+	{
+		NoArgs args;
+		ZeroArgs(args);
+		Record(CapturedCommand::EndRenderPass, args);
+		original.EndRenderPass(ctx);
+	}
+
+	static void BindIndexBuffer(CommandContextHandle ctx, IndexType type, BufferHandle buffer, uint32_t offset)
+	{
+		BindIndexBufferArgs args;
+		ZeroArgs(args);
+		args.type = type;
+		args.buffer = BufferIndex(buffer, offset);
+		args.offset = offset;
+		Record(CapturedCommand::BindIndexBuffer, args);
+		original.BindIndexBuffer(ctx, type, buffer, offset);
+	}
+
+	static void BindVertexBuffer(CommandContextHandle ctx, uint32_t binding, BufferHandle buffer, uint32_t offset)
+	{
+		BindVertexBufferArgs args;
+		ZeroArgs(args);
+		args.binding = binding;
+		args.buffer = BufferIndex(buffer, offset);
+		args.offset = offset;
+		Record(CapturedCommand::BindVertexBuffer, args);
+		original.BindVertexBuffer(ctx, binding, buffer, offset);
+	}
+
+	static void Draw(
+		CommandContextHandle ctx, uint32_t firstVertex, uint32_t numVertices, uint32_t firstInstance,
+		uint32_t numInstances)
+	{
+		DrawArgs args;
+		ZeroArgs(args);
+		args.firstVertex = firstVertex;
+		args.numVertices = numVertices;
+		args.firstInstance = firstInstance;
+		args.numInstances = numInstances;
+		Record(CapturedCommand::Draw, args);
+		original.Draw(ctx, firstVertex, numVertices, firstInstance, numInstances);
+	}
+
+	static void DrawIndexed(
+		CommandContextHandle ctx, uint32_t firstIndex, uint32_t numIndices, uint32_t firstVertex,
+		uint32_t firstInstance, uint32_t numInstances)
+	{
+		DrawIndexedArgs args;
+		ZeroArgs(args);
+		args.firstIndex = firstIndex;
+		args.numIndices = numIndices;
+		args.firstVertex = firstVertex;
+		args.firstInstance = firstInstance;
+		args.numInstances = numInstances;
+		Record(CapturedCommand::DrawIndexed, args);
+		original.DrawIndexed(ctx, firstIndex, numIndices, firstVertex, firstInstance, numInstances);
+	}
+
+	static void CopyQueryResults(
+		CommandContextHandle ctx, QueryPoolHandle queryPool, uint32_t firstQuery, uint32_t numQueries,
+		BufferHandle dstBuffer, uint64_t dstOffset)
+	{
+		CopyQueryResultsArgs args;
+		ZeroArgs(args);
+		args.dstOffset = dstOffset;
+		args.queryPool = QueryPoolIndex(queryPool, QueryType::Timestamp, firstQuery + numQueries);
+		args.firstQuery = firstQuery;
+		args.numQueries = numQueries;
+		args.dstBuffer = BufferIndex(dstBuffer, dstOffset + numQueries * sizeof(uint64_t));
+		Record(CapturedCommand::CopyQueryResults, args);
+		original.CopyQueryResults(ctx, queryPool, firstQuery, numQueries, dstBuffer, dstOffset);
+	}
+
+	static void RecordQuery(CapturedCommand command, uint32_t queryPool, uint32_t firstQuery, uint32_t numQueries)
+	{
+		QueryArgs args;
+		ZeroArgs(args);
+		args.queryPool = queryPool;
+		args.firstQuery = firstQuery;
+		args.numQueries = numQueries;
+		Record(command, args);
+	}
+
+	static void WriteTimestamp(CommandContextHandle ctx, QueryPoolHandle queryPool, uint32_t query)
+	{
+		const uint32_t index = QueryPoolIndex(queryPool, QueryType::Timestamp, query + 1);
+		RecordQuery(CapturedCommand::WriteTimestamp, index, query, 1);
+		original.WriteTimestamp(ctx, queryPool, query);
+	}
+
+	static void ResetQueries(
+		CommandContextHandle ctx, QueryPoolHandle queryPool, uint32_t firstQuery, uint32_t numQueries)
+	{
+		const uint32_t index = Index(HandleType::QueryPool, queryPool);
+		active->m_handles[index].queryCount = std::max(active->m_handles[index].queryCount, firstQuery + numQueries);
+		RecordQuery(CapturedCommand::ResetQueries, index, firstQuery, numQueries);
+		original.ResetQueries(ctx, queryPool, firstQuery, numQueries);
+	}
+
+	static void BeginQuery(CommandContextHandle ctx, QueryPoolHandle queryPool, uint32_t query)
+	{
+		RecordQuery(CapturedCommand::BeginQuery, QueryPoolIndex(queryPool, QueryType::Occlusion, query + 1), query, 1);
+		original.BeginQuery(ctx, queryPool, query);
+	}
+
+	static void EndQuery(CommandContextHandle ctx, QueryPoolHandle queryPool, uint32_t query)
+	{
+		RecordQuery(CapturedCommand::EndQuery, QueryPoolIndex(queryPool, QueryType::Occlusion, query + 1), query, 1);
+		original.EndQuery(ctx, queryPool, query);
+	}
+
+	static void RecordDebugLabel(CapturedCommand command, const char* label, const float* color)
+	{
+		DebugLabelArgs args;
+		ZeroArgs(args);
+		args.labelLength = UnsignedNarrow<uint32_t>(std::strlen(label));
+		args.hasColor = color != nullptr;
+		if (color != nullptr)
+			std::copy_n(color, 4, args.color);
+		Record(command, args, label, args.labelLength);
+	}
+
+	static void DebugLabelBegin(CommandContextHandle ctx, const char* label, const float* color)
+	{
+		RecordDebugLabel(CapturedCommand::DebugLabelBegin, label, color);
+		original.DebugLabelBegin(ctx, label, color);
+	}
+
+	static void DebugLabelEnd(CommandContextHandle ctx)
+	{
+		NoArgs args;
+		ZeroArgs(args);
+		Record(CapturedCommand::DebugLabelEnd, args);
+		original.DebugLabelEnd(ctx);
+	}
+
+	static void DebugLabelInsert(CommandContextHandle ctx, const char* label, const float* color)
+	{
+		RecordDebugLabel(CapturedCommand::DebugLabelInsert, label, color);
+		original.DebugLabelInsert(ctx, label, color);
+	}
+};
+
+// Callbacks that are replaced while capturing, each of them records a command. MapBuffer is not replaced, writes to
+//  mapped memory are captured when they are flushed.
+#define XM_CAPTURED_CALLBACKS                                                                                          \
+	XM_CAPTURED(BufferBarrier)                                                                                         \
+	XM_CAPTURED(UpdateBuffer)                                                                                          \
+	XM_CAPTURED(FillBuffer)                                                                                            \
+	XM_CAPTURED(CopyBuffer)                                                                                            \
+	XM_CAPTURED(FlushBuffer)                                                                                           \
+	XM_CAPTURED(BindUniformBuffer)                                                                                     \
+	XM_CAPTURED(BindStorageBuffer)                                                                                     \
+	XM_CAPTURED(TextureBarrier)                                                                                        \
+	XM_CAPTURED(SetTextureData)                                                                                        \
+	XM_CAPTURED(GetTextureData)                                                                                        \
+	XM_CAPTURED(CopyTextureData)                                                                                       \
+	XM_CAPTURED(GenerateMipmaps)                                                                                       \
+	XM_CAPTURED(BindTexture)                                                                                           \
+	XM_CAPTURED(BindStorageImage)                                                                                      \
+	XM_CAPTURED(ClearColorTexture)                                                                                     \
+	XM_CAPTURED(ResolveTexture)                                                                                        \
+	XM_CAPTURED(BindDescriptorSet)                                                                                     \
+	XM_CAPTURED(BindPipeline)                                                                                          \
+	XM_CAPTURED(PushConstants)                                                                                         \
+	XM_CAPTURED(DispatchCompute)                                                                                       \
+	XM_CAPTURED(SetViewport)                                                                                           \
+	XM_CAPTURED(SetScissor)                                                                                            \
+	XM_CAPTURED(SetStencilValue)                                                                                       \
+	XM_CAPTURED(BeginRenderPass)                                                                                       \
+	XM_CAPTURED(EndRenderPass)                                                                                         \
+	XM_CAPTURED(BindIndexBuffer)                                                                                       \
+	XM_CAPTURED(BindVertexBuffer)                                                                                      \
+	XM_CAPTURED(Draw)                                                                                                  \
+	XM_CAPTURED(DrawIndexed)                                                                                           \
+	XM_CAPTURED(CopyQueryResults)                                                                                      \
+	XM_CAPTURED(WriteTimestamp)                                                                                        \
+	XM_CAPTURED(ResetQueries)                                                                                          \
+	XM_CAPTURED(BeginQuery)                                                                                            \
+	XM_CAPTURED(EndQuery)                                                                                              \
+	XM_CAPTURED(DebugLabelBegin)                                                                                       \
+	XM_CAPTURED(DebugLabelEnd)                                                                                         \
+	XM_CAPTURED(DebugLabelInsert)
+
+CommandCapture::CommandCapture(CommandCapture&& other) noexcept
+{
+	*this = std::move(other);
+}
+
+CommandCapture& CommandCapture::operator=(CommandCapture&& other) noexcept
+{
+	if (this == &other)
+		return *this;
+
+	if (IsCapturing())
+		EndCapture();
+	DestroyStandInResources();
+
+	m_stream = std::move(other.m_stream);
+	m_handles = std::move(other.m_handles);
+	m_handleIndices = std::move(other.m_handleIndices);
+	m_callCounts = other.m_callCounts;
+	m_isReadBack = other.m_isReadBack;
+	m_hasStandIns = other.m_hasStandIns;
+
+	// The stand-ins are owned by this capture now
+	other.m_handles.clear();
+	other.m_hasStandIns = false;
+
+	if (CommandRecorder::active == &other)
+		CommandRecorder::active = this;
+
+	return *this;
+}
+
+CommandCapture::~CommandCapture()
+{
+	if (IsCapturing())
+		EndCapture();
+	DestroyStandInResources();
+}
+
+void CommandCapture::BeginCapture()
+{
+	if (CommandRecorder::active != nullptr)
+		EG_PANIC("Another command capture is already recording")
+
+	DestroyStandInResources();
+	m_stream.clear();
+	m_handles.clear();
+	m_handleIndices.clear();
+	m_callCounts = {};
+	m_isReadBack = false;
+
+	CommandRecorder::active = this;
+
+#define XM_ABSCALLBACK(name, ret, params) CommandRecorder::original.name = gal::name;
+#include "AbstractionCallbacks.inl"
+#undef XM_ABSCALLBACK
+
+#define XM_CAPTURED(name) gal::name = &CommandRecorder::name;
+	XM_CAPTURED_CALLBACKS
+#undef XM_CAPTURED
+}
+
+void CommandCapture::EndCapture()
+{
+	EG_ASSERT(IsCapturing());
+
+#define XM_CAPTURED(name) gal::name = CommandRecorder::original.name;
+	XM_CAPTURED_CALLBACKS
+#undef XM_CAPTURED
+
+	CommandRecorder::active = nullptr;
+	m_handleIndices.clear();
+}
+
+bool CommandCapture::IsCapturing() const
+{
+	return CommandRecorder::active == this;
+}
+
+uint32_t CommandCapture::HandleIndex(HandleType type, void* handle)
+{
+	if (handle == nullptr)
+		return NULL_HANDLE_INDEX;
+
+	const uint32_t nextIndex = UnsignedNarrow<uint32_t>(m_handles.size());
+	auto [it, inserted] = m_handleIndices.emplace(HandleKey{ type, handle }, nextIndex);
+	if (inserted)
+	{
+		CapturedHandle& capturedHandle = m_handles.emplace_back();
+		capturedHandle = {};
+		capturedHandle.type = type;
+		capturedHandle.handle = handle;
+	}
+	return it->second;
+}
+
+template <typename HandleTp>
+HandleTp CommandCapture::Handle(uint32_t index) const
+{
+	if (index == NULL_HANDLE_INDEX)
+		return nullptr;
+
+	HandleType expectedType;
+	if constexpr (std::is_same_v<HandleTp, BufferHandle>)
+		expectedType = HandleType::Buffer;
+	else if constexpr (std::is_same_v<HandleTp, TextureHandle>)
+		expectedType = HandleType::Texture;
+	else if constexpr (std::is_same_v<HandleTp, TextureViewHandle>)
+		expectedType = HandleType::TextureView;
+	else if constexpr (std::is_same_v<HandleTp, SamplerHandle>)
+		expectedType = HandleType::Sampler;
+	else if constexpr (std::is_same_v<HandleTp, DescriptorSetHandle>)
+		expectedType = HandleType::DescriptorSet;
+	else if constexpr (std::is_same_v<HandleTp, PipelineHandle>)
+		expectedType = HandleType::Pipeline;
+	else if constexpr (std::is_same_v<HandleTp, FramebufferHandle>)
+		expectedType = HandleType::Framebuffer;
+	else
+		expectedType = HandleType::QueryPool;
+
+	if (index >= m_handles.size() || m_handles[index].type != expectedType)
+		EG_PANIC("Command capture refers to an invalid handle: " << index)
+	return static_cast<HandleTp>(m_handles[index].handle);
+}
+
+void CommandCapture::Replay(CommandContext& cc) const
+{
+	// Read back captures have no resources until stand-ins are created, the null backend would dereference null handles
+	EG_ASSERT(!m_isReadBack || m_hasStandIns);
+
+	const CommandContextHandle ctx = cc.Handle();
+
+	CommandStreamReader reader(m_stream);
+	while (!reader.AtEnd())
+	{
+		const CapturedCommand command = reader.Read<CapturedCommand>();
+		switch (command)
+		{
+		case CapturedCommand::BufferBarrier:
+		{
+			const auto args = reader.Read<BufferBarrierArgs>();
+			gal::BufferBarrier(ctx, Handle<BufferHandle>(args.buffer), args.barrier);
+			break;
+		}
+		case CapturedCommand::UpdateBuffer:
+		{
+			const auto args = reader.Read<UpdateBufferArgs>();
+			const char* data = reader.Skip(args.size);
+			gal::UpdateBuffer(ctx, Handle<BufferHandle>(args.buffer), args.offset, args.size, data);
+			break;
+		}
+		case CapturedCommand::FillBuffer:
+		{
+			const auto args = reader.Read<FillBufferArgs>();
+			gal::FillBuffer(ctx, Handle<BufferHandle>(args.buffer), args.offset, args.size, args.data);
+			break;
+		}
+		case CapturedCommand::CopyBuffer:
+		{
+			const auto args = reader.Read<CopyBufferArgs>();
+			gal::CopyBuffer(
+				ctx, Handle<BufferHandle>(args.src), Handle<BufferHandle>(args.dst), args.srcOffset, args.dstOffset,
+				args.size);
+			break;
+		}
+		case CapturedCommand::FlushBuffer:
+		{
+			const auto args = reader.Read<FlushBufferArgs>();
+			const char* data = reader.Skip(args.range);
+			const BufferHandle buffer = Handle<BufferHandle>(args.buffer);
+			std::memcpy(gal::MapBuffer(buffer, args.offset, args.range), data, args.range);
+			gal::FlushBuffer(buffer, args.offset, args.range);
+			break;
+		}
+		case CapturedCommand::BindUniformBuffer:
+		{
+			const auto args = reader.Read<BindBufferArgs>();
+			gal::BindUniformBuffer(
+				ctx, Handle<BufferHandle>(args.buffer), args.set, args.binding, args.offset, args.range);
+			break;
+		}
+		case CapturedCommand::BindStorageBuffer:
+		{
+			const auto args = reader.Read<BindBufferArgs>();
+			gal::BindStorageBuffer(
+				ctx, Handle<BufferHandle>(args.buffer), args.set, args.binding, args.offset, args.range);
+			break;
+		}
+		case CapturedCommand::TextureBarrier:
+		{
+			const auto args = reader.Read<TextureBarrierArgs>();
+			gal::TextureBarrier(ctx, Handle<TextureHandle>(args.texture), args.barrier);
+			break;
+		}
+		case CapturedCommand::SetTextureData:
+		{
+			const auto args = reader.Read<TextureDataArgs>();
+			gal::SetTextureData(
+				ctx, Handle<TextureHandle>(args.texture), args.range, Handle<BufferHandle>(args.buffer), args.offset);
+			break;
+		}
+		case CapturedCommand::GetTextureData:
+		{
+			const auto args = reader.Read<TextureDataArgs>();
+			gal::GetTextureData(
+				ctx, Handle<TextureHandle>(args.texture), args.range, Handle<BufferHandle>(args.buffer), args.offset);
+			break;
+		}
+		case CapturedCommand::CopyTextureData:
+		{
+			const auto args = reader.Read<CopyTextureDataArgs>();
+			gal::CopyTextureData(
+				ctx, Handle<TextureHandle>(args.src), Handle<TextureHandle>(args.dst), args.srcRange, args.dstOffset);
+			break;
+		}
+		case CapturedCommand::GenerateMipmaps:
+		{
+			const auto args = reader.Read<TextureArgs>();
+			gal::GenerateMipmaps(ctx, Handle<TextureHandle>(args.texture));
+			break;
+		}
+		case CapturedCommand::BindTexture:
+		{
+			const auto args = reader.Read<BindTextureArgs>();
+			gal::BindTexture(
+				ctx, Handle<TextureViewHandle>(args.textureView), Handle<SamplerHandle>(args.sampler), args.set,
+				args.binding);
+			break;
+		}
+		case CapturedCommand::BindStorageImage:
+		{
+			const auto args = reader.Read<BindTextureArgs>();
+			gal::BindStorageImage(ctx, Handle<TextureViewHandle>(args.textureView), args.set, args.binding);
+			break;
+		}
+		case CapturedCommand::ClearColorTexture:
+		{
+			const auto args = reader.Read<ClearColorTextureArgs>();
+			gal::ClearColorTexture(ctx, Handle<TextureHandle>(args.texture), args.mipLevel, args.color);
+			break;
+		}
+		case CapturedCommand::ResolveTexture:
+		{
+			const auto args = reader.Read<ResolveTextureArgs>();
+			gal::ResolveTexture(ctx, Handle<TextureHandle>(args.src), Handle<TextureHandle>(args.dst), args.region);
+			break;
+		}
+		case CapturedCommand::BindDescriptorSet:
+		{
+			const auto args = reader.Read<BindDescriptorSetArgs>();
+			gal::BindDescriptorSet(ctx, args.set, Handle<DescriptorSetHandle>(args.descriptorSet));
+			break;
+		}
+		case CapturedCommand::BindPipeline:
+		{
+			const auto args = reader.Read<BindPipelineArgs>();
+			gal::BindPipeline(ctx, Handle<PipelineHandle>(args.pipeline));
+			break;
+		}
+		case CapturedCommand::PushConstants:
+		{
+			const auto args = reader.Read<PushConstantsArgs>();
+			gal::PushConstants(ctx, args.offset, args.range, reader.Skip(args.range));
+			break;
+		}
+		case CapturedCommand::DispatchCompute:
+		{
+			const auto args = reader.Read<DispatchComputeArgs>();
+			gal::DispatchCompute(ctx, args.sizeX, args.sizeY, args.sizeZ);
+			break;
+		}
+		case CapturedCommand::SetViewport:
+		{
+			const auto args = reader.Read<ViewportArgs>();
+			gal::SetViewport(ctx, args.x, args.y, args.w, args.h);
+			break;
+		}
+		case CapturedCommand::SetScissor:
+		{
+			const auto args = reader.Read<ScissorArgs>();
+			gal::SetScissor(ctx, args.x, args.y, args.w, args.h);
+			break;
+		}
+		case CapturedCommand::SetStencilValue:
+		{
+			const auto args = reader.Read<StencilValueArgs>();
+			gal::SetStencilValue(ctx, args.kind, args.value);
+			break;
+		}
+		case CapturedCommand::BeginRenderPass:
+		{
+			auto args = reader.Read<BeginRenderPassArgs>();
+			args.beginInfo.framebuffer = Handle<FramebufferHandle>(args.framebuffer);
+			gal::BeginRenderPass(ctx, args.beginInfo);
+			break;
+		}
+		case CapturedCommand::EndRenderPass:
+			reader.Read<NoArgs>();
+			gal::EndRenderPass(ctx);
+			break;
+		case CapturedCommand::BindIndexBuffer:
+		{
+			const auto args = reader.Read<BindIndexBufferArgs>();
+			gal::BindIndexBuffer(ctx, args.type, Handle<BufferHandle>(args.buffer), args.offset);
+			break;
+		}
+		case CapturedCommand::BindVertexBuffer:
+		{
+			const auto args = reader.Read<BindVertexBufferArgs>();
+			gal::BindVertexBuffer(ctx, args.binding, Handle<BufferHandle>(args.buffer), args.offset);
+			break;
+		}
+		case CapturedCommand::Draw:
+		{
+			const auto args = reader.Read<DrawArgs>();
+			gal::Draw(ctx, args.firstVertex, args.numVertices, args.firstInstance, args.numInstances);
+			break;
+		}
+		case CapturedCommand::DrawIndexed:
+		{
+			const auto args = reader.Read<DrawIndexedArgs>();
+			gal::DrawIndexed(
+				ctx, args.firstIndex, args.numIndices, args.firstVertex, args.firstInstance, args.numInstances);
+			break;
+		}
+		case CapturedCommand::CopyQueryResults:
+		{
+			const auto args = reader.Read<CopyQueryResultsArgs>();
+			gal::CopyQueryResults(
+				ctx, Handle<QueryPoolHandle>(args.queryPool), args.firstQuery, args.numQueries,
+				Handle<BufferHandle>(args.dstBuffer), args.dstOffset);
+			break;
+		}
+		case CapturedCommand::WriteTimestamp:
+		{
+			const auto args = reader.Read<QueryArgs>();
+			gal::WriteTimestamp(ctx, Handle<QueryPoolHandle>(args.queryPool), args.firstQuery);
+			break;
+		}
+		case CapturedCommand::ResetQueries:
+		{
+			const auto args = reader.Read<QueryArgs>();
+			gal::ResetQueries(ctx, Handle<QueryPoolHandle>(args.queryPool), args.firstQuery, args.numQueries);
+			break;
+		}
+		case CapturedCommand::BeginQuery:
+		{
+			const auto args = reader.Read<QueryArgs>();
+			gal::BeginQuery(ctx, Handle<QueryPoolHandle>(args.queryPool), args.firstQuery);
+			break;
+		}
+		case CapturedCommand::EndQuery:
+		{
+			const auto args = reader.Read<QueryArgs>();
+			gal::EndQuery(ctx, Handle<QueryPoolHandle>(args.queryPool), args.firstQuery);
+			break;
+		}
+		case CapturedCommand::DebugLabelBegin:
+		case CapturedCommand::DebugLabelInsert:
+		{
+			const auto args = reader.Read<DebugLabelArgs>();
+			const std::string label(reader.Skip(args.labelLength), args.labelLength);
+			const float* color = args.hasColor ? args.color : nullptr;
+			if (command == CapturedCommand::DebugLabelBegin)
+				gal::DebugLabelBegin(ctx, label.c_str(), color);
+			else
+				gal::DebugLabelInsert(ctx, label.c_str(), color);
+			break;
+		}
+		case CapturedCommand::DebugLabelEnd:
+			reader.Read<NoArgs>();
+			gal::DebugLabelEnd(ctx);
+			break;
+		default:
+			EG_PANIC("Unknown command in command capture: " << static_cast<int>(command))
+		}
+	}
+}
+
+void CommandCapture::CreateStandInResources()
+{
+	EG_ASSERT(CurrentGraphicsAPI() == GraphicsAPI::Null);
+	DestroyStandInResources();
+
+	for (CapturedHandle& handle : m_handles)
+	{
+		switch (handle.type)
+		{
+		case HandleType::Buffer:
+		{
+			BufferCreateInfo createInfo;
+			createInfo.flags =
+				BufferFlags::MapWrite | BufferFlags::Update | BufferFlags::CopySrc | BufferFlags::CopyDst;
+			createInfo.size = std::max<uint64_t>(handle.bufferSize, 1);
+			handle.handle = gal::CreateBuffer(createInfo);
+			break;
+		}
+		case HandleType::Texture:
+		{
+			TextureCreateInfo createInfo;
+			createInfo.format = Format::R8_UNorm;
+			createInfo.width = std::max(handle.textureWidth, 1u);
+			createInfo.height = std::max(handle.textureHeight, 1u);
+			createInfo.arrayLayers = std::max(handle.textureLayers, 1u);
+			createInfo.mipLevels = std::max(handle.textureMipLevels, 1u);
+			handle.handle = gal::CreateTexture2DArray(createInfo);
+			break;
+		}
+		case HandleType::Sampler:
+			handle.handle = gal::CreateSampler(SamplerDescription());
+			break;
+		case HandleType::DescriptorSet:
+			handle.handle = gal::CreateDescriptorSetB({});
+			break;
+		case HandleType::Pipeline:
+			handle.handle = gal::CreateGraphicsPipeline(GraphicsPipelineCreateInfo());
+			break;
+		case HandleType::QueryPool:
+			handle.handle = gal::CreateQueryPool(handle.queryType, std::max(handle.queryCount, 1u));
+			break;
+		case HandleType::TextureView:
+		case HandleType::Framebuffer:
+			// The null backend does not look at views or framebuffers
+			handle.handle = nullptr;
+			break;
+		}
+		handle.isStandIn = true;
+	}
+	m_hasStandIns = true;
+}
+
+void CommandCapture::DestroyStandInResources()
+{
+	for (CapturedHandle& handle : m_handles)
+	{
+		if (!handle.isStandIn || handle.handle == nullptr)
+			continue;
+
+		switch (handle.type)
+		{
+		case HandleType::Buffer:
+			gal::DestroyBuffer(static_cast<BufferHandle>(handle.handle));
+			break;
+		case HandleType::Texture:
+			gal::DestroyTexture(static_cast<TextureHandle>(handle.handle));
+			break;
+		case HandleType::Sampler:
+			gal::DestroySampler(static_cast<SamplerHandle>(handle.handle));
+			break;
+		case HandleType::DescriptorSet:
+			gal::DestroyDescriptorSet(static_cast<DescriptorSetHandle>(handle.handle));
+			break;
+		case HandleType::Pipeline:
+			gal::DestroyPipeline(static_cast<PipelineHandle>(handle.handle));
+			break;
+		case HandleType::QueryPool:
+			gal::DestroyQueryPool(static_cast<QueryPoolHandle>(handle.handle));
+			break;
+		case HandleType::TextureView:
+		case HandleType::Framebuffer: break;
+		}
+		handle.handle = nullptr;
+	}
+	m_hasStandIns = false;
+}
+
+void CommandCapture::WriteCallCounts(std::ostream& stream) const
+{
+	for (size_t i = 0; i < NUM_CAPTURED_COMMANDS; i++)
+	{
+		if (m_callCounts[i] != 0)
+			stream << capturedCommandNames[i] << " " << m_callCounts[i] << "\n";
+	}
+}
+
+void CommandCapture::Write(std::ostream& stream) const
+{
+	BinWrite(stream, CAPTURE_FILE_VERSION);
+
+	BinWrite(stream, UnsignedNarrow<uint32_t>(m_handles.size()));
+	for (const CapturedHandle& handle : m_handles)
+	{
+		BinWrite(stream, static_cast<uint8_t>(handle.type));
+		BinWrite(stream, static_cast<uint8_t>(handle.queryType));
+		BinWrite(stream, handle.bufferSize);
+		BinWrite(stream, handle.textureWidth);
+		BinWrite(stream, handle.textureHeight);
+		BinWrite(stream, handle.textureLayers);
+		BinWrite(stream, handle.textureMipLevels);
+		BinWrite(stream, handle.queryCount);
+	}
+
+	for (uint64_t callCount : m_callCounts)
+		BinWrite(stream, callCount);
+
+	BinWrite(stream, static_cast<uint64_t>(m_stream.size()));
+	stream.write(m_stream.data(), ToInt64(m_stream.size()));
+}
+
+CommandCapture CommandCapture::Read(std::istream& stream)
+{
+	if (BinRead<uint32_t>(stream) != CAPTURE_FILE_VERSION)
+		EG_PANIC("Unsupported command capture version")
+
+	const uint32_t numHandles = BinRead<uint32_t>(stream);
+	if (!stream)
+		EG_PANIC("Command capture is truncated")
+
+	CommandCapture capture;
+	capture.m_handles.resize(numHandles);
+	for (CapturedHandle& handle : capture.m_handles)
+	{
+		handle = {};
+		const uint8_t type = BinRead<uint8_t>(stream);
+		const uint8_t queryType = BinRead<uint8_t>(stream);
+		if (type > static_cast<uint8_t>(HandleType::QueryPool) ||
+		    queryType > static_cast<uint8_t>(QueryType::Occlusion))
+		{
+			EG_PANIC("Command capture has an invalid handle type")
+		}
+		handle.type = static_cast<HandleType>(type);
+		handle.queryType = static_cast<QueryType>(queryType);
+		handle.bufferSize = BinRead<uint64_t>(stream);
+		handle.textureWidth = BinRead<uint32_t>(stream);
+		handle.textureHeight = BinRead<uint32_t>(stream);
+		handle.textureLayers = BinRead<uint32_t>(stream);
+		handle.textureMipLevels = BinRead<uint32_t>(stream);
+		handle.queryCount = BinRead<uint32_t>(stream);
+	}
+
+	for (uint64_t& callCount : capture.m_callCounts)
+		callCount = BinRead<uint64_t>(stream);
+
+	const uint64_t streamBytes = BinRead<uint64_t>(stream);
+	if (!stream)
+		EG_PANIC("Command capture is truncated")
+	capture.m_stream.resize(streamBytes);
+	stream.read(capture.m_stream.data(), ToInt64(capture.m_stream.size()));
+	if (!stream)
+		EG_PANIC("Command capture is truncated")
+
+	capture.m_isReadBack = true;
+	return capture;
+}
+} // namespace eg
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "../Hash.hpp"
+#include "AbstractionHL.hpp"
+
+#include <array>
+#include <iosfwd>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace eg
+{
+enum class CapturedCommand : uint8_t
+{
+	BufferBarrier,
+	UpdateBuffer,
+	FillBuffer,
+	CopyBuffer,
+	FlushBuffer,
+	BindUniformBuffer,
+	BindStorageBuffer,
+	TextureBarrier,
+	SetTextureData,
+	GetTextureData,
+	CopyTextureData,
+	GenerateMipmaps,
+	BindTexture,
+	BindStorageImage,
+	ClearColorTexture,
+	ResolveTexture,
+	BindDescriptorSet,
+	BindPipeline,
+	PushConstants,
+	DispatchCompute,
+	SetViewport,
+	SetScissor,
+	SetStencilValue,
+	BeginRenderPass,
+	EndRenderPass,
+	BindIndexBuffer,
+	BindVertexBuffer,
+	Draw,
+	DrawIndexed,
+	CopyQueryResults,
+	WriteTimestamp,
+	ResetQueries,
+	BeginQuery,
+	EndQuery,
+	DebugLabelBegin,
+	DebugLabelEnd,
+	DebugLabelInsert,
+};
+
+constexpr size_t NUM_CAPTURED_COMMANDS = static_cast<size_t>(CapturedCommand::DebugLabelInsert) + 1;
+
+EG_API std::string_view CapturedCommandName(CapturedCommand command);
+
+/**
+ * Records the commands issued through the gal callbacks between BeginCapture and EndCapture into a compact binary
+ * stream, along with the data they upload (buffer updates, push constants and flushed ranges of mapped buffers).
+ *
+ * A capture can be replayed any number of times against the resources it was recorded with. A capture that has been
+ * read back with Read can instead be replayed against stand-in resources on the null graphics backend. Commands are
+ * expected to come from one thread at a time, like for the direct context.
+ *
+ * Limitations:
+ *  - Only data that passes through the captured commands is recorded. The contents that buffers and textures had
+ *    before BeginCapture (from initial data, earlier uploads or GPU writes) are not, so a replay only reproduces
+ *    the original results if those resources still hold the same contents.
+ *  - Replaying a capture that was read back with Read is only supported on the null backend. The real backends
+ *    would need the pipelines, descriptor sets and framebuffers themselves, which a capture does not describe.
+ */
+class EG_API CommandCapture
+{
+public:
+	CommandCapture() = default;
+
+	// Moving a capture that is recording moves the recording as well
+	CommandCapture(CommandCapture&& other) noexcept;
+	CommandCapture& operator=(CommandCapture&& other) noexcept;
+
+	CommandCapture(const CommandCapture& other) = delete;
+	CommandCapture& operator=(const CommandCapture& other) = delete;
+
+	~CommandCapture();
+
+	// Clears the capture and starts recording commands, only one capture can be recording at a time
+	void BeginCapture();
+	void EndCapture();
+
+	bool IsCapturing() const;
+
+	void Replay(CommandContext& cc = DC) const;
+
+	/**
+	 * Creates resources for every handle referenced by the capture, large enough for the ranges used by its commands.
+	 * The stand-ins only carry what the null backend checks, so this requires the null backend to be active. Buffers
+	 * start out zeroed rather than with the contents they had when the capture began.
+	 */
+	void CreateStandInResources();
+	void DestroyStandInResources();
+
+	uint64_t CallCount(CapturedCommand command) const { return m_callCounts[static_cast<size_t>(command)]; }
+
+	// Writes one line per command type with the number of calls, for diffing captures
+	void WriteCallCounts(std::ostream& stream) const;
+
+	size_t StreamBytes() const { return m_stream.size(); }
+
+	void Write(std::ostream& stream) const;
+	static CommandCapture Read(std::istream& stream);
+
+private:
+	friend struct CommandRecorder;
+
+	enum class HandleType : uint8_t
+	{
+		Buffer,
+		Texture,
+		TextureView,
+		Sampler,
+		DescriptorSet,
+		Pipeline,
+		Framebuffer,
+		QueryPool
+	};
+
+	struct CapturedHandle
+	{
+		HandleType type;
+		bool isStandIn;
+		void* handle;
+
+		// Smallest resource that fits the commands that used it, for creating stand-ins
+		uint64_t bufferSize;
+		uint32_t textureWidth;
+		uint32_t textureHeight;
+		uint32_t textureLayers;
+		uint32_t textureMipLevels;
+		uint32_t queryCount;
+		QueryType queryType;
+	};
+
+	// Handles are indexed by type as well, since backends may use the same pointer for different handle types
+	//  (the null backend returns textures as their own texture views for example)
+	struct HandleKey
+	{
+		HandleType type;
+		void* handle;
+
+		bool operator==(const HandleKey& other) const { return type == other.type && handle == other.handle; }
+
+		size_t Hash() const
+		{
+			size_t hash = std::hash<void*>()(handle);
+			HashAppend(hash, static_cast<uint8_t>(type));
+			return hash;
+		}
+	};
+
+	static constexpr uint32_t NULL_HANDLE_INDEX = UINT32_MAX;
+
+	uint32_t HandleIndex(HandleType type, void* handle);
+
+	// Panics if the index does not refer to a handle of the type, since captures may be read from files
+	template <typename HandleTp>
+	HandleTp Handle(uint32_t index) const;
+
+	std::vector<char> m_stream;
+	std::vector<CapturedHandle> m_handles;
+	std::unordered_map<HandleKey, uint32_t, MemberFunctionHash<HandleKey>> m_handleIndices;
+	std::array<uint64_t, NUM_CAPTURED_COMMANDS> m_callCounts{};
+
+	// Set for captures created by Read, which can only be replayed against stand-ins
+	bool m_isReadBack = false;
+	bool m_hasStandIns = false;
+};
+} // namespace eg
@@ -11,6 +11,7 @@
 #include <fstream>
 #include <glm/glm.hpp>
 #include <memory>
+#include <mutex>
 #include <stb_image.h>
 #include <stb_rect_pack.h>
 #include <utf8.h>
@@ -43,6 +44,10 @@ static DynamicLibrary ftDynLibrary;
 
 static FT_Library ftLibrary = nullptr;
 
+// FreeType does not allow faces of the same library to be created or destroyed concurrently,
+//  fonts are rarely rendered so all rendering is serialized.
+static std::mutex ftMutex;
+
 namespace ft
 {
 #define DEF_FREETYPE_FUNC(name) decltype(&FT_##name) name;
@@ -89,6 +94,7 @@ std::optional<FontAtlas> FontAtlas::Render(
 #ifdef EG_NO_FREETYPE
 	return {};
 #else
+	std::lock_guard<std::mutex> lock(ftMutex);
 	if (!MaybeInitFreeType())
 		return {};
 
@@ -107,6 +113,7 @@ std::optional<FontAtlas> FontAtlas::Render(
 #ifdef EG_NO_FREETYPE
 	return {};
 #else
+	std::lock_guard<std::mutex> lock(ftMutex);
 	if (!MaybeInitFreeType())
 		return {};
 
@@ -10,6 +10,7 @@ enum class GraphicsAPI
 {
 	OpenGL,
 	Vulkan,
+	Null, // Headless backend that keeps resources in host memory and only records command statistics
 	Preferred = OpenGL
 };
 
@@ -1,13 +1,144 @@
 #include "MeshBatch.hpp"
 #include "../Assert.hpp"
+#include "../Hash.hpp"
 
 #include <algorithm>
 
 namespace eg
 {
-void MeshBatch::_Add(
-	const MeshBatch::Mesh& mesh, const IMaterial& material, MeshBatch::Instance* instance, int orderPriority,
-	const std::type_info* instanceDataType)
+// Layout of draw keys in MeshBatchMode::SortKeys, from the most significant bits: order priority (16 bits), then
+//  pipeline, material, model and mesh ids (12 bits each). Sorting by key groups instances the same way as buckets.
+static constexpr uint32_t KEY_ID_BITS = 12;
+static constexpr uint32_t MAX_KEY_IDS = 1 << KEY_ID_BITS;
+static constexpr uint32_t MESH_SHIFT = 0;
+static constexpr uint32_t MODEL_SHIFT = KEY_ID_BITS;
+static constexpr uint32_t MATERIAL_SHIFT = KEY_ID_BITS * 2;
+static constexpr uint32_t PIPELINE_SHIFT = KEY_ID_BITS * 3;
+static constexpr uint32_t ORDER_PRIORITY_SHIFT = KEY_ID_BITS * 4;
+
+static uint32_t KeyField(uint64_t key, uint32_t shift)
+{
+	return static_cast<uint32_t>(key >> shift) & (MAX_KEY_IDS - 1);
+}
+
+template <typename Map, typename T>
+static uint64_t GetKeyId(Map& ids, std::vector<T>& values, const typename Map::key_type& key, const T& value)
+{
+	auto [it, inserted] = ids.emplace(key, static_cast<uint32_t>(values.size()));
+	if (inserted)
+	{
+		if (values.size() == MAX_KEY_IDS)
+			EG_PANIC("Too many distinct pipelines, materials, models or meshes in a sort key mesh batch.");
+		values.push_back(value);
+	}
+	return it->second;
+}
+
+size_t MeshBatch::KeyModel::Hash() const
+{
+	size_t hash = 0;
+	HashAppend(hash, vertexBuffer.handle);
+	HashAppend(hash, indexBuffer.handle);
+	HashAppend(hash, static_cast<int>(indexType));
+	return hash;
+}
+
+size_t MeshBatch::KeyMesh::Hash() const
+{
+	size_t hash = 0;
+	HashAppend(hash, firstIndex);
+	HashAppend(hash, firstVertex);
+	HashAppend(hash, numElements);
+	return hash;
+}
+
+void MeshBatch::KeyedInstances::Add(
+	const Mesh& mesh, const IMaterial& material, const Instance* instance, int orderPriority)
+{
+	if (&material != lastMaterial || orderPriority != lastOrderPriority || mesh != lastMesh)
+	{
+		if (orderPriority < INT16_MIN || orderPriority > INT16_MAX)
+			EG_PANIC("Order priority " << orderPriority << " does not fit in a mesh batch sort key.");
+
+		const KeyPipeline pipeline = { &material, instance->dataSize };
+		const uint64_t pipelineId = GetKeyId(pipelineIds, pipelines, material.PipelineHash(), pipeline);
+		const uint64_t materialId = GetKeyId(materialIds, materials, &material, &material);
+		const KeyModel model = { mesh.vertexBuffer, mesh.indexBuffer, mesh.indexType };
+		const uint64_t modelId = GetKeyId(modelIds, models, model, model);
+		const KeyMesh keyMesh = { mesh.firstIndex, mesh.firstVertex, mesh.numElements };
+		const uint64_t meshId = GetKeyId(meshIds, meshes, keyMesh, keyMesh);
+
+		lastKey = static_cast<uint64_t>(orderPriority - INT16_MIN) << ORDER_PRIORITY_SHIFT |
+		          pipelineId << PIPELINE_SHIFT | materialId << MATERIAL_SHIFT | modelId << MODEL_SHIFT |
+		          meshId << MESH_SHIFT;
+		lastMaterial = &material;
+		lastMesh = mesh;
+		lastOrderPriority = orderPriority;
+	}
+
+	// Instances of a pipeline share one instance buffer binding, so their data must have the same size
+	if (pipelines[KeyField(lastKey, PIPELINE_SHIFT)].dataSize != instance->dataSize)
+	{
+		EG_PANIC("Instance data size mismatch when using the same material");
+	}
+
+	keys.push_back({ lastKey, static_cast<uint32_t>(instances.size()) });
+	instances.push_back(instance);
+}
+
+void MeshBatch::KeyedInstances::Append(const KeyedInstances& other)
+{
+	// Ids are only looked up once per distinct component, then every key is rewritten through these tables
+	std::vector<uint64_t> pipelineMap(other.pipelines.size());
+	for (size_t i = 0; i < other.pipelines.size(); i++)
+	{
+		const KeyPipeline& pipeline = other.pipelines[i];
+		pipelineMap[i] = GetKeyId(pipelineIds, pipelines, pipeline.material->PipelineHash(), pipeline);
+		if (pipelines[pipelineMap[i]].dataSize != pipeline.dataSize)
+		{
+			EG_PANIC("Instance data size mismatch when using the same material");
+		}
+	}
+	std::vector<uint64_t> materialMap(other.materials.size());
+	for (size_t i = 0; i < other.materials.size(); i++)
+		materialMap[i] = GetKeyId(materialIds, materials, other.materials[i], other.materials[i]);
+	std::vector<uint64_t> modelMap(other.models.size());
+	for (size_t i = 0; i < other.models.size(); i++)
+		modelMap[i] = GetKeyId(modelIds, models, other.models[i], other.models[i]);
+	std::vector<uint64_t> meshMap(other.meshes.size());
+	for (size_t i = 0; i < other.meshes.size(); i++)
+		meshMap[i] = GetKeyId(meshIds, meshes, other.meshes[i], other.meshes[i]);
+
+	const uint32_t firstIndex = static_cast<uint32_t>(instances.size());
+	keys.reserve(keys.size() + other.keys.size());
+	for (const RadixSortItem<uint64_t>& item : other.keys)
+	{
+		const uint64_t key = (item.key >> ORDER_PRIORITY_SHIFT) << ORDER_PRIORITY_SHIFT |
+		                     pipelineMap[KeyField(item.key, PIPELINE_SHIFT)] << PIPELINE_SHIFT |
+		                     materialMap[KeyField(item.key, MATERIAL_SHIFT)] << MATERIAL_SHIFT |
+		                     modelMap[KeyField(item.key, MODEL_SHIFT)] << MODEL_SHIFT |
+		                     meshMap[KeyField(item.key, MESH_SHIFT)] << MESH_SHIFT;
+		keys.push_back({ key, firstIndex + item.index });
+	}
+	instances.insert(instances.end(), other.instances.begin(), other.instances.end());
+}
+
+void MeshBatch::KeyedInstances::Clear()
+{
+	pipelineIds.clear();
+	materialIds.clear();
+	modelIds.clear();
+	meshIds.clear();
+	pipelines.clear();
+	materials.clear();
+	models.clear();
+	meshes.clear();
+	keys.clear();
+	instances.clear();
+	lastMaterial = nullptr;
+}
+
+void MeshBatch::CheckAdd(const IMaterial& material, const std::type_info* instanceDataType)
 {
 	if (material.GetOrderRequirement() == IMaterial::OrderRequirement::OnlyOrdered)
 	{
@@ -19,7 +150,47 @@ void MeshBatch::_Add(
 		const char* instanceDataTypeName = instanceDataType ? instanceDataType->name() : "none";
 		EG_PANIC("Attempted to use incompatible instance data type (" << instanceDataTypeName << ")");
 	}
+}
+
+void MeshBatch::_Add(
+	const MeshBatch::Mesh& mesh, const IMaterial& material, MeshBatch::Instance* instance, int orderPriority,
+	const std::type_info* instanceDataType)
+{
+	CheckAdd(material, instanceDataType);
+
+	if (m_mode == MeshBatchMode::SortKeys)
+		m_keyedInstances.Add(mesh, material, instance, orderPriority);
+	else
+		AddToBuckets(mesh, material, instance, orderPriority);
+
+	m_totalInstanceData += instance->dataSize;
+	m_totalInstances++;
+}
+
+void MeshBatch::RecordingContext::_Add(
+	const Mesh& mesh, const IMaterial& material, Instance* instance, int orderPriority,
+	const std::type_info* instanceDataType)
+{
+	CheckAdd(material, instanceDataType);
+
+	if (m_mode == MeshBatchMode::SortKeys)
+		m_keyedInstances.Add(mesh, material, instance, orderPriority);
+	else
+		m_pendingInstances.push_back({ mesh, &material, instance, orderPriority });
+
+	m_totalInstanceData += instance->dataSize;
+}
 
+void MeshBatch::RecordingContext::Reset()
+{
+	m_allocator.Reset();
+	m_pendingInstances.clear();
+	m_keyedInstances.Clear();
+	m_totalInstanceData = 0;
+}
+
+void MeshBatch::AddToBuckets(const Mesh& mesh, const IMaterial& material, Instance* instance, int orderPriority)
+{
 	size_t pipelineHash = material.PipelineHash();
 
 	auto opBucketIt = std::lower_bound(
@@ -118,20 +289,86 @@ void MeshBatch::_Add(
 	}
 
 	meshBucket->numInstances++;
-	m_totalInstanceData += instance->dataSize;
-	m_totalInstances++;
 }
 
-void MeshBatch::Begin()
+void MeshBatch::Begin(uint32_t numRecordingContexts)
 {
 	m_allocator.Reset();
 	m_drawList.clear();
 	m_totalInstances = 0;
 	m_totalInstanceData = 0;
+
+	if (m_mode == MeshBatchMode::SortKeys)
+	{
+		m_keyedInstances.Clear();
+		m_keyDraws.clear();
+	}
+
+	// Contexts are kept between frames so that their allocators can be reused
+	while (m_recordingContexts.size() < numRecordingContexts)
+		m_recordingContexts.push_back(std::make_unique<RecordingContext>(m_mode));
+	m_numRecordingContexts = numRecordingContexts;
+	for (uint32_t i = 0; i < m_numRecordingContexts; i++)
+		m_recordingContexts[i]->Reset();
+}
+
+void MeshBatch::MergeRecordingContexts()
+{
+	// Instance data stays in the contexts' allocators until End copies it into the upload buffer
+	for (uint32_t i = 0; i < m_numRecordingContexts; i++)
+	{
+		const RecordingContext& context = *m_recordingContexts[i];
+		if (m_mode == MeshBatchMode::SortKeys)
+		{
+			m_keyedInstances.Append(context.m_keyedInstances);
+			m_totalInstances += static_cast<uint32_t>(context.m_keyedInstances.keys.size());
+		}
+		else
+		{
+			for (const PendingInstance& pending : context.m_pendingInstances)
+				AddToBuckets(pending.mesh, *pending.material, pending.instance, pending.orderPriority);
+			m_totalInstances += static_cast<uint32_t>(context.m_pendingInstances.size());
+		}
+		m_totalInstanceData += context.m_totalInstanceData;
+	}
+	m_numRecordingContexts = 0;
+}
+
+void MeshBatch::EndSortKeys(char* instanceDataOut)
+{
+	m_sortScratch.resize(m_keyedInstances.keys.size());
+	RadixSort<uint64_t>(m_keyedInstances.keys, m_sortScratch);
+
+	// Copies instance data in draw order and merges runs of equal keys into instanced draws. Instance indices restart
+	//  for every pipeline, since the instance buffer is bound at the offset of the pipeline's first instance.
+	m_keyDraws.clear();
+	uint32_t instanceDataOffset = 0;
+	uint32_t pipelineInstanceDataOffset = 0;
+	uint32_t instanceIndex = 0;
+	for (const RadixSortItem<uint64_t>& item : m_keyedInstances.keys)
+	{
+		if (m_keyDraws.empty() || m_keyDraws.back().key != item.key)
+		{
+			if (m_keyDraws.empty() || (m_keyDraws.back().key >> PIPELINE_SHIFT) != (item.key >> PIPELINE_SHIFT))
+			{
+				pipelineInstanceDataOffset = instanceDataOffset;
+				instanceIndex = 0;
+			}
+			m_keyDraws.push_back({ item.key, instanceIndex, 0, pipelineInstanceDataOffset });
+		}
+
+		const Instance* instance = m_keyedInstances.instances[item.index];
+		std::memcpy(instanceDataOut + instanceDataOffset, instance->data, instance->dataSize);
+		instanceDataOffset += instance->dataSize;
+		m_keyDraws.back().numInstances++;
+		instanceIndex++;
+	}
 }
 
 void MeshBatch::End(CommandContext& cmdCtx)
 {
+	MergeRecordingContexts();
+
 	if (m_totalInstances == 0)
 		return;
 
@@ -139,6 +376,8 @@ void MeshBatch::End(CommandContext& cmdCtx)
 
 	char* instanceDataOut = static_cast<char*>(uploadBuffer.Map());
 	uint32_t instanceDataOffset = 0;
+	if (m_mode == MeshBatchMode::SortKeys)
+		EndSortKeys(instanceDataOut);
 	for (const OrderPriorityBucket& opBucket : m_drawList)
 	{
 		for (PipelineBucket* pipeline = opBucket.pipelines; pipeline; pipeline = pipeline->next)
@@ -177,11 +416,76 @@ void MeshBatch::End(CommandContext& cmdCtx)
 	m_instanceDataBuffer.UsageHint(eg::BufferUsage::VertexBuffer);
 }
 
+void MeshBatch::DrawSortKeys(CommandContext& cmdCtx, void* drawArgs) const
+{
+	uint64_t boundPipelineKey = UINT64_MAX;
+	uint64_t boundMaterialKey = UINT64_MAX;
+	uint32_t boundModelId = UINT32_MAX;
+	bool pipelineOk = false;
+	bool materialOk = false;
+
+	for (const KeyDraw& draw : m_keyDraws)
+	{
+		if ((draw.key >> PIPELINE_SHIFT) != boundPipelineKey)
+		{
+			boundPipelineKey = draw.key >> PIPELINE_SHIFT;
+			boundMaterialKey = UINT64_MAX;
+
+			const KeyPipeline& pipeline = m_keyedInstances.pipelines[KeyField(draw.key, PIPELINE_SHIFT)];
+			pipelineOk = pipeline.material->BindPipeline(cmdCtx, drawArgs);
+			if (pipelineOk && pipeline.dataSize != 0)
+			{
+				cmdCtx.BindVertexBuffer(1, m_instanceDataBuffer, draw.instanceDataOffset);
+			}
+		}
+		if (!pipelineOk)
+			continue;
+
+		if ((draw.key >> MATERIAL_SHIFT) != boundMaterialKey)
+		{
+			boundMaterialKey = draw.key >> MATERIAL_SHIFT;
+			boundModelId = UINT32_MAX;
+			materialOk = m_keyedInstances.materials[KeyField(draw.key, MATERIAL_SHIFT)]->BindMaterial(cmdCtx, drawArgs);
+		}
+		if (!materialOk)
+			continue;
+
+		const uint32_t modelId = KeyField(draw.key, MODEL_SHIFT);
+		const KeyModel& model = m_keyedInstances.models[modelId];
+		if (modelId != boundModelId)
+		{
+			boundModelId = modelId;
+			cmdCtx.BindVertexBuffer(0, model.vertexBuffer, 0);
+			if (model.indexBuffer.handle != nullptr)
+			{
+				cmdCtx.BindIndexBuffer(model.indexType, model.indexBuffer, 0);
+			}
+		}
+
+		const KeyMesh& mesh = m_keyedInstances.meshes[KeyField(draw.key, MESH_SHIFT)];
+		if (model.indexBuffer.handle == nullptr)
+		{
+			cmdCtx.Draw(mesh.firstVertex, mesh.numElements, draw.firstInstance, draw.numInstances);
+		}
+		else
+		{
+			cmdCtx.DrawIndexed(
+				mesh.firstIndex, mesh.numElements, mesh.firstVertex, draw.firstInstance, draw.numInstances);
+		}
+	}
+}
+
 void MeshBatch::Draw(CommandContext& cmdCtx, void* drawArgs)
 {
 	if (m_totalInstances == 0)
 		return;
 
+	if (m_mode == MeshBatchMode::SortKeys)
+	{
+		DrawSortKeys(cmdCtx, drawArgs);
+		return;
+	}
+
 	for (const OrderPriorityBucket& opBucket : m_drawList)
 	{
 		for (PipelineBucket* pipeline = opBucket.pipelines; pipeline; pipeline = pipeline->next)
@@ -3,12 +3,30 @@
 #include "AbstractionHL.hpp"
 #include "IMaterial.hpp"
 #include "Model.hpp"
+#include "../Hash.hpp"
+#include "../RadixSort.hpp"
+
+#include <memory>
+#include <unordered_map>
 
 namespace eg
 {
+enum class MeshBatchMode
+{
+	// Instances are added to nested lists of pipeline, material, model and mesh buckets
+	Buckets,
+
+	// Instances are appended to a flat list with a 64-bit draw key, which is radix sorted in End. Adds take
+	//  constant time, which is faster with many distinct materials and meshes. At most 4096 distinct pipelines,
+	//  materials, models and meshes may be added per frame, and order priorities must fit in 16 bits.
+	SortKeys
+};
+
 class EG_API MeshBatch
 {
 public:
+	explicit MeshBatch(MeshBatchMode mode = MeshBatchMode::Buckets) : m_mode(mode) {}
+
 	struct Mesh
 	{
 		eg::BufferRef vertexBuffer;
@@ -17,6 +35,25 @@ public:
 		uint32_t firstVertex;
 		uint32_t numElements; // Number of vertices or indices
 		eg::IndexType indexType;
+
+		bool operator==(const Mesh& other) const
+		{
+			return vertexBuffer.handle == other.vertexBuffer.handle && indexBuffer.handle == other.indexBuffer.handle &&
+			       indexType == other.indexType && firstIndex == other.firstIndex && firstVertex == other.firstVertex &&
+			       numElements == other.numElements;
+		}
+
+		static Mesh FromModel(const Model& model, size_t meshIndex)
+		{
+			Mesh mesh;
+			mesh.vertexBuffer = model.VertexBuffer();
+			mesh.indexBuffer = model.IndexBuffer();
+			mesh.firstIndex = model.GetMesh(meshIndex).firstIndex;
+			mesh.firstVertex = model.GetMesh(meshIndex).firstVertex;
+			mesh.numElements = model.GetMesh(meshIndex).numIndices;
+			mesh.indexType = model.IndexType();
+			return mesh;
+		}
 	};
 
 	template <typename T>
@@ -32,39 +69,46 @@ public:
 	void AddModelMesh(
 		const Model& model, size_t meshIndex, const IMaterial& material, const T& instanceData, int orderPriority = 0)
 	{
-		Mesh mesh;
-		mesh.vertexBuffer = model.VertexBuffer();
-		mesh.indexBuffer = model.IndexBuffer();
-		mesh.firstIndex = model.GetMesh(meshIndex).firstIndex;
-		mesh.firstVertex = model.GetMesh(meshIndex).firstVertex;
-		mesh.numElements = model.GetMesh(meshIndex).numIndices;
-		mesh.indexType = model.IndexType();
-		Add<T>(mesh, material, instanceData, orderPriority);
+		Add<T>(Mesh::FromModel(model, meshIndex), material, instanceData, orderPriority);
 	}
 
 	template <typename T>
 	void Add(const Mesh& mesh, const IMaterial& material, const T& instanceData, int orderPriority = 0)
 	{
-		void* instanceMem = m_allocator.Allocate(sizeof(Instance) - 1 + sizeof(T), alignof(Instance));
-		Instance* instance = static_cast<Instance*>(instanceMem);
-		instance->dataSize = sizeof(T);
-		new (instance->data) T(instanceData);
-		_Add(mesh, material, instance, orderPriority, &typeid(T));
+		_Add(mesh, material, NewInstance<T>(m_allocator, instanceData), orderPriority, &typeid(T));
 	}
 
 	void AddNoData(const Mesh& mesh, const IMaterial& material, int orderPriority = 0)
 	{
-		Instance* instance = m_allocator.New<Instance>();
-		instance->dataSize = 0;
-		_Add(mesh, material, instance, orderPriority, nullptr);
+		_Add(mesh, material, NewInstanceNoData(m_allocator), orderPriority, nullptr);
 	}
 
-	void Begin();
+	class RecordingContext;
 
+	/**
+	 * Starts recording a new batch. numRecordingContexts contexts are made available through GetRecordingContext,
+	 * which may be used to add instances from other threads until End is called.
+	 */
+	void Begin(uint32_t numRecordingContexts = 0);
+
+	// Returns one of the contexts created by Begin. Each context must only be used by one thread at a time.
+	RecordingContext& GetRecordingContext(uint32_t index)
+	{
+		EG_ASSERT(index < m_numRecordingContexts);
+		return *m_recordingContexts[index];
+	}
+
+	/**
+	 * Merges instances from recording contexts and uploads instance data. All threads must have finished adding
+	 * to the contexts. Contexts are merged in index order after the instances added directly to the batch, so the
+	 * result does not depend on thread timing.
+	 */
 	void End(CommandContext& cmdCtx);
 
 	void Draw(CommandContext& cmdCtx, void* drawArgs = nullptr);
 
+	MeshBatchMode Mode() const { return m_mode; }
+
 private:
 	struct Instance
 	{
@@ -73,10 +117,156 @@ private:
 		alignas(std::max_align_t) char data[1];
 	};
 
+	template <typename T>
+	static Instance* NewInstance(LinearAllocator& allocator, const T& instanceData)
+	{
+		void* instanceMem = allocator.Allocate(sizeof(Instance) - 1 + sizeof(T), alignof(Instance));
+		Instance* instance = static_cast<Instance*>(instanceMem);
+		instance->dataSize = sizeof(T);
+		new (instance->data) T(instanceData);
+		return instance;
+	}
+
+	static Instance* NewInstanceNoData(LinearAllocator& allocator)
+	{
+		Instance* instance = allocator.New<Instance>();
+		instance->dataSize = 0;
+		return instance;
+	}
+
+	static void CheckAdd(const IMaterial& material, const std::type_info* instanceDataType);
+
+	// State for MeshBatchMode::SortKeys. Each component of the draw key is a dense id assigned on first use.
+	struct KeyPipeline
+	{
+		const IMaterial* material;
+		uint32_t dataSize;
+	};
+
+	struct KeyModel
+	{
+		eg::BufferRef vertexBuffer;
+		eg::BufferRef indexBuffer;
+		eg::IndexType indexType;
+
+		bool operator==(const KeyModel& other) const
+		{
+			return vertexBuffer.handle == other.vertexBuffer.handle &&
+			       indexBuffer.handle == other.indexBuffer.handle && indexType == other.indexType;
+		}
+
+		size_t Hash() const;
+	};
+
+	struct KeyMesh
+	{
+		uint32_t firstIndex;
+		uint32_t firstVertex;
+		uint32_t numElements;
+
+		bool operator==(const KeyMesh& other) const = default;
+
+		size_t Hash() const;
+	};
+
+	// Instances with their draw keys, and the ids that the keys refer to
+	struct KeyedInstances
+	{
+		std::unordered_map<size_t, uint32_t> pipelineIds;
+		std::unordered_map<const IMaterial*, uint32_t> materialIds;
+		std::unordered_map<KeyModel, uint32_t, MemberFunctionHash<KeyModel>> modelIds;
+		std::unordered_map<KeyMesh, uint32_t, MemberFunctionHash<KeyMesh>> meshIds;
+		std::vector<KeyPipeline> pipelines;
+		std::vector<const IMaterial*> materials;
+		std::vector<KeyModel> models;
+		std::vector<KeyMesh> meshes;
+
+		std::vector<RadixSortItem<uint64_t>> keys;
+		std::vector<const Instance*> instances;
+
+		// The material and mesh of the previous add and their key, since consecutive adds often share these
+		const IMaterial* lastMaterial = nullptr;
+		Mesh lastMesh{};
+		int lastOrderPriority = 0;
+		uint64_t lastKey = 0;
+
+		void Add(const Mesh& mesh, const IMaterial& material, const Instance* instance, int orderPriority);
+
+		// Appends instances from another set, translating the ids in their keys to ids in this set
+		void Append(const KeyedInstances& other);
+
+		void Clear();
+	};
+
+	// Instance added to a recording context in MeshBatchMode::Buckets, inserted into the buckets by End
+	struct PendingInstance
+	{
+		Mesh mesh;
+		const IMaterial* material;
+		Instance* instance;
+		int orderPriority;
+	};
+
+public:
+	// Records instances on one thread, which are merged into the batch by End
+	class EG_API RecordingContext
+	{
+	public:
+		explicit RecordingContext(MeshBatchMode mode) : m_mode(mode) {}
+
+		template <typename T>
+		void AddModel(const Model& model, const IMaterial& material, const T& instanceData, int orderPriority = 0)
+		{
+			for (size_t i = 0; i < model.NumMeshes(); i++)
+			{
+				AddModelMesh<T>(model, i, material, instanceData, orderPriority);
+			}
+		}
+
+		template <typename T>
+		void AddModelMesh(
+			const Model& model, size_t meshIndex, const IMaterial& material, const T& instanceData,
+			int orderPriority = 0)
+		{
+			Add<T>(Mesh::FromModel(model, meshIndex), material, instanceData, orderPriority);
+		}
+
+		template <typename T>
+		void Add(const Mesh& mesh, const IMaterial& material, const T& instanceData, int orderPriority = 0)
+		{
+			_Add(mesh, material, NewInstance<T>(m_allocator, instanceData), orderPriority, &typeid(T));
+		}
+
+		void AddNoData(const Mesh& mesh, const IMaterial& material, int orderPriority = 0)
+		{
+			_Add(mesh, material, NewInstanceNoData(m_allocator), orderPriority, nullptr);
+		}
+
+	private:
+		friend class MeshBatch;
+
+		void _Add(
+			const Mesh& mesh, const IMaterial& material, Instance* instance, int orderPriority,
+			const std::type_info* instanceDataType);
+
+		void Reset();
+
+		MeshBatchMode m_mode;
+		eg::LinearAllocator m_allocator;
+		std::vector<PendingInstance> m_pendingInstances;
+		KeyedInstances m_keyedInstances;
+		uint32_t m_totalInstanceData = 0;
+	};
+
+private:
 	void _Add(
 		const Mesh& mesh, const IMaterial& material, Instance* instance, int orderPriority,
 		const std::type_info* instanceDataType);
 
+	void AddToBuckets(const Mesh& mesh, const IMaterial& material, Instance* instance, int orderPriority);
+
+	void MergeRecordingContexts();
+
 	struct MeshBucket
 	{
 		uint32_t firstVertex;
@@ -122,9 +312,30 @@ private:
 
 	std::vector<OrderPriorityBucket> m_drawList;
 
+	void EndSortKeys(char* instanceDataOut);
+	void DrawSortKeys(CommandContext& cmdCtx, void* drawArgs) const;
+
+	// Consecutive instances with the same key, drawn with one instanced draw
+	struct KeyDraw
+	{
+		uint64_t key;
+		uint32_t firstInstance;
+		uint32_t numInstances;
+		uint32_t instanceDataOffset;
+	};
+
+	KeyedInstances m_keyedInstances;
+	std::vector<RadixSortItem<uint64_t>> m_sortScratch;
+	std::vector<KeyDraw> m_keyDraws;
+
+	MeshBatchMode m_mode;
+
 	eg::LinearAllocator m_allocator;
-	uint32_t m_totalInstances;
-	uint32_t m_totalInstanceData;
+	uint32_t m_totalInstances = 0;
+	uint32_t m_totalInstanceData = 0;
+
+	std::vector<std::unique_ptr<RecordingContext>> m_recordingContexts;
+	uint32_t m_numRecordingContexts = 0;
 
 	uint32_t m_instanceDataCapacity = 0;
 	eg::Buffer m_instanceDataBuffer;
@@ -1,17 +1,29 @@
 #include "MeshBatchOrdered.hpp"
 #include "Model.hpp"
 
-#include <algorithm>
+#include <cstring>
 
 namespace eg
 {
-void MeshBatchOrdered::Begin()
+void MeshBatchOrdered::RecordingContext::Reset()
 {
 	m_instances.clear();
 	m_instanceDataAllocator.Reset();
 	m_totalInstanceData = 0;
 }
 
+void MeshBatchOrdered::Begin(uint32_t numRecordingContexts)
+{
+	m_mainContext.Reset();
+
+	// Contexts are kept between frames so that their allocators can be reused
+	while (m_recordingContexts.size() < numRecordingContexts)
+		m_recordingContexts.push_back(std::make_unique<RecordingContext>());
+	m_numRecordingContexts = numRecordingContexts;
+	for (uint32_t i = 0; i < m_numRecordingContexts; i++)
+		m_recordingContexts[i]->Reset();
+}
+
 static inline void CheckRequirements(const IMaterial& material, const std::type_info* instanceDataType)
 {
 	if (material.GetOrderRequirement() == IMaterial::OrderRequirement::OnlyUnordered)
@@ -26,42 +38,11 @@ static inline void CheckRequirements(const IMaterial& material, const std::type_
 	}
 }
 
-void MeshBatchOrdered::AddNoData(const MeshBatch::Mesh& mesh, const IMaterial& material, float order)
-{
-	CheckRequirements(material, nullptr);
-	Instance& instance = m_instances.emplace_back();
-	instance.dataSize = 0;
-	instance.data = nullptr;
-	instance.mesh = mesh;
-	instance.material = &material;
-	instance.order = order;
-}
-
-void MeshBatchOrdered::_AddModelMesh(
-	const Model& model, size_t meshIndex, const IMaterial& material, const void* data, uint32_t dataSize, float order,
-	const std::type_info& instanceDataType)
-{
-	CheckRequirements(material, &instanceDataType);
-
-	Instance& instance = m_instances.emplace_back();
-	instance.dataSize = dataSize;
-	instance.data = data;
-	instance.mesh.vertexBuffer = model.VertexBuffer();
-	instance.mesh.indexBuffer = model.IndexBuffer();
-	instance.mesh.firstIndex = model.GetMesh(meshIndex).firstIndex;
-	instance.mesh.firstVertex = model.GetMesh(meshIndex).firstVertex;
-	instance.mesh.numElements = model.GetMesh(meshIndex).numIndices;
-	instance.mesh.indexType = model.IndexType();
-	instance.material = &material;
-	instance.order = order;
-	m_totalInstanceData += dataSize;
-}
-
-void MeshBatchOrdered::_Add(
+void MeshBatchOrdered::RecordingContext::_Add(
 	const MeshBatch::Mesh& mesh, const IMaterial& material, const void* data, uint32_t dataSize, float order,
-	const std::type_info& instanceDataType)
+	const std::type_info* instanceDataType)
 {
-	CheckRequirements(material, &instanceDataType);
+	CheckRequirements(material, instanceDataType);
 
 	Instance& instance = m_instances.emplace_back();
 	instance.dataSize = dataSize;
@@ -74,87 +55,116 @@ void MeshBatchOrdered::_Add(
 
 void MeshBatchOrdered::End(CommandContext& cmdCtx)
 {
-	if (m_instances.empty())
+	m_sortKeys.clear();
+	m_instances.clear();
+	m_draws.clear();
+
+	// Instances are sorted through compact (order, index) keys rather than moving the instance records, and their
+	//  data stays in the contexts' allocators until it is copied into the upload buffer below
+	uint32_t totalInstanceData = 0;
+	auto AddInstances = [&](const RecordingContext& context)
+	{
+		for (const Instance& instance : context.m_instances)
+		{
+			m_sortKeys.push_back({ FloatToSortableBits(instance.order), static_cast<uint32_t>(m_instances.size()) });
+			m_instances.push_back(&instance);
+		}
+		totalInstanceData += context.m_totalInstanceData;
+	};
+	AddInstances(m_mainContext);
+	for (uint32_t i = 0; i < m_numRecordingContexts; i++)
+		AddInstances(*m_recordingContexts[i]);
+	m_numRecordingContexts = 0;
+
+	if (m_sortKeys.empty())
 		return;
 
-	std::sort(
-		m_instances.begin(), m_instances.end(),
-		[&](const Instance& a, const Instance& b) { return a.order < b.order; });
+	// The sort is stable, so instances with equal order are drawn in the order they were added
+	m_sortScratch.resize(m_sortKeys.size());
+	RadixSort<uint32_t>(m_sortKeys, m_sortScratch);
+
+	// Consecutive instances with the same material and mesh are merged into one instanced draw, which preserves the
+	//  draw order since instances are rasterized in order
+	char* instanceDataOut = nullptr;
+	eg::UploadBuffer uploadBuffer = {};
+	if (totalInstanceData != 0)
+	{
+		uploadBuffer = eg::GetTemporaryUploadBuffer(totalInstanceData);
+		instanceDataOut = static_cast<char*>(uploadBuffer.Map());
+	}
 
-	if (m_totalInstanceData != 0)
+	uint32_t instanceDataOffset = 0;
+	for (const RadixSortItem<uint32_t>& item : m_sortKeys)
 	{
-		eg::UploadBuffer uploadBuffer = eg::GetTemporaryUploadBuffer(m_totalInstanceData);
+		const Instance& instance = *m_instances[item.index];
+		if (m_draws.empty() || m_draws.back().material != instance.material || m_draws.back().mesh != instance.mesh ||
+		    m_draws.back().dataSize != instance.dataSize)
+		{
+			m_draws.push_back({ instance.mesh, instance.material, instance.dataSize, 0, instanceDataOffset });
+		}
+		m_draws.back().numInstances++;
 
-		char* instanceDataOut = static_cast<char*>(uploadBuffer.Map());
-		for (const Instance& instance : m_instances)
+		if (instance.dataSize != 0)
 		{
-			std::memcpy(instanceDataOut, instance.data, instance.dataSize);
-			instanceDataOut += instance.dataSize;
+			std::memcpy(instanceDataOut + instanceDataOffset, instance.data, instance.dataSize);
+			instanceDataOffset += instance.dataSize;
 		}
+	}
 
+	if (totalInstanceData != 0)
+	{
 		uploadBuffer.Flush();
 
-		if (m_totalInstanceData > m_instanceDataCapacity)
+		if (totalInstanceData > m_instanceDataCapacity)
 		{
-			m_instanceDataCapacity = eg::RoundToNextMultiple(m_totalInstanceData, 1024);
+			m_instanceDataCapacity = eg::RoundToNextMultiple(totalInstanceData, 1024);
 			m_instanceDataBuffer =
 				eg::Buffer(eg::BufferFlags::CopyDst | eg::BufferFlags::VertexBuffer, m_instanceDataCapacity, nullptr);
 		}
 
-		cmdCtx.CopyBuffer(uploadBuffer.buffer, m_instanceDataBuffer, uploadBuffer.offset, 0, m_totalInstanceData);
+		cmdCtx.CopyBuffer(uploadBuffer.buffer, m_instanceDataBuffer, uploadBuffer.offset, 0, totalInstanceData);
 		m_instanceDataBuffer.UsageHint(eg::BufferUsage::VertexBuffer);
 	}
 }
 
 void MeshBatchOrdered::Draw(CommandContext& cmdCtx, void* drawArgs) const
 {
-	if (m_instances.empty())
-		return;
-
 	const IMaterial* currentMaterial = nullptr;
 	size_t currentPipelineHash = 0;
 
-	uint32_t instanceDataOffset = 0;
-
-	for (const Instance& instance : m_instances)
+	for (const OrderedDraw& draw : m_draws)
 	{
-		size_t newPipelineHash = instance.material->PipelineHash();
+		size_t newPipelineHash = draw.material->PipelineHash();
 		if (currentMaterial == nullptr || newPipelineHash != currentPipelineHash)
 		{
-			if (!instance.material->BindPipeline(cmdCtx, drawArgs))
-			{
-				instanceDataOffset += instance.dataSize;
+			if (!draw.material->BindPipeline(cmdCtx, drawArgs))
 				continue;
-			}
 			currentPipelineHash = newPipelineHash;
 		}
 
-		if (currentMaterial != instance.material)
+		if (currentMaterial != draw.material)
 		{
-			if (!instance.material->BindMaterial(cmdCtx, drawArgs))
-			{
-				instanceDataOffset += instance.dataSize;
+			if (!draw.material->BindMaterial(cmdCtx, drawArgs))
 				continue;
-			}
-			currentMaterial = instance.material;
+			currentMaterial = draw.material;
 		}
 
-		if (instance.dataSize != 0)
+		if (draw.dataSize != 0)
 		{
-			cmdCtx.BindVertexBuffer(1, m_instanceDataBuffer, instanceDataOffset);
-			instanceDataOffset += instance.dataSize;
+			cmdCtx.BindVertexBuffer(1, m_instanceDataBuffer, draw.instanceDataOffset);
 		}
 
-		cmdCtx.BindVertexBuffer(0, instance.mesh.vertexBuffer, 0);
-		if (instance.mesh.indexBuffer.handle == nullptr)
+		cmdCtx.BindVertexBuffer(0, draw.mesh.vertexBuffer, 0);
+		if (draw.mesh.indexBuffer.handle == nullptr)
 		{
-			cmdCtx.Draw(instance.mesh.firstVertex, instance.mesh.numElements, 0, 1);
+			cmdCtx.Draw(draw.mesh.firstVertex, draw.mesh.numElements, 0, draw.numInstances);
 		}
 		else
 		{
-			cmdCtx.BindIndexBuffer(instance.mesh.indexType, instance.mesh.indexBuffer, 0);
+			cmdCtx.BindIndexBuffer(draw.mesh.indexType, draw.mesh.indexBuffer, 0);
 
-			cmdCtx.DrawIndexed(instance.mesh.firstIndex, instance.mesh.numElements, instance.mesh.firstVertex, 0, 1);
+			cmdCtx.DrawIndexed(
+				draw.mesh.firstIndex, draw.mesh.numElements, draw.mesh.firstVertex, 0, draw.numInstances);
 		}
 	}
 }
@@ -8,61 +8,135 @@ namespace eg
 {
 class EG_API MeshBatchOrdered
 {
+private:
+	struct Instance
+	{
+		float order;
+		MeshBatch::Mesh mesh;
+		const IMaterial* material;
+		uint32_t dataSize;
+		const void* data;
+	};
+
 public:
+	// Records instances on one thread, which are merged into the batch by End
+	class EG_API RecordingContext
+	{
+	public:
+		RecordingContext() = default;
+
+		template <typename T>
+		void AddModel(const Model& model, const IMaterial& material, const T& instanceData, float order)
+		{
+			for (size_t i = 0; i < model.NumMeshes(); i++)
+			{
+				AddModelMesh<T>(model, i, material, instanceData, order);
+			}
+		}
+
+		template <typename T>
+		void AddModelMesh(
+			const class Model& model, size_t meshIndex, const IMaterial& material, const T& instanceData, float order)
+		{
+			Add<T>(MeshBatch::Mesh::FromModel(model, meshIndex), material, instanceData, order);
+		}
+
+		template <typename T>
+		void Add(const MeshBatch::Mesh& mesh, const IMaterial& material, const T& instanceData, float order)
+		{
+			_Add(mesh, material, m_instanceDataAllocator.New<T>(instanceData), sizeof(T), order, &typeid(T));
+		}
+
+		void AddNoData(const MeshBatch::Mesh& mesh, const IMaterial& material, float order)
+		{
+			_Add(mesh, material, nullptr, 0, order, nullptr);
+		}
+
+	private:
+		friend class MeshBatchOrdered;
+
+		void _Add(
+			const MeshBatch::Mesh& mesh, const IMaterial& material, const void* data, uint32_t dataSize, float order,
+			const std::type_info* instanceDataType);
+
+		void Reset();
+
+		std::vector<Instance> m_instances;
+		LinearAllocator m_instanceDataAllocator;
+		uint32_t m_totalInstanceData = 0;
+	};
+
 	MeshBatchOrdered() = default;
 
 	template <typename T>
 	void AddModel(const Model& model, const IMaterial& material, const T& instanceData, float order)
 	{
-		for (size_t i = 0; i < model.NumMeshes(); i++)
-		{
-			AddModelMesh<T>(model, i, material, instanceData, order);
-		}
+		m_mainContext.AddModel<T>(model, material, instanceData, order);
 	}
 
 	template <typename T>
 	void AddModelMesh(
 		const class Model& model, size_t meshIndex, const IMaterial& material, const T& instanceData, float order)
 	{
-		_AddModelMesh(
-			model, meshIndex, material, m_instanceDataAllocator.New<T>(instanceData), sizeof(T), order, typeid(T));
+		m_mainContext.AddModelMesh<T>(model, meshIndex, material, instanceData, order);
 	}
 
 	template <typename T>
 	void Add(const MeshBatch::Mesh& mesh, const IMaterial& material, const T& instanceData, float order)
 	{
-		_Add(mesh, material, m_instanceDataAllocator.New<T>(instanceData), sizeof(T), order, typeid(T));
+		m_mainContext.Add<T>(mesh, material, instanceData, order);
 	}
 
-	void AddNoData(const MeshBatch::Mesh& mesh, const IMaterial& material, float order);
+	void AddNoData(const MeshBatch::Mesh& mesh, const IMaterial& material, float order)
+	{
+		m_mainContext.AddNoData(mesh, material, order);
+	}
 
-	void Begin();
+	/**
+	 * Starts recording a new batch. numRecordingContexts contexts are made available through GetRecordingContext,
+	 * which may be used to add instances from other threads until End is called.
+	 */
+	void Begin(uint32_t numRecordingContexts = 0);
+
+	// Returns one of the contexts created by Begin. Each context must only be used by one thread at a time.
+	RecordingContext& GetRecordingContext(uint32_t index)
+	{
+		EG_ASSERT(index < m_numRecordingContexts);
+		return *m_recordingContexts[index];
+	}
 
+	/**
+	 * Merges instances from recording contexts, sorts them by order and uploads instance data. Instances with equal
+	 * order are drawn in the order they were added. All threads must have finished adding to the contexts. Contexts
+	 * are merged in index order after the instances added directly to the batch, so the result does not depend on
+	 * thread timing.
+	 */
 	void End(CommandContext& cmdCtx);
 
 	void Draw(CommandContext& cmdCtx, void* drawArgs = nullptr) const;
 
 private:
-	void _AddModelMesh(
-		const class Model& model, size_t meshIndex, const IMaterial& material, const void* data, uint32_t dataSize,
-		float order, const std::type_info& instanceDataType);
-	void _Add(
-		const MeshBatch::Mesh& mesh, const IMaterial& material, const void* data, uint32_t dataSize, float order,
-		const std::type_info& instanceDataType);
+	// Instances added directly to the batch, contexts are merged into this one by End
+	RecordingContext m_mainContext;
 
-	struct Instance
+	std::vector<std::unique_ptr<RecordingContext>> m_recordingContexts;
+	uint32_t m_numRecordingContexts = 0;
+
+	// Consecutive instances with the same material and mesh, drawn with one instanced draw
+	struct OrderedDraw
 	{
-		float order;
 		MeshBatch::Mesh mesh;
 		const IMaterial* material;
 		uint32_t dataSize;
-		const void* data;
+		uint32_t numInstances;
+		uint32_t instanceDataOffset;
 	};
 
-	std::vector<Instance> m_instances;
-	LinearAllocator m_instanceDataAllocator;
+	std::vector<const Instance*> m_instances;
+	std::vector<RadixSortItem<uint32_t>> m_sortKeys;
+	std::vector<RadixSortItem<uint32_t>> m_sortScratch;
+	std::vector<OrderedDraw> m_draws;
 
-	uint32_t m_totalInstanceData = 0;
 	uint32_t m_instanceDataCapacity = 0;
 	eg::Buffer m_instanceDataBuffer;
 };
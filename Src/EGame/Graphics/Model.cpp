@@ -128,6 +128,7 @@ Model ModelBuilderUnformatted::CreateAndReset()
 
 	// Uploads vertices and indices
 	const uint64_t totalBytesToUpload = totalVerticesBytes + totalIndicesBytes;
+	model.m_gpuDataBytes = totalBytesToUpload;
 	if (totalBytesToUpload != 0)
 	{
 		Buffer uploadBuffer(
@@ -191,6 +192,7 @@ Model ModelBuilderUnformatted::CreateAndReset()
 
 		if (m_meshes[i].access != MeshAccess::GPUOnly)
 		{
+			model.m_cpuDataBytes += m_meshes[i].numVertices * m_vertexSize + m_meshes[i].numIndices * m_indexSize;
 			model.m_meshes[i].memory = std::move(m_meshes[i].memory);
 			model.m_meshes[i].indices =
 				static_cast<char*>(model.m_meshes[i].memory.get()) + m_meshes[i].numVertices * m_vertexSize;
@@ -123,6 +123,10 @@ public:
 
 	BufferRef IndexBuffer() const { return m_indexBuffer; }
 
+	// Bytes of vertex and index data kept in GPU buffers and in CPU memory (for meshes with CPU access)
+	uint64_t GPUDataBytes() const { return m_gpuDataBytes; }
+	uint64_t CPUDataBytes() const { return m_cpuDataBytes; }
+
 	eg::IndexType IndexType() const { return m_indexTypeE; }
 
 	std::type_index VertexType() const { return m_vertexType; }
@@ -146,6 +150,8 @@ private:
 
 	Buffer m_vertexBuffer;
 	Buffer m_indexBuffer;
+	uint64_t m_gpuDataBytes = 0;
+	uint64_t m_cpuDataBytes = 0;
 
 	std::vector<Animation> m_animations;
 };
@@ -0,0 +1,649 @@
+#include "NullGraphics.hpp"
+#include "../../Alloc/ObjectPool.hpp"
+#include "../../Assert.hpp"
+#include "../AbstractionHL.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace eg
+{
+static NullGraphicsStats stats;
+
+static int drawableWidth = 1280;
+static int drawableHeight = 720;
+
+const NullGraphicsStats& GetNullGraphicsStats()
+{
+	return stats;
+}
+
+void ResetNullGraphicsStats()
+{
+	stats = {};
+}
+
+void SetNullGraphicsDrawableSize(int width, int height)
+{
+	drawableWidth = width;
+	drawableHeight = height;
+}
+} // namespace eg
+
+namespace eg::graphics_api::null
+{
+struct Buffer
+{
+	std::unique_ptr<char[]> data;
+	uint64_t size;
+
+	void AssertRange(uint64_t begin, uint64_t length) const
+	{
+		if (begin + length > size)
+			EG_PANIC("Buffer range out of bounds, " << begin << "+" << length << " exceeds size " << size)
+	}
+};
+
+struct Texture
+{
+	Format format;
+	uint32_t width;
+	uint32_t height;
+	uint32_t depth;     // Only larger than one for 3D textures
+	uint32_t numLayers; // Includes cube map faces
+	uint64_t numBytes;
+
+	std::vector<std::vector<char>> mipLevels;
+
+	uint32_t MipWidth(uint32_t mipLevel) const { return std::max(width >> mipLevel, 1u); }
+	uint32_t MipHeight(uint32_t mipLevel) const { return std::max(height >> mipLevel, 1u); }
+	uint32_t MipLayers(uint32_t mipLevel) const { return depth > 1 ? std::max(depth >> mipLevel, 1u) : numLayers; }
+
+	uint64_t LayerBytes(uint32_t mipLevel) const
+	{
+		return GetImageByteSize(MipWidth(mipLevel), MipHeight(mipLevel), format);
+	}
+};
+
+struct Pipeline
+{
+	bool isCompute;
+};
+
+struct QueryPool
+{
+	QueryType type;
+	uint32_t queryCount;
+};
+
+// Samplers, shader modules, framebuffers and descriptor sets have no state, but still need unique handles
+struct Object
+{
+	uint32_t unused;
+};
+
+static ObjectPool<Buffer> bufferPool;
+static ObjectPool<Texture> texturePool;
+static ObjectPool<Pipeline> pipelinePool;
+static ObjectPool<QueryPool> queryPoolPool;
+static ObjectPool<Object> objectPool;
+
+static uint64_t allocatedBytes;
+static uint32_t numAllocations;
+
+static PipelineHandle boundPipeline;
+
+static std::string deviceName = "Null Device";
+
+static inline Buffer* UnwrapBuffer(BufferHandle handle)
+{
+	return reinterpret_cast<Buffer*>(handle);
+}
+
+// Texture views alias their texture, since nothing is ever sampled
+static inline Texture* UnwrapTexture(TextureHandle handle)
+{
+	return reinterpret_cast<Texture*>(handle);
+}
+
+template <typename HandleTp>
+static HandleTp NewObject()
+{
+	return reinterpret_cast<HandleTp>(objectPool.New());
+}
+
+template <typename HandleTp>
+static void DeleteObject(HandleTp handle)
+{
+	objectPool.Delete(reinterpret_cast<Object*>(handle));
+}
+
+bool Initialize(const GraphicsAPIInitArguments& initArguments)
+{
+	ResetNullGraphicsStats();
+	boundPipeline = nullptr;
+
+	// Headless programs initialize the graphics API directly instead of going through eg::Run, which is otherwise
+	//  what queries the device info
+	GetDeviceInfo(detail::graphicsDeviceInfo);
+
+	Log(LogLevel::Info, "gfx", "Using null graphics backend");
+	return true;
+}
+
+GraphicsMemoryStat GetMemoryStat()
+{
+	GraphicsMemoryStat memoryStat = {};
+	memoryStat.allocatedBytes = allocatedBytes;
+	memoryStat.numBlocks = numAllocations;
+	return memoryStat;
+}
+
+void GetDrawableSize(int& width, int& height)
+{
+	width = drawableWidth;
+	height = drawableHeight;
+}
+
+std::span<std::string> GetDeviceNames()
+{
+	return { &deviceName, 1 };
+}
+
+void GetDeviceInfo(GraphicsDeviceInfo& deviceInfo)
+{
+	deviceInfo.uniformBufferOffsetAlignment = 256;
+	deviceInfo.storageBufferOffsetAlignment = 256;
+	deviceInfo.maxTessellationPatchSize = 32;
+	deviceInfo.maxClipDistances = 8;
+	deviceInfo.maxMSAA = 8;
+	for (uint32_t i = 0; i < 3; i++)
+	{
+		deviceInfo.maxComputeWorkGroupSize[i] = 1024;
+		deviceInfo.maxComputeWorkGroupCount[i] = 65535;
+	}
+	deviceInfo.maxComputeWorkGroupInvocations = 1024;
+	deviceInfo.depthRange = DepthRange::ZeroToOne;
+	deviceInfo.geometryShader = true;
+	deviceInfo.computeShader = true;
+	deviceInfo.tessellation = true;
+	deviceInfo.persistentMappedBuffers = true;
+	deviceInfo.partialTextureViews = true;
+	deviceInfo.textureCubeMapArray = true;
+	deviceInfo.blockTextureCompression = true;
+	deviceInfo.timerTicksPerNS = 1.0f;
+	deviceInfo.concurrentResourceCreation = false;
+	deviceInfo.deviceName = deviceName;
+	deviceInfo.deviceVendorName = "EGame";
+}
+
+FormatCapabilities GetFormatCapabilities(Format format)
+{
+	FormatCapabilities capabilities = FormatCapabilities::SampledImage | FormatCapabilities::SampledImageFilterLinear;
+	if (GetFormatType(format) == FormatTypes::DepthStencil)
+		return capabilities | FormatCapabilities::DepthStencilAttachment;
+	if (IsCompressedFormat(format))
+		return capabilities;
+	return capabilities | FormatCapabilities::StorageImage | FormatCapabilities::StorageImageAtomic |
+	       FormatCapabilities::ColorAttachment | FormatCapabilities::ColorAttachmentBlend |
+	       FormatCapabilities::VertexAttribute;
+}
+
+void EndLoading() {}
+
+bool IsLoadingComplete()
+{
+	return true;
+}
+
+void BeginFrame() {}
+
+void EndFrame()
+{
+	stats.frames++;
+}
+
+void Shutdown()
+{
+	boundPipeline = nullptr;
+}
+
+void SetEnableVSync(bool enableVSync) {}
+
+void DeviceWaitIdle() {}
+
+BufferHandle CreateBuffer(const BufferCreateInfo& createInfo)
+{
+	Buffer* buffer = bufferPool.New();
+	buffer->size = createInfo.size;
+	buffer->data = std::make_unique<char[]>(createInfo.size);
+	if (createInfo.initialData != nullptr)
+	{
+		std::memcpy(buffer->data.get(), createInfo.initialData, createInfo.size);
+		stats.bytesUploaded += createInfo.size;
+	}
+
+	allocatedBytes += createInfo.size;
+	numAllocations++;
+	return reinterpret_cast<BufferHandle>(buffer);
+}
+
+void DestroyBuffer(BufferHandle handle)
+{
+	Buffer* buffer = UnwrapBuffer(handle);
+	allocatedBytes -= buffer->size;
+	numAllocations--;
+	bufferPool.Delete(buffer);
+}
+
+void BufferUsageHint(BufferHandle handle, BufferUsage newUsage, ShaderAccessFlags shaderAccessFlags) {}
+
+void BufferBarrier(CommandContextHandle ctx, BufferHandle handle, const eg::BufferBarrier& barrier) {}
+
+void* MapBuffer(BufferHandle handle, uint64_t offset, uint64_t range)
+{
+	Buffer* buffer = UnwrapBuffer(handle);
+	buffer->AssertRange(offset, range);
+	return buffer->data.get() + offset;
+}
+
+void FlushBuffer(BufferHandle handle, uint64_t modOffset, uint64_t modRange)
+{
+	Buffer* buffer = UnwrapBuffer(handle);
+	buffer->AssertRange(modOffset, modRange);
+	stats.bytesUploaded += modRange;
+}
+
+void InvalidateBuffer(BufferHandle handle, uint64_t modOffset, uint64_t modRange) {}
+
+void UpdateBuffer(CommandContextHandle, BufferHandle handle, uint64_t offset, uint64_t size, const void* data)
+{
+	Buffer* buffer = UnwrapBuffer(handle);
+	buffer->AssertRange(offset, size);
+	std::memcpy(buffer->data.get() + offset, data, size);
+	stats.bytesUploaded += size;
+}
+
+void FillBuffer(CommandContextHandle, BufferHandle handle, uint64_t offset, uint64_t size, uint32_t data)
+{
+	Buffer* buffer = UnwrapBuffer(handle);
+	buffer->AssertRange(offset, size);
+	for (uint64_t i = 0; i < size; i += sizeof(uint32_t))
+		std::memcpy(buffer->data.get() + offset + i, &data, std::min<uint64_t>(size - i, sizeof(uint32_t)));
+}
+
+void CopyBuffer(
+	CommandContextHandle, BufferHandle src, BufferHandle dst, uint64_t srcOffset, uint64_t dstOffset, uint64_t size)
+{
+	Buffer* srcBuffer = UnwrapBuffer(src);
+	Buffer* dstBuffer = UnwrapBuffer(dst);
+	srcBuffer->AssertRange(srcOffset, size);
+	dstBuffer->AssertRange(dstOffset, size);
+	std::memmove(dstBuffer->data.get() + dstOffset, srcBuffer->data.get() + srcOffset, size);
+	stats.bytesCopied += size;
+}
+
+void BindUniformBuffer(
+	CommandContextHandle, BufferHandle handle, uint32_t set, uint32_t binding, uint64_t offset, uint64_t range)
+{
+	UnwrapBuffer(handle)->AssertRange(offset, range);
+	stats.resourceBinds++;
+}
+
+void BindStorageBuffer(
+	CommandContextHandle, BufferHandle handle, uint32_t set, uint32_t binding, uint64_t offset, uint64_t range)
+{
+	UnwrapBuffer(handle)->AssertRange(offset, range);
+	stats.resourceBinds++;
+}
+
+static TextureHandle CreateTexture(const TextureCreateInfo& createInfo, uint32_t depth, uint32_t numLayers)
+{
+	Texture* texture = texturePool.New();
+	texture->format = createInfo.format;
+	texture->width = createInfo.width;
+	texture->height = std::max(createInfo.height, 1u);
+	texture->depth = depth;
+	texture->numLayers = numLayers;
+	texture->numBytes = 0;
+
+	texture->mipLevels.resize(std::max(createInfo.mipLevels, 1u));
+	for (uint32_t i = 0; i < texture->mipLevels.size(); i++)
+	{
+		texture->mipLevels[i].resize(texture->LayerBytes(i) * texture->MipLayers(i));
+		texture->numBytes += texture->mipLevels[i].size();
+	}
+
+	allocatedBytes += texture->numBytes;
+	numAllocations++;
+	return reinterpret_cast<TextureHandle>(texture);
+}
+
+TextureHandle CreateTexture2D(const TextureCreateInfo& createInfo)
+{
+	return CreateTexture(createInfo, 1, 1);
+}
+
+TextureHandle CreateTexture2DArray(const TextureCreateInfo& createInfo)
+{
+	return CreateTexture(createInfo, 1, createInfo.arrayLayers);
+}
+
+TextureHandle CreateTextureCube(const TextureCreateInfo& createInfo)
+{
+	return CreateTexture(createInfo, 1, 6);
+}
+
+TextureHandle CreateTextureCubeArray(const TextureCreateInfo& createInfo)
+{
+	return CreateTexture(createInfo, 1, 6 * createInfo.arrayLayers);
+}
+
+TextureHandle CreateTexture3D(const TextureCreateInfo& createInfo)
+{
+	return CreateTexture(createInfo, createInfo.depth, 1);
+}
+
+void DestroyTexture(TextureHandle handle)
+{
+	Texture* texture = UnwrapTexture(handle);
+	allocatedBytes -= texture->numBytes;
+	numAllocations--;
+	texturePool.Delete(texture);
+}
+
+void TextureUsageHint(TextureHandle handle, TextureUsage newUsage, ShaderAccessFlags shaderAccessFlags) {}
+
+void TextureBarrier(CommandContextHandle ctx, TextureHandle handle, const eg::TextureBarrier& barrier) {}
+
+/**
+ * Copies a region of a texture to or from tightly packed memory, which is the layout used for texture data in
+ * buffers. Block compressed formats are copied one row of blocks at a time.
+ */
+static void CopyTextureRegion(Texture& texture, const TextureRange& range, char* packed, bool toTexture)
+{
+	const uint32_t rowHeight = IsCompressedFormat(texture.format) ? 4 : 1;
+	const uint32_t numRows = (range.sizeY + rowHeight - 1) / rowHeight;
+	const uint32_t mipHeight = texture.MipHeight(range.mipLevel);
+	if (range.mipLevel >= texture.mipLevels.size() || range.offsetX + range.sizeX > texture.MipWidth(range.mipLevel) ||
+	    range.offsetY / rowHeight + numRows > (mipHeight + rowHeight - 1) / rowHeight ||
+	    range.offsetZ + range.sizeZ > texture.MipLayers(range.mipLevel))
+	{
+		EG_PANIC("Texture range out of bounds")
+	}
+
+	const uint64_t rowBytes = GetImageByteSize(texture.MipWidth(range.mipLevel), 1, texture.format);
+	const uint64_t layerBytes = texture.LayerBytes(range.mipLevel);
+	const uint64_t offsetXBytes = GetImageByteSize(range.offsetX, 1, texture.format);
+	const uint64_t packedRowBytes = GetImageByteSize(range.sizeX, 1, texture.format);
+	const uint64_t packedLayerBytes = GetImageByteSize(range.sizeX, range.sizeY, texture.format);
+
+	char* mipData = texture.mipLevels[range.mipLevel].data();
+	for (uint32_t z = 0; z < range.sizeZ; z++)
+	{
+		for (uint32_t row = 0; row < numRows; row++)
+		{
+			const uint64_t rowIndex = range.offsetY / rowHeight + row;
+			char* texturePtr = mipData + (range.offsetZ + z) * layerBytes + rowIndex * rowBytes + offsetXBytes;
+			char* packedPtr = packed + z * packedLayerBytes + row * packedRowBytes;
+			if (toTexture)
+				std::memcpy(texturePtr, packedPtr, packedRowBytes);
+			else
+				std::memcpy(packedPtr, texturePtr, packedRowBytes);
+		}
+	}
+}
+
+static uint64_t PackedRangeBytes(const TextureRange& range, Format format)
+{
+	return static_cast<uint64_t>(GetImageByteSize(range.sizeX, range.sizeY, format)) * range.sizeZ;
+}
+
+void SetTextureData(
+	CommandContextHandle ctx, TextureHandle handle, const TextureRange& range, BufferHandle buffer, uint64_t offset)
+{
+	Texture* texture = UnwrapTexture(handle);
+	const uint64_t numBytes = PackedRangeBytes(range, texture->format);
+	UnwrapBuffer(buffer)->AssertRange(offset, numBytes);
+	CopyTextureRegion(*texture, range, UnwrapBuffer(buffer)->data.get() + offset, true);
+	stats.bytesCopied += numBytes;
+}
+
+void GetTextureData(
+	CommandContextHandle ctx, TextureHandle handle, const TextureRange& range, BufferHandle buffer, uint64_t offset)
+{
+	Texture* texture = UnwrapTexture(handle);
+	const uint64_t numBytes = PackedRangeBytes(range, texture->format);
+	UnwrapBuffer(buffer)->AssertRange(offset, numBytes);
+	CopyTextureRegion(*texture, range, UnwrapBuffer(buffer)->data.get() + offset, false);
+	stats.bytesCopied += numBytes;
+}
+
+void CopyTextureData(
+	CommandContextHandle ctx, TextureHandle src, TextureHandle dst, const TextureRange& srcRange,
+	const TextureOffset& dstOffset)
+{
+	Texture* srcTexture = UnwrapTexture(src);
+	std::vector<char> packed(PackedRangeBytes(srcRange, srcTexture->format));
+	CopyTextureRegion(*srcTexture, srcRange, packed.data(), false);
+
+	const TextureRange dstRange = { dstOffset.offsetX, dstOffset.offsetY, dstOffset.offsetZ, srcRange.sizeX,
+		                            srcRange.sizeY,    srcRange.sizeZ,    dstOffset.mipLevel };
+	CopyTextureRegion(*UnwrapTexture(dst), dstRange, packed.data(), true);
+	stats.bytesCopied += packed.size();
+}
+
+// Mipmap generation, clears and resolves leave texture contents unchanged, since nothing reads them back for
+//  rendering purposes.
+void GenerateMipmaps(CommandContextHandle ctx, TextureHandle handle) {}
+
+void ClearColorTexture(CommandContextHandle ctx, TextureHandle texture, uint32_t mipLevel, const void* color) {}
+
+void ResolveTexture(CommandContextHandle ctx, TextureHandle src, TextureHandle dst, const ResolveRegion& region) {}
+
+void BindTexture(
+	CommandContextHandle ctx, TextureViewHandle textureView, SamplerHandle sampler, uint32_t set, uint32_t binding)
+{
+	stats.resourceBinds++;
+}
+
+void BindStorageImage(CommandContextHandle ctx, TextureViewHandle texture, uint32_t set, uint32_t binding)
+{
+	stats.resourceBinds++;
+}
+
+TextureViewHandle GetTextureView(
+	TextureHandle texture, TextureViewType viewType, const TextureSubresource& subresource, Format format)
+{
+	return reinterpret_cast<TextureViewHandle>(texture);
+}
+
+DescriptorSetHandle CreateDescriptorSetP(PipelineHandle pipeline, uint32_t set)
+{
+	return NewObject<DescriptorSetHandle>();
+}
+
+DescriptorSetHandle CreateDescriptorSetB(std::span<const DescriptorSetBinding> bindings)
+{
+	return NewObject<DescriptorSetHandle>();
+}
+
+void DestroyDescriptorSet(DescriptorSetHandle set)
+{
+	DeleteObject(set);
+}
+
+void BindTextureDS(TextureViewHandle textureView, SamplerHandle sampler, DescriptorSetHandle set, uint32_t binding) {}
+
+void BindStorageImageDS(TextureViewHandle textureView, DescriptorSetHandle set, uint32_t binding) {}
+
+void BindUniformBufferDS(
+	BufferHandle handle, DescriptorSetHandle set, uint32_t binding, uint64_t offset, uint64_t range)
+{
+	UnwrapBuffer(handle)->AssertRange(offset, range);
+}
+
+void BindStorageBufferDS(
+	BufferHandle handle, DescriptorSetHandle set, uint32_t binding, uint64_t offset, uint64_t range)
+{
+	UnwrapBuffer(handle)->AssertRange(offset, range);
+}
+
+void BindDescriptorSet(CommandContextHandle ctx, uint32_t set, DescriptorSetHandle handle)
+{
+	stats.resourceBinds++;
+}
+
+FramebufferHandle CreateFramebuffer(const FramebufferCreateInfo& createInfo)
+{
+	return NewObject<FramebufferHandle>();
+}
+
+void DestroyFramebuffer(FramebufferHandle framebuffer)
+{
+	DeleteObject(framebuffer);
+}
+
+SamplerHandle CreateSampler(const SamplerDescription& description)
+{
+	return NewObject<SamplerHandle>();
+}
+
+void DestroySampler(SamplerHandle handle)
+{
+	DeleteObject(handle);
+}
+
+ShaderModuleHandle CreateShaderModule(ShaderStage stage, std::span<const char> code)
+{
+	return NewObject<ShaderModuleHandle>();
+}
+
+void DestroyShaderModule(ShaderModuleHandle handle)
+{
+	DeleteObject(handle);
+}
+
+PipelineHandle CreateGraphicsPipeline(const GraphicsPipelineCreateInfo& createInfo)
+{
+	return reinterpret_cast<PipelineHandle>(pipelinePool.New(Pipeline{ false }));
+}
+
+PipelineHandle CreateComputePipeline(const ComputePipelineCreateInfo& createInfo)
+{
+	return reinterpret_cast<PipelineHandle>(pipelinePool.New(Pipeline{ true }));
+}
+
+void DestroyPipeline(PipelineHandle handle)
+{
+	if (boundPipeline == handle)
+		boundPipeline = nullptr;
+	pipelinePool.Delete(reinterpret_cast<Pipeline*>(handle));
+}
+
+void PipelineFramebufferFormatHint(PipelineHandle handle, const FramebufferFormatHint& hint) {}
+
+void BindPipeline(CommandContextHandle ctx, PipelineHandle handle)
+{
+	stats.pipelineBinds++;
+	if (boundPipeline != handle)
+	{
+		stats.pipelineSwitches++;
+		boundPipeline = handle;
+	}
+}
+
+void PushConstants(CommandContextHandle ctx, uint32_t offset, uint32_t range, const void* data)
+{
+	stats.pushConstantBytes += range;
+}
+
+void DispatchCompute(CommandContextHandle ctx, uint32_t sizeX, uint32_t sizeY, uint32_t sizeZ)
+{
+	stats.computeDispatches++;
+}
+
+void SetViewport(CommandContextHandle ctx, float x, float y, float w, float h) {}
+
+void SetScissor(CommandContextHandle, int x, int y, int w, int h) {}
+
+void SetStencilValue(CommandContextHandle, StencilValue kind, uint32_t val) {}
+
+void BeginRenderPass(CommandContextHandle ctx, const RenderPassBeginInfo& beginInfo)
+{
+	stats.renderPasses++;
+}
+
+void EndRenderPass(CommandContextHandle ctx) {}
+
+void BindIndexBuffer(CommandContextHandle, IndexType type, BufferHandle buffer, uint32_t offset)
+{
+	stats.resourceBinds++;
+}
+
+void BindVertexBuffer(CommandContextHandle, uint32_t binding, BufferHandle buffer, uint32_t offset)
+{
+	stats.resourceBinds++;
+}
+
+void Draw(
+	CommandContextHandle ctx, uint32_t firstVertex, uint32_t numVertices, uint32_t firstInstance, uint32_t numInstances)
+{
+	stats.drawCalls++;
+	stats.drawnVertices += static_cast<uint64_t>(numVertices) * numInstances;
+}
+
+void DrawIndexed(
+	CommandContextHandle, uint32_t firstIndex, uint32_t numIndices, uint32_t firstVertex, uint32_t firstInstance,
+	uint32_t numInstances)
+{
+	stats.drawCalls++;
+	stats.drawnVertices += static_cast<uint64_t>(numIndices) * numInstances;
+}
+
+QueryPoolHandle CreateQueryPool(QueryType type, uint32_t queryCount)
+{
+	return reinterpret_cast<QueryPoolHandle>(queryPoolPool.New(QueryPool{ type, queryCount }));
+}
+
+void DestroyQueryPool(QueryPoolHandle queryPool)
+{
+	queryPoolPool.Delete(reinterpret_cast<QueryPool*>(queryPool));
+}
+
+// Queries always complete immediately with a result of zero
+bool GetQueryResults(QueryPoolHandle queryPool, uint32_t firstQuery, uint32_t numQueries, uint64_t dataSize, void* data)
+{
+	std::memset(data, 0, dataSize);
+	return true;
+}
+
+void CopyQueryResults(
+	CommandContextHandle cctx, QueryPoolHandle queryPoolHandle, uint32_t firstQuery, uint32_t numQueries,
+	BufferHandle dstBufferHandle, uint64_t dstOffset)
+{
+	Buffer* buffer = UnwrapBuffer(dstBufferHandle);
+	const uint64_t numBytes = static_cast<uint64_t>(numQueries) * sizeof(uint64_t);
+	buffer->AssertRange(dstOffset, numBytes);
+	std::memset(buffer->data.get() + dstOffset, 0, numBytes);
+}
+
+void WriteTimestamp(CommandContextHandle cctx, QueryPoolHandle queryPoolHandle, uint32_t query) {}
+
+void ResetQueries(CommandContextHandle cctx, QueryPoolHandle queryPoolHandle, uint32_t firstQuery, uint32_t numQueries)
+{
+}
+
+void BeginQuery(CommandContextHandle cctx, QueryPoolHandle queryPoolHandle, uint32_t query) {}
+
+void EndQuery(CommandContextHandle cctx, QueryPoolHandle queryPoolHandle, uint32_t query) {}
+
+void DebugLabelBegin(CommandContextHandle ctx, const char* label, const float* color) {}
+
+void DebugLabelEnd(CommandContextHandle ctx) {}
+
+void DebugLabelInsert(CommandContextHandle ctx, const char* label, const float* color) {}
+} // namespace eg::graphics_api::null
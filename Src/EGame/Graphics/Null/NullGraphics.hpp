@@ -0,0 +1,40 @@
+#pragma once
+
+#include "../Abstraction.hpp"
+
+namespace eg
+{
+// Commands recorded by the null graphics backend since the last call to ResetNullGraphicsStats
+struct NullGraphicsStats
+{
+	uint64_t frames;
+	uint64_t drawCalls;
+	uint64_t drawnVertices; // Vertices or indices times instances
+	uint64_t computeDispatches;
+	uint64_t renderPasses;
+	uint64_t pipelineBinds;
+	uint64_t pipelineSwitches; // Pipeline binds that changed the bound pipeline
+	uint64_t resourceBinds;    // Vertex, index and uniform buffers, textures, storage resources and descriptor sets
+	uint64_t pushConstantBytes;
+	uint64_t bytesUploaded; // Initial buffer data, buffer updates and flushed ranges of mapped buffers
+	uint64_t bytesCopied;   // Buffer and texture copies, including texture uploads from staging buffers
+};
+
+EG_API const NullGraphicsStats& GetNullGraphicsStats();
+
+EG_API void ResetNullGraphicsStats();
+
+// Sets the size reported by GetDrawableSize, since the null backend does not render to a window
+EG_API void SetNullGraphicsDrawableSize(int width, int height);
+} // namespace eg
+
+namespace eg::graphics_api::null
+{
+bool Initialize(const GraphicsAPIInitArguments& initArguments);
+
+GraphicsMemoryStat GetMemoryStat();
+
+#define XM_ABSCALLBACK(name, ret, params) ret name params;
+#include "../AbstractionCallbacks.inl"
+#undef XM_ABSCALLBACK
+} // namespace eg::graphics_api::null
@@ -4,13 +4,14 @@
 #include "ParticleEmitterInstance.hpp"
 
 #include <algorithm>
+#include <bit>
 #include <bitset>
 #include <ctime>
 
 namespace eg
 {
-ParticleManager::ParticleManager()
-	: m_random(static_cast<std::mt19937::result_type>(std::time(nullptr)))
+ParticleManager::ParticleManager(ThreadPool& workerPool)
+	: m_random(static_cast<std::mt19937::result_type>(std::time(nullptr))), m_workerPool(workerPool)
 #ifndef __EMSCRIPTEN__
 	  ,
 	  m_thread(&ParticleManager::ThreadTarget, this)
@@ -33,12 +34,7 @@ ParticleManager::~ParticleManager()
 
 void ParticleManager::SetGravity(glm::vec3 gravity)
 {
-#ifdef EG_HAS_SIMD
-	alignas(16) float setBuf[4] = { gravity.x, gravity.y, gravity.z, 0.0f };
-	m_gravity = _mm_load_ps(setBuf);
-#else
-	m_gravity = glm::vec4(gravity, 0.0f);
-#endif
+	m_gravity = gravity;
 }
 
 void ParticleManager::SetTextureSize(int width, int height)
@@ -47,266 +43,417 @@ void ParticleManager::SetTextureSize(int width, int height)
 	m_texturePixelSize.y = 1.0f / static_cast<float>(height);
 }
 
-void ParticleManager::SimulateOneStep()
+void ParticleManager::UpdatePage(ParticlePage& page, float dt) const
 {
-	float dt = m_currentTime - m_lastSimTime;
-	m_lastSimTime = m_currentTime;
-
 #ifdef EG_HAS_SIMD
 	__m128 dt4 = _mm_set1_ps(dt);
 #endif
 
-	int particleCount = 0;
-
-	// Updates existing particles
-	for (ParticlePage* page : m_pages)
-	{
-		int numAlive = page->livingParticles;
-		int numAliveDiv4 = (page->livingParticles + 3) / 4;
+	int numAlive = page.livingParticles;
+	int numAliveDiv4 = (page.livingParticles + 3) / 4;
 
-		int numDead = 0;
-		int deadIndices[PARTICLES_PER_PAGE];
+	int numDead = 0;
+	int deadIndices[PARTICLES_PER_PAGE];
 
 #ifdef EG_HAS_SIMD
-		__m128* rotationM = reinterpret_cast<__m128*>(page->rotation);
-		__m128* angularVelocityM = reinterpret_cast<__m128*>(page->angularVelocity);
-		__m128* lifeProgressM = reinterpret_cast<__m128*>(page->lifeProgress);
-		__m128* oneOverLifeTimeM = reinterpret_cast<__m128*>(page->oneOverLifeTime);
+	__m128* rotationM = reinterpret_cast<__m128*>(page.rotation);
+	__m128* angularVelocityM = reinterpret_cast<__m128*>(page.angularVelocity);
+	__m128* lifeProgressM = reinterpret_cast<__m128*>(page.lifeProgress);
+	__m128* oneOverLifeTimeM = reinterpret_cast<__m128*>(page.oneOverLifeTime);
 
-		// Increases life progress
-		for (int i = numAliveDiv4 - 1; i >= 0; i--)
-		{
-			lifeProgressM[i] = _mm_add_ps(lifeProgressM[i], _mm_mul_ps(oneOverLifeTimeM[i], dt4));
+	// Increases life progress
+	for (int i = numAliveDiv4 - 1; i >= 0; i--)
+	{
+		lifeProgressM[i] = _mm_add_ps(lifeProgressM[i], _mm_mul_ps(oneOverLifeTimeM[i], dt4));
 
-			alignas(16) float lp[4];
-			_mm_store_ps(lp, lifeProgressM[i]);
+		alignas(16) float lp[4];
+		_mm_store_ps(lp, lifeProgressM[i]);
 
-			for (int j = 3; j >= 0; j--)
+		for (int j = 3; j >= 0; j--)
+		{
+			if (lp[j] > 1.0f)
 			{
-				if (lp[j] > 1.0f)
-				{
-					deadIndices[numDead++] = i * 4 + j;
-				}
+				deadIndices[numDead++] = i * 4 + j;
 			}
 		}
+	}
 #else
-		// Increases life progress
-		for (int i = numAlive - 1; i >= 0; i--)
+	// Increases life progress
+	for (int i = numAlive - 1; i >= 0; i--)
+	{
+		page.lifeProgress[i] += page.oneOverLifeTime[i] * dt;
+		if (page.lifeProgress[i] >= 1.0f)
 		{
-			page->lifeProgress[i] += page->oneOverLifeTime[i] * dt;
-			if (page->lifeProgress[i] >= 1.0f)
-			{
-				deadIndices[numDead++] = i;
-			}
+			deadIndices[numDead++] = i;
 		}
+	}
 #endif
 
-		// Removes dead particles
-		for (int i = 0; i < numDead; i++)
-		{
-			int idx = deadIndices[i];
-			if (static_cast<uint32_t>(idx) >= page->livingParticles)
-				continue;
+	// Removes dead particles
+	for (int i = 0; i < numDead; i++)
+	{
+		int idx = deadIndices[i];
+		if (static_cast<uint32_t>(idx) >= page.livingParticles)
+			continue;
 
-			numAlive--;
-			page->position[idx] = page->position[numAlive];
-			page->velocity[idx] = page->velocity[numAlive];
-			page->textureVariants[idx] = page->textureVariants[numAlive];
-			page->lifeProgress[idx] = page->lifeProgress[numAlive];
-			page->oneOverLifeTime[idx] = page->oneOverLifeTime[numAlive];
-			page->rotation[idx] = page->rotation[numAlive];
-			page->angularVelocity[idx] = page->angularVelocity[numAlive];
-			page->initialOpacity[idx] = page->initialOpacity[numAlive];
-			page->deltaOpacity[idx] = page->deltaOpacity[numAlive];
-			page->initialSize[idx] = page->initialSize[numAlive];
-			page->deltaSize[idx] = page->deltaSize[numAlive];
+		numAlive--;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			page.position[axis][idx] = page.position[axis][numAlive];
+			page.velocity[axis][idx] = page.velocity[axis][numAlive];
 		}
-		page->livingParticles = numAlive;
-		numAliveDiv4 = (numAlive + 3) / 4;
+		page.cullPlane[idx] = page.cullPlane[numAlive];
+		page.textureVariants[idx] = page.textureVariants[numAlive];
+		page.lifeProgress[idx] = page.lifeProgress[numAlive];
+		page.oneOverLifeTime[idx] = page.oneOverLifeTime[numAlive];
+		page.rotation[idx] = page.rotation[numAlive];
+		page.angularVelocity[idx] = page.angularVelocity[numAlive];
+		page.initialOpacity[idx] = page.initialOpacity[numAlive];
+		page.deltaOpacity[idx] = page.deltaOpacity[numAlive];
+		page.initialSize[idx] = page.initialSize[numAlive];
+		page.deltaSize[idx] = page.deltaSize[numAlive];
+	}
+	page.livingParticles = numAlive;
+	numAliveDiv4 = (numAlive + 3) / 4;
 
 #ifdef EG_HAS_SIMD
-		// Updates rotation and writes current size and opacity
-		__m128* initialOpacityM = reinterpret_cast<__m128*>(page->initialOpacity);
-		__m128* deltaOpacityM = reinterpret_cast<__m128*>(page->deltaOpacity);
-		__m128* currentOpacityM = reinterpret_cast<__m128*>(page->currentOpacity);
-		__m128* initialSizeM = reinterpret_cast<__m128*>(page->initialSize);
-		__m128* deltaSizeM = reinterpret_cast<__m128*>(page->deltaSize);
-		__m128* currentSizeM = reinterpret_cast<__m128*>(page->currentSize);
-		for (int i = 0; i < numAliveDiv4; i++)
-		{
-			rotationM[i] = _mm_add_ps(rotationM[i], _mm_mul_ps(angularVelocityM[i], dt4));
-			currentOpacityM[i] = _mm_mul_ps(
-				_mm_add_ps(initialOpacityM[i], _mm_mul_ps(deltaOpacityM[i], lifeProgressM[i])), _mm_set1_ps(255.0f));
-			currentSizeM[i] = _mm_add_ps(initialSizeM[i], _mm_mul_ps(deltaSizeM[i], lifeProgressM[i]));
-		}
+	// Updates rotation and writes current size and opacity
+	__m128* initialOpacityM = reinterpret_cast<__m128*>(page.initialOpacity);
+	__m128* deltaOpacityM = reinterpret_cast<__m128*>(page.deltaOpacity);
+	__m128* currentOpacityM = reinterpret_cast<__m128*>(page.currentOpacity);
+	__m128* initialSizeM = reinterpret_cast<__m128*>(page.initialSize);
+	__m128* deltaSizeM = reinterpret_cast<__m128*>(page.deltaSize);
+	__m128* currentSizeM = reinterpret_cast<__m128*>(page.currentSize);
+	for (int i = 0; i < numAliveDiv4; i++)
+	{
+		rotationM[i] = _mm_add_ps(rotationM[i], _mm_mul_ps(angularVelocityM[i], dt4));
+		currentOpacityM[i] = _mm_mul_ps(
+			_mm_add_ps(initialOpacityM[i], _mm_mul_ps(deltaOpacityM[i], lifeProgressM[i])), _mm_set1_ps(255.0f));
+		currentSizeM[i] = _mm_add_ps(initialSizeM[i], _mm_mul_ps(deltaSizeM[i], lifeProgressM[i]));
+	}
 
-		// Updates velocity and position
-		__m128 deltaVelGravity = _mm_mul_ps(m_gravity, _mm_set1_ps(dt * page->emitterType->gravity));
-		__m128 deltaVelDragFactor = _mm_set1_ps(-dt * page->emitterType->drag);
-		for (int i = 0; i < numAlive; i++)
+	// Updates velocity and position
+	const glm::vec3 deltaVelGravity = m_gravity * (dt * page.emitterType->gravity);
+	__m128 deltaVelDragFactor = _mm_set1_ps(-dt * page.emitterType->drag);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		__m128* positionM = reinterpret_cast<__m128*>(page.position[axis]);
+		__m128* velocityM = reinterpret_cast<__m128*>(page.velocity[axis]);
+		__m128 deltaVelGravityM = _mm_set1_ps(deltaVelGravity[axis]);
+		for (int i = 0; i < numAliveDiv4; i++)
 		{
-			__m128 vel = page->velocity[i];
+			__m128 vel = velocityM[i];
 			vel = _mm_add_ps(vel, _mm_mul_ps(deltaVelDragFactor, vel));
-			vel = _mm_add_ps(vel, deltaVelGravity);
-			page->position[i] = _mm_add_ps(page->position[i], _mm_mul_ps(vel, dt4));
-			page->velocity[i] = vel;
+			vel = _mm_add_ps(vel, deltaVelGravityM);
+			positionM[i] = _mm_add_ps(positionM[i], _mm_mul_ps(vel, dt4));
+			velocityM[i] = vel;
 		}
+	}
 #else
-		glm::vec4 deltaVelGravity = m_gravity * (dt * page->emitterType->gravity);
-		float deltaVelDragFactor = -dt * page->emitterType->drag;
-		for (int i = 0; i < numAlive; i++)
-		{
-			page->rotation[i] += page->angularVelocity[i] * dt;
-			page->currentOpacity[i] = (page->initialOpacity[i] + page->deltaOpacity[i] * page->lifeProgress[i]) * 255;
-			page->currentSize[i] = page->initialSize[i] + (page->deltaSize[i] * page->lifeProgress[i]);
+	glm::vec3 deltaVelGravity = m_gravity * (dt * page.emitterType->gravity);
+	float deltaVelDragFactor = -dt * page.emitterType->drag;
+	for (int i = 0; i < numAlive; i++)
+	{
+		page.rotation[i] += page.angularVelocity[i] * dt;
+		page.currentOpacity[i] = (page.initialOpacity[i] + page.deltaOpacity[i] * page.lifeProgress[i]) * 255;
+		page.currentSize[i] = page.initialSize[i] + (page.deltaSize[i] * page.lifeProgress[i]);
 
-			page->velocity[i] += deltaVelDragFactor * page->velocity[i];
-			page->velocity[i] += deltaVelGravity;
+		for (int axis = 0; axis < 3; axis++)
+		{
+			page.velocity[axis][i] += deltaVelDragFactor * page.velocity[axis][i];
+			page.velocity[axis][i] += deltaVelGravity[axis];
 
-			page->position[i] += page->velocity[i] * dt;
+			page.position[axis][i] += page.velocity[axis][i] * dt;
 		}
+	}
 #endif
+}
 
-		particleCount += numAlive;
+void ParticleManager::SpawnedParticles::Resize(uint32_t newCount)
+{
+	count = newCount;
+	const size_t paddedCount = RoundToNextMultiple<size_t>(newCount, 4);
+	for (int axis = 0; axis < 3; axis++)
+	{
+		position[axis].resize(paddedCount);
+		velocity[axis].resize(paddedCount);
 	}
+	transformFactor.resize(paddedCount);
+	oneOverLifeTime.resize(paddedCount);
+	rotation.resize(paddedCount);
+	angularVelocity.resize(paddedCount);
+	initialOpacity.resize(paddedCount);
+	deltaOpacity.resize(paddedCount);
+	initialSize.resize(paddedCount);
+	deltaSize.resize(paddedCount);
+}
 
-	for (int64_t i = ToInt64(m_pages.size()) - 1; i >= 0; i--)
+// Transforms vectors stored per axis by prev and next, interpolated by a factor per vector. The arrays must be
+//  padded to a multiple of 4 elements.
+static void TransformInterpolated(
+	const glm::mat4& prev, const glm::mat4& next, float w, const float* factors, float* x, float* y, float* z,
+	size_t count)
+{
+	const glm::mat4 delta = next - prev;
+#ifdef EG_HAS_SIMD
+	for (size_t i = 0; i < count; i += 4)
 	{
-		if (m_pages[i]->livingParticles == 0)
+		const __m128 v[4] = { _mm_load_ps(x + i), _mm_load_ps(y + i), _mm_load_ps(z + i), _mm_set1_ps(w) };
+		const __m128 factor = _mm_load_ps(factors + i);
+		__m128 result[3];
+		for (int r = 0; r < 3; r++)
 		{
-			m_emptyPages.push_back(m_pages[i]);
-			m_pages[i] = m_pages.back();
-			m_pages.pop_back();
+			__m128 prevV = _mm_setzero_ps();
+			__m128 deltaV = _mm_setzero_ps();
+			for (int c = 0; c < 4; c++)
+			{
+				prevV = _mm_add_ps(prevV, _mm_mul_ps(_mm_set1_ps(prev[c][r]), v[c]));
+				deltaV = _mm_add_ps(deltaV, _mm_mul_ps(_mm_set1_ps(delta[c][r]), v[c]));
+			}
+			result[r] = _mm_add_ps(prevV, _mm_mul_ps(deltaV, factor));
 		}
+		_mm_store_ps(x + i, result[0]);
+		_mm_store_ps(y + i, result[1]);
+		_mm_store_ps(z + i, result[2]);
+	}
+#else
+	for (size_t i = 0; i < count; i++)
+	{
+		const glm::vec4 v(x[i], y[i], z[i], w);
+		const glm::vec3 result(prev * v + (delta * v) * factors[i]);
+		x[i] = result.x;
+		y[i] = result.y;
+		z[i] = result.z;
 	}
+#endif
+}
 
-	// Spawns new particles
-	for (Emitter& emitter : m_btEmitters)
+void ParticleManager::GenerateParticles(Emitter& emitter, float dt) const
+{
+	if (!emitter.hasSetTransform)
+		return;
+	if (!emitter.hasSetOldTransform)
 	{
-		if (!emitter.hasSetTransform)
-			continue;
-		if (!emitter.hasSetOldTransform)
-		{
-			emitter.prevTransform = emitter.transform;
-			emitter.hasSetOldTransform = true;
-			continue;
-		}
+		emitter.prevTransform = emitter.transform;
+		emitter.hasSetOldTransform = true;
+		return;
+	}
+
+	float oldTSE = emitter.timeSinceEmit;
+	emitter.timeSinceEmit += dt;
 
-		float oldTSE = emitter.timeSinceEmit;
-		emitter.timeSinceEmit += dt;
+	uint32_t numEmissions = 0;
+	while (emitter.timeSinceEmit > emitter.emissionDelay)
+	{
+		emitter.timeSinceEmit -= emitter.emissionDelay;
+		numEmissions++;
+	}
+
+	SpawnedParticles& spawned = emitter.spawned;
+	spawned.Resize(numEmissions);
+	if (numEmissions != 0)
+	{
+		// Every attribute is generated for the whole batch at once, the padding is generated too so that the
+		//  transform can process 4 particles at a time
+		const size_t paddedCount = spawned.oneOverLifeTime.size();
+		auto Span = [&](std::vector<float>& values) { return std::span<float>(values.data(), paddedCount); };
 
-		int emissionsMade = 1;
-		while (emitter.timeSinceEmit > emitter.emissionDelay)
+		auto GenerateVec3 = [&](const Vec3Generator& generator, std::vector<float>* values)
 		{
-			ParticlePage* page = GetPage(*emitter.type);
-			EG_DEBUG_ASSERT(page->livingParticles < PARTICLES_PER_PAGE);
+			std::visit(
+				[&](const auto& gen)
+				{ gen.Generate(emitter.random, Span(values[0]), Span(values[1]), Span(values[2])); },
+				generator);
+		};
+		GenerateVec3(emitter.type->positionGenerator, spawned.position);
+		GenerateVec3(emitter.type->velocityGenerator, spawned.velocity);
+
+		for (size_t i = 0; i < paddedCount; i++)
+		{
+			const float emitTime = static_cast<float>(i + 1) * emitter.emissionDelay;
+			spawned.transformFactor[i] = glm::clamp((emitTime - oldTSE) / dt, 0.0f, 1.0f);
+		}
+		TransformInterpolated(
+			emitter.prevTransform, emitter.transform, 1, spawned.transformFactor.data(), spawned.position[0].data(),
+			spawned.position[1].data(), spawned.position[2].data(), paddedCount);
+		TransformInterpolated(
+			emitter.prevTransform, emitter.transform, 0, spawned.transformFactor.data(), spawned.velocity[0].data(),
+			spawned.velocity[1].data(), spawned.velocity[2].data(), paddedCount);
+
+		emitter.random.NextFloats(emitter.type->lifeTime, Span(spawned.oneOverLifeTime));
+		emitter.random.NextFloats(emitter.type->initialRotation, Span(spawned.rotation));
+		emitter.random.NextFloats(emitter.type->angularVelocity, Span(spawned.angularVelocity));
+		emitter.random.NextFloats(emitter.type->initialOpacity, Span(spawned.initialOpacity));
+		emitter.random.NextFloats(emitter.type->finalOpacity, Span(spawned.deltaOpacity));
+		emitter.random.NextFloats(emitter.type->initialSize, Span(spawned.initialSize));
+		emitter.random.NextFloats(emitter.type->finalSize, Span(spawned.deltaSize));
+
+		// The final opacity and size are relative to the initial ones
+		for (size_t i = 0; i < paddedCount; i++)
+		{
+			spawned.oneOverLifeTime[i] = 1.0f / spawned.oneOverLifeTime[i];
+			spawned.deltaOpacity[i] = (spawned.deltaOpacity[i] - 1.0f) * spawned.initialOpacity[i];
+			spawned.deltaSize[i] = (spawned.deltaSize[i] - 1.0f) * spawned.initialSize[i];
+		}
+	}
 
-			auto Vec3GenVisitor = [&](const auto& generator) { return generator(m_random); };
+	emitter.prevTransform = emitter.transform;
+}
 
-			uint32_t idx = page->livingParticles++;
+void ParticleManager::CullPage(ParticlePage& page) const
+{
+	const SphereSoA particleSpheres = { page.position[0], page.position[1], page.position[2], page.currentSize,
+		                                page.livingParticles };
+	m_frustum.IntersectsBatch(particleSpheres, page.visibleMask, std::span(page.cullPlane, page.livingParticles));
 
-			float transformIA =
-				glm::clamp((static_cast<float>(emissionsMade) * emitter.emissionDelay - oldTSE) / dt, 0.0f, 1.0f);
-			auto TransformV3 = [&](const glm::vec3& v, float w)
-			{
-				glm::vec3 prev(emitter.prevTransform * glm::vec4(v, w));
-				glm::vec3 next(emitter.transform * glm::vec4(v, w));
-				return glm::mix(prev, next, transformIA);
-			};
+	page.numVisible = 0;
+	for (uint32_t i = 0; i < (page.livingParticles + 63) / 64; i++)
+		page.numVisible += static_cast<uint32_t>(std::popcount(page.visibleMask[i]));
+}
 
-			glm::vec4 position(TransformV3(std::visit(Vec3GenVisitor, emitter.type->positionGenerator), 1), 1);
-			glm::vec4 velocity(TransformV3(std::visit(Vec3GenVisitor, emitter.type->velocityGenerator), 0), 0);
+void ParticleManager::WritePageSortItems(const ParticlePage& page, uint32_t pageIndex)
+{
+	uint32_t itemIndex = page.firstInstance;
+	for (int i = ToInt(page.livingParticles) - 1; i >= 0; i--)
+	{
+		if (((page.visibleMask[i / 64] >> (i % 64)) & 1) == 0)
+			continue;
 
-#ifdef EG_HAS_SIMD
-			page->position[idx] = _mm_loadu_ps(&position.x);
-			page->velocity[idx] = _mm_loadu_ps(&velocity.x);
-#else
-			page->position[idx] = position;
-			page->velocity[idx] = velocity;
-#endif
+		const glm::vec3 position(page.position[0][i], page.position[1][i], page.position[2][i]);
+		const float depth = glm::dot(position, m_cameraForward);
+		m_particleSortItems[itemIndex++] = { ~FloatToSortableBits(depth),
+			                                 (pageIndex << PARTICLE_INDEX_BITS) | static_cast<uint32_t>(i) };
+	}
+}
 
-			page->oneOverLifeTime[idx] = 1.0f / emitter.type->lifeTime(m_random);
-			page->lifeProgress[idx] = 0;
-			page->rotation[idx] = emitter.type->initialRotation(m_random);
-			page->angularVelocity[idx] = emitter.type->angularVelocity(m_random);
+void ParticleManager::WriteInstance(const ParticlePage& page, uint32_t particle, ParticleInstance& instance) const
+{
+	for (int j = 0; j < 3; j++)
+		instance.position[j] = page.position[j][particle];
+	instance.size = page.currentSize[particle];
+	instance.opacity = static_cast<uint8_t>(glm::clamp(page.currentOpacity[particle], 0.0f, 255.0f));
+	instance.additiveBlend = HasFlag(page.emitterType->flags, ParticleFlags::BlendAdditive) ? 0xFF : 0;
+	instance.sinR = static_cast<uint8_t>(((std::sin(page.rotation[particle]) + 1.0f) * 127.0f));
+	instance.cosR = static_cast<uint8_t>(((std::cos(page.rotation[particle]) + 1.0f) * 127.0f));
+
+	auto texVariant = page.emitterType->textureVariants[page.textureVariants[particle]];
+	int frame = std::min(
+		static_cast<int>(page.lifeProgress[particle] * static_cast<float>(texVariant.numFrames)),
+		texVariant.numFrames - 1);
+	int texX = texVariant.x + frame * texVariant.width;
+
+	instance.texCoord[0] = ToUNorm16(static_cast<float>(texX) * m_texturePixelSize.x);
+	instance.texCoord[1] = ToUNorm16(static_cast<float>(texVariant.y) * m_texturePixelSize.y);
+	instance.texCoord[2] = ToUNorm16(static_cast<float>(texX + texVariant.width) * m_texturePixelSize.x);
+	instance.texCoord[3] = ToUNorm16(static_cast<float>(texVariant.y + texVariant.height) * m_texturePixelSize.y);
+}
 
-			page->initialOpacity[idx] = emitter.type->initialOpacity(m_random);
-			float finalOpacity = emitter.type->finalOpacity(m_random) * page->initialOpacity[idx];
-			page->deltaOpacity[idx] = finalOpacity - page->initialOpacity[idx];
+void ParticleManager::SimulateOneStep()
+{
+	float dt = m_currentTime - m_lastSimTime;
+	m_lastSimTime = m_currentTime;
 
-			page->initialSize[idx] = emitter.type->initialSize(m_random);
-			float finalSize = emitter.type->finalSize(m_random) * page->initialSize[idx];
-			page->deltaSize[idx] = finalSize - page->initialSize[idx];
+	// Updates existing particles, pages are independent so they are distributed over the workers
+	m_workerPool.ParallelFor(
+		m_pages.size(), 1,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				UpdatePage(*m_pages[i], dt);
+		});
 
-			emitter.timeSinceEmit -= emitter.emissionDelay;
-			emissionsMade++;
+	for (int64_t i = ToInt64(m_pages.size()) - 1; i >= 0; i--)
+	{
+		if (m_pages[i]->livingParticles == 0)
+		{
+			m_emptyPages.push_back(m_pages[i]);
+			m_pages[i] = m_pages.back();
+			m_pages.pop_back();
 		}
-
-		emitter.prevTransform = emitter.transform;
 	}
 
-	// Writes visible particles to the particle instances list
-	m_particleInstances.clear();
-	m_particleDepths.clear();
-	for (ParticlePage* page : m_pages)
+	// Spawns new particles. Emitters generate particles in parallel using their own random generators, then the
+	//  particles are added to pages in emitter order, so the result does not depend on the number of workers.
+	m_workerPool.ParallelFor(
+		m_btEmitters.size(), 4,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				GenerateParticles(m_btEmitters[i], dt);
+		});
+	for (Emitter& emitter : m_btEmitters)
 	{
-		for (int i = page->livingParticles - 1; i >= 0; i--)
+		const SpawnedParticles& spawned = emitter.spawned;
+		for (uint32_t first = 0; first < spawned.count;)
 		{
-			bool draw = true;
-			for (int p = 0; p < 6; p++)
-			{
-				float dst = sse::Dot(page->position[i], m_frustumPlanes[p]);
-				if (dst < -page->currentSize[i])
-				{
-					draw = false;
-					break;
-				}
-			}
+			ParticlePage* page = GetPage(*emitter.type);
+			const uint32_t idx = page->livingParticles;
+			const uint32_t count =
+				std::min(spawned.count - first, static_cast<uint32_t>(PARTICLES_PER_PAGE) - page->livingParticles);
 
-			if (draw)
+			auto CopyAttribute = [&](const std::vector<float>& src, float* dst)
+			{ std::copy_n(src.data() + first, count, dst + idx); };
+			for (int axis = 0; axis < 3; axis++)
 			{
-				float depth = sse::Dot(page->position[i], m_cameraForward);
-				m_particleDepths.emplace_back(depth, m_particleInstances.size());
-
-				ParticleInstance& instance = m_particleInstances.emplace_back();
-#ifdef EG_HAS_SSE
-				_mm_storeu_ps(instance.position, page->position[i]);
-#else
-				for (int j = 0; j < 3; j++)
-					instance.position[j] = page->position[i][j];
-#endif
-				instance.size = page->currentSize[i];
-				instance.opacity = static_cast<uint8_t>(glm::clamp(page->currentOpacity[i], 0.0f, 255.0f));
-				instance.additiveBlend = HasFlag(page->emitterType->flags, ParticleFlags::BlendAdditive) ? 0xFF : 0;
-				instance.sinR = static_cast<uint8_t>(((std::sin(page->rotation[i]) + 1.0f) * 127.0f));
-				instance.cosR = static_cast<uint8_t>(((std::cos(page->rotation[i]) + 1.0f) * 127.0f));
-
-				auto texVariant = page->emitterType->textureVariants[page->textureVariants[i]];
-				int frame = std::min(
-					static_cast<int>(page->lifeProgress[i] * static_cast<float>(texVariant.numFrames)),
-					texVariant.numFrames - 1);
-				int texX = texVariant.x + frame * texVariant.width;
-
-				instance.texCoord[0] = ToUNorm16(static_cast<float>(texX) * m_texturePixelSize.x);
-				instance.texCoord[1] = ToUNorm16(static_cast<float>(texVariant.y) * m_texturePixelSize.y);
-				instance.texCoord[2] = ToUNorm16(static_cast<float>(texX + texVariant.width) * m_texturePixelSize.x);
-				instance.texCoord[3] =
-					ToUNorm16(static_cast<float>(texVariant.y + texVariant.height) * m_texturePixelSize.y);
+				CopyAttribute(spawned.position[axis], page->position[axis]);
+				CopyAttribute(spawned.velocity[axis], page->velocity[axis]);
 			}
+			CopyAttribute(spawned.oneOverLifeTime, page->oneOverLifeTime);
+			CopyAttribute(spawned.rotation, page->rotation);
+			CopyAttribute(spawned.angularVelocity, page->angularVelocity);
+			CopyAttribute(spawned.initialOpacity, page->initialOpacity);
+			CopyAttribute(spawned.deltaOpacity, page->deltaOpacity);
+			CopyAttribute(spawned.initialSize, page->initialSize);
+			CopyAttribute(spawned.deltaSize, page->deltaSize);
+			std::fill_n(page->lifeProgress + idx, count, 0.0f);
+			std::fill_n(page->cullPlane + idx, count, 0);
+			std::fill_n(page->textureVariants + idx, count, 0);
+
+			page->livingParticles += count;
+			first += count;
 		}
+		emitter.spawned.count = 0;
+	}
+
+	// Culls pages in parallel, then writes sort items for the visible particles of each page to its own range
+	m_workerPool.ParallelFor(
+		m_pages.size(), 1,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				CullPage(*m_pages[i]);
+		});
+
+	uint32_t numVisible = 0;
+	for (ParticlePage* page : m_pages)
+	{
+		page->firstInstance = numVisible;
+		numVisible += page->numVisible;
 	}
+	m_particleSortItems.resize(numVisible);
+	m_particleSortScratch.resize(numVisible);
+
+	m_workerPool.ParallelFor(
+		m_pages.size(), 1,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+				WritePageSortItems(*m_pages[i], UnsignedNarrow<uint32_t>(i));
+		});
 
-	std::sort(m_particleDepths.begin(), m_particleDepths.end(), std::greater<>());
+	RadixSort<uint32_t>(m_particleSortItems, m_particleSortScratch);
 
 	for (ParticleUploadBuffer& buffer : m_particleUploadBuffers)
 	{
 		buffer.reuseDelay = std::max(buffer.reuseDelay - 1, 0);
 	}
 
-	// Writes particles to upload buffers
+	// Splits the sorted particles into ranges that fit in the available upload buffers
+	m_uploadRanges.clear();
 	m_missingUploadBuffers = 0;
+	uint32_t numAssigned = 0;
 	size_t uploadBufferIdx = 0;
-	for (size_t i = 0; i < m_particleInstances.size(); i++)
+	while (numAssigned < numVisible)
 	{
 		while (uploadBufferIdx < m_particleUploadBuffers.size() &&
 		       (m_particleUploadBuffers[uploadBufferIdx].reuseDelay != 0 ||
@@ -320,15 +467,37 @@ void ParticleManager::SimulateOneStep()
 			if (!GetGraphicsDeviceInfo().concurrentResourceCreation)
 			{
 				m_missingUploadBuffers =
-					(m_particleInstances.size() - i + PARTICLES_PER_UPLOAD_BUFFER - 1) / PARTICLES_PER_UPLOAD_BUFFER;
+					(numVisible - numAssigned + PARTICLES_PER_UPLOAD_BUFFER - 1) / PARTICLES_PER_UPLOAD_BUFFER;
 				break;
 			}
 			AddUploadBuffer();
 		}
 
-		size_t pos = m_particleUploadBuffers[uploadBufferIdx].instancesWritten++;
-		m_particleUploadBuffers[uploadBufferIdx].instances[pos] = m_particleInstances[m_particleDepths[i].second];
+		ParticleUploadBuffer& buffer = m_particleUploadBuffers[uploadBufferIdx];
+		const uint32_t numInstances = std::min(
+			numVisible - numAssigned, static_cast<uint32_t>(PARTICLES_PER_UPLOAD_BUFFER - buffer.instancesWritten));
+		m_uploadRanges.push_back({ buffer.instances + buffer.instancesWritten, numAssigned, numInstances });
+		buffer.instancesWritten += static_cast<int>(numInstances);
+		numAssigned += numInstances;
 	}
+
+	// Writes the sorted particles straight into the mapped upload buffers
+	m_workerPool.ParallelFor(
+		m_uploadRanges.size(), 1,
+		[&](size_t begin, size_t end)
+		{
+			for (size_t i = begin; i < end; i++)
+			{
+				const UploadRange& range = m_uploadRanges[i];
+				for (uint32_t j = 0; j < range.numInstances; j++)
+				{
+					const uint32_t index = m_particleSortItems[range.firstSortItem + j].index;
+					WriteInstance(
+						*m_pages[index >> PARTICLE_INDEX_BITS], index & ((1U << PARTICLE_INDEX_BITS) - 1),
+						range.instances[j]);
+				}
+			}
+		});
 }
 
 #ifndef __EMSCRIPTEN__
@@ -450,31 +619,10 @@ void ParticleManager::Step(float dt, const Frustum& frustum, const glm::vec3& ca
 		m_deviceBuffer.UsageHint(BufferUsage::VertexBuffer);
 	}
 
-	alignas(16) float setBuf[4];
-
-	for (int i = 0; i < 6; i++)
-	{
-		const Plane& p = frustum.GetPlane(i);
-#ifdef EG_HAS_SIMD
-		setBuf[0] = p.GetNormal().x;
-		setBuf[1] = p.GetNormal().y;
-		setBuf[2] = p.GetNormal().z;
-		setBuf[3] = -p.GetDistance();
-		m_frustumPlanes[i] = _mm_load_ps(setBuf);
-#else
-		m_frustumPlanes[i] = glm::vec4(p.GetNormal(), -p.GetDistance());
-#endif
-	}
-
-#ifdef EG_HAS_SIMD
-	setBuf[0] = cameraForward.x;
-	setBuf[1] = cameraForward.y;
-	setBuf[2] = cameraForward.z;
-	setBuf[3] = 0.0f;
-	m_cameraForward = _mm_load_ps(setBuf);
-#else
-	m_cameraForward = glm::vec4(cameraForward, 0.0f);
-#endif
+	// Particles are always tested against all six planes
+	m_frustum = frustum;
+	m_frustum.SetEnableZCheck(true);
+	m_cameraForward = cameraForward;
 
 	m_currentTime += dt;
 
@@ -515,6 +663,7 @@ ParticleEmitterInstance ParticleManager::AddEmitter(const ParticleEmitterType& t
 	emitter.gravity = glm::vec3(0, -5, 0);
 	emitter.transform = glm::mat4(1.0f);
 	emitter.prevTransform = glm::mat4(1.0f);
+	emitter.random.Seed(m_random());
 	emitter.UpdateEmissionDelay(1.0f);
 	return ParticleEmitterInstance(emitter.id, this);
 }
@@ -2,9 +2,11 @@
 
 #include "../../API.hpp"
 #include "../../Geometry/Frustum.hpp"
-#include "../../SIMD.hpp"
+#include "../../RadixSort.hpp"
+#include "../../ThreadPool.hpp"
 #include "../AbstractionHL.hpp"
 #include "ParticleEmitterType.hpp"
+#include "ParticleRandom.hpp"
 
 #include <condition_variable>
 #include <thread>
@@ -27,7 +29,12 @@ class EG_API ParticleManager
 public:
 	friend class ParticleEmitterInstance;
 
-	ParticleManager();
+	/**
+	 * Simulation runs on a background thread, which updates, culls and writes pages in parallel with the workers of
+	 * workerPool. The pool must outlive the manager, with a pool without workers everything runs on the background
+	 * thread.
+	 */
+	explicit ParticleManager(ThreadPool& workerPool = SharedThreadPool());
 
 	~ParticleManager();
 
@@ -49,6 +56,25 @@ public:
 	class ParticleEmitterInstance AddEmitter(const ParticleEmitterType& type);
 
 private:
+	// Particles spawned by an emitter in one step, stored per attribute so that they are generated in batches.
+	//  The attribute lists are padded to a multiple of 4 particles.
+	struct SpawnedParticles
+	{
+		uint32_t count = 0;
+		std::vector<float> position[3];
+		std::vector<float> velocity[3];
+		std::vector<float> transformFactor; // Interpolation factor between the previous and current transform
+		std::vector<float> oneOverLifeTime;
+		std::vector<float> rotation;
+		std::vector<float> angularVelocity;
+		std::vector<float> initialOpacity;
+		std::vector<float> deltaOpacity;
+		std::vector<float> initialSize;
+		std::vector<float> deltaSize;
+
+		void Resize(uint32_t newCount);
+	};
+
 	struct Emitter
 	{
 		uint32_t id;
@@ -62,6 +88,12 @@ private:
 		glm::mat4 transform;
 		glm::mat4 prevTransform;
 
+		// Each emitter has its own generator so that emitters can spawn particles in parallel
+		ParticleRandom random;
+
+		// Particles spawned in the current step, added to pages after all emitters have run
+		SpawnedParticles spawned;
+
 		void UpdateEmissionDelay(float rateFactor) { emissionDelay = 1.0f / (type->emissionRate * rateFactor); }
 	};
 
@@ -70,13 +102,17 @@ private:
 	void SimulateOneStep();
 
 	static constexpr size_t PARTICLES_PER_PAGE = 1024;
+	static constexpr uint32_t PARTICLE_INDEX_BITS = 10;
+	static_assert((1 << PARTICLE_INDEX_BITS) == PARTICLES_PER_PAGE);
 
 	struct ParticlePage
 	{
 		const ParticleEmitterType* emitterType;
 		uint32_t livingParticles;
-		m128 position[PARTICLES_PER_PAGE];
-		m128 velocity[PARTICLES_PER_PAGE];
+		// Positions and velocities are stored per axis, so that they can be updated and culled 4 at a time
+		alignas(16) float position[3][PARTICLES_PER_PAGE];
+		alignas(16) float velocity[3][PARTICLES_PER_PAGE];
+		uint8_t cullPlane[PARTICLES_PER_PAGE]; // Frustum plane that last culled each particle
 		uint8_t textureVariants[PARTICLES_PER_PAGE];
 		alignas(16) float lifeProgress[PARTICLES_PER_PAGE];
 		alignas(16) float oneOverLifeTime[PARTICLES_PER_PAGE];
@@ -88,8 +124,18 @@ private:
 		alignas(16) float initialSize[PARTICLES_PER_PAGE];
 		alignas(16) float deltaSize[PARTICLES_PER_PAGE];
 		alignas(16) float currentSize[PARTICLES_PER_PAGE];
+
+		uint64_t visibleMask[PARTICLES_PER_PAGE / 64];
+		uint32_t numVisible;
+		uint32_t firstInstance; // Index of the page's first visible particle in the sort items list
 	};
 
+	void UpdatePage(ParticlePage& page, float dt) const;
+	void GenerateParticles(Emitter& emitter, float dt) const;
+	void CullPage(ParticlePage& page) const;
+	void WritePageSortItems(const ParticlePage& page, uint32_t pageIndex);
+	void WriteInstance(const ParticlePage& page, uint32_t particle, ParticleInstance& instance) const;
+
 	static constexpr size_t PARTICLES_PER_UPLOAD_BUFFER = 16384;
 
 	struct ParticleUploadBuffer
@@ -102,6 +148,15 @@ private:
 	std::vector<ParticleUploadBuffer> m_particleUploadBuffers;
 	size_t m_missingUploadBuffers = 0;
 
+	// A contiguous run of sorted particles that is written to one upload buffer
+	struct UploadRange
+	{
+		ParticleInstance* instances;
+		uint32_t firstSortItem;
+		uint32_t numInstances;
+	};
+	std::vector<UploadRange> m_uploadRanges;
+
 	uint32_t m_deviceBufferCapacity = 0;
 	Buffer m_deviceBuffer;
 
@@ -115,8 +170,10 @@ private:
 	std::vector<ParticlePage*> m_pages;
 	std::vector<ParticlePage*> m_emptyPages;
 
-	std::vector<ParticleInstance> m_particleInstances;
-	std::vector<std::pair<float, int>> m_particleDepths;
+	// Visible particles keyed by inverted depth (so that the farthest is drawn first), the index is the page index
+	//  shifted by PARTICLE_INDEX_BITS combined with the particle's index within the page
+	std::vector<RadixSortItem<uint32_t>> m_particleSortItems;
+	std::vector<RadixSortItem<uint32_t>> m_particleSortScratch;
 
 	uint32_t m_nextEmitterId = 0;
 	std::vector<Emitter> m_btEmitters;
@@ -124,15 +181,17 @@ private:
 
 	float m_currentTime = 0;
 	float m_lastSimTime = 0;
-	m128 m_frustumPlanes[6];
-	m128 m_cameraForward;
+	Frustum m_frustum;
+	glm::vec3 m_cameraForward;
 
-	m128 m_gravity;
+	glm::vec3 m_gravity;
 
 	glm::vec2 m_texturePixelSize;
 
 	std::mt19937 m_random;
 
+	ThreadPool& m_workerPool;
+
 #ifndef __EMSCRIPTEN__
 	void ThreadTarget();
 
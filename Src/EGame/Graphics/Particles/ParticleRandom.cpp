@@ -0,0 +1,96 @@
+#include "ParticleRandom.hpp"
+#include "../../SIMD.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace eg
+{
+// Converts the top 24 bits of a random integer to a float in [0, 1)
+static constexpr float RANDOM_TO_FLOAT = 1.0f / 16777216.0f;
+
+void ParticleRandom::Seed(uint64_t seed)
+{
+	// Expands the seed with splitmix64, which never produces the all zero state that xoshiro can not leave
+	for (uint32_t lane = 0; lane < 4; lane++)
+	{
+		for (uint32_t word = 0; word < 4; word += 2)
+		{
+			seed += 0x9E3779B97F4A7C15ULL;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			z ^= z >> 31;
+			m_state[word][lane] = static_cast<uint32_t>(z);
+			m_state[word + 1][lane] = static_cast<uint32_t>(z >> 32);
+		}
+	}
+}
+
+void ParticleRandom::NextFloats(std::span<float> values)
+{
+#ifdef EG_HAS_SIMD
+	__m128i s0 = _mm_load_si128(reinterpret_cast<const __m128i*>(m_state[0]));
+	__m128i s1 = _mm_load_si128(reinterpret_cast<const __m128i*>(m_state[1]));
+	__m128i s2 = _mm_load_si128(reinterpret_cast<const __m128i*>(m_state[2]));
+	__m128i s3 = _mm_load_si128(reinterpret_cast<const __m128i*>(m_state[3]));
+	const __m128 scale = _mm_set1_ps(RANDOM_TO_FLOAT);
+
+	for (size_t i = 0; i < values.size(); i += 4)
+	{
+		const __m128i result = _mm_add_epi32(s0, s3);
+		const __m128i t = _mm_slli_epi32(s1, 9);
+		s2 = _mm_xor_si128(s2, s0);
+		s3 = _mm_xor_si128(s3, s1);
+		s1 = _mm_xor_si128(s1, s2);
+		s0 = _mm_xor_si128(s0, s3);
+		s2 = _mm_xor_si128(s2, t);
+		s3 = _mm_or_si128(_mm_slli_epi32(s3, 11), _mm_srli_epi32(s3, 21));
+
+		const __m128 floats = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(result, 8)), scale);
+		if (values.size() - i >= 4)
+		{
+			_mm_storeu_ps(values.data() + i, floats);
+		}
+		else
+		{
+			alignas(16) float remaining[4];
+			_mm_store_ps(remaining, floats);
+			std::copy_n(remaining, values.size() - i, values.data() + i);
+		}
+	}
+
+	_mm_store_si128(reinterpret_cast<__m128i*>(m_state[0]), s0);
+	_mm_store_si128(reinterpret_cast<__m128i*>(m_state[1]), s1);
+	_mm_store_si128(reinterpret_cast<__m128i*>(m_state[2]), s2);
+	_mm_store_si128(reinterpret_cast<__m128i*>(m_state[3]), s3);
+#else
+	for (size_t i = 0; i < values.size(); i += 4)
+	{
+		for (uint32_t lane = 0; lane < 4; lane++)
+		{
+			const uint32_t result = m_state[0][lane] + m_state[3][lane];
+			const uint32_t t = m_state[1][lane] << 9;
+			m_state[2][lane] ^= m_state[0][lane];
+			m_state[3][lane] ^= m_state[1][lane];
+			m_state[1][lane] ^= m_state[2][lane];
+			m_state[0][lane] ^= m_state[3][lane];
+			m_state[2][lane] ^= t;
+			m_state[3][lane] = (m_state[3][lane] << 11) | (m_state[3][lane] >> 21);
+
+			if (i + lane < values.size())
+				values[i + lane] = static_cast<float>(result >> 8) * RANDOM_TO_FLOAT;
+		}
+	}
+#endif
+}
+
+void ParticleRandom::NextFloats(const std::uniform_real_distribution<float>& dist, std::span<float> values)
+{
+	NextFloats(values);
+	const float min = dist.a();
+	const float range = dist.b() - dist.a();
+	for (float& value : values)
+		value = min + value * range;
+}
+} // namespace eg
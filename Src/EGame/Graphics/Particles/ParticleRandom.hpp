@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../../API.hpp"
+
+#include <cstdint>
+#include <random>
+#include <span>
+
+namespace eg
+{
+/**
+ * Random number generator for spawning particles in batches. Runs four interleaved xoshiro128+ generators, so that
+ * four numbers are produced at a time with SSE. The scalar fallback produces the same sequence.
+ */
+class EG_API ParticleRandom
+{
+public:
+	ParticleRandom() { Seed(0); }
+
+	explicit ParticleRandom(uint64_t seed) { Seed(seed); }
+
+	void Seed(uint64_t seed);
+
+	// Fills values with uniformly distributed floats in [0, 1)
+	void NextFloats(std::span<float> values);
+
+	// Fills values with uniformly distributed floats in the range of dist
+	void NextFloats(const std::uniform_real_distribution<float>& dist, std::span<float> values);
+
+private:
+	// State word, then generator
+	alignas(16) uint32_t m_state[4][4];
+};
+} // namespace eg
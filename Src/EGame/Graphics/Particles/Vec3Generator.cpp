@@ -1,6 +1,8 @@
 #include "Vec3Generator.hpp"
+#include "../../Assert.hpp"
 #include "../../Utils.hpp"
 
+#include <algorithm>
 #include <istream>
 #include <ostream>
 
@@ -21,6 +23,28 @@ glm::vec3 SphereVec3Generator::operator()(std::mt19937& rand) const
 	return sphere.position + (r * sphere.radius) * glm::vec3(sinPhi * cosTheta, sinPhi * sinTheta, cosPhi);
 }
 
+void SphereVec3Generator::Generate(
+	ParticleRandom& rand, std::span<float> x, std::span<float> y, std::span<float> z) const
+{
+	EG_ASSERT(y.size() == x.size() && z.size() == x.size());
+
+	// The output spans are first filled with the random numbers for theta, cos(phi) and the radius
+	rand.NextFloats(x);
+	rand.NextFloats(y);
+	rand.NextFloats(z);
+
+	for (size_t i = 0; i < x.size(); i++)
+	{
+		const float theta = x[i] * TWO_PI;
+		const float cosPhi = y[i] * 2 - 1;
+		const float sinPhi = std::sqrt(std::max(1 - cosPhi * cosPhi, 0.0f));
+		const float r = std::cbrt(z[i]) * sphere.radius;
+		x[i] = sphere.position.x + r * sinPhi * std::cos(theta);
+		y[i] = sphere.position.y + r * sinPhi * std::sin(theta);
+		z[i] = sphere.position.z + r * cosPhi;
+	}
+}
+
 void SphereVec3Generator::Read(std::istream& stream)
 {
 	float data[4];
@@ -2,8 +2,10 @@
 
 #include "../../API.hpp"
 #include "../../Geometry/Sphere.hpp"
+#include "ParticleRandom.hpp"
 
 #include <random>
+#include <span>
 #include <variant>
 
 namespace eg
@@ -16,6 +18,9 @@ struct EG_API SphereVec3Generator
 
 	glm::vec3 operator()(std::mt19937& rand) const;
 
+	// Generates x.size() vectors at once, stored per axis. All three spans must have the same size.
+	void Generate(ParticleRandom& rand, std::span<float> x, std::span<float> y, std::span<float> z) const;
+
 	void Read(std::istream& stream);
 	void Write(std::ostream& stream) const;
 
@@ -61,6 +61,7 @@ struct CommandContextState
 	bool viewportOutOfDate;
 	bool scissorOutOfDate;
 	struct AbstractPipeline* pipeline;
+	bool skipDraws; // Set when the bound pipeline is still compiling and draws should be dropped
 	uint32_t framebufferW;
 	uint32_t framebufferH;
 };
@@ -85,6 +86,8 @@ struct Context
 	VkQueue backgroundQueue;
 	VkDebugUtilsMessengerEXT debugMessenger;
 	VmaAllocator allocator;
+	VkPipelineCache pipelineCache;
+	bool hasPipelineCreationFeedback;
 
 	VkCommandPool mainCommandPool;
 
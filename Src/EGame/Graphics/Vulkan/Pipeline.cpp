@@ -17,6 +17,7 @@ void BindPipeline(CommandContextHandle cc, PipelineHandle handle)
 	RefResource(cc, *pipeline);
 	CommandContextState& ctxState = GetCtxState(cc);
 	ctxState.pipeline = pipeline;
+	ctxState.skipDraws = false;
 
 	pipeline->Bind(cc);
 }
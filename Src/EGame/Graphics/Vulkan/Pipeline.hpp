@@ -27,6 +27,9 @@ struct AbstractPipeline : public Resource
 	virtual void Free() override = 0;
 };
 
+// Waits for pipelines that are compiling in the background and stops the compile workers
+void WaitForPipelineCompilation();
+
 void InitShaderStageCreateInfo(
 	VkPipelineShaderStageCreateInfo& createInfo, LinearAllocator& linAllocator, const ShaderStageInfo& stageInfo,
 	VkShaderStageFlagBits stage);
@@ -0,0 +1,217 @@
+#ifndef EG_NO_VULKAN
+#include "PipelineCache.hpp"
+#include "../../Assert.hpp"
+#include "../../Core.hpp"
+#include "../../IOUtils.hpp"
+#include "../../Platform/FileSystem.hpp"
+#include "../../String.hpp"
+#include "../../Utils.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+namespace eg::graphics_api::vk
+{
+static const char pipelineCacheMagic[] = { -1, 'E', 'P', 'C' };
+static constexpr uint32_t PIPELINE_CACHE_FILE_VERSION = 1;
+
+// Size of the header that vulkan puts at the start of pipeline cache data (VK_PIPELINE_CACHE_HEADER_VERSION_ONE)
+static constexpr size_t VK_CACHE_HEADER_SIZE = 16 + VK_UUID_SIZE;
+
+static std::string pipelineCachePath;
+static VkPhysicalDeviceProperties cacheDeviceProperties;
+
+static struct
+{
+	uint64_t loadedBytes;
+	std::atomic<uint64_t> hits;
+	std::atomic<uint64_t> misses;
+	std::atomic<uint64_t> unreported;
+	std::atomic<int64_t> creationTimeNs;
+} cacheStats;
+
+// Checks that the data was created by this device and driver. The file header is checked against the driver
+// version, which vulkan's own header does not include.
+static bool IsCacheDataCompatible(std::istream& stream, std::vector<char>& dataOut)
+{
+	char magic[sizeof(pipelineCacheMagic)];
+	stream.read(magic, sizeof(magic));
+	if (!stream || std::memcmp(magic, pipelineCacheMagic, sizeof(magic)) != 0)
+		return false;
+
+	uint8_t uuid[VK_UUID_SIZE];
+	const uint32_t version = BinRead<uint32_t>(stream);
+	const uint32_t vendorID = BinRead<uint32_t>(stream);
+	const uint32_t deviceID = BinRead<uint32_t>(stream);
+	const uint32_t driverVersion = BinRead<uint32_t>(stream);
+	stream.read(reinterpret_cast<char*>(uuid), VK_UUID_SIZE);
+	const uint64_t dataSize = BinRead<uint64_t>(stream);
+	if (!stream || version != PIPELINE_CACHE_FILE_VERSION || vendorID != cacheDeviceProperties.vendorID ||
+	    deviceID != cacheDeviceProperties.deviceID || driverVersion != cacheDeviceProperties.driverVersion ||
+	    std::memcmp(uuid, cacheDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) != 0 ||
+	    dataSize < VK_CACHE_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	dataOut.resize(dataSize);
+	stream.read(dataOut.data(), static_cast<std::streamsize>(dataSize));
+	if (!stream)
+		return false;
+
+	// Also checks vulkan's header, drivers are supposed to reject mismatching data but not all of them do
+	uint32_t vkHeader[4];
+	std::memcpy(vkHeader, dataOut.data(), sizeof(vkHeader));
+	return vkHeader[0] >= VK_CACHE_HEADER_SIZE && vkHeader[0] <= dataSize &&
+	       vkHeader[1] == VK_PIPELINE_CACHE_HEADER_VERSION_ONE && vkHeader[2] == cacheDeviceProperties.vendorID &&
+	       vkHeader[3] == cacheDeviceProperties.deviceID &&
+	       std::memcmp(dataOut.data() + 16, cacheDeviceProperties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void InitPipelineCache(const VkPhysicalDeviceProperties& deviceProperties)
+{
+	cacheDeviceProperties = deviceProperties;
+	pipelineCachePath = Concat({ AppDataPath(), GameName(), "/VkPipelineCache.bin" });
+
+	std::vector<char> initialData;
+	if (std::ifstream stream(pipelineCachePath, std::ios::binary); stream)
+	{
+		if (!IsCacheDataCompatible(stream, initialData))
+		{
+			Log(LogLevel::Info, "vk", "Ignoring pipeline cache from a different device or driver");
+			initialData.clear();
+		}
+	}
+
+	VkPipelineCacheCreateInfo createInfo = { VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+	createInfo.initialDataSize = initialData.size();
+	createInfo.pInitialData = initialData.data();
+	VkResult result = vkCreatePipelineCache(ctx.device, &createInfo, nullptr, &ctx.pipelineCache);
+	if (result != VK_SUCCESS && !initialData.empty())
+	{
+		Log(LogLevel::Warning, "vk", "Pipeline cache creation from cached data failed with status: {0}", result);
+		initialData.clear();
+		createInfo.initialDataSize = 0;
+		createInfo.pInitialData = nullptr;
+		result = vkCreatePipelineCache(ctx.device, &createInfo, nullptr, &ctx.pipelineCache);
+	}
+	CheckRes(result);
+
+	cacheStats.loadedBytes = initialData.size();
+	if (!initialData.empty())
+		Log(LogLevel::Info, "vk", "Loaded pipeline cache ({0} KiB)", initialData.size() / 1024);
+}
+
+void SaveAndDestroyPipelineCache()
+{
+	// Nothing was added to the cache if every pipeline was a hit
+	const bool cacheChanged = cacheStats.misses != 0 || cacheStats.unreported != 0 || cacheStats.loadedBytes == 0;
+
+	size_t dataSize = 0;
+	std::vector<char> data;
+	if (cacheChanged && vkGetPipelineCacheData(ctx.device, ctx.pipelineCache, &dataSize, nullptr) == VK_SUCCESS)
+	{
+		data.resize(dataSize);
+		if (vkGetPipelineCacheData(ctx.device, ctx.pipelineCache, &dataSize, data.data()) != VK_SUCCESS)
+			dataSize = 0;
+	}
+
+	vkDestroyPipelineCache(ctx.device, ctx.pipelineCache, nullptr);
+	ctx.pipelineCache = VK_NULL_HANDLE;
+
+	if (dataSize < VK_CACHE_HEADER_SIZE)
+		return;
+
+	CreateDirectories(ParentPath(pipelineCachePath));
+
+	// Writes to a temporary file first so that a crash while writing does not leave a truncated cache behind
+	const std::string tempPath = pipelineCachePath + ".tmp";
+	{
+		std::ofstream stream(tempPath, std::ios::binary);
+		if (!stream)
+		{
+			Log(LogLevel::Warning, "vk", "Failed to open pipeline cache file for writing: '{0}'", tempPath);
+			return;
+		}
+
+		stream.write(pipelineCacheMagic, sizeof(pipelineCacheMagic));
+		BinWrite(stream, PIPELINE_CACHE_FILE_VERSION);
+		BinWrite(stream, cacheDeviceProperties.vendorID);
+		BinWrite(stream, cacheDeviceProperties.deviceID);
+		BinWrite(stream, cacheDeviceProperties.driverVersion);
+		stream.write(reinterpret_cast<const char*>(cacheDeviceProperties.pipelineCacheUUID), VK_UUID_SIZE);
+		BinWrite(stream, static_cast<uint64_t>(dataSize));
+		stream.write(data.data(), static_cast<std::streamsize>(dataSize));
+	}
+
+	std::error_code ec;
+	std::filesystem::rename(tempPath, pipelineCachePath, ec);
+	if (ec)
+		Log(LogLevel::Warning, "vk", "Failed to write pipeline cache file: {0}", ec.message());
+}
+
+PipelineCacheStat GetPipelineCacheStat()
+{
+	PipelineCacheStat stat;
+	stat.loadedBytes = cacheStats.loadedBytes;
+	stat.hits = cacheStats.hits;
+	stat.misses = cacheStats.misses;
+	stat.unreported = cacheStats.unreported;
+	stat.creationTimeNs = cacheStats.creationTimeNs;
+	return stat;
+}
+
+template <typename CreateInfoTp, typename CreateCallback>
+static VkPipeline CreatePipelineWithFeedback(CreateInfoTp createInfo, uint32_t numStages, CreateCallback create)
+{
+	VkPipelineCreationFeedbackEXT pipelineFeedback = {};
+	VkPipelineCreationFeedbackEXT stageFeedback[8] = {};
+	VkPipelineCreationFeedbackCreateInfoEXT feedbackCreateInfo = {
+		VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO_EXT
+	};
+	if (ctx.hasPipelineCreationFeedback)
+	{
+		EG_ASSERT(numStages <= std::size(stageFeedback));
+		feedbackCreateInfo.pNext = createInfo.pNext;
+		feedbackCreateInfo.pPipelineCreationFeedback = &pipelineFeedback;
+		feedbackCreateInfo.pipelineStageCreationFeedbackCount = numStages;
+		feedbackCreateInfo.pPipelineStageCreationFeedbacks = stageFeedback;
+		createInfo.pNext = &feedbackCreateInfo;
+	}
+
+	const int64_t beginTime = NanoTime();
+	VkPipeline pipeline;
+	CheckRes(create(createInfo, pipeline));
+	cacheStats.creationTimeNs += NanoTime() - beginTime;
+
+	if (!(pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT_EXT))
+		cacheStats.unreported++;
+	else if (pipelineFeedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT_EXT)
+		cacheStats.hits++;
+	else
+		cacheStats.misses++;
+
+	return pipeline;
+}
+
+VkPipeline CreateCachedGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo)
+{
+	return CreatePipelineWithFeedback(
+		createInfo, createInfo.stageCount,
+		[](const VkGraphicsPipelineCreateInfo& ci, VkPipeline& pipeline)
+		{ return vkCreateGraphicsPipelines(ctx.device, ctx.pipelineCache, 1, &ci, nullptr, &pipeline); });
+}
+
+VkPipeline CreateCachedComputePipeline(const VkComputePipelineCreateInfo& createInfo)
+{
+	return CreatePipelineWithFeedback(
+		createInfo, 1,
+		[](const VkComputePipelineCreateInfo& ci, VkPipeline& pipeline)
+		{ return vkCreateComputePipelines(ctx.device, ctx.pipelineCache, 1, &ci, nullptr, &pipeline); });
+}
+} // namespace eg::graphics_api::vk
+
+#endif
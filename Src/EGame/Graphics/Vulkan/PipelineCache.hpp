@@ -0,0 +1,20 @@
+#pragma once
+
+#ifndef EG_NO_VULKAN
+
+#include "Common.hpp"
+
+namespace eg::graphics_api::vk
+{
+// Creates ctx.pipelineCache, seeded from the cache file if it was written by the same device and driver
+void InitPipelineCache(const VkPhysicalDeviceProperties& deviceProperties);
+
+// Writes the pipeline cache back to the cache file and destroys it
+void SaveAndDestroyPipelineCache();
+
+// Pipeline creation through ctx.pipelineCache, counting cache hits if the driver reports them
+VkPipeline CreateCachedGraphicsPipeline(const VkGraphicsPipelineCreateInfo& createInfo);
+VkPipeline CreateCachedComputePipeline(const VkComputePipelineCreateInfo& createInfo);
+} // namespace eg::graphics_api::vk
+
+#endif
@@ -1,6 +1,7 @@
 #ifndef EG_NO_VULKAN
 #include "../../Alloc/ObjectPool.hpp"
 #include "Pipeline.hpp"
+#include "PipelineCache.hpp"
 #include "ShaderModule.hpp"
 
 namespace eg::graphics_api::vk
@@ -46,8 +47,7 @@ PipelineHandle CreateComputePipeline(const ComputePipelineCreateInfo& createInfo
 		pipeline->shaderModule->bindings, createInfo.setBindModes, pipeline->shaderModule->pushConstantBytes);
 	pipelineCreateInfo.layout = pipeline->pipelineLayout;
 
-	CheckRes(
-		vkCreateComputePipelines(ctx.device, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &pipeline->pipeline));
+	pipeline->pipeline = CreateCachedComputePipeline(pipelineCreateInfo);
 
 	if (createInfo.label != nullptr)
 	{
@@ -1,23 +1,45 @@
 #ifndef EG_NO_VULKAN
 #include "../../Alloc/ObjectPool.hpp"
 #include "../../Assert.hpp"
+#include "../../ThreadPool.hpp"
 #include "Common.hpp"
 #include "Framebuffer.hpp"
 #include "Pipeline.hpp"
+#include "PipelineCache.hpp"
 #include "RenderPasses.hpp"
 #include "ShaderModule.hpp"
 #include "Translation.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <iomanip>
+#include <memory>
 #include <spirv_cross.hpp>
 
 namespace eg::graphics_api::vk
 {
+struct PipelineCompileJob
+{
+	static constexpr uint32_t QUEUED = 0;
+	static constexpr uint32_t COMPILING = 1;
+	static constexpr uint32_t DONE = 2;
+
+	struct GraphicsPipeline* pipeline;
+	FramebufferFormat format;
+	VkRenderPass renderPass;
+	VkPipeline basePipeline;
+
+	std::atomic<uint32_t> state{ QUEUED };
+	VkPipeline result = VK_NULL_HANDLE; // Stays null if the job is cancelled
+};
+
 struct FramebufferPipeline
 {
 	size_t framebufferHash;
 	VkPipeline pipeline;
+
+	// Set while the variant is being compiled in the background
+	std::shared_ptr<PipelineCompileJob> pendingJob;
 };
 
 struct GraphicsPipeline : AbstractPipeline
@@ -25,7 +47,9 @@ struct GraphicsPipeline : AbstractPipeline
 	ShaderModule* shaderModules[5];
 	GraphicsPipeline* basePipeline;
 	std::vector<FramebufferPipeline> pipelines;
+	std::mutex variantsMutex;
 	bool enableScissorTest;
+	bool skipDrawsWhileCompiling;
 
 	bool enableAlphaToCoverage;
 	bool enableAlphaToOne;
@@ -57,8 +81,24 @@ struct GraphicsPipeline : AbstractPipeline
 
 static ConcurrentObjectPool<GraphicsPipeline> gfxPipelinesPool;
 
+static void CancelOrWaitForCompileJob(PipelineCompileJob& job);
+
 void GraphicsPipeline::Free()
 {
+	// Jobs that have not started are cancelled and running ones are waited for, since they use the layout and
+	//  shader modules released below. All jobs are finished before any variant is destroyed, as running jobs may
+	//  use another variant as their base pipeline.
+	for (const FramebufferPipeline& pipeline : pipelines)
+	{
+		if (pipeline.pendingJob != nullptr)
+			CancelOrWaitForCompileJob(*pipeline.pendingJob);
+	}
+	for (const FramebufferPipeline& pipeline : pipelines)
+	{
+		vkDestroyPipeline(
+			ctx.device, pipeline.pendingJob != nullptr ? pipeline.pendingJob->result : pipeline.pipeline, nullptr);
+	}
+
 	if (basePipeline != nullptr)
 	{
 		basePipeline->UnRef();
@@ -74,11 +114,6 @@ void GraphicsPipeline::Free()
 			module->UnRef();
 	}
 
-	for (const FramebufferPipeline& pipeline : pipelines)
-	{
-		vkDestroyPipeline(ctx.device, pipeline.pipeline, nullptr);
-	}
-
 	gfxPipelinesPool.Delete(this);
 }
 
@@ -98,6 +133,7 @@ PipelineHandle CreateGraphicsPipeline(const GraphicsPipelineCreateInfo& createIn
 	GraphicsPipeline* pipeline = gfxPipelinesPool.New();
 	pipeline->refCount = 1;
 	pipeline->enableScissorTest = createInfo.enableScissorTest;
+	pipeline->skipDrawsWhileCompiling = createInfo.skipDrawsWhileCompiling;
 	pipeline->bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
 	std::fill_n(pipeline->shaderModules, 5, nullptr);
 
@@ -327,32 +363,30 @@ static const VkPipelineViewportStateCreateInfo g_viewportStateCI = {
 	/* pScissors     */ &g_dummyScissor
 };
 
-static VkPipeline MaybeCreatePipelineFramebufferVariant(
-	const FramebufferFormat& format, GraphicsPipeline& pipeline, bool warn)
-{
-	auto it = std::lower_bound(
-		pipeline.pipelines.begin(), pipeline.pipelines.end(), format.hash,
-		[&](const FramebufferPipeline& a, size_t b) { return a.framebufferHash < b; });
-
-	if (it != pipeline.pipelines.end() && it->framebufferHash == format.hash)
-		return it->pipeline;
-
-	int64_t beginTime = NanoTime();
+static std::mutex compilePoolMutex;
+static std::unique_ptr<ThreadPool> compilePool;
 
-	RenderPassDescription renderPassDescription;
-	renderPassDescription.numResolveColorAttachments = 0;
-	renderPassDescription.numColorAttachments = 0;
-	renderPassDescription.depthAttachment.format = format.depthStencilFormat;
-	renderPassDescription.depthAttachment.samples = format.sampleCount;
-	renderPassDescription.depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-	for (uint32_t i = 0; i < 8 && format.colorFormats[i] != VK_FORMAT_UNDEFINED; i++)
+static ThreadPool& GetCompilePool()
+{
+	std::lock_guard<std::mutex> lock(compilePoolMutex);
+	if (compilePool == nullptr)
 	{
-		renderPassDescription.colorAttachments[i].format = format.colorFormats[i];
-		renderPassDescription.colorAttachments[i].samples = format.sampleCount;
-		renderPassDescription.colorAttachments[i].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
-		renderPassDescription.numColorAttachments++;
+		// Leaves most workers free so that background compilation does not compete with the game's own threads
+		compilePool = std::make_unique<ThreadPool>(std::max(ThreadPool::DefaultNumWorkers() / 2, 1U));
 	}
+	return *compilePool;
+}
 
+void WaitForPipelineCompilation()
+{
+	std::lock_guard<std::mutex> lock(compilePoolMutex);
+	compilePool.reset();
+}
+
+static VkPipeline CompilePipelineVariant(
+	const FramebufferFormat& format, const GraphicsPipeline& pipeline, VkRenderPass renderPass,
+	VkPipeline basePipeline)
+{
 	VkPipelineInputAssemblyStateCreateInfo iaState = { VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
 	iaState.topology = pipeline.topology;
 
@@ -408,57 +442,168 @@ static VkPipeline MaybeCreatePipelineFramebufferVariant(
 		/* pColorBlendState    */ &pipeline.colorBlendStateCI,
 		/* pDynamicState       */ &dynamicStateCI,
 		/* layout              */ pipeline.pipelineLayout,
-		/* renderPass          */ GetRenderPass(renderPassDescription, true),
+		/* renderPass          */ renderPass,
 		/* subpass             */ 0,
 		/* basePipelineHandle  */ VK_NULL_HANDLE,
 		/* basePipelineIndex   */ -1
 	};
 
-	if (!pipeline.pipelines.empty())
+	if (basePipeline != VK_NULL_HANDLE)
 	{
 		vkCreateInfo.flags |= VK_PIPELINE_CREATE_DERIVATIVE_BIT;
-		vkCreateInfo.basePipelineHandle = pipeline.pipelines.front().pipeline;
+		vkCreateInfo.basePipelineHandle = basePipeline;
 	}
 
-	FramebufferPipeline& fbPipeline = *pipeline.pipelines.emplace(it);
-	fbPipeline.framebufferHash = format.hash;
-	CheckRes(vkCreateGraphicsPipelines(ctx.device, VK_NULL_HANDLE, 1, &vkCreateInfo, nullptr, &fbPipeline.pipeline));
+	VkPipeline vkPipeline = CreateCachedGraphicsPipeline(vkCreateInfo);
 
-	int64_t elapsed = NanoTime() - beginTime;
+	if (!pipeline.label.empty())
+	{
+		SetObjectName(reinterpret_cast<uint64_t>(vkPipeline), VK_OBJECT_TYPE_PIPELINE, pipeline.label.c_str());
+	}
+
+	return vkPipeline;
+}
+
+// Compiles the variant if no thread has started the job yet
+static bool TryRunCompileJob(PipelineCompileJob& job)
+{
+	uint32_t expected = PipelineCompileJob::QUEUED;
+	if (!job.state.compare_exchange_strong(expected, PipelineCompileJob::COMPILING))
+		return false;
+
+	job.result = CompilePipelineVariant(job.format, *job.pipeline, job.renderPass, job.basePipeline);
+	job.state.store(PipelineCompileJob::DONE);
+	job.state.notify_all();
+	return true;
+}
 
-	if (warn)
+static void WaitForCompileJob(PipelineCompileJob& job)
+{
+	uint32_t state = job.state.load();
+	while (state != PipelineCompileJob::DONE)
 	{
-		std::ostringstream msgStream;
-		msgStream << "Creating pipeline on demand stalled CPU for " << std::setprecision(2)
-				  << (static_cast<double>(elapsed) * 1E-6) << "ms.";
+		job.state.wait(state);
+		state = job.state.load();
+	}
+}
+
+static void RunOrWaitForCompileJob(PipelineCompileJob& job)
+{
+	if (!TryRunCompileJob(job))
+		WaitForCompileJob(job);
+}
+
+static void CancelOrWaitForCompileJob(PipelineCompileJob& job)
+{
+	uint32_t expected = PipelineCompileJob::QUEUED;
+	if (!job.state.compare_exchange_strong(expected, PipelineCompileJob::DONE))
+		WaitForCompileJob(job);
+}
+
+/**
+ * Gets the variant of the pipeline for the given framebuffer format. Variants that do not exist yet are compiled on
+ * the compile pool if wait is false, in which case VK_NULL_HANDLE is returned until the variant is ready. If wait is
+ * true, a missing variant is compiled on the calling thread, stalling the CPU.
+ */
+static VkPipeline GetPipelineFramebufferVariant(const FramebufferFormat& format, GraphicsPipeline& pipeline, bool wait)
+{
+	std::lock_guard<std::mutex> lock(pipeline.variantsMutex);
+
+	auto it = std::lower_bound(
+		pipeline.pipelines.begin(), pipeline.pipelines.end(), format.hash,
+		[&](const FramebufferPipeline& a, size_t b) { return a.framebufferHash < b; });
+
+	if (it != pipeline.pipelines.end() && it->framebufferHash == format.hash)
+	{
+		if (it->pendingJob != nullptr)
+		{
+			if (it->pendingJob->state.load() != PipelineCompileJob::DONE)
+			{
+				if (!wait)
+					return VK_NULL_HANDLE;
+				RunOrWaitForCompileJob(*it->pendingJob);
+			}
+			it->pipeline = it->pendingJob->result;
+			it->pendingJob.reset();
+		}
+		return it->pipeline;
+	}
+
+	int64_t beginTime = NanoTime();
 
-		if (!pipeline.label.empty())
-			msgStream << " Label:'" << pipeline.label << "'.";
+	RenderPassDescription renderPassDescription;
+	renderPassDescription.numResolveColorAttachments = 0;
+	renderPassDescription.numColorAttachments = 0;
+	renderPassDescription.depthAttachment.format = format.depthStencilFormat;
+	renderPassDescription.depthAttachment.samples = format.sampleCount;
+	renderPassDescription.depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+	for (uint32_t i = 0; i < 8 && format.colorFormats[i] != VK_FORMAT_UNDEFINED; i++)
+	{
+		renderPassDescription.colorAttachments[i].format = format.colorFormats[i];
+		renderPassDescription.colorAttachments[i].samples = format.sampleCount;
+		renderPassDescription.colorAttachments[i].finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+		renderPassDescription.numColorAttachments++;
+	}
+	VkRenderPass renderPass = GetRenderPass(renderPassDescription, true);
 
-		msgStream << "\n  FB format: ";
-		for (size_t i = 0; i < MAX_COLOR_ATTACHMENTS; i++)
+	// Variants are derived from the first one that has finished compiling
+	VkPipeline basePipeline = VK_NULL_HANDLE;
+	for (const FramebufferPipeline& variant : pipeline.pipelines)
+	{
+		if (variant.pendingJob == nullptr)
 		{
-			if (format.colorFormats[i] != VK_FORMAT_UNDEFINED)
-				msgStream << FormatToString(format.originalColorFormats[i]) << " ";
+			basePipeline = variant.pipeline;
+			break;
 		}
-		if (format.depthStencilFormat != VK_FORMAT_UNDEFINED)
-			msgStream << FormatToString(format.originalDepthStencilFormat) << " ";
-		msgStream << "x" << static_cast<int>(format.sampleCount);
+	}
+
+	FramebufferPipeline& fbPipeline = *pipeline.pipelines.emplace(it);
+	fbPipeline.framebufferHash = format.hash;
 
-		Log(LogLevel::Warning, "vk", "{0}", msgStream.str());
+	if (!wait)
+	{
+		auto job = std::make_shared<PipelineCompileJob>();
+		job->pipeline = &pipeline;
+		job->format = format;
+		job->renderPass = renderPass;
+		job->basePipeline = basePipeline;
+		fbPipeline.pipeline = VK_NULL_HANDLE;
+		fbPipeline.pendingJob = job;
+
+		// The job does not reference the pipeline, Free cancels or waits for it instead
+		GetCompilePool().Add([job] { TryRunCompileJob(*job); });
+		return VK_NULL_HANDLE;
 	}
 
+	fbPipeline.pipeline = CompilePipelineVariant(format, pipeline, renderPass, basePipeline);
+
+	int64_t elapsed = NanoTime() - beginTime;
+
+	std::ostringstream msgStream;
+	msgStream << "Creating pipeline on demand stalled CPU for " << std::setprecision(2)
+			  << (static_cast<double>(elapsed) * 1E-6) << "ms.";
+
 	if (!pipeline.label.empty())
+		msgStream << " Label:'" << pipeline.label << "'.";
+
+	msgStream << "\n  FB format: ";
+	for (size_t i = 0; i < MAX_COLOR_ATTACHMENTS; i++)
 	{
-		SetObjectName(reinterpret_cast<uint64_t>(fbPipeline.pipeline), VK_OBJECT_TYPE_PIPELINE, pipeline.label.c_str());
+		if (format.colorFormats[i] != VK_FORMAT_UNDEFINED)
+			msgStream << FormatToString(format.originalColorFormats[i]) << " ";
 	}
+	if (format.depthStencilFormat != VK_FORMAT_UNDEFINED)
+		msgStream << FormatToString(format.originalDepthStencilFormat) << " ";
+	msgStream << "x" << static_cast<int>(format.sampleCount);
+
+	Log(LogLevel::Warning, "vk", "{0}", msgStream.str());
 
 	return fbPipeline.pipeline;
 }
 
 void PipelineFramebufferFormatHint(PipelineHandle handle, const FramebufferFormatHint& hint)
 {
-	MaybeCreatePipelineFramebufferVariant(
+	GetPipelineFramebufferVariant(
 		FramebufferFormat::FromHint(hint), *static_cast<GraphicsPipeline*>(UnwrapPipeline(handle)), false);
 }
 
@@ -531,7 +676,12 @@ void SetStencilValue(CommandContextHandle cc, StencilValue kind, uint32_t val)
 void GraphicsPipeline::Bind(CommandContextHandle cc)
 {
 	VkCommandBuffer cb = GetCB(cc);
-	VkPipeline vkPipeline = MaybeCreatePipelineFramebufferVariant(currentFBFormat, *this, true);
+	VkPipeline vkPipeline = GetPipelineFramebufferVariant(currentFBFormat, *this, !skipDrawsWhileCompiling);
+	if (vkPipeline == VK_NULL_HANDLE)
+	{
+		GetCtxState(cc).skipDraws = true;
+		return;
+	}
 	vkCmdBindPipeline(cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vkPipeline);
 
 	if (!enableScissorTest)
@@ -544,6 +694,8 @@ void GraphicsPipeline::Bind(CommandContextHandle cc)
 void Draw(
 	CommandContextHandle cc, uint32_t firstVertex, uint32_t numVertices, uint32_t firstInstance, uint32_t numInstances)
 {
+	if (GetCtxState(cc).skipDraws)
+		return;
 	CommitDynamicState(cc);
 	vkCmdDraw(GetCB(cc), numVertices, numInstances, firstVertex, firstInstance);
 }
@@ -552,6 +704,8 @@ void DrawIndexed(
 	CommandContextHandle cc, uint32_t firstIndex, uint32_t numIndices, uint32_t firstVertex, uint32_t firstInstance,
 	uint32_t numInstances)
 {
+	if (GetCtxState(cc).skipDraws)
+		return;
 	CommitDynamicState(cc);
 	vkCmdDrawIndexed(GetCB(cc), numIndices, numInstances, firstIndex, firstVertex, firstInstance);
 }
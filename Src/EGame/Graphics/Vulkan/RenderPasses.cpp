@@ -3,6 +3,7 @@
 #include "../../Assert.hpp"
 
 #include <list>
+#include <mutex>
 
 namespace eg::graphics_api::vk
 {
@@ -28,8 +29,13 @@ struct RenderPass
 
 static std::list<RenderPass> renderPasses;
 
+// Pipeline variants look up render passes on the threads that hint framebuffer formats
+static std::mutex renderPassesMutex;
+
 VkRenderPass GetRenderPass(const RenderPassDescription& description, bool allowCompatible)
 {
+	std::lock_guard<std::mutex> lock(renderPassesMutex);
+
 	// Searches for a compatible render pass in the cache.
 	for (const RenderPass& renderPass : renderPasses)
 	{
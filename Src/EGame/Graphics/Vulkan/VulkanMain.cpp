@@ -6,6 +6,8 @@
 #include "Buffer.hpp"
 #include "CachedDescriptorSetLayout.hpp"
 #include "Common.hpp"
+#include "Pipeline.hpp"
+#include "PipelineCache.hpp"
 #include "RenderPasses.hpp"
 #include "Sampler.hpp"
 #include "Translation.hpp"
@@ -258,7 +260,8 @@ static const char* REQUIRED_DEVICE_EXTENSIONS[] = {
 static const char* OPTIONAL_DEVICE_EXTENSIONS[] = { VK_KHR_GET_MEMORY_REQUIREMENTS_2_EXTENSION_NAME,
 	                                                VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME,
 	                                                VK_KHR_DEPTH_STENCIL_RESOLVE_EXTENSION_NAME,
-	                                                VK_KHR_BIND_MEMORY_2_EXTENSION_NAME };
+	                                                VK_KHR_BIND_MEMORY_2_EXTENSION_NAME,
+	                                                VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME };
 
 static inline std::string_view GetVendorName(uint32_t id)
 {
@@ -628,6 +631,7 @@ bool Initialize(const GraphicsAPIInitArguments& initArguments)
 	                                    OptionalExtensionAvailable(VK_KHR_DEDICATED_ALLOCATION_EXTENSION_NAME) &&
 	                                    !renderdoc::IsPresent();
 	const bool hasBindMemory2 = OptionalExtensionAvailable(VK_KHR_BIND_MEMORY_2_EXTENSION_NAME);
+	ctx.hasPipelineCreationFeedback = OptionalExtensionAvailable(VK_EXT_PIPELINE_CREATION_FEEDBACK_EXTENSION_NAME);
 
 	VkDeviceCreateInfo deviceCreateInfo = { /* sType                   */ VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
 		                                    /* pNext                   */ nullptr,
@@ -669,6 +673,8 @@ bool Initialize(const GraphicsAPIInitArguments& initArguments)
 	};
 	CheckRes(vkCreateCommandPool(ctx.device, &mainCommandPoolCreateInfo, nullptr, &ctx.mainCommandPool));
 
+	InitPipelineCache(currentDeviceProperties);
+
 	// Creates the debug messenger
 	if (ctx.hasDebugUtils)
 	{
@@ -834,12 +840,14 @@ void Shutdown()
 {
 	vkDeviceWaitIdle(ctx.device);
 
+	WaitForPipelineCompilation();
 	ProcessPendingInitBuffers(true);
 
 	CachedDescriptorSetLayout::DestroyCached();
 	DestroySamplers();
 	DestroyRenderPasses();
 	DestroyDefaultFramebuffer();
+	SaveAndDestroyPipelineCache();
 
 	for (uint32_t i = 0; i < MAX_CONCURRENT_FRAMES; i++)
 	{
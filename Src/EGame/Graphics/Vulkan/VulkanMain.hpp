@@ -12,6 +12,8 @@ bool Initialize(const GraphicsAPIInitArguments& initArguments);
 
 GraphicsMemoryStat GetMemoryStat();
 
+PipelineCacheStat GetPipelineCacheStat();
+
 void MaybeAcquireSwapchainImage();
 
 #define XM_ABSCALLBACK(name, ret, params) ret name params;
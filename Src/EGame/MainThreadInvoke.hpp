@@ -12,6 +12,8 @@ namespace detail
 {
 struct MTIBase
 {
+	virtual ~MTIBase() = default;
+
 	virtual void Invoke() = 0;
 
 	MTIBase* next = nullptr;
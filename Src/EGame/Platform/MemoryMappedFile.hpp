@@ -0,0 +1,51 @@
+#pragma once
+
+#ifndef __EMSCRIPTEN__
+
+#include "../API.hpp"
+
+#include <cstddef>
+#include <span>
+
+namespace eg
+{
+// Read-only mapping of an entire file into the address space of the process.
+class EG_API MemoryMappedFile
+{
+public:
+	MemoryMappedFile() = default;
+
+	~MemoryMappedFile() { Close(); }
+
+	MemoryMappedFile(MemoryMappedFile&& other) noexcept : m_data(other.m_data), m_size(other.m_size)
+	{
+		other.m_data = nullptr;
+		other.m_size = 0;
+	}
+
+	MemoryMappedFile& operator=(MemoryMappedFile&& other) noexcept
+	{
+		Close();
+		m_data = other.m_data;
+		m_size = other.m_size;
+		other.m_data = nullptr;
+		other.m_size = 0;
+		return *this;
+	}
+
+	// Maps the file at path, returns false if the file could not be opened or is empty.
+	bool Open(const char* path);
+
+	void Close();
+
+	bool IsOpen() const { return m_data != nullptr; }
+
+	std::span<const char> Data() const { return std::span<const char>(m_data, m_size); }
+
+private:
+	const char* m_data = nullptr;
+	size_t m_size = 0;
+};
+} // namespace eg
+
+#endif
@@ -0,0 +1,52 @@
+#if defined(__linux__) || defined(__APPLE__)
+
+#include "MemoryMappedFile.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace eg
+{
+bool MemoryMappedFile::Open(const char* path)
+{
+	Close();
+
+	int fd = open(path, O_RDONLY);
+	if (fd == -1)
+		return false;
+
+	struct stat attrib;
+	if (fstat(fd, &attrib) != 0 || attrib.st_size <= 0)
+	{
+		close(fd);
+		return false;
+	}
+
+	const size_t size = static_cast<size_t>(attrib.st_size);
+	void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping keeps its own reference to the file, so the descriptor is not needed anymore
+	close(fd);
+
+	if (data == MAP_FAILED)
+		return false;
+
+	m_data = static_cast<const char*>(data);
+	m_size = size;
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (m_data != nullptr)
+	{
+		munmap(const_cast<char*>(m_data), m_size);
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
+} // namespace eg
+
+#endif
@@ -0,0 +1,53 @@
+#ifdef _WIN32
+
+#include "MemoryMappedFile.hpp"
+
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+
+namespace eg
+{
+bool MemoryMappedFile::Open(const char* path)
+{
+	Close();
+
+	HANDLE file =
+		CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart <= 0)
+	{
+		CloseHandle(file);
+		return false;
+	}
+
+	HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	CloseHandle(file);
+	if (mapping == nullptr)
+		return false;
+
+	// The view keeps the mapping object alive, so the handle can be closed right away
+	void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(mapping);
+	if (data == nullptr)
+		return false;
+
+	m_data = static_cast<const char*>(data);
+	m_size = static_cast<size_t>(fileSize.QuadPart);
+	return true;
+}
+
+void MemoryMappedFile::Close()
+{
+	if (m_data != nullptr)
+	{
+		UnmapViewOfFile(m_data);
+		m_data = nullptr;
+		m_size = 0;
+	}
+}
+} // namespace eg
+
+#endif
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "Assert.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <type_traits>
+
+namespace eg
+{
+template <typename K>
+struct RadixSortItem
+{
+	K key;
+	uint32_t index;
+};
+
+/**
+ * Stable LSD radix sort of items by key, 8 bits per pass. Passes over digits that are the same for every item are
+ * skipped, so keys that only use some of their bits are cheap to sort. scratch must be at least as large as items,
+ * the sorted result always ends up in items.
+ */
+template <typename K>
+void RadixSort(std::span<RadixSortItem<K>> items, std::span<RadixSortItem<K>> scratch)
+{
+	static_assert(std::is_unsigned_v<K>);
+	constexpr uint32_t NUM_PASSES = sizeof(K);
+
+	EG_ASSERT(scratch.size() >= items.size());
+	if (items.size() <= 1)
+		return;
+
+	// Counts digits for all passes at once
+	std::array<std::array<uint32_t, 256>, NUM_PASSES> counts = {};
+	for (const RadixSortItem<K>& item : items)
+	{
+		for (uint32_t pass = 0; pass < NUM_PASSES; pass++)
+			counts[pass][(item.key >> (pass * 8)) & 0xFF]++;
+	}
+
+	RadixSortItem<K>* src = items.data();
+	RadixSortItem<K>* dst = scratch.data();
+	for (uint32_t pass = 0; pass < NUM_PASSES; pass++)
+	{
+		const uint32_t shift = pass * 8;
+		if (counts[pass][(src[0].key >> shift) & 0xFF] == items.size())
+			continue;
+
+		std::array<uint32_t, 256> offsets;
+		uint32_t offset = 0;
+		for (uint32_t digit = 0; digit < 256; digit++)
+		{
+			offsets[digit] = offset;
+			offset += counts[pass][digit];
+		}
+
+		for (size_t i = 0; i < items.size(); i++)
+			dst[offsets[(src[i].key >> shift) & 0xFF]++] = src[i];
+
+		std::swap(src, dst);
+	}
+
+	if (src != items.data())
+		std::copy_n(src, items.size(), items.data());
+}
+
+// Maps a float to an unsigned integer with the same ordering, for radix sorting by float keys
+inline uint32_t FloatToSortableBits(float value)
+{
+	uint32_t bits;
+	std::memcpy(&bits, &value, sizeof(bits));
+	return (bits & 0x80000000U) ? ~bits : (bits | 0x80000000U);
+}
+} // namespace eg
@@ -5,10 +5,25 @@
 #include <emmintrin.h>
 #include <smmintrin.h>
 
+// Compiles a function for instruction set extensions beyond the baseline, which must be checked for at runtime
+#define EG_SIMD_TARGET(targets) __attribute__((target(targets)))
+
 namespace eg
 {
 using m128 = __m128;
+
+inline bool CPUSupportsSSE41()
+{
+	static const bool supported = __builtin_cpu_supports("sse4.1");
+	return supported;
+}
+
+inline bool CPUSupportsAVX2()
+{
+	static const bool supported = __builtin_cpu_supports("avx2");
+	return supported;
 }
+} // namespace eg
 
 namespace eg::sse
 {
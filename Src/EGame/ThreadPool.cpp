@@ -0,0 +1,153 @@
+#include "ThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+namespace eg
+{
+ThreadPool::ThreadPool(uint32_t numWorkers)
+{
+#ifndef __EMSCRIPTEN__
+	m_workers.reserve(numWorkers);
+	for (uint32_t i = 0; i < numWorkers; i++)
+		m_workers.emplace_back(&ThreadPool::WorkerTarget, this);
+#endif
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_taskAddedSignal.notify_all();
+
+	// Workers drain the queue before exiting, so no added task is lost
+	for (std::thread& worker : m_workers)
+		worker.join();
+}
+
+uint32_t ThreadPool::DefaultNumWorkers()
+{
+#ifdef __EMSCRIPTEN__
+	return 0;
+#else
+	// Leaves one hardware thread for the thread that owns the pool
+	return std::max(std::thread::hardware_concurrency(), 2U) - 1;
+#endif
+}
+
+void ThreadPool::Add(std::function<void()> task)
+{
+	if (m_workers.empty())
+	{
+		task();
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tasks.push_back(std::move(task));
+	}
+	m_taskAddedSignal.notify_one();
+}
+
+void ThreadPool::RunFrontTask(std::unique_lock<std::mutex>& lock)
+{
+	std::function<void()> task = std::move(m_tasks.front());
+	m_tasks.pop_front();
+	m_runningTasks++;
+
+	lock.unlock();
+	task();
+	lock.lock();
+
+	m_runningTasks--;
+	if (m_runningTasks == 0 && m_tasks.empty())
+		m_idleSignal.notify_all();
+}
+
+void ThreadPool::WorkerTarget()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		m_taskAddedSignal.wait(lock, [&] { return m_stop || !m_tasks.empty(); });
+		if (m_tasks.empty())
+			return;
+		RunFrontTask(lock);
+	}
+}
+
+void ThreadPool::Wait()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (true)
+	{
+		if (!m_tasks.empty())
+			RunFrontTask(lock);
+		else if (m_runningTasks != 0)
+			m_idleSignal.wait(lock);
+		else
+			break;
+	}
+}
+
+struct ParallelForState
+{
+	std::atomic<size_t> nextRange{ 0 };
+	std::atomic<size_t> completedRanges{ 0 };
+};
+
+void ThreadPool::ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& callback)
+{
+	grainSize = std::max<size_t>(grainSize, 1);
+	const size_t numRanges = (count + grainSize - 1) / grainSize;
+
+	if (numRanges <= 1 || m_workers.empty())
+	{
+		for (size_t begin = 0; begin < count; begin += grainSize)
+			callback(begin, std::min(begin + grainSize, count));
+		return;
+	}
+
+	// The state is shared with the helper tasks since a helper may start after all ranges have been claimed
+	//  and this function has returned. The callback is only accessed while a range is claimed.
+	auto state = std::make_shared<ParallelForState>();
+	auto RunRanges = [state, count, grainSize, numRanges, callback = &callback]
+	{
+		while (true)
+		{
+			const size_t range = state->nextRange.fetch_add(1);
+			if (range >= numRanges)
+				return;
+
+			const size_t begin = range * grainSize;
+			(*callback)(begin, std::min(begin + grainSize, count));
+
+			if (state->completedRanges.fetch_add(1) + 1 == numRanges)
+				state->completedRanges.notify_all();
+		}
+	};
+
+	const size_t numHelpers = std::min<size_t>(m_workers.size(), numRanges - 1);
+	for (size_t i = 0; i < numHelpers; i++)
+		Add(RunRanges);
+
+	RunRanges();
+
+	size_t completedRanges = state->completedRanges.load();
+	while (completedRanges != numRanges)
+	{
+		state->completedRanges.wait(completedRanges);
+		completedRanges = state->completedRanges.load();
+	}
+}
+
+ThreadPool& SharedThreadPool()
+{
+	static ThreadPool pool;
+	return pool;
+}
+} // namespace eg
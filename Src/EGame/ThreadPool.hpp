@@ -0,0 +1,63 @@
+#pragma once
+
+#include "API.hpp"
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace eg
+{
+// Fixed size pool of worker threads that run queued tasks in the order they were added.
+//  Without thread support (emscripten) the pool has no workers and tasks run inline on the calling thread.
+class EG_API ThreadPool
+{
+public:
+	explicit ThreadPool(uint32_t numWorkers = DefaultNumWorkers());
+
+	~ThreadPool();
+
+	ThreadPool(ThreadPool&&) = delete;
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(ThreadPool&&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	void Add(std::function<void()> task);
+
+	// Runs queued tasks on the calling thread until every task added so far has completed.
+	void Wait();
+
+	/**
+	 * Invokes callback(begin, end) for consecutive ranges covering [0, count), each with at most grainSize elements.
+	 * The ranges are distributed over the workers and the calling thread, returns once all of them have completed.
+	 */
+	void ParallelFor(size_t count, size_t grainSize, const std::function<void(size_t, size_t)>& callback);
+
+	uint32_t NumWorkers() const { return static_cast<uint32_t>(m_workers.size()); }
+
+	static uint32_t DefaultNumWorkers();
+
+private:
+	void WorkerTarget();
+
+	void RunFrontTask(std::unique_lock<std::mutex>& lock);
+
+	std::mutex m_mutex;
+	std::condition_variable m_taskAddedSignal;
+	std::condition_variable m_idleSignal;
+
+	std::deque<std::function<void()>> m_tasks;
+	uint32_t m_runningTasks = 0;
+	bool m_stop = false;
+
+	std::vector<std::thread> m_workers;
+};
+
+// Pool shared by engine systems that do not need a dedicated one, created on first use.
+EG_API ThreadPool& SharedThreadPool();
+} // namespace eg
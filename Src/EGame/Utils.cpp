@@ -23,7 +23,9 @@ void ParseCommandLineArgs(RunConfig& runConfig, int argc, char** argv)
 					 "  --gl     Force rendering with OpenGL"
 				  << LineEnd(runConfig.graphicsAPI == eg::GraphicsAPI::OpenGL)
 				  << "  --vk     Force rendering with Vulkan"
-				  << LineEnd(runConfig.graphicsAPI == eg::GraphicsAPI::Vulkan) << "  --igpu   Prefer integrated GPU"
+				  << LineEnd(runConfig.graphicsAPI == eg::GraphicsAPI::Vulkan)
+				  << "  --null   Use the headless null graphics backend"
+				  << LineEnd(runConfig.graphicsAPI == eg::GraphicsAPI::Null) << "  --igpu   Prefer integrated GPU"
 				  << LineEndDefWithFlag(RunFlags::PreferIntegratedGPU) << "  --dgpu   Prefer dedicated GPU"
 				  << LineEndDefWithoutFlag(RunFlags::PreferIntegratedGPU)
 				  << "  --gles   Prefer GLES path when using OpenGL" << LineEndDefWithFlag(RunFlags::PreferGLESPath)
@@ -44,6 +46,8 @@ void ParseCommandLineArgs(RunConfig& runConfig, int argc, char** argv)
 			runConfig.graphicsAPI = eg::GraphicsAPI::OpenGL;
 		else if (arg == "--vk")
 			runConfig.graphicsAPI = eg::GraphicsAPI::Vulkan;
+		else if (arg == "--null")
+			runConfig.graphicsAPI = eg::GraphicsAPI::Null;
 		else if (arg == "--igpu")
 			runConfig.flags |= RunFlags::PreferIntegratedGPU;
 		else if (arg == "--dgpu")